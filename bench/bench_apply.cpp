@@ -0,0 +1,126 @@
+/*
+ * 静默注册表导入程序 - 差异导入基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_apply [--keys N] [--values N] [--changed PERCENT]
+ * 在内存后端上重复应用同一组写操作，比较直接写入与读取比较后写入：
+ * 吞吐量、实际写入次数和跳过次数
+ */
+
+#include "reg_apply.h"
+#include "reg_encoding.h"
+#include "reg_hive.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 生成模拟策略文件的写操作：每个键一个[key]加若干值
+static std::vector<RegOp> GenerateOps(size_t keys, size_t valuesPerKey, unsigned salt, size_t changedPercent) {
+    std::vector<RegOp> ops;
+    unsigned seed = 2024;
+    for (size_t k = 0; k < keys; k++) {
+        RegOp op;
+        op.kind = RegOpCreateKey;
+        op.keyPath = "HKEY_LOCAL_MACHINE\\SOFTWARE\\Policies\\Vendor\\Product" + std::to_string(k / 64) +
+                     "\\Setting" + std::to_string(k);
+        ops.push_back(op);
+        for (size_t v = 0; v < valuesPerKey; v++) {
+            seed = seed * 1103515245u + 12345u;
+            bool changed = ((seed >> 16) % 100) < changedPercent;
+            op.kind = RegOpSetValue;
+            op.valueName = "Value" + std::to_string(v);
+            op.data.clear();
+            if (v % 2 == 0) {
+                uint32_t dword = static_cast<uint32_t>(k * 31 + v) + (changed ? salt : 0);
+                op.type = kRegDword;
+                op.data.resize(4);
+                std::memcpy(op.data.data(), &dword, 4);
+            } else {
+                std::string text = "C:\\Program Files\\Vendor\\Product\\" + std::to_string(k) +
+                                   (changed ? "-" + std::to_string(salt) : std::string());
+                op.type = kRegSz;
+                Utf8ToUtf16Le(text.data(), text.size(), &op.data);
+                op.data.push_back(0);
+                op.data.push_back(0);
+            }
+            ops.push_back(op);
+        }
+    }
+    return ops;
+}
+
+// 统计实际落到后端的写入次数
+class CountingBackend : public RegHive {
+public:
+    CountingBackend() : setCalls(0) {}
+
+    long SetValue(RegKeyHandle key, const std::string& name, uint32_t type, const uint8_t* data, size_t size) override {
+        setCalls++;
+        return RegHive::SetValue(key, name, type, data, size);
+    }
+
+    size_t setCalls;
+};
+
+static double ApplyAll(RegBackend& backend, const std::vector<RegOp>& ops, bool onlyDifferences,
+                       RegApplyStats* stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RegApplier applier(backend, onlyDifferences);
+    for (size_t i = 0; i < ops.size(); i++) {
+        applier.Apply(ops[i]);
+    }
+    applier.CloseCurrentKey();
+    *stats = applier.GetStats();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void Report(const char* name, size_t opCount, double seconds, const RegApplyStats& stats, size_t setCalls) {
+    std::printf("  %-28s %10.0f ops/s  written=%zu skipped=%zu backend writes=%zu\n", name,
+                static_cast<double>(opCount) / seconds, stats.valuesWritten, stats.valuesSkipped, setCalls);
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 20000;
+    size_t valuesPerKey = 8;
+    size_t changedPercent = 5;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        size_t value = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        if (arg == "--keys") {
+            keys = value;
+        } else if (arg == "--values") {
+            valuesPerKey = value;
+        } else if (arg == "--changed") {
+            changedPercent = value;
+        }
+    }
+
+    std::vector<RegOp> baseline = GenerateOps(keys, valuesPerKey, 0, 0);
+    std::vector<RegOp> update = GenerateOps(keys, valuesPerKey, 7, changedPercent);
+    std::printf("%zu keys x %zu values, %zu%% changed on re-apply\n", keys, valuesPerKey, changedPercent);
+
+    RegApplyStats stats;
+    for (int mode = 0; mode < 2; mode++) {
+        bool onlyDifferences = mode == 1;
+        std::printf("%s:\n", onlyDifferences ? "read-compare-write" : "blind write");
+
+        CountingBackend backend;
+        double t = ApplyAll(backend, baseline, onlyDifferences, &stats);
+        Report("initial apply", baseline.size(), t, stats, backend.setCalls);
+
+        backend.setCalls = 0;
+        t = ApplyAll(backend, baseline, onlyDifferences, &stats);
+        Report("re-apply identical", baseline.size(), t, stats, backend.setCalls);
+
+        backend.setCalls = 0;
+        t = ApplyAll(backend, update, onlyDifferences, &stats);
+        Report("re-apply partly changed", update.size(), t, stats, backend.setCalls);
+    }
+    return 0;
+}
@@ -0,0 +1,320 @@
+/*
+ * 静默注册表导入程序 - 基准测试语料生成
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 按参数生成确定的合成.reg文件集合，供基准测试共用：
+ * - 每个文件是HKLM\SOFTWARE\BenchCorpus\FileNNN下一棵深度和宽度固定的子树，每个键若干个值
+ * - 值类型按权重混合（sz、expand_sz、dword、qword、binary、multi_sz），字符串和二进制值的长度
+ *   在平均长度的0~2倍之间随机；长hex数据按regedit的方式折行
+ * - REGEDIT5（UTF-16LE，字符串含非ASCII字符）或REGEDIT4（ANSI）
+ * - 使用自带的splitmix64随机数，同一参数和种子在任何平台上生成逐字节相同的语料，
+ *   语料指纹（xxHash64）写入结果，基线只与相同语料的结果比较
+ */
+
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include "reg_encoding.h"
+#include "reg_hash.h"
+#include "reg_types.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// 值类型混合的顺序
+enum RegCorpusValueKind {
+    kCorpusSz = 0,
+    kCorpusExpandSz,
+    kCorpusDword,
+    kCorpusQword,
+    kCorpusBinary,
+    kCorpusMultiSz,
+    kCorpusKindCount
+};
+
+static const char* const kCorpusKindNames[kCorpusKindCount] = {"sz", "expand_sz", "dword", "qword", "binary",
+                                                               "multi_sz"};
+
+// 语料参数
+struct RegCorpusConfig {
+    size_t files;
+    size_t depth;           // 文件根键之下的层数
+    size_t fanout;          // 每个键的子键数
+    size_t values;          // 每个键的值数
+    size_t valueSize;       // 字符串和二进制值的平均字节数
+    bool ansi;              // true为REGEDIT4（ANSI），否则为REGEDIT5（UTF-16LE）
+    uint64_t seed;
+    unsigned mix[kCorpusKindCount];     // 各类型的权重
+
+    RegCorpusConfig() : files(16), depth(4), fanout(6), values(4), valueSize(24), ansi(false), seed(1) {
+        const unsigned defaults[kCorpusKindCount] = {40, 5, 25, 5, 15, 10};
+        for (size_t i = 0; i < kCorpusKindCount; i++) {
+            mix[i] = defaults[i];
+        }
+    }
+
+    // 解析"sz=40,dword=25,..."形式的权重，未列出的类型权重为0
+    bool ParseMix(const std::string& text) {
+        unsigned parsed[kCorpusKindCount] = {0, 0, 0, 0, 0, 0};
+        unsigned total = 0;
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = text.find(',', begin);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+            std::string item = text.substr(begin, end - begin);
+            size_t equals = item.find('=');
+            if (equals == std::string::npos) {
+                return false;
+            }
+            std::string name = item.substr(0, equals);
+            size_t kind = 0;
+            while (kind < kCorpusKindCount && name != kCorpusKindNames[kind]) {
+                kind++;
+            }
+            if (kind == kCorpusKindCount) {
+                return false;
+            }
+            parsed[kind] = static_cast<unsigned>(std::strtoul(item.c_str() + equals + 1, NULL, 10));
+            total += parsed[kind];
+            begin = end + 1;
+        }
+        if (total == 0) {
+            return false;
+        }
+        for (size_t i = 0; i < kCorpusKindCount; i++) {
+            mix[i] = parsed[i];
+        }
+        return true;
+    }
+
+    std::string FormatMix() const {
+        std::string text;
+        for (size_t i = 0; i < kCorpusKindCount; i++) {
+            if (mix[i] > 0) {
+                text += (text.empty() ? "" : ",") + std::string(kCorpusKindNames[i]) + "=" + std::to_string(mix[i]);
+            }
+        }
+        return text;
+    }
+};
+
+// 一个生成的文件
+struct RegCorpusFile {
+    std::string name;       // 如 corpus_003.reg
+    std::string bytes;      // 文件内容（含BOM和文件头）
+};
+
+// 生成的语料及其内容统计
+struct RegCorpus {
+    std::vector<RegCorpusFile> files;
+    size_t bytes;
+    size_t keys;
+    size_t values;
+    uint64_t fingerprint;   // 所有文件内容的哈希
+
+    RegCorpus() : bytes(0), keys(0), values(0), fingerprint(0) {}
+};
+
+// 语料生成器
+class RegCorpusGenerator {
+public:
+    explicit RegCorpusGenerator(const RegCorpusConfig& config) : m_config(config), m_state(config.seed) {
+        m_mixTotal = 0;
+        for (size_t i = 0; i < kCorpusKindCount; i++) {
+            m_mixTotal += config.mix[i];
+        }
+    }
+
+    void Generate(RegCorpus* corpus) {
+        char name[32];
+        for (size_t f = 0; f < m_config.files; f++) {
+            m_text.assign(m_config.ansi ? "REGEDIT4\r\n" : "Windows Registry Editor Version 5.00\r\n");
+            std::snprintf(name, sizeof(name), "File%03zu", f);
+            GenerateKey("HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchCorpus\\" + std::string(name), 0, corpus);
+
+            RegCorpusFile file;
+            std::snprintf(name, sizeof(name), "corpus_%03zu.reg", f);
+            file.name = name;
+            if (m_config.ansi) {
+                file.bytes.swap(m_text);
+            } else {
+                std::vector<uint8_t> utf16;
+                utf16.push_back(0xFF);
+                utf16.push_back(0xFE);
+                Utf8ToUtf16Le(m_text.data(), m_text.size(), &utf16);
+                file.bytes.assign(reinterpret_cast<const char*>(utf16.data()), utf16.size());
+            }
+            corpus->bytes += file.bytes.size();
+            corpus->fingerprint = RegHash64::Hash(file.bytes.data(), file.bytes.size(), corpus->fingerprint);
+            corpus->files.push_back(file);
+        }
+    }
+
+private:
+    // splitmix64：输出只取决于种子
+    uint64_t Next() {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    size_t Below(size_t limit) { return limit == 0 ? 0 : static_cast<size_t>(Next() % limit); }
+
+    // 平均长度为valueSize的随机长度（至少1）
+    size_t RandomSize() { return 1 + Below(m_config.valueSize * 2); }
+
+    void GenerateKey(const std::string& path, size_t level, RegCorpus* corpus) {
+        m_text += "\r\n[" + path + "]\r\n";
+        corpus->keys++;
+        for (size_t v = 0; v < m_config.values; v++) {
+            GenerateValue(v);
+            corpus->values++;
+        }
+        if (level == m_config.depth) {
+            return;
+        }
+        char name[32];
+        for (size_t c = 0; c < m_config.fanout; c++) {
+            std::snprintf(name, sizeof(name), "\\Node%zu_%02x", c, static_cast<unsigned>(Below(256)));
+            GenerateKey(path + name, level + 1, corpus);
+        }
+    }
+
+    void GenerateValue(size_t index) {
+        // 第一个值有1/8的概率是默认值
+        std::string name;
+        if (index == 0 && Below(8) == 0) {
+            name = "@";
+        } else {
+            name = "\"Value" + std::to_string(index) + "_" + std::to_string(Below(1000)) + "\"";
+        }
+        size_t pick = Below(m_mixTotal);
+        size_t kind = 0;
+        while (pick >= m_config.mix[kind]) {
+            pick -= m_config.mix[kind];
+            kind++;
+        }
+        m_text += name;
+        m_text += '=';
+        switch (kind) {
+            case kCorpusSz: {
+                std::string text = RandomText(RandomSize());
+                m_text += '"';
+                for (size_t i = 0; i < text.size(); i++) {
+                    if (text[i] == '\\' || text[i] == '"') {
+                        m_text += '\\';
+                    }
+                    m_text += text[i];
+                }
+                m_text += "\"\r\n";
+                break;
+            }
+            case kCorpusExpandSz: {
+                std::string text = "%SystemRoot%\\System32\\" + RandomText(RandomSize()) + ".dll";
+                std::vector<uint8_t> data;
+                AppendStringData(text, &data);
+                AppendHex("hex(2):", name.size() + 1, data);
+                break;
+            }
+            case kCorpusDword: {
+                char number[16];
+                std::snprintf(number, sizeof(number), "dword:%08x", static_cast<unsigned>(Next() & 0xFFFFFFFFu));
+                m_text += number;
+                m_text += "\r\n";
+                break;
+            }
+            case kCorpusQword: {
+                std::vector<uint8_t> data(8);
+                uint64_t number = Next();
+                for (size_t i = 0; i < 8; i++) {
+                    data[i] = static_cast<uint8_t>(number >> (i * 8));
+                }
+                AppendHex("hex(b):", name.size() + 1, data);
+                break;
+            }
+            case kCorpusBinary: {
+                std::vector<uint8_t> data(RandomSize());
+                for (size_t i = 0; i < data.size(); i++) {
+                    data[i] = static_cast<uint8_t>(Next());
+                }
+                AppendHex("hex:", name.size() + 1, data);
+                break;
+            }
+            default: {
+                std::vector<uint8_t> data;
+                size_t count = 1 + Below(4);
+                for (size_t i = 0; i < count; i++) {
+                    AppendStringData(RandomText(1 + Below(m_config.valueSize)), &data);
+                }
+                AppendStringData(std::string(), &data);
+                AppendHex("hex(7):", name.size() + 1, data);
+                break;
+            }
+        }
+    }
+
+    // 随机文本：ASCII字母数字和少量符号，REGEDIT5时混入非ASCII字符（UTF-8）
+    std::string RandomText(size_t size) {
+        static const char ascii[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-.\\\"";
+        static const char* const wide[] = {"\xC3\xA9", "\xC3\xBC", "\xE4\xB8\xAD", "\xE6\x96\x87", "\xCE\xA9"};
+        std::string text;
+        while (text.size() < size) {
+            size_t pick = Below(sizeof(ascii) - 1 + 8);
+            if (pick < sizeof(ascii) - 1) {
+                text += ascii[pick];
+            } else if (!m_config.ansi) {
+                text += wide[Below(sizeof(wide) / sizeof(wide[0]))];
+            } else {
+                text += 'x';
+            }
+        }
+        return text;
+    }
+
+    // 字符串的注册表原始字节（含结尾NUL）：REGEDIT5为UTF-16LE，REGEDIT4为ANSI
+    void AppendStringData(const std::string& text, std::vector<uint8_t>* data) {
+        if (m_config.ansi) {
+            data->insert(data->end(), text.begin(), text.end());
+            data->push_back(0);
+        } else {
+            Utf8ToUtf16Le(text.data(), text.size(), data);
+            data->push_back(0);
+            data->push_back(0);
+        }
+    }
+
+    // 按regedit的格式输出hex数据：每行不超过80列，续行以"  "开头
+    void AppendHex(const char* prefix, size_t column, const std::vector<uint8_t>& data) {
+        static const char digits[] = "0123456789abcdef";
+        m_text += prefix;
+        column += std::strlen(prefix);
+        for (size_t i = 0; i < data.size(); i++) {
+            m_text += digits[data[i] >> 4];
+            m_text += digits[data[i] & 0x0F];
+            column += 2;
+            if (i + 1 < data.size()) {
+                m_text += ',';
+                column++;
+                if (column >= 76) {
+                    m_text += "\\\r\n  ";
+                    column = 2;
+                }
+            }
+        }
+        m_text += "\r\n";
+    }
+
+    RegCorpusConfig m_config;
+    uint64_t m_state;
+    size_t m_mixTotal;
+    std::string m_text;
+};
+
+#endif // BENCH_CORPUS_H
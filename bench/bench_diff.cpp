@@ -0,0 +1,336 @@
+/*
+ * 静默注册表导入程序 - 结构化差异基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_diff [--keys N] [--changes C] [--memory-mb M] [--jobs J] [--dir D]
+ * 在内存配置单元中构造N个键（每键4个值）的树并导出为A.reg，随机修改（改值、改类型、加值、删值、
+ * 加空键和嵌套键、删子树）后导出为B.reg，再生成在B之后追加[-key]、重建键和重复写值的C.reg：
+ * - 比较A.reg与B.reg（内存上限M，强制写出有序段）、不限内存时的同一比较、配置单元A与B.reg、A.reg与C.reg，
+ *   输出各阶段耗时、吞吐量、有序段数和内存峰值
+ * - 校验：不同内存上限和线程数、文件与注册表来源生成的补丁逐字节相同
+ * - 校验：A.reg依次导入配置单元后再导入补丁，结果与B.reg（或C.reg）导入后的配置单元逐键逐值相同
+ * - 校验：相同来源的差异为空
+ * 临时文件和生成的.reg写在D下（默认/tmp）
+ */
+
+#include "reg_diff.h"
+#include "reg_export.h"
+#include "reg_hive.h"
+#include "reg_parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+static const char kRoot[] = "HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchDiff";
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void SetText(RegHive* hive, RegKeyHandle key, const std::string& name, const std::string& text,
+                    uint32_t type = kRegSz) {
+    std::vector<uint8_t> data;
+    Utf8ToUtf16Le(text.data(), text.size(), &data);
+    data.push_back(0);
+    data.push_back(0);
+    hive->SetValue(key, name, type, data.data(), data.size());
+}
+
+static std::vector<std::string> BuildTree(RegHive* hive, size_t keys) {
+    std::vector<std::string> paths;
+    char path[200];
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(path, sizeof(path), "%s\\Group%02zu\\Sub%02zu\\Item%07zu", kRoot, k % 64, (k / 64) % 16, k);
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        SetText(hive, key, "", "C:\\Program Files\\Vendor\\component.dll");
+        uint32_t flags = static_cast<uint32_t>(k * 2654435761u);
+        hive->SetValue(key, "Flags", kRegDword, reinterpret_cast<const uint8_t*>(&flags), 4);
+        SetText(hive, key, "Name", "Item \"" + std::to_string(k) + "\"");
+        std::vector<uint8_t> blob(16 + k % 48);
+        for (size_t i = 0; i < blob.size(); i++) {
+            blob[i] = static_cast<uint8_t>(k * 31 + i);
+        }
+        hive->SetValue(key, "Blob", kRegBinary, blob.data(), blob.size());
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+// 在随机的深层键上修改：改值、改类型、加值、删值、加空键、加嵌套键、删子树
+static void Mutate(RegHive* hive, const std::vector<std::string>& paths, size_t changes, uint32_t seed) {
+    uint32_t state = seed;
+    for (size_t i = 0; i < changes; i++) {
+        state = state * 1103515245u + 12345u;
+        const std::string& path = paths[(state >> 8) % paths.size()];
+        RegKeyHandle key = NULL;
+        if (hive->OpenKey(path, &key) != kRegSuccess) {
+            continue;
+        }
+        uint32_t value = state;
+        switch (i % 7) {
+        case 0:
+            hive->SetValue(key, "Flags", kRegDword, reinterpret_cast<const uint8_t*>(&value), 4);
+            break;
+        case 1:
+            SetText(hive, key, "Added\\" + std::to_string(i), "new value");
+            break;
+        case 2:
+            hive->DeleteValue(key, "Name");
+            break;
+        case 3:
+            SetText(hive, key, "", "%ProgramFiles%\\Vendor\\component.dll", kRegExpandSz);
+            break;
+        case 4: {
+            RegKeyHandle child = NULL;
+            hive->CreateKey(path + "\\New" + std::to_string(i) + "\\Nested", &child);
+            SetText(hive, child, "", "nested");
+            break;
+        }
+        case 5: {
+            RegKeyHandle child = NULL;
+            hive->CreateKey(path + "\\Empty" + std::to_string(i), &child);
+            break;
+        }
+        default:
+            hive->DeleteKeyTree(path);
+            break;
+        }
+    }
+}
+
+static bool ExportHive(RegHive& hive, const std::string& file) {
+    std::ofstream out(file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    RegExporter exporter(hive, [&out](const uint8_t* data, size_t size) {
+        out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(out);
+    });
+    std::string error;
+    std::vector<std::string> roots(1, kRoot);
+    bool exported = exporter.Export(roots, &error);
+    out.close();
+    return exported && out;
+}
+
+// 把ASCII文本以UTF-16LE追加到.reg文件末尾
+static void AppendText(const std::string& file, const std::string& text) {
+    std::vector<uint8_t> data;
+    Utf8ToUtf16Le(text.data(), text.size(), &data);
+    std::ofstream out(file.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+// 配置单元的全部键和值（路径和值名折叠为大写）
+typedef std::map<std::string, std::map<std::string, std::pair<uint32_t, std::vector<uint8_t> > > > TreeDump;
+
+static std::string Upper(const std::string& text) {
+    std::string result(text);
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i] = RegAsciiUpper(result[i]);
+    }
+    return result;
+}
+
+static void Dump(RegBackend& backend, const std::string& path, TreeDump* dump) {
+    RegKeyHandle key = NULL;
+    if (backend.OpenKey(path, &key) != kRegSuccess) {
+        return;
+    }
+    std::map<std::string, std::pair<uint32_t, std::vector<uint8_t> > >& values = (*dump)[Upper(path)];
+    std::string name;
+    uint32_t type = 0;
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; backend.EnumValue(key, i, &name, &type, &data) == kRegSuccess; i++) {
+        values[Upper(name)] = std::make_pair(type, data);
+    }
+    std::vector<std::string> children;
+    for (uint32_t i = 0; backend.EnumSubKey(key, i, &name) == kRegSuccess; i++) {
+        children.push_back(name);
+    }
+    backend.CloseKey(key);
+    for (size_t i = 0; i < children.size(); i++) {
+        Dump(backend, path + "\\" + children[i], dump);
+    }
+}
+
+static void NoAnsi(const char* data, size_t size, std::string* out) { out->append(data, size); }
+
+// 一个来源：.reg文件路径，或配置单元（file为空时）
+struct DiffInput {
+    std::string file;
+    RegBackend* hive;
+};
+
+struct DiffRun {
+    std::string patch;
+    RegDiffStats stats;
+    double loadSeconds;
+    double mergeSeconds;
+    size_t records;
+    size_t runs;
+    size_t peakMemory;
+    bool ok;
+};
+
+static DiffRun RunDiff(const DiffInput& from, const DiffInput& to, size_t memoryLimit, size_t jobs,
+                       const std::string& dir) {
+    DiffRun run;
+    run.ok = true;
+    std::string error;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RegDiffSource a(dir + "/bench_diff_from_", memoryLimit);
+    RegDiffSource b(dir + "/bench_diff_to_", memoryLimit);
+    const DiffInput* inputs[2] = {&from, &to};
+    RegDiffSource* sources[2] = {&a, &b};
+    for (int i = 0; i < 2 && run.ok; i++) {
+        if (inputs[i]->file.empty()) {
+            run.ok = sources[i]->AddSubtree(*inputs[i]->hive, std::vector<std::string>(1, kRoot), jobs, &error);
+        } else {
+            run.ok = sources[i]->AddRegFile(inputs[i]->file, NoAnsi, &error);
+        }
+        run.ok = run.ok && sources[i]->Finish(&error);
+    }
+    run.loadSeconds = Seconds(start);
+    start = std::chrono::steady_clock::now();
+    std::string& patch = run.patch;
+    RegDiffWriter writer([&patch](const uint8_t* data, size_t size) {
+        patch.append(reinterpret_cast<const char*>(data), size);
+        return true;
+    });
+    run.ok = run.ok && writer.Diff(a, b, &error);
+    run.mergeSeconds = Seconds(start);
+    if (!run.ok) {
+        std::printf("  diff failed: %s\n", error.c_str());
+    }
+    run.stats = writer.GetStats();
+    run.records = a.GetSorter().GetRecordCount() + b.GetSorter().GetRecordCount();
+    run.runs = a.GetSorter().GetRunCount() + b.GetSorter().GetRunCount();
+    run.peakMemory = std::max(a.GetSorter().GetPeakMemory(), b.GetSorter().GetPeakMemory());
+    return run;
+}
+
+static void PrintRun(const char* label, const DiffRun& run) {
+    const RegDiffStats& s = run.stats;
+    double total = run.loadSeconds + run.mergeSeconds;
+    std::printf("%s:\n", label);
+    std::printf("  sort %.3f s + merge %.3f s = %.3f s, %zu records (%.2f M records/s), %zu runs, peak %.1f MB\n",
+                run.loadSeconds, run.mergeSeconds, total, run.records, run.records / total / 1e6, run.runs,
+                run.peakMemory / 1048576.0);
+    std::printf("  keys %zu -> %zu: +%zu -%zu ~%zu; values +%zu -%zu ~%zu; patch %zu bytes\n", s.fromKeys, s.toKeys,
+                s.keysAdded, s.keysDeleted, s.keysChanged, s.valuesAdded, s.valuesDeleted, s.valuesChanged, s.bytes);
+}
+
+// 依次导入base和补丁后的配置单元是否与expected导入后的相同
+static bool PatchReproduces(const std::string& base, const std::string& patch, const std::string& patchFile,
+                            const std::string& expected) {
+    std::ofstream out(patchFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(patch.data(), static_cast<std::streamsize>(patch.size()));
+    out.close();
+    std::string error;
+    RegHive patched;
+    RegHive reference;
+    if (!patched.LoadRegFile(base, &error) || !patched.LoadRegFile(patchFile, &error) ||
+        !reference.LoadRegFile(expected, &error)) {
+        std::printf("  load failed: %s\n", error.c_str());
+        return false;
+    }
+    TreeDump left;
+    TreeDump right;
+    Dump(patched, kRoot, &left);
+    Dump(reference, kRoot, &right);
+    return left == right;
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 200000;
+    size_t changes = 2000;
+    size_t memoryMb = 16;
+    size_t jobs = std::max<size_t>(RegDefaultJobCount(), 4);
+    std::string dir = "/tmp";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--keys") {
+            keys = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--changes") {
+            changes = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--memory-mb") {
+            memoryMb = std::max<size_t>(static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10)), 1);
+        } else if (arg == "--jobs") {
+            jobs = std::max<size_t>(static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10)), 1);
+        } else if (arg == "--dir") {
+            dir = argv[i + 1];
+        }
+    }
+    std::string fileA = dir + "/bench_diff_a.reg";
+    std::string fileB = dir + "/bench_diff_b.reg";
+    std::string fileC = dir + "/bench_diff_c.reg";
+    std::string filePatch = dir + "/bench_diff_patch.reg";
+
+    RegHive hiveA;
+    std::vector<std::string> paths = BuildTree(&hiveA, keys);
+    RegHive hiveB;
+    BuildTree(&hiveB, keys);
+    Mutate(&hiveB, paths, changes, 12345);
+    if (!ExportHive(hiveA, fileA) || !ExportHive(hiveB, fileB)) {
+        std::printf("cannot write %s\n", dir.c_str());
+        return 1;
+    }
+    // C：B之后删除一个组再重建其中一个键，重复写同一值，删除后又写回一个值
+    std::string group = std::string(kRoot) + "\\Group01";
+    std::string item = paths[1];
+    std::string other = paths[2];
+    {
+        std::ifstream in(fileB.c_str(), std::ios::in | std::ios::binary);
+        std::ofstream out(fileC.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        out << in.rdbuf();
+    }
+    AppendText(fileC, "\r\n[-" + group + "]\r\n\r\n[" + item + "]\r\n\"Flags\"=dword:00000001\r\n"
+                      "\"Flags\"=dword:00000002\r\n\r\n[" + Upper(other) + "]\r\n\"Name\"=-\r\n\"Extra\"=\"x\"\r\n"
+                      "\"Extra\"=-\r\n\"Blob\"=hex:01,02\r\n\r\n");
+
+    std::printf("%zu keys, %zu changes, %zu MB sort memory, %zu threads\n", keys, changes, memoryMb, jobs);
+    DiffInput a = {fileA, NULL};
+    DiffInput b = {fileB, NULL};
+    DiffInput c = {fileC, NULL};
+    DiffInput live = {std::string(), &hiveA};
+    DiffInput liveB = {std::string(), &hiveB};
+
+    DiffRun spilled = RunDiff(a, b, memoryMb * 1048576, jobs, dir);
+    PrintRun("A.reg -> B.reg (external sort)", spilled);
+    DiffRun inMemory = RunDiff(a, b, static_cast<size_t>(-1), jobs, dir);
+    PrintRun("A.reg -> B.reg (in memory)", inMemory);
+    DiffRun fromLive = RunDiff(live, b, memoryMb * 1048576, jobs, dir);
+    PrintRun("live A -> B.reg", fromLive);
+    DiffRun serialLive = RunDiff(live, b, memoryMb * 1048576, 1, dir);
+    DiffRun deletes = RunDiff(a, c, memoryMb * 1048576, jobs, dir);
+    PrintRun("A.reg -> C.reg (with [-key] and rewrites)", deletes);
+    DiffRun same = RunDiff(b, liveB, memoryMb * 1048576, jobs, dir);
+    PrintRun("B.reg -> live B", same);
+
+    bool ok = spilled.ok && inMemory.ok && fromLive.ok && serialLive.ok && deletes.ok && same.ok;
+    bool identical = spilled.patch == inMemory.patch && spilled.patch == fromLive.patch &&
+                     fromLive.patch == serialLive.patch;
+    std::printf("  external/in-memory, file/live, 1/%zu threads: %s\n", jobs, identical ? "identical" : "DIFFER");
+    bool reproducesB = PatchReproduces(fileA, spilled.patch, filePatch, fileB);
+    std::printf("  A + patch == B: %s\n", reproducesB ? "yes" : "NO");
+    bool reproducesC = PatchReproduces(fileA, deletes.patch, filePatch, fileC);
+    std::printf("  A + patch == C: %s\n", reproducesC ? "yes" : "NO");
+    bool empty = same.stats.Empty();
+    std::printf("  identical sources: %s\n", empty ? "empty patch" : "NOT EMPTY");
+    ok = ok && identical && reproducesB && reproducesC && empty && spilled.runs > 2;
+
+    std::remove(fileA.c_str());
+    std::remove(fileB.c_str());
+    std::remove(fileC.c_str());
+    std::remove(filePatch.c_str());
+    std::printf("%s\n", ok ? "all checks passed" : "CHECK FAILED");
+    return ok ? 0 : 1;
+}
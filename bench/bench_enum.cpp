@@ -0,0 +1,196 @@
+/*
+ * 静默注册表导入程序 - 值枚举分配基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_enum [--keys N] [--values V] [--jobs J]
+ * 在内存配置单元中构造N个键、每键V个值（混有超过4KB的大值），统计：
+ * - 按QueryKeyInfo预留缓冲区后逐值枚举并格式化（引擎本身）
+ * - 完整查询输出（含调试日志）和完整导出
+ * 每种场景报告每秒值数，以及通过替换全局operator new统计的每值/每键分配次数
+ */
+
+#include "reg_export.h"
+#include "reg_hive.h"
+#include "reg_query.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+static std::atomic<size_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+// 丢弃所有输出的流缓冲区，只统计字节数
+class CountingStreamBuf : public std::streambuf {
+public:
+    CountingStreamBuf() : bytes(0) {}
+    size_t bytes;
+
+protected:
+    int overflow(int c) override {
+        bytes++;
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        bytes += static_cast<size_t>(n);
+        return n;
+    }
+};
+
+static void BuildTree(RegHive* hive, size_t keys, size_t values) {
+    std::vector<uint8_t> text;
+    Utf8ToUtf16Le("C:\\Program Files\\Vendor\\Component\\bin\\component.dll", 50, &text);
+    text.push_back(0);
+    text.push_back(0);
+    std::vector<uint8_t> blob(256 * 1024);
+    for (size_t i = 0; i < blob.size(); i++) {
+        blob[i] = static_cast<uint8_t>(i * 31);
+    }
+    char path[128];
+    char name[32];
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(path, sizeof(path), "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Group%03zu\\Item%07zu", k % 512, k);
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        for (size_t v = 0; v < values; v++) {
+            std::snprintf(name, sizeof(name), "Value%02zu", v);
+            switch (v % 4) {
+                case 0:
+                    hive->SetValue(key, name, kRegSz, text.data(), text.size());
+                    break;
+                case 1:
+                    hive->SetValue(key, name, kRegDword, blob.data(), 4);
+                    break;
+                case 2:
+                    hive->SetValue(key, name, kRegBinary, blob.data(), 64);
+                    break;
+                default:
+                    // 每64个键有一个大值（8KB~256KB），超过旧实现的4KB固定缓冲区
+                    hive->SetValue(key, name, kRegBinary, blob.data(),
+                                   k % 64 == 0 ? (8192u << (k / 64 % 6)) : 16);
+                    break;
+            }
+        }
+    }
+}
+
+struct Measurement {
+    double seconds;
+    size_t allocations;
+};
+
+template <typename Function>
+static Measurement Measure(Function function) {
+    size_t before = g_allocations.load();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    function();
+    Measurement result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.allocations = g_allocations.load() - before;
+    return result;
+}
+
+static void Report(const char* label, const Measurement& m, size_t keys, size_t values) {
+    std::printf("%-28s %10.0f values/s  %8.3f allocs/value  %8.2f allocs/key\n", label,
+                static_cast<double>(values) / m.seconds, static_cast<double>(m.allocations) / static_cast<double>(values),
+                static_cast<double>(m.allocations) / static_cast<double>(keys));
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 100000;
+    size_t values = 8;
+    size_t jobs = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--keys") {
+            keys = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--values") {
+            values = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--jobs") {
+            jobs = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        }
+    }
+
+    RegHive hive;
+    BuildTree(&hive, keys, values);
+    size_t keyCount = hive.GetKeyCount();
+    size_t valueCount = hive.GetValueCount();
+    std::printf("hive: %zu keys, %zu values, jobs %zu\n", keyCount, valueCount, jobs);
+
+    // 预先收集键路径，只测量打开、枚举和格式化
+    std::vector<std::string> paths;
+    paths.reserve(keys);
+    char path[128];
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(path, sizeof(path), "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Group%03zu\\Item%07zu", k % 512, k);
+        paths.push_back(path);
+    }
+    RegTraversalContext context;
+    size_t enumerated = 0;
+    size_t largest = 0;
+    size_t formattedBytes = 0;
+    Measurement engine = Measure([&]() {
+        for (size_t k = 0; k < paths.size(); k++) {
+            RegKeyHandle key = NULL;
+            hive.OpenKey(paths[k], &key);
+            RegKeyInfo info;
+            hive.QueryKeyInfo(key, &info);
+            context.Reserve(info);
+            for (uint32_t index = 0; hive.EnumValue(key, index, &context.name, &context.type, &context.data) ==
+                                     kRegSuccess; index++) {
+                context.text.clear();
+                AppendRegValueData(context.type, context.data.data(), context.data.size(), &context.text);
+                formattedBytes += context.text.size();
+                largest = std::max(largest, context.data.size());
+                enumerated++;
+            }
+            hive.CloseKey(key);
+        }
+    });
+    Report("enumerate + format", engine, paths.size(), enumerated);
+    std::printf("  largest value enumerated: %zu bytes, formatted %.1f MB\n", largest,
+                static_cast<double>(formattedBytes) / (1024.0 * 1024.0));
+
+    std::vector<std::string> roots(1, "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor");
+    for (int withLog = 0; withLog < 2; withLog++) {
+        CountingStreamBuf buffer;
+        std::ostream out(&buffer);
+        RegQueryPrinter printer(hive, out, jobs);
+        size_t logBytes = 0;
+        if (withLog) {
+            printer.SetLogSink([&logBytes](const std::string& message) { logBytes += message.size(); });
+        }
+        Measurement query = Measure([&]() { printer.Query(roots); });
+        Report(withLog ? "query (with debug log)" : "query", query, printer.GetKeyCount(), valueCount);
+    }
+
+    size_t exportBytes = 0;
+    RegExporter exporter(hive, [&exportBytes](const uint8_t*, size_t size) {
+        exportBytes += size;
+        return true;
+    }, 1024 * 1024, jobs);
+    std::string error;
+    Measurement exported = Measure([&]() { exporter.Export(roots, &error); });
+    Report("export", exported, exporter.GetStats().keys, exporter.GetStats().values);
+    std::printf("  export output %.1f MB\n", static_cast<double>(exportBytes) / (1024.0 * 1024.0));
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * 静默注册表导入程序 - REGEDIT5导出基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_export [--keys N] [export.reg]
+ * 把合成数据（或指定的导出文件）加载到内存配置单元，再整树导出：
+ * 测量导出吞吐量，并检查重新导出的字节与输入是否一致；
+ * 另检查含CR/LF的字符串和值名导出后能原样重新导入
+ */
+
+#include "reg_export.h"
+#include "reg_hive.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// 生成合成的REGEDIT5导出（格式与regedit一致，可逐字节对比往返结果）
+static std::string GenerateSyntheticExport(size_t keys) {
+    std::string text = "Windows Registry Editor Version 5.00\r\n";
+    text += "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE]\r\n";
+    text += "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor]\r\n";
+    // 含控制字符的字符串输出为hex(1)，值名中的CR、LF转义为\r、\n
+    text += "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Control]\r\n";
+    text += "\"Lines\"=hex(1):61,00,0d,00,0a,00,62,00,00,00\r\n";
+    text += "\"Tab\"=hex(1):61,00,09,00,62,00,00,00\r\n";
+    text += "\"Line\\r\\nName\"=\"x\"\r\n";
+    char product[32];
+    char item[32];
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(product, sizeof(product), "Product%05zu", k / 256);
+        std::snprintf(item, sizeof(item), "Item%08zu", k);
+        if (k % 256 == 0) {
+            text += "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\" + std::string(product) + "]\r\n";
+        }
+        text += "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\" + std::string(product) + "\\" + item + "]\r\n";
+        text += "@=\"C:\\\\Program Files\\\\Vendor\\\\" + std::string(item) + ".dll\"\r\n";
+        text += "\"Flags\"=dword:0000001f\r\n";
+        text += "\"Data\"=hex:00,01,02,03,04,05,06,07,08,09,0a,0b,0c,0d,0e,0f,10,11,12,13,14,15,\\\r\n"
+                "  16,17,18,19,1a,1b,1c,1d,1e,1f\r\n";
+    }
+    text += "\r\n";
+    std::vector<uint8_t> utf16;
+    utf16.push_back(0xFF);
+    utf16.push_back(0xFE);
+    Utf8ToUtf16Le(text.data(), text.size(), &utf16);
+    return std::string(reinterpret_cast<const char*>(utf16.data()), utf16.size());
+}
+
+// 在配置单元中写入含CR/LF的字符串和值名，导出后重新导入，检查值是否逐字节保留
+static bool ControlCharactersSurvive() {
+    RegHive hive;
+    RegKeyHandle key = NULL;
+    hive.CreateKey("HKEY_CURRENT_USER\\Software\\Control", &key);
+    std::vector<uint8_t> data;
+    const char text[] = "line1\r\nline2";
+    Utf8ToUtf16Le(text, sizeof(text) - 1, &data);
+    data.push_back(0);
+    data.push_back(0);
+    hive.SetValue(key, "Text", kRegSz, data.data(), data.size());
+    hive.SetValue(key, "Name\r\nWith\nBreaks", kRegSz, data.data(), data.size());
+
+    const char* path = "bench_export_control.reg";
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    RegExporter exporter(hive, [&file](const uint8_t* bytes, size_t size) {
+        file.write(reinterpret_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    });
+    std::string error;
+    bool ok = exporter.Export(std::vector<std::string>(1, "HKEY_CURRENT_USER\\Software\\Control"), &error);
+    file.close();
+
+    RegHive loaded;
+    ok = ok && loaded.LoadRegFile(path, &error);
+    std::remove(path);
+    const char* names[] = {"Text", "Name\r\nWith\nBreaks"};
+    for (size_t i = 0; i < 2 && ok; i++) {
+        uint32_t type = 0;
+        std::vector<uint8_t> value;
+        ok = loaded.OpenKey("HKEY_CURRENT_USER\\Software\\Control", &key) == kRegSuccess &&
+             loaded.QueryValue(key, names[i], &type, &value) == kRegSuccess && type == kRegSz && value == data;
+    }
+    return ok;
+}
+
+static bool ReadWholeFile(const std::string& path, std::string* out) {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    out->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 200000;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--keys" && i + 1 < argc) {
+            keys = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else {
+            path = arg;
+        }
+    }
+
+    std::string input;
+    bool synthetic = path.empty();
+    if (synthetic) {
+        path = "bench_export_synthetic.reg";
+        input = GenerateSyntheticExport(keys);
+        std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(input.data(), static_cast<std::streamsize>(input.size()));
+    } else if (!ReadWholeFile(path, &input)) {
+        std::fprintf(stderr, "Cannot open file: %s\n", path.c_str());
+        return 1;
+    }
+
+    RegHive hive;
+    std::string error;
+    if (!hive.LoadRegFile(path, &error)) {
+        std::fprintf(stderr, "Load failed: %s\n", error.c_str());
+        return 1;
+    }
+    if (synthetic) {
+        std::remove(path.c_str());
+    }
+
+    // 导出每个根键下的第一个顶层子键（与常见的单子树导出文件对应）
+    std::vector<std::string> roots;
+    const size_t rootCount = sizeof(kRegRootKeys) / sizeof(kRegRootKeys[0]);
+    for (size_t i = 0; i < rootCount; i++) {
+        RegKeyHandle key;
+        std::string name;
+        if (hive.OpenKey(kRegRootKeys[i].fullName, &key) == kRegSuccess &&
+            hive.EnumSubKey(key, 0, &name) == kRegSuccess) {
+            roots.push_back(std::string(kRegRootKeys[i].fullName) + "\\" + name);
+        }
+    }
+
+    std::string output;
+    double best = 1e30;
+    RegExportStats stats;
+    for (int repeat = 0; repeat < 3; repeat++) {
+        output.clear();
+        RegExporter exporter(hive, [&output](const uint8_t* data, size_t size) {
+            output.append(reinterpret_cast<const char*>(data), size);
+            return true;
+        });
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!exporter.Export(roots, &error)) {
+            std::fprintf(stderr, "Export failed: %s\n", error.c_str());
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds < best) {
+            best = seconds;
+        }
+        stats = exporter.GetStats();
+    }
+
+    std::printf("export %zu keys %zu values: %.1f MB in %.3f s  %8.1f MB/s  %10.0f keys/s\n", stats.keys,
+                stats.values, static_cast<double>(stats.bytes) / (1024.0 * 1024.0), best,
+                static_cast<double>(stats.bytes) / (1024.0 * 1024.0) / best, static_cast<double>(stats.keys) / best);
+    std::printf("round trip: %s\n", output == input ? "byte-identical" : "differs from input");
+    std::printf("CR/LF in strings and value names: %s\n", ControlCharactersSurvive() ? "re-imported intact" : "LOST");
+    return 0;
+}
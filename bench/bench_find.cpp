@@ -0,0 +1,349 @@
+/*
+ * 静默注册表导入程序 - 子树内并行查找基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_find [--keys N] [--jobs J]
+ * 在内存配置单元中构造N个键的树（REG_SZ、REG_EXPAND_SZ、REG_MULTI_SZ、DWORD和二进制值，
+ * 少量键在不同大小写、REG_MULTI_SZ的第二个字符串中含有要查找的文本，另有跨越REG_MULTI_SZ字符串
+ * 边界、不应命中的文本），对字面、忽略大小写、正则和只查键名/值名几种查找：
+ * - 报告1、2、4...J个线程的耗时和扫描的值数据吞吐
+ * - 对比"导出为.reg再搜索UTF-16文本"的耗时
+ * - 字面查找在标量、SSE2、AVX2各级别下的耗时，以及子串查找内核在64MB UTF-16LE文本上的吞吐
+ * - 校验：各线程数的输出与逐个值解码为UTF-8后用std::string::find/std::regex匹配的参考实现逐字节相同
+ */
+
+#include "reg_export.h"
+#include "reg_find.h"
+#include "reg_hive.h"
+#include "reg_parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char kRoot[] = "HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchFind";
+
+static std::vector<uint8_t> Utf16(const std::string& text) {
+    std::vector<uint8_t> wide;
+    Utf8ToUtf16Le(text.data(), text.size(), &wide);
+    wide.push_back(0);
+    wide.push_back(0);
+    return wide;
+}
+
+// 多个字符串组成的REG_MULTI_SZ数据（以两个NUL结尾）
+static std::vector<uint8_t> MultiSz(const std::vector<std::string>& strings) {
+    std::vector<uint8_t> wide;
+    for (size_t i = 0; i < strings.size(); i++) {
+        std::vector<uint8_t> one = Utf16(strings[i]);
+        wide.insert(wide.end(), one.begin(), one.end());
+    }
+    wide.push_back(0);
+    wide.push_back(0);
+    return wide;
+}
+
+// 构造树：根下256组，每组的键下有约6个值；每997个键中有一个键的值含目标文本
+static size_t BuildTree(RegHive* hive, size_t keys) {
+    size_t dataBytes = 0;
+    char path[200];
+    uint8_t binary[48];
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(path, sizeof(path), "%s\\Group%03zu\\Component%07zu", kRoot, k % 256, k);
+        if (k % 4999 == 17) {
+            std::snprintf(path, sizeof(path), "%s\\Group%03zu\\ProxySettings%07zu", kRoot, k % 256, k);
+        }
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        std::string install = "C:\\Program Files\\Vendor " + std::to_string(k % 97) + "\\Product\\bin\\module" +
+                              std::to_string(k) + ".dll";
+        std::string server = "https://update" + std::to_string(k % 13) + ".vendor.example/api/v2/channel";
+        if (k % 997 == 3) {
+            server = "http://proxy.corp.example:8080/";
+        } else if (k % 997 == 500) {
+            server = "HTTP://PROXY.CORP.EXAMPLE:3128/";
+        }
+        std::vector<std::string> list;
+        list.push_back("first-" + std::to_string(k));
+        list.push_back(k % 991 == 7 ? "bypass;proxy.corp.example" : "second-entry");
+        // 跨越字符串边界的文本不应命中
+        if (k % 983 == 11) {
+            list.push_back("proxy.co");
+            list.push_back("rp.example");
+        }
+        std::vector<uint8_t> data = Utf16(install);
+        hive->SetValue(key, "", kRegSz, data.data(), data.size());
+        dataBytes += data.size();
+        data = Utf16(server);
+        hive->SetValue(key, k % 1499 == 9 ? "ProxyServer" : "UpdateServer", kRegSz, data.data(), data.size());
+        dataBytes += data.size();
+        data = Utf16("%ProgramData%\\Vendor\\Cache\\" + std::to_string(k));
+        hive->SetValue(key, "CacheDir", kRegExpandSz, data.data(), data.size());
+        dataBytes += data.size();
+        data = MultiSz(list);
+        hive->SetValue(key, "Channels", kRegMultiSz, data.data(), data.size());
+        dataBytes += data.size();
+        uint32_t flags = static_cast<uint32_t>(k * 2654435761u);
+        hive->SetValue(key, "Flags", kRegDword, reinterpret_cast<const uint8_t*>(&flags), 4);
+        dataBytes += 4;
+        for (size_t i = 0; i < sizeof(binary); i++) {
+            binary[i] = static_cast<uint8_t>(k * 31 + i);
+        }
+        hive->SetValue(key, "State", kRegBinary, binary, sizeof(binary));
+        dataBytes += sizeof(binary);
+    }
+    return dataBytes;
+}
+
+// 一种查找
+struct FindCase {
+    const char* name;
+    std::string pattern;
+    bool ignoreCase;
+    bool regex;
+    unsigned scope;
+};
+
+// 参考实现的匹配：文本先解码为UTF-8，字面匹配用std::string::find（忽略大小写时两边都转为小写）
+struct ReferenceMatcher {
+    const FindCase& find;
+    std::regex compiled;
+    std::string needle;
+
+    explicit ReferenceMatcher(const FindCase& c) : find(c) {
+        if (c.regex) {
+            compiled = std::regex(c.pattern, c.ignoreCase ? std::regex::ECMAScript | std::regex::icase
+                                                           : std::regex::ECMAScript);
+        }
+        needle = Lower(c.pattern);
+    }
+
+    std::string Lower(std::string text) const {
+        if (find.ignoreCase) {
+            for (size_t i = 0; i < text.size(); i++) {
+                text[i] = RegAsciiLower(text[i]);
+            }
+        }
+        return text;
+    }
+
+    bool Match(const std::string& text) const {
+        return find.regex ? std::regex_search(text, compiled) : Lower(text).find(needle) != std::string::npos;
+    }
+
+    bool MatchData(uint32_t type, const std::vector<uint8_t>& data) const {
+        if (type == kRegMultiSz) {
+            for (size_t start = 0, i = 0; i + 1 < data.size() + 1; i += 2) {
+                if (i + 1 >= data.size() || (data[i] == 0 && data[i + 1] == 0)) {
+                    if (i > start && Match(RegStringDataToUtf8(data.data() + start, i - start))) {
+                        return true;
+                    }
+                    start = i + 2;
+                }
+            }
+            return false;
+        }
+        if (type == kRegSz || type == kRegExpandSz) {
+            return !data.empty() && Match(RegStringDataToUtf8(data.data(), data.size()));
+        }
+        return Match(FormatRegValueData(type, data.data(), data.size()));
+    }
+};
+
+// 参考实现：递归先序遍历，按与查找输出器相同的格式输出命中的键和值
+static void ReferenceFind(RegBackend& backend, const std::string& path, const ReferenceMatcher& matcher,
+                          std::string* out) {
+    RegKeyHandle key = NULL;
+    if (backend.OpenKey(path, &key) != kRegSuccess) {
+        return;
+    }
+    std::string lines;
+    std::string name;
+    uint32_t type = 0;
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; backend.EnumValue(key, i, &name, &type, &data) == kRegSuccess; i++) {
+        bool matched = ((matcher.find.scope & kRegFindValueNames) != 0 && matcher.Match(name)) ||
+                       ((matcher.find.scope & kRegFindData) != 0 && matcher.MatchData(type, data));
+        if (matched) {
+            lines += "  \"" + name + "\" = " + FormatRegValueData(type, data.data(), data.size()) + " (" +
+                     GetRegTypeName(type) + ")\n";
+        }
+    }
+    bool keyMatched = (matcher.find.scope & kRegFindKeyNames) != 0 &&
+                      matcher.Match(path.substr(path.rfind('\\') + 1));
+    if (keyMatched || !lines.empty()) {
+        *out += path + "\n" + lines;
+    }
+    std::vector<std::string> children;
+    for (uint32_t i = 0; backend.EnumSubKey(key, i, &name) == kRegSuccess; i++) {
+        children.push_back(name);
+    }
+    backend.CloseKey(key);
+    for (size_t i = 0; i < children.size(); i++) {
+        ReferenceFind(backend, path + "\\" + children[i], matcher, out);
+    }
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string RunFind(RegHive& hive, const RegFindPattern& pattern, unsigned scope, size_t jobs,
+                           double* seconds, size_t* matches) {
+    std::ostringstream out;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RegFindPrinter printer(hive, pattern, scope, out, jobs);
+    printer.Find(std::vector<std::string>(1, kRoot));
+    *seconds = Seconds(start);
+    *matches = printer.GetMatchedValueCount();
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 200000;
+    size_t maxJobs = std::max<size_t>(RegDefaultJobCount(), 4);
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--keys") {
+            keys = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--jobs") {
+            maxJobs = std::max<size_t>(static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10)), 1);
+        }
+    }
+
+    RegHive hive;
+    size_t dataBytes = BuildTree(&hive, keys);
+    double megabytes = static_cast<double>(dataBytes) / 1e6;
+    std::printf("%zu keys, %zu values, %.1f MB of value data, simd %s\n", hive.GetKeyCount(), hive.GetValueCount(),
+                megabytes, RegSimdLevelName(RegGetSimdLevel()));
+
+    // 基线：导出为.reg（UTF-16LE）后搜索文本
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::string exported;
+        RegOutputSink sink = [&exported](const uint8_t* data, size_t size) {
+            exported.append(reinterpret_cast<const char*>(data), size);
+            return true;
+        };
+        RegExporter exporter(hive, sink, 1024 * 1024, 1);
+        std::string error;
+        exporter.Export(std::vector<std::string>(1, kRoot), &error);
+        std::vector<uint8_t> needle;
+        Utf8ToUtf16Le("proxy.corp", 10, &needle);
+        std::string needleText(needle.begin(), needle.end());
+        size_t hits = 0;
+        for (size_t pos = exported.find(needleText); pos != std::string::npos; pos = exported.find(needleText, pos + 1)) {
+            hits++;
+        }
+        std::printf("  export + search UTF-16 text     %8.3f s  (%.1f MB exported, %zu hits)\n", Seconds(start),
+                    static_cast<double>(exported.size()) / 1e6, hits);
+    }
+
+    std::vector<FindCase> cases;
+    FindCase literal = {"literal", "proxy.corp", false, false, kRegFindAll};
+    FindCase ignoreCase = {"ignore case", "PROXY.CORP.example", true, false, kRegFindAll};
+    FindCase regex = {"regex", "proxy\\.corp\\.[a-z]+:[0-9]+", false, true, kRegFindAll};
+    FindCase regexIgnoreCase = {"regex ignore case", "^https?://proxy\\.", true, true, kRegFindData};
+    FindCase names = {"key and value names", "proxy", true, false, kRegFindKeyNames | kRegFindValueNames};
+    FindCase numbers = {"dword text", "(2654435761)", false, false, kRegFindData};
+    cases.push_back(literal);
+    cases.push_back(ignoreCase);
+    cases.push_back(regex);
+    cases.push_back(regexIgnoreCase);
+    cases.push_back(names);
+    cases.push_back(numbers);
+
+    bool ok = true;
+    for (size_t c = 0; c < cases.size(); c++) {
+        const FindCase& find = cases[c];
+        RegFindPattern pattern;
+        std::string error;
+        if (!pattern.Compile(find.pattern, find.ignoreCase, find.regex, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        std::string expected;
+        ReferenceFind(hive, kRoot, ReferenceMatcher(find), &expected);
+        std::printf("%s: %s\n", find.name, find.pattern.c_str());
+        double oneThread = 0;
+        bool caseOk = true;
+        for (size_t jobs = 1; jobs <= maxJobs; jobs = (jobs * 2 > maxJobs && jobs < maxJobs) ? maxJobs : jobs * 2) {
+            double best = 1e30;
+            size_t matches = 0;
+            std::string output;
+            for (int repeat = 0; repeat < 3; repeat++) {
+                double seconds = 0;
+                output = RunFind(hive, pattern, find.scope, jobs, &seconds, &matches);
+                best = std::min(best, seconds);
+            }
+            if (jobs == 1) {
+                oneThread = best;
+            }
+            caseOk = caseOk && output == expected;
+            std::printf("  find %3zu threads               %8.3f s  %8.1f MB/s  x%.2f  %zu values matched\n", jobs,
+                        best, megabytes / best, oneThread / best, matches);
+        }
+        std::printf("  output: %s\n", caseOk ? "identical to decode-and-search reference" : "DIFFERS");
+        ok = ok && caseOk && !expected.empty();
+    }
+
+    // 字面查找在各SIMD级别下的耗时
+    RegSimdLevel detected = RegGetSimdLevel();
+    RegFindPattern pattern;
+    std::string error;
+    pattern.Compile("proxy.corp", true, false, &error);
+    std::string reference;
+    for (int level = RegSimdScalar; level <= detected; level++) {
+        RegSetSimdLevel(static_cast<RegSimdLevel>(level));
+        double best = 1e30;
+        size_t matches = 0;
+        std::string output;
+        for (int repeat = 0; repeat < 3; repeat++) {
+            double seconds = 0;
+            output = RunFind(hive, pattern, kRegFindData, 1, &seconds, &matches);
+            best = std::min(best, seconds);
+        }
+        if (level == RegSimdScalar) {
+            reference = output;
+        }
+        std::printf("  ignore-case literal, %-6s      %8.3f s  %8.1f MB/s%s\n",
+                    RegSimdLevelName(static_cast<RegSimdLevel>(level)), best, megabytes / best,
+                    output == reference ? "" : "  DIFFERS FROM SCALAR");
+        ok = ok && output == reference;
+    }
+
+    // 子串查找内核本身：64MB UTF-16LE文本，目标在末尾
+    std::vector<uint8_t> text;
+    while (text.size() < 64 * 1024 * 1024) {
+        std::vector<uint8_t> piece = Utf16("C:\\Program Files\\Vendor\\Product\\bin\\module.dll;");
+        text.insert(text.end(), piece.begin(), piece.end() - 2);
+    }
+    std::vector<uint8_t> tail = Utf16("PROXY.CORP.EXAMPLE");
+    text.insert(text.end(), tail.begin(), tail.end() - 2);
+    std::vector<uint8_t> needle = Utf16("proxy.corp.example");
+    size_t units = text.size() / 2;
+    size_t expectedPosition = units - (needle.size() - 2) / 2;
+    for (int level = RegSimdScalar; level <= detected; level++) {
+        RegSetSimdLevel(static_cast<RegSimdLevel>(level));
+        double best = 1e30;
+        size_t position = 0;
+        for (int repeat = 0; repeat < 3; repeat++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            position = RegFindSubstringUtf16(text.data(), units, needle.data(), (needle.size() - 2) / 2, true);
+            best = std::min(best, Seconds(start));
+        }
+        std::printf("  UTF-16 kernel, %-6s            %8.3f s  %8.1f MB/s%s\n",
+                    RegSimdLevelName(static_cast<RegSimdLevel>(level)), best,
+                    static_cast<double>(text.size()) / 1e6 / best, position == expectedPosition ? "" : "  WRONG POSITION");
+        ok = ok && position == expectedPosition;
+    }
+    RegSetSimdLevel(detected);
+    return ok ? 0 : 1;
+}
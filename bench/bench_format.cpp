@@ -0,0 +1,101 @@
+/*
+ * 静默注册表导入程序 - 机器可读查询输出基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_format [--keys N] [--jobs J]
+ * 在内存配置单元中构造N个键（字符串、DWORD、多字符串和二进制值），
+ * 分别以text、ndjson、json、csv格式查询整棵树，输出经RegBufferedOutput写入只计数的回调，
+ * 报告每秒记录数、输出吞吐量、回调次数（写入系统调用次数）和最大单次写入量
+ */
+
+#include "reg_format.h"
+#include "reg_hive.h"
+#include "reg_query.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <vector>
+
+static void BuildTree(RegHive* hive, size_t keys) {
+    std::vector<uint8_t> text;
+    Utf8ToUtf16Le("C:\\Program Files\\Vendor\\Component \"x64\"\\bin", 43, &text);
+    text.push_back(0);
+    text.push_back(0);
+    std::vector<uint8_t> multi;
+    Utf8ToUtf16Le("first", 5, &multi);
+    multi.push_back(0);
+    multi.push_back(0);
+    Utf8ToUtf16Le("second,item", 11, &multi);
+    multi.insert(multi.end(), 4, 0);
+    uint8_t blob[96];
+    for (size_t i = 0; i < sizeof(blob); i++) {
+        blob[i] = static_cast<uint8_t>(i * 13);
+    }
+    char path[128];
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(path, sizeof(path), "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Group%03zu\\Item%07zu", k % 512, k);
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        hive->SetValue(key, "", kRegSz, text.data(), text.size());
+        hive->SetValue(key, "Flags", kRegDword, blob, 4);
+        hive->SetValue(key, "Items", kRegMultiSz, multi.data(), multi.size());
+        hive->SetValue(key, "Data", kRegBinary, blob, sizeof(blob));
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 100000;
+    size_t jobs = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--keys") {
+            keys = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--jobs") {
+            jobs = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        }
+    }
+
+    RegHive hive;
+    BuildTree(&hive, keys);
+    std::printf("hive: %zu keys, %zu values, jobs %zu\n", hive.GetKeyCount(), hive.GetValueCount(), jobs);
+
+    std::vector<std::string> roots(1, "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor");
+    const char* names[] = {"text", "ndjson", "json", "csv"};
+    for (size_t f = 0; f < sizeof(names) / sizeof(names[0]); f++) {
+        size_t bytes = 0;
+        size_t writes = 0;
+        size_t largest = 0;
+        RegBufferedOutput buffer([&](const uint8_t*, size_t size) {
+            bytes += size;
+            writes++;
+            largest = std::max(largest, size);
+            return true;
+        });
+        std::ostream out(&buffer);
+        size_t records = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        RegQueryFormat format = kRegFormatText;
+        ParseRegQueryFormat(names[f], &format);
+        if (format == kRegFormatText) {
+            RegQueryPrinter printer(hive, out, jobs);
+            printer.Query(roots);
+            records = printer.GetKeyCount() + hive.GetValueCount();
+        } else {
+            RegRecordPrinter printer(hive, out, format, jobs);
+            printer.Query(roots);
+            records = printer.GetKeyCount() + printer.GetValueCount();
+        }
+        out.flush();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%-7s %10.0f records/s  %7.1f MB/s  %6.1f MB  %5zu writes (max %zu KB)\n", names[f],
+                    static_cast<double>(records) / seconds, static_cast<double>(bytes) / seconds / (1024.0 * 1024.0),
+                    static_cast<double>(bytes) / (1024.0 * 1024.0), writes, largest / 1024);
+    }
+    return 0;
+}
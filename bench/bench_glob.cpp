@@ -0,0 +1,193 @@
+/*
+ * 静默注册表导入程序 - 通配符展开基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_glob [--files N] [--root dir] [--keep]
+ * 生成一个约N个文件的目录树（默认120000个，一半为.reg，含一个被排除的legacy子树），
+ * 或使用已有的目录树（--root），用递归模式展开root下所有子目录中的.reg文件：
+ * - 不同线程数下的耗时和每秒检查的目录项，校验各线程数结果逐项一致
+ * - 与独立实现（顺序递归枚举后按完整路径匹配）的结果一致
+ * - 排除模式跳过的文件数，多个重叠模式去重后与单个模式结果一致
+ */
+
+#include "reg_glob.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 生成目录树：root/dNN/sNN/ 下各放若干文件，root/d00/legacy/ 为要排除的子树
+static size_t BuildTree(const std::string& root, size_t files) {
+    const size_t top = 20;
+    const size_t sub = 20;
+    size_t perDir = std::max<size_t>(1, files / (top * sub));
+    size_t created = 0;
+    ::mkdir(root.c_str(), 0755);
+    for (size_t d = 0; d < top; d++) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/d%02zu", d);
+        std::string dir = root + name;
+        ::mkdir(dir.c_str(), 0755);
+        for (size_t s = 0; s < sub; s++) {
+            std::snprintf(name, sizeof(name), "/s%02zu", s);
+            std::string leaf = (d == 0 && s == 0) ? dir + "/legacy" : dir + name;
+            ::mkdir(leaf.c_str(), 0755);
+            for (size_t f = 0; f < perDir; f++) {
+                std::snprintf(name, sizeof(name), "/f%04zu.%s", f, f % 2 == 0 ? "reg" : "txt");
+                std::ofstream file((leaf + name).c_str());
+                created++;
+            }
+        }
+    }
+    return created;
+}
+
+// 独立实现：顺序递归列出全部文件，再按完整路径用RegGlobMatchParts匹配
+static void ReferenceWalk(const std::string& dir, std::vector<std::string>* files) {
+    std::vector<RegDirEntry> entries;
+    RegListDirectory(dir, &entries);
+    for (size_t i = 0; i < entries.size(); i++) {
+        std::string path = RegJoinPath(dir, entries[i].name);
+        if (entries[i].directory) {
+            ReferenceWalk(path, files);
+        } else {
+            files->push_back(path);
+        }
+    }
+}
+
+static void RemoveTree(const std::string& dir) {
+    std::vector<RegDirEntry> entries;
+    RegListDirectory(dir, &entries);
+    for (size_t i = 0; i < entries.size(); i++) {
+        std::string path = RegJoinPath(dir, entries[i].name);
+        if (entries[i].directory) {
+            RemoveTree(path);
+        } else {
+            std::remove(path.c_str());
+        }
+    }
+    ::rmdir(dir.c_str());
+}
+
+int main(int argc, char** argv) {
+    size_t fileCount = 120000;
+    std::string root;
+    bool keep = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--files" && i + 1 < argc) {
+            fileCount = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--root" && i + 1 < argc) {
+            root = argv[++i];
+        } else if (arg == "--keep") {
+            keep = true;
+        }
+    }
+    bool synthetic = root.empty();
+    if (synthetic) {
+        root = "bench_glob_tree";
+        struct stat info;
+        if (::stat(root.c_str(), &info) != 0) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            size_t created = BuildTree(root, fileCount);
+            std::printf("created %zu files in %.1f s\n", created, Seconds(start));
+        }
+    }
+    std::string pattern = root + "/**/*.reg";
+
+    // 不同线程数：最好的一次耗时，结果必须逐项一致
+    std::vector<std::string> baseline;
+    bool consistent = true;
+    const size_t jobCounts[] = {1, 2, 4, 8};
+    for (size_t j = 0; j < sizeof(jobCounts) / sizeof(jobCounts[0]); j++) {
+        double best = 1e30;
+        std::vector<std::string> files;
+        RegGlobStats stats;
+        for (int repeat = 0; repeat < 3; repeat++) {
+            RegGlob glob(jobCounts[j]);
+            files.clear();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            glob.Expand(pattern, &files);
+            double seconds = Seconds(start);
+            if (seconds < best) {
+                best = seconds;
+                stats = glob.GetStats();
+            }
+        }
+        if (j == 0) {
+            baseline = files;
+        } else if (files != baseline) {
+            consistent = false;
+        }
+        std::printf("jobs %zu  %7.1f ms  %6zu matched  %6zu dirs  %7zu entries  %9.0f entries/s  %4zu steals\n",
+                    jobCounts[j], best * 1000.0, files.size(), stats.directories, stats.entries,
+                    static_cast<double>(stats.entries) / best, stats.steals);
+    }
+
+    // 独立实现的结果
+    std::vector<std::string> all;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ReferenceWalk(root, &all);
+    std::vector<std::string> patternParts = RegSplitPath(pattern);
+    std::vector<std::string> reference;
+    for (size_t i = 0; i < all.size(); i++) {
+        if (RegGlobMatchParts(patternParts, 0, RegSplitPath(all[i]), 0)) {
+            reference.push_back(all[i]);
+        }
+    }
+    std::sort(reference.begin(), reference.end());
+    double referenceSeconds = Seconds(start);
+    bool matchesReference = reference == baseline;
+    std::printf("reference recursive walk + full path match %7.1f ms: %s\n", referenceSeconds * 1000.0,
+                matchesReference ? "identical" : "DIFFERS");
+
+    // 排除：名称（任意一级的legacy目录）和完整路径两种写法结果相同
+    RegGlob byName(4);
+    byName.AddExclude("legacy");
+    std::vector<std::string> excludedByName;
+    byName.Expand(pattern, &excludedByName);
+    RegGlob byPath(4);
+    byPath.AddExclude(root + "/*/legacy/**");
+    std::vector<std::string> excludedByPath;
+    byPath.Expand(pattern, &excludedByPath);
+    size_t legacyFiles = 0;
+    for (size_t i = 0; i < baseline.size(); i++) {
+        if (baseline[i].find("/legacy/") != std::string::npos) {
+            legacyFiles++;
+        }
+    }
+    bool excludeOk = excludedByName == excludedByPath && excludedByName.size() + legacyFiles == baseline.size();
+    std::printf("exclude: %zu files skipped (%zu directories pruned by name): %s\n", legacyFiles,
+                byName.GetStats().excluded, excludeOk ? "ok" : "WRONG");
+
+    // 去重：多个重叠的模式合并后与单个模式相同
+    RegGlob overlap(4);
+    std::vector<std::string> merged;
+    overlap.Expand(pattern, &merged);
+    overlap.Expand(root + "/d0*/**/*.reg", &merged);
+    overlap.Expand("./" + root + "/d01/*/*.reg", &merged);
+    size_t mergedCount = merged.size();
+    size_t removed = RegRemoveDuplicatePaths(&merged);
+    bool dedupOk = merged == baseline;
+    std::printf("dedup: %zu paths from 3 overlapping patterns, %zu duplicates removed: %s\n", mergedCount, removed,
+                dedupOk ? "ok" : "WRONG");
+
+    if (synthetic && !keep) {
+        RemoveTree(root);
+    }
+    return consistent && matchesReference && excludeOk && dedupOk ? 0 : 1;
+}
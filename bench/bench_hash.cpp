@@ -0,0 +1,219 @@
+/*
+ * 静默注册表导入程序 - 内容哈希与导入状态缓存基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_hash [--size MB] [--files N] [export.reg]
+ * - 校验XXH64参考值，测量内存中整块和4KB分块计算的GB/s
+ * - 对合成（或指定的）导出文件按不同缓冲区大小流式计算哈希，与完整解析的MB/s对比
+ * - 模拟N个文件的缓存检查：大小和修改时间命中、修改时间变化后按内容命中、全部重新解析，对比每文件耗时
+ */
+
+#include "reg_cache.h"
+#include "reg_parser.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Fn>
+static double BestSeconds(int repeat, Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < repeat; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fn();
+        double seconds = Seconds(start);
+        if (seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// 生成合成的REGEDIT5导出（UTF-16LE带BOM）
+static std::string GenerateSyntheticExport(size_t targetBytes, size_t firstKey) {
+    std::string text = "Windows Registry Editor Version 5.00\r\n";
+    size_t key = firstKey;
+    while (text.size() * 2 < targetBytes) {
+        text += "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE\\Classes\\CLSID\\{" + std::to_string(100000 + key) +
+                "-0000-0000-C000-000000000046}\\InprocServer32]\r\n";
+        text += "@=\"C:\\\\Windows\\\\System32\\\\ole32.dll\"\r\n";
+        text += "\"ThreadingModel\"=\"Both\"\r\n";
+        text += "\"Flags\"=dword:0000001f\r\n";
+        key++;
+    }
+    std::vector<uint8_t> utf16;
+    utf16.push_back(0xFF);
+    utf16.push_back(0xFE);
+    Utf8ToUtf16Le(text.data(), text.size(), &utf16);
+    return std::string(reinterpret_cast<const char*>(utf16.data()), utf16.size());
+}
+
+static bool WriteFile(const std::string& path, const std::string& data) {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+static bool Stamp(const std::string& path, RegApplyCacheEntry* entry) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    entry->size = static_cast<uint64_t>(info.st_size);
+    entry->mtime = static_cast<uint64_t>(info.st_mtime);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t sizeMb = 64;
+    size_t fileCount = 500;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            sizeMb = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--files" && i + 1 < argc) {
+            fileCount = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else {
+            path = arg;
+        }
+    }
+
+    // 参考值（与xxHash官方实现一致）
+    bool vectorsOk = RegHash64::Hash("", 0) == 0xef46db3751d8e999ULL &&
+                     RegHash64::Hash("abc", 3) == 0x44bc2cf5ad770999ULL;
+    std::printf("reference vectors: %s\n", vectorsOk ? "ok" : "MISMATCH");
+
+    // 内存中计算
+    std::string data(sizeMb * 1024 * 1024, '\0');
+    uint64_t seed = 88172645463325252ull;
+    for (size_t i = 0; i < data.size(); i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        data[i] = static_cast<char>(seed);
+    }
+    uint64_t whole = 0;
+    uint64_t chunked = 0;
+    double wholeSeconds = BestSeconds(5, [&]() { whole = RegHash64::Hash(data.data(), data.size()); });
+    double chunkedSeconds = BestSeconds(5, [&]() {
+        RegHash64 hasher;
+        for (size_t offset = 0; offset < data.size(); offset += 4096) {
+            hasher.Update(data.data() + offset, std::min<size_t>(4096, data.size() - offset));
+        }
+        chunked = hasher.Digest();
+    });
+    double gb = static_cast<double>(data.size()) / (1024.0 * 1024.0 * 1024.0);
+    std::printf("memory    whole %6.2f GB/s  4KB chunks %6.2f GB/s  (%s)\n", gb / wholeSeconds,
+                gb / chunkedSeconds, whole == chunked ? "identical" : "DIFFERS");
+
+    // 流式计算文件哈希与完整解析对比（文件已在页缓存中）
+    std::string filePath = path;
+    if (filePath.empty()) {
+        filePath = "bench_hash_input.reg";
+        WriteFile(filePath, GenerateSyntheticExport(sizeMb * 1024 * 1024, 0));
+    }
+    RegApplyCacheEntry fileStamp;
+    if (!Stamp(filePath, &fileStamp)) {
+        std::fprintf(stderr, "Cannot stat %s\n", filePath.c_str());
+        return 1;
+    }
+    double mb = static_cast<double>(fileStamp.size) / (1024.0 * 1024.0);
+    const size_t bufferSizes[] = {64 * 1024, 256 * 1024, 1024 * 1024};
+    uint64_t fileHash = 0;
+    for (size_t i = 0; i < sizeof(bufferSizes) / sizeof(bufferSizes[0]); i++) {
+        std::string error;
+        double seconds = BestSeconds(3, [&]() { RegHashFile(filePath, &fileHash, &error, bufferSizes[i]); });
+        std::printf("file      hash (%4zu KB buffer) %8.1f MB/s\n", bufferSizes[i] / 1024, mb / seconds);
+    }
+    size_t opCount = 0;
+    double parseSeconds = BestSeconds(1, [&]() {
+        RegParsedFile parsed;
+        ParseRegFileToOps(filePath, Latin1ToUtf8, &parsed);
+        opCount = parsed.ops.size();
+    });
+    std::printf("file      parse                 %8.1f MB/s  (%zu ops)\n", mb / parseSeconds, opCount);
+    if (path.empty()) {
+        std::remove(filePath.c_str());
+    }
+
+    // 模拟开机时的文件包：N个小文件
+    std::vector<std::string> files;
+    std::vector<RegApplyCacheEntry> stamps(fileCount);
+    for (size_t i = 0; i < fileCount; i++) {
+        files.push_back("bench_hash_bundle_" + std::to_string(i) + ".reg");
+        WriteFile(files[i], GenerateSyntheticExport(16 * 1024, i * 1000));
+        Stamp(files[i], &stamps[i]);
+    }
+    RegApplyCache cache;
+    for (size_t i = 0; i < fileCount; i++) {
+        RegApplyCacheEntry entry = stamps[i];
+        cache.Check(files[i], files[i], &entry);
+        cache.Record(files[i], entry);
+    }
+
+    size_t hits = 0;
+    double statSeconds = BestSeconds(3, [&]() {
+        hits = 0;
+        for (size_t i = 0; i < fileCount; i++) {
+            RegApplyCacheEntry entry;
+            Stamp(files[i], &entry);
+            if (cache.Check(files[i], files[i], &entry) != kRegCacheMiss) {
+                hits++;
+            }
+        }
+    });
+    size_t statHits = hits;
+    // 修改时间全部变化（如重新复制的文件包），内容未变
+    double contentSeconds = BestSeconds(3, [&]() {
+        hits = 0;
+        for (size_t i = 0; i < fileCount; i++) {
+            RegApplyCacheEntry entry;
+            Stamp(files[i], &entry);
+            entry.mtime++;
+            if (cache.Check(files[i], files[i], &entry) == kRegCacheHitContent) {
+                hits++;
+            }
+            // 恢复记录的修改时间，下一轮仍走内容哈希
+            entry.mtime--;
+            cache.Record(files[i], entry);
+        }
+    });
+    size_t contentHits = hits;
+    double reparseSeconds = BestSeconds(3, [&]() {
+        for (size_t i = 0; i < fileCount; i++) {
+            RegParsedFile parsed;
+            ParseRegFileToOps(files[i], Latin1ToUtf8, &parsed);
+        }
+    });
+    double perFile = 1e6 / static_cast<double>(fileCount);
+    std::printf("bundle    %zu files: size/time hit %6.1f us/file (%zu hits), content hit %6.1f us/file (%zu hits), "
+                "parse %6.1f us/file\n",
+                fileCount, statSeconds * perFile, statHits, contentSeconds * perFile, contentHits,
+                reparseSeconds * perFile);
+    for (size_t i = 0; i < fileCount; i++) {
+        std::remove(files[i].c_str());
+    }
+
+    // 缓存文件序列化往返
+    RegApplyCache reloaded;
+    WriteFile("bench_hash_cache.txt", cache.Serialize());
+    reloaded.Load("bench_hash_cache.txt");
+    std::remove("bench_hash_cache.txt");
+    bool roundTrip = reloaded.Serialize() == cache.Serialize() && reloaded.GetEntryCount() == fileCount;
+    std::printf("cache file round trip: %s\n", roundTrip ? "identical" : "DIFFERS");
+
+    return vectorsOk && whole == chunked && statHits == fileCount && contentHits == fileCount && roundTrip ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+/*
+ * 静默注册表导入程序 - 十六进制编解码基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_hex [--size MB]
+ * 对随机二进制数据（默认64MB），在每个可用的指令集级别（scalar/sse2/avx2）分别测量GB/s（按二进制字节计）：
+ * - 编码为"xx,xx,..."、按regedit布局分段编码（每段1MB）、解码
+ * - 与逐字节snprintf("%02X ")的旧查询输出方式和逐字符解码的旧解析方式对比
+ * 并校验：往返一致；布局编码与逐字节实现在各种首行列位置和分段方式下输出相同；
+ * 随机文本（含空白、单个数字、大写、注释、非法字符）的解码结果与逐字符实现相同
+ */
+
+#include "reg_hex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+template <typename Fn>
+static double BestSeconds(int repeat, Fn fn) {
+    double best = 1e30;
+    for (int r = 0; r < repeat; r++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static void Report(const char* name, const char* level, size_t bytes, double seconds) {
+    std::printf("  %-24s %-7s %8.2f GB/s\n", name, level, static_cast<double>(bytes) / seconds / 1e9);
+}
+
+// 逐字节的regedit布局（与导出器原来的实现相同）
+static std::string ReferenceLayout(const uint8_t* data, size_t size, size_t lineLength) {
+    static const char digits[] = "0123456789abcdef";
+    std::string text;
+    for (size_t i = 0; i < size; i++) {
+        text += digits[data[i] >> 4];
+        text += digits[data[i] & 0x0F];
+        if (i + 1 == size) {
+            break;
+        }
+        text += ',';
+        lineLength += 3;
+        if (lineLength >= 77) {
+            text += "\\\r\n  ";
+            lineLength = 2;
+        }
+    }
+    return text;
+}
+
+// 逐字符解码（与解析器原来的实现相同）
+static bool ReferenceDecode(const std::string& text, std::vector<uint8_t>* out) {
+    int current = -1;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c == ',') {
+            if (current < 0) {
+                return false;
+            }
+            out->push_back(static_cast<uint8_t>(current));
+            current = -1;
+            continue;
+        }
+        if (c == ' ' || c == '\t') {
+            continue;
+        }
+        if (c == ';') {
+            break;
+        }
+        int nibble = RegHexNibble(c);
+        if (nibble < 0 || current > 0xF) {
+            return false;
+        }
+        current = (current < 0) ? nibble : ((current << 4) | nibble);
+    }
+    if (current >= 0) {
+        out->push_back(static_cast<uint8_t>(current));
+    }
+    return true;
+}
+
+static uint64_t g_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t Random() {
+    g_state ^= g_state << 13;
+    g_state ^= g_state >> 7;
+    g_state ^= g_state << 17;
+    return g_state;
+}
+
+// 布局编码：各种首行列位置、长度和分段方式与逐字节实现比较
+static size_t CheckLayout() {
+    size_t failures = 0;
+    std::vector<uint8_t> data(4096);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uint8_t>(Random());
+    }
+    std::vector<char> text;
+    for (size_t trial = 0; trial < 3000; trial++) {
+        size_t size = trial < 200 ? trial : Random() % data.size();
+        size_t column = Random() % 120;
+        size_t piece = 1 + Random() % 100;
+        RegHexLayoutEncoder encoder(column, 77);
+        text.resize(encoder.MaxEncodedSize(size) + 1);
+        size_t length = 0;
+        for (size_t i = 0; i < size; i += piece) {
+            length += encoder.Encode(data.data() + i, std::min(piece, size - i), text.data() + length);
+        }
+        if (std::string(text.data(), length) != ReferenceLayout(data.data(), size, column)) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// 解码：随机文本与逐字符实现比较（偏向生成规范的"hh,"以覆盖向量化路径的边界）
+static size_t CheckDecode() {
+    static const char noise[] = "0123456789abcdefABCDEF, \t;xg";
+    size_t failures = 0;
+    for (size_t trial = 0; trial < 200000; trial++) {
+        std::string text;
+        size_t length = Random() % 160;
+        while (text.size() < length) {
+            if (Random() % 8 != 0) {
+                text.append(RegHexDigitPairs(Random() % 2 == 0) + (Random() % 256) * 2, 2);
+                text += ',';
+            } else {
+                text += noise[Random() % (sizeof(noise) - 1)];
+            }
+        }
+        std::vector<uint8_t> expected;
+        std::vector<uint8_t> actual;
+        bool expectedOk = ReferenceDecode(text, &expected);
+        bool actualOk = RegHexDecodeList(text.data(), text.size(), &actual);
+        if (expectedOk != actualOk || (expectedOk && expected != actual)) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    size_t sizeMb = 64;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            sizeMb = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        }
+    }
+    size_t size = std::max<size_t>(sizeMb, 1) * 1024 * 1024;
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<uint8_t>(Random() >> 32);
+    }
+    std::printf("%zu MB random binary data\n", size / (1024 * 1024));
+
+    bool ok = true;
+    std::vector<char> text(size * 3 + 64);
+    std::string printed;
+    double t = BestSeconds(1, [&]() {
+        printed.clear();
+        char hex[4];
+        for (size_t i = 0; i < size; i++) {
+            std::snprintf(hex, sizeof(hex), "%02X ", data[i]);
+            printed.append(hex, 3);
+        }
+    });
+    Report("snprintf %02X", "-", size, t);
+
+    std::string flat(printed);
+    std::replace(flat.begin(), flat.end(), ' ', ',');
+    std::vector<uint8_t> decoded;
+    decoded.reserve(size);
+    t = BestSeconds(1, [&]() {
+        decoded.clear();
+        ReferenceDecode(flat, &decoded);
+    });
+    Report("per-char decode", "-", size, t);
+    flat.clear();
+
+    RegSimdLevel maxLevel = RegDetectSimdLevel();
+    for (int l = RegSimdScalar; l <= maxLevel; l++) {
+        RegSimdLevel level = RegSetSimdLevel(static_cast<RegSimdLevel>(l));
+        const char* name = RegSimdLevelName(level);
+
+        size_t length = 0;
+        t = BestSeconds(3, [&]() { length = RegHexEncodeList(data.data(), size, ',', false, text.data()); });
+        Report("encode", name, size, t);
+
+        size_t printedLength = 0;
+        t = BestSeconds(3, [&]() { printedLength = RegHexEncodeList(data.data(), size, ' ', true, text.data()); });
+        Report("encode (query text)", name, size, t);
+        bool printedOk = printedLength + 1 == printed.size() && printed.compare(0, printedLength, text.data(),
+                                                                                   printedLength) == 0;
+
+        std::vector<char> layout;
+        size_t layoutLength = 0;
+        t = BestSeconds(3, [&]() {
+            RegHexLayoutEncoder encoder(10, 77);
+            const size_t chunk = 1024 * 1024;
+            layout.resize(encoder.MaxEncodedSize(size));
+            layoutLength = 0;
+            for (size_t i = 0; i < size; i += chunk) {
+                layoutLength +=
+                    encoder.Encode(data.data() + i, std::min(chunk, size - i), layout.data() + layoutLength);
+            }
+        });
+        Report("encode (regedit layout)", name, size, t);
+
+        length = RegHexEncodeList(data.data(), size, ',', false, text.data());
+        bool decodeOk = true;
+        t = BestSeconds(3, [&]() {
+            decoded.clear();
+            decodeOk = RegHexDecodeList(text.data(), length, &decoded);
+        });
+        Report("decode", name, size, t);
+
+        bool roundTrip = decodeOk && decoded == data;
+        std::printf("  round trip %s, query text %s, layout %.1f MB\n", roundTrip ? "ok" : "DIFFERS",
+                    printedOk ? "ok" : "DIFFERS", layoutLength / 1e6);
+        ok = ok && roundTrip && printedOk;
+
+        size_t layoutFailures = CheckLayout();
+        size_t decodeFailures = CheckDecode();
+        std::printf("  layout mismatches: %zu, decode mismatches: %zu\n", layoutFailures, decodeFailures);
+        ok = ok && layoutFailures == 0 && decodeFailures == 0;
+    }
+    RegSetSimdLevel(maxLevel);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+/*
+ * 静默注册表导入程序 - 内存配置单元基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_hive [--keys N] [export.reg]
+ * 不指定文件时生成N个键的合成REGEDIT5导出（写入临时文件）
+ * 测量.reg加载、随机键查找和整树查询输出的吞吐量
+ */
+
+#include "reg_hive.h"
+#include "reg_query.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// 丢弃所有输出的流缓冲区，只统计字节数
+class CountingStreamBuf : public std::streambuf {
+public:
+    CountingStreamBuf() : bytes(0) {}
+    size_t bytes;
+
+protected:
+    int overflow(int c) override {
+        bytes++;
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        bytes += static_cast<size_t>(n);
+        return n;
+    }
+};
+
+static std::string KeyPath(size_t k) {
+    return "HKEY_LOCAL_MACHINE\\SOFTWARE\\Classes\\CLSID\\{" + std::to_string(100000 + k / 16) +
+           "-0000-0000-C000-000000000046}\\Sub" + std::to_string(k % 16);
+}
+
+// 生成合成的REGEDIT5导出（UTF-16LE带BOM）
+static bool WriteSyntheticExport(const std::string& path, size_t keys) {
+    std::string text = "Windows Registry Editor Version 5.00\r\n";
+    for (size_t k = 0; k < keys; k++) {
+        text += "\r\n[" + KeyPath(k) + "]\r\n";
+        text += "@=\"C:\\\\Windows\\\\System32\\\\component" + std::to_string(k) + ".dll\"\r\n";
+        text += "\"ThreadingModel\"=\"Both\"\r\n";
+        text += "\"Flags\"=dword:0000001f\r\n";
+    }
+    std::vector<uint8_t> utf16;
+    utf16.push_back(0xFF);
+    utf16.push_back(0xFE);
+    Utf8ToUtf16Le(text.data(), text.size(), &utf16);
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(utf16.data()), static_cast<std::streamsize>(utf16.size()));
+    return static_cast<bool>(file);
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 1000000;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--keys" && i + 1 < argc) {
+            keys = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else {
+            path = arg;
+        }
+    }
+    bool synthetic = path.empty();
+    if (synthetic) {
+        path = "bench_hive_synthetic.reg";
+        if (!WriteSyntheticExport(path, keys)) {
+            std::fprintf(stderr, "Cannot write file: %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    RegHive hive;
+    std::string error;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!hive.LoadRegFile(path, &error)) {
+        std::fprintf(stderr, "Load failed: %s\n", error.c_str());
+        return 1;
+    }
+    double t = Seconds(start);
+    std::printf("load %-32s %8zu keys %9zu values  %6.2f s  %10.0f keys/s  arena %.1f MB\n", path.c_str(),
+                hive.GetKeyCount(), hive.GetValueCount(), t, static_cast<double>(hive.GetKeyCount()) / t,
+                static_cast<double>(hive.GetArenaBytes()) / (1024.0 * 1024.0));
+
+    if (synthetic) {
+        const size_t lookups = 1000000;
+        std::vector<std::string> paths;
+        unsigned seed = 7;
+        for (size_t i = 0; i < 4096; i++) {
+            seed = seed * 1103515245u + 12345u;
+            paths.push_back(KeyPath(((seed >> 8) % keys)));
+        }
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups; i++) {
+            RegKeyHandle key;
+            if (hive.OpenKey(paths[i % paths.size()], &key) == kRegSuccess) {
+                found++;
+            }
+        }
+        t = Seconds(start);
+        std::printf("random OpenKey                      %10.0f lookups/s  (found=%zu)\n",
+                    static_cast<double>(lookups) / t, found);
+        std::remove(path.c_str());
+    }
+
+    const size_t rootCount = sizeof(kRegRootKeys) / sizeof(kRegRootKeys[0]);
+    CountingStreamBuf sink;
+    std::ostream out(&sink);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rootCount; i++) {
+        RegQueryPrinter printer(hive, out);
+        printer.Query(kRegRootKeys[i].fullName);
+    }
+    t = Seconds(start);
+    std::printf("query all roots                     %10.0f keys/s  %8.1f MB/s output\n",
+                static_cast<double>(hive.GetKeyCount()) / t, static_cast<double>(sink.bytes) / (1024.0 * 1024.0) / t);
+    return 0;
+}
@@ -0,0 +1,357 @@
+/*
+ * 静默注册表导入程序 - 增量查询基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_incremental [--keys N] [--changes C] [--call-us U] [--jobs J]
+ * 在内存配置单元中构造N个键的树，首次增量查询（空索引）生成索引，然后在随机的深层键上
+ * 修改、新增和删除值，新增和删除键，再次增量查询：
+ * - 比较完整查询和增量查询的耗时及后端调用次数（打开、键信息、枚举值、枚举子键）
+ * - 校验：1个和J个线程的增量输出相同，且与修改前后整棵树逐键比较得到的差异逐条相同
+ * - 校验：没有修改时增量输出为空，生成的索引与上次相同
+ * - 校验：某个键无法打开时其子树不报告为删除，新索引沿用旧行；恢复访问后增量输出为空
+ * --call-us为每次后端调用附加的忙等时间，模拟真实注册表的系统调用开销
+ */
+
+#include "reg_hive.h"
+#include "reg_index.h"
+#include "reg_parallel.h"
+#include "reg_query.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char kRoot[] = "HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchIncremental";
+
+// 每次调用附加固定延迟并按种类计数的配置单元
+class SlowCallHive : public RegHive {
+public:
+    explicit SlowCallHive(double callMicros) : m_callMicros(callMicros), m_opens(0), m_infos(0), m_values(0), m_subKeys(0) {}
+
+    long OpenKey(const std::string& keyPath, RegKeyHandle* key) override {
+        Delay(&m_opens);
+        if (!m_denied.empty() && keyPath == m_denied) {
+            return kRegErrorAccessDenied;
+        }
+        return RegHive::OpenKey(keyPath, key);
+    }
+
+    long QueryKeyInfo(RegKeyHandle key, RegKeyInfo* info) override {
+        Delay(&m_infos);
+        return RegHive::QueryKeyInfo(key, info);
+    }
+
+    long EnumValue(RegKeyHandle key, uint32_t index, std::string* name, uint32_t* type,
+                   std::vector<uint8_t>* data) override {
+        Delay(&m_values);
+        return RegHive::EnumValue(key, index, name, type, data);
+    }
+
+    long EnumSubKey(RegKeyHandle key, uint32_t index, std::string* name) override {
+        Delay(&m_subKeys);
+        return RegHive::EnumSubKey(key, index, name);
+    }
+
+    void SetCallDelay(double callMicros) { m_callMicros = callMicros; }
+
+    // 打开该路径时返回拒绝访问（空字符串取消），模拟权限不足的键
+    void SetDeniedPath(const std::string& path) { m_denied = path; }
+
+    // 自上次调用以来的调用次数
+    std::string TakeCallCounts() {
+        char text[160];
+        std::snprintf(text, sizeof(text), "open %zu, info %zu, enum value %zu, enum subkey %zu", m_opens.exchange(0),
+                      m_infos.exchange(0), m_values.exchange(0), m_subKeys.exchange(0));
+        return text;
+    }
+
+private:
+    void Delay(std::atomic<size_t>* counter) {
+        (*counter)++;
+        if (m_callMicros > 0) {
+            std::chrono::steady_clock::time_point until =
+                std::chrono::steady_clock::now() +
+                std::chrono::nanoseconds(static_cast<long long>(m_callMicros * 1000.0));
+            while (std::chrono::steady_clock::now() < until) {
+            }
+        }
+    }
+
+    double m_callMicros;
+    std::string m_denied;
+    std::atomic<size_t> m_opens;
+    std::atomic<size_t> m_infos;
+    std::atomic<size_t> m_values;
+    std::atomic<size_t> m_subKeys;
+};
+
+static void SetText(RegHive* hive, RegKeyHandle key, const std::string& name, const std::string& text) {
+    std::vector<uint8_t> wide;
+    Utf8ToUtf16Le(text.data(), text.size(), &wide);
+    wide.push_back(0);
+    wide.push_back(0);
+    hive->SetValue(key, name, kRegSz, wide.data(), wide.size());
+}
+
+// 构造树：根下64组，每组16个子组，键均匀分布在子组下
+static std::vector<std::string> BuildTree(RegHive* hive, size_t keys) {
+    std::vector<std::string> paths;
+    char path[200];
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(path, sizeof(path), "%s\\Group%02zu\\Sub%02zu\\Item%07zu", kRoot, k % 64, (k / 64) % 16, k);
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        SetText(hive, key, "", "C:\\Program Files\\Vendor\\component.dll");
+        uint32_t flags = static_cast<uint32_t>(k * 2654435761u);
+        hive->SetValue(key, "Flags", kRegDword, reinterpret_cast<const uint8_t*>(&flags), 4);
+        SetText(hive, key, "Name", "Item " + std::to_string(k));
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+// 在随机的深层键上修改：改值、加值、删值、加子键、删键
+static void Mutate(RegHive* hive, const std::vector<std::string>& paths, size_t changes, uint32_t seed) {
+    uint32_t state = seed;
+    for (size_t i = 0; i < changes; i++) {
+        state = state * 1103515245u + 12345u;
+        const std::string& path = paths[(state >> 8) % paths.size()];
+        RegKeyHandle key = NULL;
+        if (hive->OpenKey(path, &key) != kRegSuccess) {
+            continue;
+        }
+        uint32_t value = state;
+        switch (i % 5) {
+        case 0:
+            hive->SetValue(key, "Flags", kRegDword, reinterpret_cast<const uint8_t*>(&value), 4);
+            break;
+        case 1:
+            SetText(hive, key, "Added" + std::to_string(i), "new value");
+            break;
+        case 2:
+            hive->DeleteValue(key, "Name");
+            break;
+        case 3: {
+            RegKeyHandle child = NULL;
+            hive->CreateKey(path + "\\New" + std::to_string(i) + "\\Nested", &child);
+            SetText(hive, child, "", "nested");
+            break;
+        }
+        default:
+            hive->DeleteKeyTree(path);
+            break;
+        }
+    }
+}
+
+// 整棵树：路径 -> 值名 -> (类型, 数据)
+typedef std::map<std::string, std::pair<uint32_t, std::vector<uint8_t> > > ValueMap;
+typedef std::map<std::string, ValueMap> TreeDump;
+
+static void Dump(RegBackend& backend, const std::string& path, TreeDump* dump) {
+    RegKeyHandle key = NULL;
+    if (backend.OpenKey(path, &key) != kRegSuccess) {
+        return;
+    }
+    ValueMap& values = (*dump)[path];
+    std::string name;
+    uint32_t type = 0;
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; backend.EnumValue(key, i, &name, &type, &data) == kRegSuccess; i++) {
+        values[name] = std::make_pair(type, data);
+    }
+    std::vector<std::string> children;
+    for (uint32_t i = 0; backend.EnumSubKey(key, i, &name) == kRegSuccess; i++) {
+        children.push_back(name);
+    }
+    backend.CloseKey(key);
+    for (size_t i = 0; i < children.size(); i++) {
+        Dump(backend, path + "\\" + children[i], dump);
+    }
+}
+
+static std::string ValueLine(const char* mark, const std::string& name, uint32_t type, const std::vector<uint8_t>& data) {
+    std::string line = std::string("  ") + mark + " \"" + name + "\" = ";
+    AppendRegValueData(type, data.data(), data.size(), &line);
+    return line + " (" + GetRegTypeName(type) + ")";
+}
+
+// 参考实现：逐键比较修改前后的整棵树，每个变化一行（值行前加所属键行），排序后返回
+static std::vector<std::string> ReferenceDiff(const TreeDump& before, const TreeDump& after) {
+    std::vector<std::string> lines;
+    for (TreeDump::const_iterator key = after.begin(); key != after.end(); ++key) {
+        TreeDump::const_iterator old = before.find(key->first);
+        std::string header = (old == before.end() ? "[+] " : "[*] ") + key->first;
+        if (old == before.end()) {
+            lines.push_back(header);
+        }
+        for (ValueMap::const_iterator v = key->second.begin(); v != key->second.end(); ++v) {
+            ValueMap::const_iterator previous = old == before.end() ? v : old->second.find(v->first);
+            if (old == before.end() || previous == old->second.end()) {
+                lines.push_back(header + "\t" + ValueLine("+", v->first, v->second.first, v->second.second));
+            } else if (previous->second != v->second) {
+                lines.push_back(header + "\t" + ValueLine("*", v->first, v->second.first, v->second.second));
+            }
+        }
+        for (ValueMap::const_iterator v = old == before.end() ? key->second.end() : old->second.begin();
+             old != before.end() && v != old->second.end(); ++v) {
+            if (key->second.find(v->first) == key->second.end()) {
+                lines.push_back(header + "\t  - \"" + v->first + "\"");
+            }
+        }
+    }
+    // 删除的键只列出子树的根
+    for (TreeDump::const_iterator key = before.begin(); key != before.end(); ++key) {
+        size_t slash = key->first.rfind('\\');
+        if (after.count(key->first) == 0 && after.count(key->first.substr(0, slash)) != 0) {
+            lines.push_back("[-] " + key->first);
+        }
+    }
+    std::sort(lines.begin(), lines.end());
+    return lines;
+}
+
+// 把增量输出转为与参考实现相同的行集合
+static std::vector<std::string> OutputLines(const std::string& output) {
+    std::vector<std::string> lines;
+    std::string header;
+    std::istringstream in(output);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 1, "[") == 0) {
+            header = line;
+            if (line.compare(0, 3, "[*]") != 0) {
+                lines.push_back(line);
+            }
+        } else {
+            lines.push_back(header + "\t" + line);
+        }
+    }
+    std::sort(lines.begin(), lines.end());
+    return lines;
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 对照索引文本增量查询一次，返回输出，newIndex得到新索引
+static std::string RunIncremental(RegBackend& backend, const std::string& indexText, size_t jobs,
+                                  std::string* newIndex, double* seconds, RegIncrementalStats* stats) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RegQueryIndex index;
+    std::istringstream indexIn(indexText);
+    index.Load(indexIn);
+    std::ostringstream out;
+    RegIncrementalQuery query(backend, index, out, jobs);
+    if (!query.Query(std::vector<std::string>(1, kRoot), newIndex)) {
+        std::fprintf(stderr, "incremental query failed\n");
+    }
+    *seconds = Seconds(start);
+    *stats = query.GetStats();
+    return out.str();
+}
+
+static void PrintRun(const char* name, double seconds, SlowCallHive& hive, const RegIncrementalStats* stats) {
+    std::printf("  %-28s %8.3f s  (%s)\n", name, seconds, hive.TakeCallCounts().c_str());
+    if (stats != NULL) {
+        std::printf("  %-28s %zu keys: %zu unchanged, %zu added, %zu modified, %zu deleted; values +%zu *%zu -%zu\n",
+                    "", stats->keys, stats->unchangedKeys, stats->addedKeys, stats->modifiedKeys, stats->deletedKeys,
+                    stats->addedValues, stats->modifiedValues, stats->deletedValues);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 200000;
+    size_t changes = 500;
+    double callMicros = 0;
+    size_t jobs = std::max<size_t>(RegDefaultJobCount(), 4);
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--keys") {
+            keys = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--changes") {
+            changes = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--call-us") {
+            callMicros = std::strtod(argv[i + 1], NULL);
+        } else if (arg == "--jobs") {
+            jobs = std::max<size_t>(static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10)), 1);
+        }
+    }
+
+    SlowCallHive hive(0);
+    std::vector<std::string> paths = BuildTree(&hive, keys);
+    TreeDump before;
+    Dump(hive, kRoot, &before);
+    hive.TakeCallCounts();
+    hive.SetCallDelay(callMicros);
+    std::printf("%zu keys, %zu changes, %.1f us per call, %zu threads\n", keys, changes, callMicros, jobs);
+
+    // 完整查询
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        std::ostringstream out;
+        RegQueryPrinter printer(hive, out, jobs);
+        printer.Query(kRoot);
+    }
+    PrintRun("full query", Seconds(start), hive, NULL);
+
+    // 首次增量查询：全部为新增
+    std::string index;
+    double seconds = 0;
+    RegIncrementalStats stats;
+    std::string first = RunIncremental(hive, std::string(), jobs, &index, &seconds, &stats);
+    PrintRun("first run (empty index)", seconds, hive, &stats);
+    bool ok = stats.addedKeys == before.size();
+
+    // 修改后增量查询
+    hive.SetCallDelay(0);
+    Mutate(&hive, paths, changes, 12345);
+    TreeDump after;
+    Dump(hive, kRoot, &after);
+    hive.TakeCallCounts();
+    hive.SetCallDelay(callMicros);
+    std::string nextIndex;
+    std::string changed = RunIncremental(hive, index, jobs, &nextIndex, &seconds, &stats);
+    PrintRun("after changes", seconds, hive, &stats);
+    std::string serialIndex;
+    RegIncrementalStats serialStats;
+    hive.SetCallDelay(0);
+    std::string serial = RunIncremental(hive, index, 1, &serialIndex, &seconds, &serialStats);
+    hive.TakeCallCounts();
+    bool threadsOk = serial == changed && serialIndex == nextIndex;
+    bool diffOk = OutputLines(changed) == ReferenceDiff(before, after);
+    std::printf("  1 and %zu threads: %s\n", jobs, threadsOk ? "identical" : "DIFFER");
+    std::printf("  changes: %s\n", diffOk ? "identical to full-tree comparison" : "DIFFER FROM FULL-TREE COMPARISON");
+
+    // 没有修改
+    hive.SetCallDelay(callMicros);
+    std::string finalIndex;
+    std::string unchanged = RunIncremental(hive, nextIndex, jobs, &finalIndex, &seconds, &stats);
+    PrintRun("no changes", seconds, hive, &stats);
+    bool unchangedOk = unchanged.empty() && finalIndex == nextIndex;
+    std::printf("  no changes: %s\n", unchangedOk ? "empty output, same index" : "UNEXPECTED OUTPUT");
+
+    // 某组无法打开：不报告删除，索引不变；恢复后没有变化
+    hive.SetCallDelay(0);
+    hive.SetDeniedPath(std::string(kRoot) + "\\Group07");
+    std::string deniedIndex;
+    std::string denied = RunIncremental(hive, nextIndex, jobs, &deniedIndex, &seconds, &stats);
+    hive.SetDeniedPath(std::string());
+    std::string restoredIndex;
+    std::string restored = RunIncremental(hive, deniedIndex, jobs, &restoredIndex, &seconds, &stats);
+    hive.TakeCallCounts();
+    bool deniedOk = denied.empty() && deniedIndex == nextIndex && restored.empty() && restoredIndex == nextIndex;
+    std::printf("  unreadable subtree: %s\n", deniedOk ? "kept in index, not reported deleted" : "REPORTED AS DELETED");
+
+    ok = ok && threadsOk && diffOk && unchangedOk && deniedOk && !first.empty();
+    return ok ? 0 : 1;
+}
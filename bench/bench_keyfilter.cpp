@@ -0,0 +1,330 @@
+/*
+ * 静默注册表导入程序 - 键路径/值名过滤基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_keyfilter [--keys N] [--open-us U] [--jobs J]
+ * 在内存配置单元中构造类似HKLM\SOFTWARE的树（Classes和WOW6432Node占大部分，
+ * 厂商键下有少量Policies子树），对几组常见的包含/排除模式：
+ * - 比较整棵树查询和过滤查询的耗时，报告访问的键数和剪掉的键数
+ * - 比较整棵树导出和过滤导出的耗时
+ * - 校验：1个和J个线程的过滤查询输出，与整棵树的查询输出按逐条匹配完整路径的
+ *   参考实现过滤后的结果逐字节相同
+ * --open-us为每次打开键附加的忙等时间，模拟真实注册表的系统调用开销
+ */
+
+#include "reg_export.h"
+#include "reg_hive.h"
+#include "reg_keyfilter.h"
+#include "reg_parallel.h"
+#include "reg_query.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 打开键时附加固定延迟并计数的配置单元
+class SlowOpenHive : public RegHive {
+public:
+    explicit SlowOpenHive(double openMicros) : m_openMicros(openMicros), m_opens(0) {}
+
+    long OpenKey(const std::string& keyPath, RegKeyHandle* key) override {
+        m_opens++;
+        if (m_openMicros > 0) {
+            std::chrono::steady_clock::time_point until =
+                std::chrono::steady_clock::now() +
+                std::chrono::nanoseconds(static_cast<long long>(m_openMicros * 1000.0));
+            while (std::chrono::steady_clock::now() < until) {
+            }
+        }
+        return RegHive::OpenKey(keyPath, key);
+    }
+
+    size_t TakeOpenCount() { return m_opens.exchange(0); }
+
+private:
+    double m_openMicros;
+    std::atomic<size_t> m_opens;
+};
+
+// 构造树：一半键在Classes下，四分之一在WOW6432Node下，其余在厂商键下（其中八分之一在Policies下）
+static void BuildTree(RegHive* hive, size_t keys) {
+    char path[200];
+    uint8_t data[16];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+    std::vector<uint8_t> text;
+    Utf8ToUtf16Le("C:\\Windows\\System32\\component.dll", 34, &text);
+    text.push_back(0);
+    text.push_back(0);
+    for (size_t k = 0; k < keys; k++) {
+        size_t slot = k % 8;
+        if (slot < 4) {
+            std::snprintf(path, sizeof(path),
+                          "HKEY_LOCAL_MACHINE\\SOFTWARE\\Classes\\CLSID\\{%08zX-0000}\\InprocServer%zu", k / 4, k % 3);
+        } else if (slot < 6) {
+            std::snprintf(path, sizeof(path), "HKEY_LOCAL_MACHINE\\SOFTWARE\\WOW6432Node\\Vendor%02zu\\Item%07zu",
+                          k % 37, k);
+        } else if (k % 64 == 6) {
+            std::snprintf(path, sizeof(path),
+                          "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor%02zu\\Product%03zu\\Policies\\Rule%07zu", k % 13,
+                          k % 29, k);
+        } else {
+            std::snprintf(path, sizeof(path),
+                          "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor%02zu\\Product%03zu\\Settings\\Item%07zu", k % 13,
+                          k % 29, k);
+        }
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        hive->SetValue(key, "", kRegSz, text.data(), text.size());
+        hive->SetValue(key, "Flags", kRegDword, data, 4);
+        hive->SetValue(key, "Data", kRegBinary, data, sizeof(data));
+    }
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 一组过滤条件
+struct FilterCase {
+    const char* name;
+    std::vector<std::string> includeKeys;
+    std::vector<std::string> excludeKeys;
+    std::vector<std::string> includeValues;
+    std::vector<std::string> excludeValues;
+};
+
+// 参考实现：按'\'拆分并转为小写，不含'\'的模式前加**
+static std::vector<std::string> ReferenceLevels(const std::string& pattern) {
+    std::vector<std::string> levels;
+    if (pattern.find('\\') == std::string::npos) {
+        levels.push_back("**");
+    }
+    std::string level;
+    for (size_t i = 0; i <= pattern.size(); i++) {
+        if (i == pattern.size() || pattern[i] == '\\') {
+            if (!level.empty()) {
+                levels.push_back(level);
+            }
+            level.clear();
+        } else {
+            level += RegAsciiLower(pattern[i]);
+        }
+    }
+    return levels;
+}
+
+// 参考实现：完整相对路径与模式逐级递归匹配（**匹配零到多级）
+static bool ReferenceMatch(const std::vector<std::string>& levels, size_t i, const std::vector<std::string>& parts,
+                           size_t j) {
+    if (i == levels.size()) {
+        return j == parts.size();
+    }
+    if (levels[i] == "**") {
+        for (size_t k = j; k <= parts.size(); k++) {
+            if (ReferenceMatch(levels, i + 1, parts, k)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return j < parts.size() && RegKeyGlobMatch(levels[i], parts[j].data(), parts[j].size()) &&
+           ReferenceMatch(levels, i + 1, parts, j + 1);
+}
+
+static bool ReferenceMatchAny(const std::vector<std::string>& patterns, const std::vector<std::string>& parts) {
+    for (size_t i = 0; i < patterns.size(); i++) {
+        if (ReferenceMatch(ReferenceLevels(patterns[i]), 0, parts, 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 参考实现：自身或任一上级匹配排除模式时不输出，有包含模式时自身须匹配其一
+static bool ReferenceKeySelected(const FilterCase& filter, const std::string& relative) {
+    std::vector<std::string> parts;
+    for (size_t start = 0, end; start < relative.size(); start = end + 1) {
+        end = relative.find('\\', start);
+        if (end == std::string::npos) {
+            end = relative.size();
+        }
+        parts.push_back(relative.substr(start, end - start));
+    }
+    for (size_t n = 0; n <= parts.size(); n++) {
+        if (ReferenceMatchAny(filter.excludeKeys, std::vector<std::string>(parts.begin(), parts.begin() + n))) {
+            return false;
+        }
+    }
+    return filter.includeKeys.empty() || ReferenceMatchAny(filter.includeKeys, parts);
+}
+
+static bool ReferenceValueMatchAny(const std::vector<std::string>& patterns, const std::string& name) {
+    for (size_t i = 0; i < patterns.size(); i++) {
+        std::string pattern = patterns[i];
+        for (size_t k = 0; k < pattern.size(); k++) {
+            pattern[k] = RegAsciiLower(pattern[k]);
+        }
+        if (RegKeyGlobMatch(pattern, name.data(), name.size())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ReferenceValueSelected(const FilterCase& filter, const std::string& name) {
+    std::string matched = name.empty() ? "@" : name;
+    return !ReferenceValueMatchAny(filter.excludeValues, matched) &&
+           (filter.includeValues.empty() || ReferenceValueMatchAny(filter.includeValues, matched));
+}
+
+// 按参考实现过滤整棵树的查询文本：键行（缩进后为路径）决定其后的值行是否保留
+static std::string ReferenceFilter(const std::string& full, const std::string& root, const FilterCase& filter) {
+    std::string result;
+    bool keySelected = false;
+    size_t start = 0;
+    while (start < full.size()) {
+        size_t end = full.find('\n', start) + 1;
+        std::string line = full.substr(start, end - start);
+        start = end;
+        size_t indent = line.find_first_not_of(' ');
+        if (line[indent] == '"') {
+            size_t nameEnd = line.find("\" = ", indent + 1);
+            if (keySelected && ReferenceValueSelected(filter, line.substr(indent + 1, nameEnd - indent - 1))) {
+                result += line;
+            }
+            continue;
+        }
+        std::string path = line.substr(indent, line.size() - indent - 1);
+        if (path.compare(0, 2, "[ ") == 0) {
+            path = path.substr(2, path.size() - 4);
+        }
+        std::string relative = path.size() > root.size() ? path.substr(root.size() + 1) : std::string();
+        keySelected = ReferenceKeySelected(filter, relative);
+        if (keySelected) {
+            result += line;
+        }
+    }
+    return result;
+}
+
+static void ApplyCase(const FilterCase& filterCase, RegKeyFilter* filter) {
+    std::string error;
+    for (size_t i = 0; i < filterCase.includeKeys.size(); i++) {
+        filter->AddKeyPattern(filterCase.includeKeys[i], true, &error);
+    }
+    for (size_t i = 0; i < filterCase.excludeKeys.size(); i++) {
+        filter->AddKeyPattern(filterCase.excludeKeys[i], false, &error);
+    }
+    for (size_t i = 0; i < filterCase.includeValues.size(); i++) {
+        filter->AddValuePattern(filterCase.includeValues[i], true);
+    }
+    for (size_t i = 0; i < filterCase.excludeValues.size(); i++) {
+        filter->AddValuePattern(filterCase.excludeValues[i], false);
+    }
+}
+
+static double ExportSeconds(RegHive& hive, const std::vector<std::string>& roots, const RegKeyFilter* filter,
+                            size_t jobs, size_t* keys) {
+    size_t bytes = 0;
+    RegExporter exporter(hive, [&bytes](const uint8_t*, size_t size) {
+        bytes += size;
+        return true;
+    }, 1024 * 1024, jobs);
+    exporter.SetFilter(filter);
+    std::string error;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    exporter.Export(roots, &error);
+    *keys = exporter.GetStats().keys;
+    return Seconds(start);
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 200000;
+    double openMicros = 0;
+    size_t jobs = RegDefaultJobCount();
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--keys") {
+            keys = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--open-us") {
+            openMicros = std::atof(argv[i + 1]);
+        } else if (arg == "--jobs") {
+            jobs = std::max<size_t>(static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10)), 1);
+        }
+    }
+
+    SlowOpenHive hive(openMicros);
+    BuildTree(&hive, keys);
+    std::printf("hive: %zu keys, %zu values, open latency %.1f us, %zu jobs\n", hive.GetKeyCount(),
+                hive.GetValueCount(), openMicros, jobs);
+
+    const std::string root = "HKEY_LOCAL_MACHINE\\SOFTWARE";
+    std::vector<std::string> roots(1, root);
+    std::ostringstream fullOut;
+    RegQueryPrinter fullPrinter(hive, fullOut, jobs);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    fullPrinter.Query(roots);
+    double fullQuerySeconds = Seconds(start);
+    size_t fullOpens = hive.TakeOpenCount();
+    size_t fullExportKeys = 0;
+    double fullExportSeconds = ExportSeconds(hive, roots, NULL, jobs, &fullExportKeys);
+    hive.TakeOpenCount();
+    std::printf("%-34s query %8.1f ms  export %8.1f ms  %8zu keys opened\n", "(no filter)", fullQuerySeconds * 1e3,
+                fullExportSeconds * 1e3, fullOpens);
+
+    std::vector<FilterCase> cases(5);
+    cases[0].name = "exclude \\Classes, \\WOW6432Node";
+    cases[0].excludeKeys.push_back("\\Classes");
+    cases[0].excludeKeys.push_back("\\WOW6432Node");
+    cases[1].name = "include **\\Policies\\**";
+    cases[1].includeKeys.push_back("**\\Policies\\**");
+    cases[2].name = "include Vendor0?\\Product00?\\*";
+    cases[2].includeKeys.push_back("Vendor0?\\Product00?\\*");
+    cases[3].name = "include rule000*, exclude Vendor03";
+    cases[3].includeKeys.push_back("rule000*");
+    cases[3].excludeKeys.push_back("Vendor03");
+    cases[4].name = "exclude Classes, values @ and Flags";
+    cases[4].excludeKeys.push_back("Classes");
+    cases[4].includeValues.push_back("@");
+    cases[4].includeValues.push_back("fl*");
+
+    bool ok = true;
+    for (size_t c = 0; c < cases.size(); c++) {
+        RegKeyFilter filter;
+        ApplyCase(cases[c], &filter);
+        std::string expected = ReferenceFilter(fullOut.str(), root, cases[c]);
+
+        bool identical = true;
+        double querySeconds = 0;
+        RegTraversalStats stats;
+        const size_t jobCounts[] = {1, jobs};
+        for (size_t j = 0; j < 2; j++) {
+            std::ostringstream out;
+            RegQueryPrinter printer(hive, out, jobCounts[j]);
+            printer.SetFilter(&filter);
+            start = std::chrono::steady_clock::now();
+            printer.Query(roots);
+            querySeconds = Seconds(start);
+            stats = printer.GetTraversalStats();
+            identical = identical && out.str() == expected;
+        }
+        size_t opens = hive.TakeOpenCount() / 2;
+        size_t exportKeys = 0;
+        double exportSeconds = ExportSeconds(hive, roots, &filter, jobs, &exportKeys);
+        hive.TakeOpenCount();
+        std::printf("%-34s query %8.1f ms  export %8.1f ms  %8zu keys opened (%zu visited, %zu pruned), "
+                    "%zu exported  x%.1f  %s\n",
+                    cases[c].name, querySeconds * 1e3, exportSeconds * 1e3, opens, stats.keys, stats.pruned,
+                    exportKeys, fullQuerySeconds / querySeconds, identical ? "identical to post-filter" : "DIFFERS");
+        ok = ok && identical && opens == stats.keys;
+    }
+    return ok ? 0 : 1;
+}
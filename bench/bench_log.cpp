@@ -0,0 +1,130 @@
+/*
+ * 静默注册表导入程序 - 异步日志基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_log [--messages N] [--threads T] [--capacity C] [file]
+ * T个线程各记录N条典型长度的调试消息，写入指定文件（默认临时文件），对比：
+ * - 同步写入：每条消息加锁、格式化时间戳、写入并flush（原WriteLog的做法）
+ * - 异步写入：入队后立即返回，后台线程批量写入
+ * 报告调用方看到的每条消息耗时、包含写完全部消息的总吞吐量和丢弃数
+ */
+
+#include "reg_log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 模拟查询模式的逐值日志
+static std::string Message(size_t thread, size_t index) {
+    return "  Value: InstallLocation" + std::to_string(thread) + " (REG_SZ) = C:\\Program Files\\Vendor\\Product\\" +
+           std::to_string(index);
+}
+
+// 在T个线程上并行调用log，返回调用方耗时
+template <typename Function>
+static double RunProducers(size_t threads, size_t messages, Function log) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.push_back(std::thread([t, messages, &log]() {
+            for (size_t i = 0; i < messages; i++) {
+                log(Message(t, i));
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+    return Seconds(start);
+}
+
+static void Report(const char* label, double callerSeconds, double totalSeconds, size_t total, size_t dropped) {
+    std::printf("%-6s %8.0f ns/call (caller)  %10.0f msgs/s (end to end)  dropped %zu\n", label,
+                callerSeconds * 1e9 / static_cast<double>(total), static_cast<double>(total - dropped) / totalSeconds,
+                dropped);
+}
+
+int main(int argc, char** argv) {
+    size_t messages = 200000;
+    size_t threads = 4;
+    size_t capacity = 8192;
+    std::string path = "bench_log_output.log";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--messages" && i + 1 < argc) {
+            messages = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--capacity" && i + 1 < argc) {
+            capacity = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else {
+            path = arg;
+        }
+    }
+    size_t total = messages * threads;
+    std::printf("%zu threads x %zu messages, ring capacity %zu, output %s\n", threads, messages, capacity,
+                path.c_str());
+
+    // 同步写入（与原WriteLog相同：每条消息格式化时间戳并flush）
+    {
+        std::ofstream file(path.c_str(), std::ios::out | std::ios::trunc);
+        std::mutex mutex;
+        double seconds = RunProducers(threads, messages, [&](const std::string& message) {
+            std::lock_guard<std::mutex> lock(mutex);
+            time_t now = std::time(NULL);
+            tm localTime;
+            localtime_r(&now, &localTime);
+            char timestamp[32];
+            std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &localTime);
+            file << "[" << timestamp << "] " << message << std::endl;
+            file.flush();
+        });
+        Report("sync", seconds, seconds, total, 0);
+    }
+
+    // 异步写入
+    {
+        std::ofstream file(path.c_str(), std::ios::out | std::ios::trunc);
+        RegAsyncLogger logger(capacity);
+        logger.Start([&file](const char* data, size_t size) {
+            file.write(data, static_cast<std::streamsize>(size));
+            file.flush();
+        });
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        double callerSeconds = RunProducers(threads, messages, [&logger](const std::string& message) {
+            logger.Log(kRegLogDebug, message);
+        });
+        logger.Stop();
+        double totalSeconds = Seconds(start);
+        RegLogStats stats = logger.GetStats();
+        Report("async", callerSeconds, totalSeconds, total, stats.dropped);
+        std::printf("       %zu batches, %.0f messages per batch\n", stats.batches,
+                    static_cast<double>(stats.written) / static_cast<double>(stats.batches == 0 ? 1 : stats.batches));
+    }
+
+    // 过滤掉的级别只做一次比较
+    {
+        RegAsyncLogger logger(capacity);
+        logger.SetLevel(kRegLogInfo);
+        double seconds = RunProducers(threads, messages, [&logger](const std::string& message) {
+            logger.Log(kRegLogDebug, message);
+        });
+        Report("filter", seconds, seconds, total, 0);
+    }
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * 静默注册表导入程序 - 文件清单基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_manifest [--lines N] [--batch N]
+ * 生成一个N行的清单（默认500000行，含注释、空行、带空格的路径和priority/hive选项）：
+ * - 逐行读取的耗时和每秒行数
+ * - 与--manifest相同的分批读取（首批N个，之后加倍到256）时的首批延迟和内存峰值增量，
+ *   与先把整个清单读入内存的方式对比（内存峰值取自getrusage，流式在前测量）
+ * - 行解析和命令行拆分的正确性校验
+ */
+
+#include "reg_manifest.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 进程内存峰值（KB）
+static long PeakRssKb() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static size_t WriteManifest(const std::string& path, size_t lines) {
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out << "\xEF\xBB\xBF# generated manifest\r\n";
+    size_t entries = 0;
+    char line[256];
+    for (size_t i = 0; i < lines; i++) {
+        switch (i % 8) {
+        case 0:
+            std::snprintf(line, sizeof(line), "C:\\Policies\\Site %03zu\\policy_%zu.reg priority=%d\r\n", i % 500, i,
+                          static_cast<int>(i % 7) - 3);
+            break;
+        case 1:
+            std::snprintf(line, sizeof(line), "\"C:\\Policy Files\\user_%zu.reg\"\thive=HKU\\.DEFAULT\r\n", i);
+            break;
+        case 2:
+            std::snprintf(line, sizeof(line), "; comment %zu\r\n", i);
+            out << line;
+            continue;
+        case 3:
+            out << "\r\n";
+            continue;
+        default:
+            std::snprintf(line, sizeof(line), "policies\\group_%zu\\*.reg\r\n", i);
+            break;
+        }
+        out << line;
+        entries++;
+    }
+    return entries;
+}
+
+struct Check {
+    const char* line;
+    bool valid;
+    const char* path;
+    int priority;
+    const char* hive;
+};
+
+int main(int argc, char** argv) {
+    size_t lineCount = 500000;
+    size_t firstBatch = 8;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--lines" && i + 1 < argc) {
+            lineCount = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            firstBatch = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        }
+    }
+    if (firstBatch == 0) {
+        firstBatch = 1;
+    }
+    std::string path = "bench_manifest.txt";
+    size_t expected = WriteManifest(path, lineCount);
+    std::string error;
+
+    // 流式读取：每批取出后丢弃，只保留当前批
+    long rssBefore = PeakRssKb();
+    RegManifestReader streaming;
+    if (!streaming.Open(path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double firstBatchSeconds = 0;
+    size_t batchSize = firstBatch;
+    size_t batches = 0;
+    size_t streamed = 0;
+    std::vector<RegManifestEntry> batch;
+    RegManifestEntry entry;
+    bool more = true;
+    while (more) {
+        batch.clear();
+        while (batch.size() < batchSize && (more = streaming.Next(&entry))) {
+            batch.push_back(entry);
+        }
+        if (batch.empty()) {
+            break;
+        }
+        std::stable_sort(batch.begin(), batch.end(), [](const RegManifestEntry& a, const RegManifestEntry& b) {
+            return a.priority < b.priority;
+        });
+        if (batches == 0) {
+            firstBatchSeconds = Seconds(start);
+        }
+        batches++;
+        streamed += batch.size();
+        batchSize = std::min<size_t>(batchSize * 2, 256);
+    }
+    double streamSeconds = Seconds(start);
+    long streamRss = PeakRssKb() - rssBefore;
+
+    // 整表读入：全部条目读入内存后才能开始第一批
+    rssBefore = PeakRssKb();
+    RegManifestReader whole;
+    whole.Open(path, &error);
+    start = std::chrono::steady_clock::now();
+    std::vector<RegManifestEntry> all;
+    while (whole.Next(&entry)) {
+        all.push_back(entry);
+    }
+    double wholeSeconds = Seconds(start);
+    long wholeRss = PeakRssKb() - rssBefore;
+
+    bool countOk = streamed == expected && all.size() == expected && streaming.GetInvalidCount() == 0;
+    std::printf("%zu lines, %zu entries: %.1f ms, %.0f lines/s (%s)\n", streaming.GetLineCount(), streamed,
+                streamSeconds * 1000.0, static_cast<double>(streaming.GetLineCount()) / streamSeconds,
+                countOk ? "ok" : "WRONG COUNT");
+    std::printf("streaming:    first batch of %zu after %8.3f ms, %zu batches, peak memory +%ld KB\n", firstBatch,
+                firstBatchSeconds * 1000.0, batches, streamRss);
+    std::printf("materialized: first batch after %8.3f ms (whole list),  peak memory +%ld KB\n", wholeSeconds * 1000.0,
+                wholeRss);
+    all.clear();
+    std::remove(path.c_str());
+
+    // 行解析校验
+    const Check checks[] = {
+        {"C:\\a.reg", true, "C:\\a.reg", 0, ""},
+        {"  C:\\My Files\\a b.reg  ", true, "C:\\My Files\\a b.reg", 0, ""},
+        {"C:\\My Files\\a.reg priority=5", true, "C:\\My Files\\a.reg", 5, ""},
+        {"C:\\x.reg  hive=HKU\\.DEFAULT\\  PRIORITY=-2", true, "C:\\x.reg", -2, "HKEY_USERS\\.DEFAULT"},
+        {"\"C:\\dir priority=1\\a.reg\" priority=3", true, "C:\\dir priority=1\\a.reg", 3, ""},
+        {"C:\\Tab Dir\\a.reg\tpriority=1 hive=HKCU", true, "C:\\Tab Dir\\a.reg", 1, "HKEY_CURRENT_USER"},
+        {"C:\\a=b.reg", true, "C:\\a=b.reg", 0, ""},
+        {"# comment", false, "", 0, ""},
+        {"; comment", false, "", 0, ""},
+        {"   \r", false, "", 0, ""},
+        {"\"C:\\open.reg priority=1", false, "", 0, ""},
+        {"\"C:\\a.reg\" priority=high", false, "", 0, ""},
+        {"\"C:\\a.reg\" color=red", false, "", 0, ""},
+        {"C:\\a.reg hive=HKXX", false, "", 0, ""},
+        {"\"\" priority=1", false, "", 0, ""},
+    };
+    size_t parseFailures = 0;
+    for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        const Check& check = checks[i];
+        RegManifestEntry parsed;
+        bool valid = ParseRegManifestLine(check.line, &parsed, &error);
+        bool ok = valid == check.valid;
+        if (ok && valid) {
+            ok = parsed.path == check.path && parsed.priority == check.priority && parsed.hive == check.hive;
+        }
+        if (!ok) {
+            parseFailures++;
+            std::printf("  parse mismatch: [%s] -> %d [%s] %d [%s] %s\n", check.line, valid ? 1 : 0,
+                        parsed.path.c_str(), parsed.priority, parsed.hive.c_str(), error.c_str());
+        }
+    }
+
+    // 命令行拆分校验
+    std::vector<std::string> args = RegSplitArguments("a.reg  \"C:\\My Dir\\b.reg\" @\"C:\\Lists\\c d.txt\" \"\" e");
+    bool splitOk = args.size() == 5 && args[0] == "a.reg" && args[1] == "C:\\My Dir\\b.reg" &&
+                   args[2] == "@C:\\Lists\\c d.txt" && args[3].empty() && args[4] == "e";
+    std::printf("line parsing: %zu mismatches, argument splitting: %s\n", parseFailures, splitOk ? "ok" : "WRONG");
+    return countOk && parseFailures == 0 && splitOk ? 0 : 1;
+}
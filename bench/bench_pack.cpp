@@ -0,0 +1,285 @@
+/*
+ * 静默注册表导入程序 - 预编译导入包基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_pack [--files N] [--keys N] [file.reg ...]
+ * 把合成的（或指定的）.reg文件编译为导入包，对比：
+ * - 逐个解析后写入与映射导入包后写入的耗时（写入空后端，只统计应用开销）
+ * - 两种方式每个值的内存分配次数（通过替换全局operator new统计）
+ * 并校验：两种方式写入内存配置单元后的导出结果一致，损坏或截断的导入包被拒绝
+ */
+
+#include "reg_export.h"
+#include "reg_hive.h"
+#include "reg_pack.h"
+#include "reg_plan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+// GCC内联std::allocator后会把替换的operator delete中的free误判为与operator new不匹配
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<size_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 只统计写入的空后端
+class NullBackend : public RegBackend {
+public:
+    NullBackend() : values(0), bytes(0) {}
+    size_t values;
+    size_t bytes;
+
+    long OpenKey(const std::string&, RegKeyHandle* key) override {
+        *key = this;
+        return kRegSuccess;
+    }
+    long CreateKey(const std::string&, RegKeyHandle* key) override {
+        *key = this;
+        return kRegSuccess;
+    }
+    void CloseKey(RegKeyHandle) override {}
+    long DeleteKeyTree(const std::string&) override { return kRegSuccess; }
+    long QueryKeyInfo(RegKeyHandle, RegKeyInfo* info) override {
+        *info = RegKeyInfo();
+        return kRegSuccess;
+    }
+    long EnumSubKey(RegKeyHandle, uint32_t, std::string*) override { return kRegErrorNoMoreItems; }
+    long EnumValue(RegKeyHandle, uint32_t, std::string*, uint32_t*, std::vector<uint8_t>*) override {
+        return kRegErrorNoMoreItems;
+    }
+    long QueryValue(RegKeyHandle, const std::string&, uint32_t*, std::vector<uint8_t>*) override {
+        return kRegErrorNotFound;
+    }
+    long SetValue(RegKeyHandle, const std::string&, uint32_t, const uint8_t*, size_t size) override {
+        values++;
+        bytes += size;
+        return kRegSuccess;
+    }
+    long DeleteValue(RegKeyHandle, const std::string&) override { return kRegSuccess; }
+};
+
+// 生成一个合成的策略文件（UTF-16LE带BOM），各文件的键部分重叠
+static std::string GenerateRegFile(size_t file, size_t keys) {
+    std::string text = "Windows Registry Editor Version 5.00\r\n";
+    for (size_t k = 0; k < keys; k++) {
+        size_t key = file * keys / 2 + k;
+        text += "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE\\Policies\\Vendor\\Product" + std::to_string(key / 64) +
+                "\\Setting" + std::to_string(key) + "]\r\n";
+        text += "\"Enabled\"=dword:0000000" + std::to_string(file % 10) + "\r\n";
+        text += "\"Path\"=\"C:\\\\Program Files\\\\Vendor\\\\" + std::to_string(key) + "\"\r\n";
+        text += "\"Data\"=hex:01,02,03,04,05,06,07,08,09,0a,0b,0c,0d,0e,0f,10\r\n";
+    }
+    std::vector<uint8_t> utf16;
+    utf16.push_back(0xFF);
+    utf16.push_back(0xFE);
+    Utf8ToUtf16Le(text.data(), text.size(), &utf16);
+    return std::string(reinterpret_cast<const char*>(utf16.data()), utf16.size());
+}
+
+static bool WriteFile(const std::string& path, const std::string& data) {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+// 按键导出后把每个键的值行排序（合并规划按名称排序值，逐个导入按写入顺序）
+static std::string CanonicalText(RegBackend& backend) {
+    std::string output;
+    RegExporter exporter(backend, [&output](const uint8_t* data, size_t size) {
+        output.append(reinterpret_cast<const char*>(data), size);
+        return true;
+    });
+    std::string error;
+    std::vector<std::string> roots(1, "HKEY_LOCAL_MACHINE\\SOFTWARE");
+    exporter.Export(roots, &error);
+
+    std::string canonical;
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string::npos) {
+            end = output.size();
+        }
+        std::string line = output.substr(start, end - start);
+        start = end + 1;
+        if (!line.empty() && line[0] == '[') {
+            std::sort(lines.begin(), lines.end());
+            for (size_t i = 0; i < lines.size(); i++) {
+                canonical += lines[i] + "\n";
+            }
+            lines.clear();
+            canonical += line + "\n";
+        } else {
+            lines.push_back(line);
+        }
+    }
+    std::sort(lines.begin(), lines.end());
+    for (size_t i = 0; i < lines.size(); i++) {
+        canonical += lines[i] + "\n";
+    }
+    return canonical;
+}
+
+// 逐个解析并写入（与不编译时的导入路径相同）
+static void ApplyText(const std::vector<std::string>& files, RegBackend& backend) {
+    RegApplier applier(backend, false);
+    for (size_t i = 0; i < files.size(); i++) {
+        RegFileParser parser([&applier](const RegOp& op) { applier.Apply(op); });
+        std::string error;
+        ParseRegFile(files[i], parser, &error);
+        applier.CloseCurrentKey();
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t fileCount = 8;
+    size_t keys = 20000;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--files" && i + 1 < argc) {
+            fileCount = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--keys" && i + 1 < argc) {
+            keys = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else {
+            files.push_back(arg);
+        }
+    }
+    bool synthetic = files.empty();
+    if (synthetic) {
+        for (size_t i = 0; i < fileCount; i++) {
+            files.push_back("bench_pack_input_" + std::to_string(i) + ".reg");
+            WriteFile(files[i], GenerateRegFile(i, keys));
+        }
+    }
+
+    // 编译：解析、合并规划、写出
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RegWritePlanner planner;
+    size_t sourceBytes = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        RegParsedFile parsed;
+        ParseRegFileToOps(files[i], Latin1ToUtf8, &parsed);
+        if (!parsed.parsed) {
+            std::fprintf(stderr, "Parse failed: %s\n", parsed.error.c_str());
+            return 1;
+        }
+        for (size_t j = 0; j < parsed.ops.size(); j++) {
+            planner.Add(parsed.ops[j], i);
+        }
+        std::ifstream source(files[i].c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+        sourceBytes += static_cast<size_t>(source.tellg());
+    }
+    std::vector<RegOp> ops;
+    std::vector<size_t> sources;
+    planner.Build(&ops, &sources);
+    RegPackWriter writer;
+    writer.SetSourceCount(static_cast<uint32_t>(files.size()));
+    for (size_t i = 0; i < ops.size(); i++) {
+        writer.Add(ops[i]);
+    }
+    std::string packData;
+    writer.Write([&packData](const uint8_t* data, size_t size) {
+        packData.append(reinterpret_cast<const char*>(data), size);
+        return true;
+    });
+    double compileSeconds = Seconds(start);
+    const std::string packPath = "bench_pack_output.regpack";
+    WriteFile(packPath, packData);
+    std::printf("compile   %zu files (%.1f MB) -> %zu ops on %zu keys, %.1f MB in %.3f s (%zu ops eliminated)\n",
+                files.size(), static_cast<double>(sourceBytes) / (1024.0 * 1024.0), writer.GetOpCount(),
+                writer.GetKeyCount(), static_cast<double>(packData.size()) / (1024.0 * 1024.0), compileSeconds,
+                planner.GetStats().Eliminated());
+
+    // 解析写入与导入包写入（空后端）
+    NullBackend textBackend;
+    size_t allocations = g_allocations;
+    start = std::chrono::steady_clock::now();
+    ApplyText(files, textBackend);
+    double textSeconds = Seconds(start);
+    size_t textAllocations = g_allocations - allocations;
+
+    NullBackend packBackend;
+    std::string error;
+    start = std::chrono::steady_clock::now();
+    RegPack pack;
+    if (!pack.Open(packPath, &error)) {
+        std::fprintf(stderr, "Open failed: %s\n", error.c_str());
+        return 1;
+    }
+    double loadSeconds = Seconds(start);
+    allocations = g_allocations;
+    {
+        RegApplier applier(packBackend, false);
+        pack.Apply(applier);
+    }
+    double packSeconds = Seconds(start);
+    size_t packAllocations = g_allocations - allocations;
+
+    std::printf("text      parse+apply %7.3f s  %9.0f values/s  %6.2f allocations/value (%zu values)\n", textSeconds,
+                static_cast<double>(textBackend.values) / textSeconds,
+                static_cast<double>(textAllocations) / static_cast<double>(textBackend.values), textBackend.values);
+    std::printf("pack      map+verify %7.3f s, apply total %7.3f s  %9.0f values/s  %6.2f allocations/value "
+                "(%zu values, %.1fx faster)\n",
+                loadSeconds, packSeconds, static_cast<double>(packBackend.values) / packSeconds,
+                static_cast<double>(packAllocations) / static_cast<double>(packBackend.values), packBackend.values,
+                textSeconds / packSeconds);
+
+    // 写入内存配置单元后结果一致
+    RegHive textHive;
+    ApplyText(files, textHive);
+    RegHive packHive;
+    {
+        RegApplier applier(packHive, false);
+        pack.Apply(applier);
+    }
+    bool identical = CanonicalText(textHive) == CanonicalText(packHive);
+
+    // 损坏和截断的导入包被拒绝
+    std::vector<uint64_t> aligned((packData.size() + 7) / 8);
+    std::memcpy(aligned.data(), packData.data(), packData.size());
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(aligned.data());
+    RegPack probe;
+    bool truncatedRejected = !probe.Attach(bytes, packData.size() - 1, &error);
+    bytes[packData.size() / 2] ^= 0x40;
+    bool corruptRejected = !probe.Attach(bytes, packData.size(), &error);
+    std::printf("checks: hive %s, corrupt pack %s, truncated pack %s\n", identical ? "identical" : "DIFFERS",
+                corruptRejected ? "rejected" : "ACCEPTED", truncatedRejected ? "rejected" : "ACCEPTED");
+
+    std::remove(packPath.c_str());
+    if (synthetic) {
+        for (size_t i = 0; i < files.size(); i++) {
+            std::remove(files[i].c_str());
+        }
+    }
+    return identical && corruptRejected && truncatedRejected ? 0 : 1;
+}
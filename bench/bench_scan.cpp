@@ -0,0 +1,177 @@
+/*
+ * 静默注册表导入程序 - 文本扫描与编码转换吞吐量基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_scan [--size MB] [export.reg ...]
+ * 不指定文件时生成合成的UTF-16LE regedit导出数据
+ * 对每个可用的指令集级别（scalar/sse2/avx2）分别测量MB/s
+ */
+
+#include "reg_parser.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// 生成合成的REGEDIT5导出（UTF-16LE带BOM）
+static std::string GenerateSyntheticExport(size_t targetBytes) {
+    std::string text = "Windows Registry Editor Version 5.00\r\n";
+    unsigned seed = 12345;
+    size_t key = 0;
+    while (text.size() * 2 < targetBytes) {
+        text += "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE\\Classes\\CLSID\\{" + std::to_string(100000 + key) +
+                "-0000-0000-C000-000000000046}\\InprocServer32]\r\n";
+        text += "@=\"C:\\\\Windows\\\\System32\\\\ole32.dll\"\r\n";
+        text += "\"ThreadingModel\"=\"Both\"\r\n";
+        text += "\"Flags\"=dword:" + std::string("0000001f") + "\r\n";
+        text += "\"Data\"=hex:";
+        for (int i = 0; i < 48; i++) {
+            seed = seed * 1103515245u + 12345u;
+            char hex[4];
+            std::snprintf(hex, sizeof(hex), "%02x", (seed >> 16) & 0xFF);
+            text += hex;
+            if (i != 47) {
+                text += (i % 24 == 23) ? ",\\\r\n  " : ",";
+            }
+        }
+        text += "\r\n";
+        key++;
+    }
+    std::vector<uint8_t> utf16;
+    utf16.push_back(0xFF);
+    utf16.push_back(0xFE);
+    Utf8ToUtf16Le(text.data(), text.size(), &utf16);
+    return std::string(reinterpret_cast<const char*>(utf16.data()), utf16.size());
+}
+
+static bool ReadWholeFile(const std::string& path, std::string* out) {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    out->resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(&(*out)[0], static_cast<std::streamsize>(out->size()));
+    return true;
+}
+
+template <typename Fn>
+static double BestSeconds(int repeat, Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < repeat; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        fn();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+static void Report(const char* name, RegSimdLevel level, size_t bytes, double seconds, size_t check) {
+    std::printf("  %-22s %-7s %9.1f MB/s  (check=%zu)\n", name, RegSimdLevelName(level),
+                static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds, check);
+}
+
+static void RunBenchmarks(const std::string& name, const std::string& data) {
+    std::printf("%s: %.1f MB\n", name.c_str(), static_cast<double>(data.size()) / (1024.0 * 1024.0));
+
+    bool utf16 = data.size() >= 2 && static_cast<unsigned char>(data[0]) == 0xFF &&
+                 static_cast<unsigned char>(data[1]) == 0xFE;
+    std::string utf8;
+    if (utf16) {
+        Utf16LeToUtf8(reinterpret_cast<const uint8_t*>(data.data()) + 2, (data.size() - 2) / 2, &utf8);
+    } else {
+        utf8 = data;
+    }
+
+    RegSimdLevel maxLevel = RegDetectSimdLevel();
+    for (int l = RegSimdScalar; l <= maxLevel; l++) {
+        RegSimdLevel level = RegSetSimdLevel(static_cast<RegSimdLevel>(l));
+        size_t check = 0;
+
+        if (utf16) {
+            double t = BestSeconds(3, [&]() {
+                const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data()) + 2;
+                size_t units = (data.size() - 2) / 2;
+                size_t pos = 0;
+                check = 0;
+                while (pos < units) {
+                    pos += RegFindUtf16AnyOf(p + pos * 2, units - pos, RegNewlineChars()) + 1;
+                    check++;
+                }
+            });
+            Report("utf16 newline scan", level, data.size(), t, check);
+
+            std::string out;
+            t = BestSeconds(3, [&]() {
+                out.clear();
+                Utf16LeToUtf8(reinterpret_cast<const uint8_t*>(data.data()) + 2, (data.size() - 2) / 2, &out);
+            });
+            Report("utf16 -> utf8", level, data.size(), t, out.size());
+        }
+
+        double t = BestSeconds(3, [&]() {
+            size_t pos = 0;
+            check = 0;
+            while (pos < utf8.size()) {
+                pos += RegFindAnyOf(utf8.data() + pos, utf8.size() - pos, RegStructuralChars()) + 1;
+                check++;
+            }
+        });
+        Report("utf8 structural scan", level, utf8.size(), t, check);
+
+        std::vector<uint8_t> wide;
+        t = BestSeconds(3, [&]() {
+            wide.clear();
+            Utf8ToUtf16Le(utf8.data(), utf8.size(), &wide);
+        });
+        Report("utf8 -> utf16", level, utf8.size(), t, wide.size());
+
+        t = BestSeconds(3, [&]() {
+            check = 0;
+            RegFileParser parser([&check](const RegOp&) { check++; });
+            const size_t chunk = 1024 * 1024;
+            for (size_t pos = 0; pos < data.size(); pos += chunk) {
+                parser.Feed(data.data() + pos, std::min(chunk, data.size() - pos));
+            }
+            parser.Finish();
+        });
+        Report("full parse", level, data.size(), t, check);
+    }
+    RegSetSimdLevel(maxLevel);
+}
+
+int main(int argc, char** argv) {
+    size_t sizeMb = 64;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            sizeMb = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    std::printf("Detected SIMD level: %s\n", RegSimdLevelName(RegDetectSimdLevel()));
+    if (files.empty()) {
+        RunBenchmarks("synthetic UTF-16LE export", GenerateSyntheticExport(sizeMb * 1024 * 1024));
+    }
+    for (size_t i = 0; i < files.size(); i++) {
+        std::string data;
+        if (!ReadWholeFile(files[i], &data)) {
+            std::fprintf(stderr, "Cannot open file: %s\n", files[i].c_str());
+            return 1;
+        }
+        RunBenchmarks(files[i], data);
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * 静默注册表导入程序 - 二进制快照基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_snapshot [--keys N] [--lookups L] [export.reg]
+ * 把合成数据（或指定的导出文件）加载到内存配置单元，分别保存为.reg和快照文件，对比：
+ * - 写出耗时和文件大小
+ * - 重新加载耗时（.reg为完整解析，快照为映射并校验目录）
+ * - 整树查询和按路径随机查找的速度（快照直接读取映射内存）
+ * 并校验往返结果：快照的查询输出、重新导出的.reg、按快照导入后的配置单元均与原配置单元一致
+ */
+
+#include "reg_export.h"
+#include "reg_hive.h"
+#include "reg_query.h"
+#include "reg_snapshot.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void BuildTree(RegHive* hive, size_t keys) {
+    std::vector<uint8_t> text;
+    Utf8ToUtf16Le("C:\\Program Files\\Vendor\\Component\\bin\\component.dll", 50, &text);
+    text.push_back(0);
+    text.push_back(0);
+    uint8_t blob[64];
+    for (size_t i = 0; i < sizeof(blob); i++) {
+        blob[i] = static_cast<uint8_t>(i * 29);
+    }
+    char path[160];
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(path, sizeof(path), "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Product%03zu\\Group%02zu\\Item%07zu",
+                      k % 97, (k / 97) % 24, k);
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        hive->SetValue(key, "", kRegSz, text.data(), text.size());
+        hive->SetValue(key, "InprocServer32", kRegExpandSz, text.data(), text.size());
+        hive->SetValue(key, "ThreadingModel", kRegDword, blob, 4);
+        hive->SetValue(key, "Data", kRegBinary, blob, k % sizeof(blob));
+    }
+}
+
+static std::string ExportText(RegBackend& backend, const std::vector<std::string>& roots) {
+    std::string output;
+    RegExporter exporter(backend, [&output](const uint8_t* data, size_t size) {
+        output.append(reinterpret_cast<const char*>(data), size);
+        return true;
+    });
+    std::string error;
+    exporter.Export(roots, &error);
+    return output;
+}
+
+static std::string QueryText(RegBackend& backend, const std::vector<std::string>& roots) {
+    std::ostringstream out;
+    RegQueryPrinter printer(backend, out);
+    printer.Query(roots);
+    return out.str();
+}
+
+static bool WriteFile(const std::string& path, const std::string& data) {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 200000;
+    size_t lookups = 1000000;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--keys" && i + 1 < argc) {
+            keys = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--lookups" && i + 1 < argc) {
+            lookups = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else {
+            path = arg;
+        }
+    }
+
+    RegHive hive;
+    std::string error;
+    if (path.empty()) {
+        BuildTree(&hive, keys);
+    } else if (!hive.LoadRegFile(path, &error)) {
+        std::fprintf(stderr, "Load failed: %s\n", error.c_str());
+        return 1;
+    }
+
+    // 导出每个根键下的所有顶层子键
+    std::vector<std::string> roots;
+    const size_t rootCount = sizeof(kRegRootKeys) / sizeof(kRegRootKeys[0]);
+    for (size_t i = 0; i < rootCount; i++) {
+        RegKeyHandle key;
+        std::string name;
+        if (hive.OpenKey(kRegRootKeys[i].fullName, &key) != kRegSuccess) {
+            continue;
+        }
+        for (uint32_t index = 0; hive.EnumSubKey(key, index, &name) == kRegSuccess; index++) {
+            roots.push_back(std::string(kRegRootKeys[i].fullName) + "\\" + name);
+        }
+    }
+    std::printf("hive: %zu keys, %zu values\n", hive.GetKeyCount(), hive.GetValueCount());
+
+    // .reg：写出和完整解析
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string text = ExportText(hive, roots);
+    double textWrite = Seconds(start);
+    const std::string textPath = "bench_snapshot_output.reg";
+    WriteFile(textPath, text);
+    start = std::chrono::steady_clock::now();
+    {
+        RegHive reloaded;
+        if (!reloaded.LoadRegFile(textPath, &error)) {
+            std::fprintf(stderr, "Reload failed: %s\n", error.c_str());
+            return 1;
+        }
+    }
+    double textLoad = Seconds(start);
+    std::remove(textPath.c_str());
+
+    // 快照：写出、映射并校验
+    std::string snapshotData;
+    RegSnapshotWriter writer(hive, [&snapshotData](const uint8_t* data, size_t size) {
+        snapshotData.append(reinterpret_cast<const char*>(data), size);
+        return true;
+    });
+    start = std::chrono::steady_clock::now();
+    if (!writer.Export(roots, &error)) {
+        std::fprintf(stderr, "Snapshot failed: %s\n", error.c_str());
+        return 1;
+    }
+    double snapshotWrite = Seconds(start);
+    const std::string snapshotPath = "bench_snapshot_output.regsnap";
+    WriteFile(snapshotPath, snapshotData);
+    RegSnapshot snapshot;
+    start = std::chrono::steady_clock::now();
+    if (!snapshot.Open(snapshotPath, &error)) {
+        std::fprintf(stderr, "Open failed: %s\n", error.c_str());
+        return 1;
+    }
+    double snapshotLoad = Seconds(start);
+
+    std::printf(".reg      write %7.3f s  load %7.3f s  %8.1f MB\n", textWrite, textLoad,
+                static_cast<double>(text.size()) / (1024.0 * 1024.0));
+    std::printf("snapshot  write %7.3f s  load %7.3f s  %8.1f MB  (%.2fx smaller, load %.0fx faster)\n",
+                snapshotWrite, snapshotLoad, static_cast<double>(snapshotData.size()) / (1024.0 * 1024.0),
+                static_cast<double>(text.size()) / static_cast<double>(snapshotData.size()), textLoad / snapshotLoad);
+
+    // 整树查询
+    start = std::chrono::steady_clock::now();
+    std::string hiveQuery = QueryText(hive, roots);
+    double hiveQuerySeconds = Seconds(start);
+    start = std::chrono::steady_clock::now();
+    std::string snapshotQuery = QueryText(snapshot, roots);
+    double snapshotQuerySeconds = Seconds(start);
+    std::printf("query     hive %10.0f keys/s  snapshot %10.0f keys/s\n",
+                static_cast<double>(hive.GetKeyCount()) / hiveQuerySeconds,
+                static_cast<double>(hive.GetKeyCount()) / snapshotQuerySeconds);
+
+    // 随机查找：先收集全部键路径
+    std::vector<std::string> paths;
+    std::vector<std::string> pending(roots);
+    while (!pending.empty()) {
+        std::string keyPath = pending.back();
+        pending.pop_back();
+        paths.push_back(keyPath);
+        RegKeyHandle key;
+        std::string name;
+        if (hive.OpenKey(keyPath, &key) == kRegSuccess) {
+            for (uint32_t index = 0; hive.EnumSubKey(key, index, &name) == kRegSuccess; index++) {
+                pending.push_back(keyPath + "\\" + name);
+            }
+        }
+    }
+    size_t found = 0;
+    uint64_t seed = 88172645463325252ull;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        RegKeyHandle key;
+        if (snapshot.OpenKey(paths[seed % paths.size()], &key) == kRegSuccess) {
+            found++;
+        }
+    }
+    double lookupSeconds = Seconds(start);
+    std::printf("lookup    %8.0f ns/path (%zu of %zu found)\n", lookupSeconds * 1e9 / static_cast<double>(lookups),
+                found, lookups);
+
+    // 往返校验
+    bool queryIdentical = snapshotQuery == hiveQuery;
+    bool exportIdentical = ExportText(snapshot, roots) == text;
+    RegHive imported;
+    RegApplier applier(imported, false);
+    snapshot.ForEachOp([&applier](const RegOp& op) { applier.Apply(op); });
+    applier.CloseCurrentKey();
+    bool importIdentical = ExportText(imported, roots) == text;
+    std::printf("round trip: query %s, export %s, import %s\n", queryIdentical ? "identical" : "DIFFERS",
+                exportIdentical ? "identical" : "DIFFERS", importIdentical ? "identical" : "DIFFERS");
+    std::remove(snapshotPath.c_str());
+    return queryIdentical && exportIdentical && importIdentical && found == lookups ? 0 : 1;
+}
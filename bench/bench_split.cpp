@@ -0,0 +1,228 @@
+/*
+ * 静默注册表导入程序 - 大文件分段并行解析基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_split [--size MB] [--jobs N] [--segment KB] [export.reg]
+ * 不指定文件时用bench_corpus.h生成UTF-16LE和ANSI两个大文件（默认各128MB），其中穿插
+ * 续行后以'['开头的字符串值、hex续行和以'\'结尾的注释等容易误切分的内容：
+ * - 单线程流式解析（ParseRegFile）的MB/s
+ * - 分段并行解析在1、2、4...N个线程下的MB/s和相对1线程的加速比（含映射和切分）
+ * - 结果校验：默认段大小和每个节标题都切分（段大小1字节）两种方式下，
+ *   按文件顺序拼接的操作和警告行号与单线程解析逐项相同
+ */
+
+#include "bench_corpus.h"
+#include "reg_parallel.h"
+#include "reg_split.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::vector<std::pair<size_t, std::string> > WarningList;
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 容易被误当作分段点的内容（UTF-8文本，以节标题开始）
+static const char kTrickyBlock[] =
+    "\r\n[HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchSplit\\Tricky]\r\n"
+    "\"Continued\"=\"text with [brackets] \\\r\n"
+    "[HKEY_LOCAL_MACHINE\\SOFTWARE\\NotAKey]\"\r\n"
+    "\"Hex\"=hex:01,02,03,\\\r\n"
+    "  04,05,\\\r\n"
+    "[06\r\n"
+    "; comment ending with a backslash \\\r\n"
+    "[HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchSplit\\AfterComment]\r\n"
+    "\"Value\"=dword:00000001\r\n"
+    "[HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchSplit\\NoBlankLine]\r\n"
+    "bogus line\r\n";
+
+// 生成约targetBytes字节的单个.reg文件：多份语料去掉文件头后首尾相接，中间穿插容易误切分的内容，
+// 先拼接为UTF-8文本，UTF-16LE时最后统一转换
+static std::string GenerateLargeFile(size_t targetBytes, bool ansi) {
+    std::string utf8 = ansi ? "REGEDIT4\r\n" : "Windows Registry Editor Version 5.00\r\n";
+    size_t headerSize = utf8.size();
+    RegCorpusConfig config;
+    config.files = 1;
+    config.depth = 3;
+    config.fanout = 8;
+    config.values = 6;
+    config.valueSize = 48;
+    config.ansi = ansi;
+    size_t piece = 0;
+    std::string part;
+    while (utf8.size() * (ansi ? 1 : 2) < targetBytes) {
+        config.seed = ++piece;
+        RegCorpus corpus;
+        RegCorpusGenerator(config).Generate(&corpus);
+        const std::string& bytes = corpus.files[0].bytes;
+        if (ansi) {
+            utf8.append(bytes, headerSize, std::string::npos);
+        } else {
+            part.clear();
+            Utf16LeToUtf8(reinterpret_cast<const uint8_t*>(bytes.data()) + 2, (bytes.size() - 2) / 2, &part);
+            utf8.append(part, headerSize, std::string::npos);
+        }
+        utf8 += kTrickyBlock;
+    }
+    if (ansi) {
+        return utf8;
+    }
+    std::vector<uint8_t> wide;
+    wide.push_back(0xFF);
+    wide.push_back(0xFE);
+    Utf8ToUtf16Le(utf8.data(), utf8.size(), &wide);
+    return std::string(reinterpret_cast<const char*>(wide.data()), wide.size());
+}
+
+static bool SameOps(const std::vector<RegOp>& a, const std::vector<RegOp>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].kind != b[i].kind || a[i].keyPath != b[i].keyPath || a[i].valueName != b[i].valueName ||
+            a[i].type != b[i].type || a[i].data != b[i].data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 分段并行解析，按文件顺序拼接操作和警告（行号加上之前各段的行数）；ops为NULL时只计数
+static bool ParseSplit(const std::string& path, size_t jobs, size_t segmentSize, std::vector<RegOp>* ops,
+                       WarningList* warnings, size_t* opCount, size_t* segments) {
+    RegFileSplitter splitter;
+    std::string error;
+    if (!splitter.Open(path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    *segments = splitter.Split(segmentSize);
+    bool parsed = true;
+    size_t lineOffset = 0;
+    *opCount = 0;
+    RunOrderedPipeline<RegParsedSegment>(*segments, jobs,
+        [&splitter](size_t index, RegParsedSegment* segment) {
+            splitter.ParseSegment(index, Latin1ToUtf8, segment);
+        },
+        [&](size_t, RegParsedSegment& segment) {
+            parsed = parsed && segment.file.parsed;
+            *opCount += segment.file.ops.size();
+            if (ops != NULL) {
+                ops->insert(ops->end(), segment.file.ops.begin(), segment.file.ops.end());
+                for (size_t i = 0; i < segment.file.warnings.size(); i++) {
+                    warnings->push_back(std::make_pair(lineOffset + segment.file.warnings[i].first,
+                                                       segment.file.warnings[i].second));
+                }
+            }
+            lineOffset += segment.lines;
+        });
+    return parsed;
+}
+
+static bool BenchFile(const std::string& path, size_t maxJobs, size_t segmentSize) {
+    // 单线程流式解析：参考结果和基准
+    std::vector<RegOp> expected;
+    WarningList expectedWarnings;
+    RegFileParser parser([&expected](const RegOp& op) { expected.push_back(op); });
+    parser.SetWarningSink([&expectedWarnings](size_t line, const std::string& message) {
+        expectedWarnings.push_back(std::make_pair(line, message));
+    });
+    std::string error;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool parsed = ParseRegFile(path, parser, &error);
+    double serialSeconds = Seconds(start);
+    if (!parsed) {
+        std::fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+        return false;
+    }
+    RegFileSplitter probe;
+    probe.Open(path, &error);
+    double megabytes = static_cast<double>(probe.GetSize()) / 1e6;
+    std::printf("%s: %.1f MB %s, %zu operations, %zu warnings\n", path.c_str(), megabytes,
+                probe.GetEncoding() == RegEncodingUtf16Le ? "UTF-16LE" : "ANSI", expected.size(),
+                expectedWarnings.size());
+    std::printf("  streaming parser          %8.1f MB/s\n", megabytes / serialSeconds);
+
+    // 1~N线程
+    double oneThread = 0;
+    for (size_t jobs = 1; jobs <= maxJobs; jobs = (jobs * 2 > maxJobs && jobs < maxJobs) ? maxJobs : jobs * 2) {
+        size_t opCount = 0;
+        size_t segments = 0;
+        double best = 1e30;
+        for (int repeat = 0; repeat < 3; repeat++) {
+            start = std::chrono::steady_clock::now();
+            ParseSplit(path, jobs, segmentSize, NULL, NULL, &opCount, &segments);
+            best = std::min(best, Seconds(start));
+        }
+        if (jobs == 1) {
+            oneThread = best;
+        }
+        std::printf("  split %3zu threads %4zu seg %8.1f MB/s  x%.2f%s\n", jobs, segments, megabytes / best,
+                    oneThread / best, opCount == expected.size() ? "" : "  WRONG OPERATION COUNT");
+    }
+
+    // 逐项校验：默认段大小和每个节标题都切分
+    bool ok = true;
+    const size_t sizes[] = {segmentSize, 1};
+    for (size_t i = 0; i < 2; i++) {
+        std::vector<RegOp> ops;
+        WarningList warnings;
+        size_t opCount = 0;
+        size_t segments = 0;
+        bool splitOk = ParseSplit(path, maxJobs, sizes[i], &ops, &warnings, &opCount, &segments) &&
+                       SameOps(ops, expected) && warnings == expectedWarnings;
+        std::printf("  %zu segments: %s\n", segments, splitOk ? "identical to streaming parse" : "DIFFERS");
+        ok = ok && splitOk;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    size_t sizeMb = 128;
+    size_t maxJobs = std::max<size_t>(RegDefaultJobCount(), 4);
+    size_t segmentSize = kRegSplitSegmentSize;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            sizeMb = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            maxJobs = std::max<size_t>(static_cast<size_t>(std::strtoul(argv[++i], NULL, 10)), 1);
+        } else if (arg == "--segment" && i + 1 < argc) {
+            segmentSize = std::max<size_t>(static_cast<size_t>(std::strtoul(argv[++i], NULL, 10)), 1) * 1024;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+
+    bool ok = true;
+    if (!files.empty()) {
+        for (size_t i = 0; i < files.size(); i++) {
+            ok = BenchFile(files[i], maxJobs, segmentSize) && ok;
+        }
+        return ok ? 0 : 1;
+    }
+    const bool encodings[] = {false, true};
+    for (size_t i = 0; i < 2; i++) {
+        std::string path = encodings[i] ? "bench_split_ansi.reg" : "bench_split_utf16.reg";
+        {
+            std::string data = GenerateLargeFile(sizeMb * 1024 * 1024, encodings[i]);
+            std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+        ok = BenchFile(path, maxJobs, segmentSize) && ok;
+        std::remove(path.c_str());
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,439 @@
+/*
+ * 静默注册表导入程序 - 基准测试套件
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_suite [语料参数] [--jobs N] [--repeat N] [--json file] [--baseline file] [--tolerance pct]
+ *                   [--write-corpus dir]
+ * 语料参数: --files N --depth N --fanout N --values N --value-size N --mix sz=40,dword=25,...
+ *           --encoding utf16|ansi --seed N（见bench_corpus.h）
+ * 用确定的合成语料依次测量（每项取--repeat次中最好的一次）：
+ * - parse：流式解析全部文件（64KB分块输入），MB/s
+ * - apply：解析并写入内存配置单元，values/s
+ * - format：FormatRegValueData格式化配置单元中的每个值，values/s
+ * - query/export：1个线程和--jobs个线程遍历整棵子树，keys/s
+ * 结果以JSON写入--json指定的文件（- 为标准输出）；指定--baseline时与基线逐项比较，
+ * 任一项低于基线的(100 - tolerance)%时以退出码2结束；基线的语料指纹不同时不比较，退出码3
+ * 解析出的键数和值数、各线程数的查询和导出输出必须与单线程一致，否则退出码1
+ */
+
+#include "bench_corpus.h"
+#include "reg_apply.h"
+#include "reg_export.h"
+#include "reg_hive.h"
+#include "reg_parallel.h"
+#include "reg_parser.h"
+#include "reg_query.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// 一项测量结果（均为越大越好的速率）
+struct SuiteResult {
+    std::string name;
+    std::string unit;
+    double value;
+};
+
+// 只计数不保存的输出流缓冲区
+class CountingBuffer : public std::streambuf {
+public:
+    CountingBuffer() : m_bytes(0), m_hash(0) {}
+    size_t GetBytes() const { return m_bytes; }
+    uint64_t GetHash() const { return m_hash; }
+
+protected:
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+        Add(data, static_cast<size_t>(size));
+        return size;
+    }
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) {
+            char ch = static_cast<char>(c);
+            Add(&ch, 1);
+        }
+        return c;
+    }
+
+private:
+    void Add(const char* data, size_t size) {
+        m_bytes += size;
+        m_hash = RegHash64::Hash(data, size, m_hash);
+    }
+
+    size_t m_bytes;
+    uint64_t m_hash;
+};
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 运行repeat次，返回最短耗时
+static double Best(int repeat, const std::function<void()>& run) {
+    double best = 1e30;
+    for (int i = 0; i < repeat; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        run();
+        double seconds = Seconds(start);
+        if (seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// 解析一个内存中的文件（64KB分块输入，与读取文件时相同）
+static bool ParseBuffer(const std::string& bytes, RegFileParser& parser) {
+    const size_t chunk = 64 * 1024;
+    for (size_t offset = 0; offset < bytes.size(); offset += chunk) {
+        size_t size = bytes.size() - offset < chunk ? bytes.size() - offset : chunk;
+        if (!parser.Feed(bytes.data() + offset, size)) {
+            return false;
+        }
+    }
+    return parser.Finish();
+}
+
+// 收集配置单元中的所有值（类型和原始数据）
+static void CollectValues(RegHive& hive, const std::string& path, std::vector<std::pair<uint32_t, std::vector<uint8_t>>>* values) {
+    RegKeyHandle key = NULL;
+    if (hive.OpenKey(path, &key) != kRegSuccess) {
+        return;
+    }
+    std::string name;
+    uint32_t type = 0;
+    std::vector<uint8_t> data;
+    for (uint32_t index = 0; hive.EnumValue(key, index, &name, &type, &data) == kRegSuccess; index++) {
+        values->push_back(std::make_pair(type, data));
+    }
+    std::vector<std::string> children;
+    for (uint32_t index = 0; hive.EnumSubKey(key, index, &name) == kRegSuccess; index++) {
+        children.push_back(path + "\\" + name);
+    }
+    hive.CloseKey(key);
+    for (size_t i = 0; i < children.size(); i++) {
+        CollectValues(hive, children[i], values);
+    }
+}
+
+static std::string FormatFingerprint(uint64_t fingerprint) {
+    char text[24];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(fingerprint));
+    return text;
+}
+
+// 结果JSON
+static std::string ToJson(const RegCorpusConfig& config, const RegCorpus& corpus, size_t jobs, int repeat,
+                          const std::vector<SuiteResult>& results) {
+    std::string json = "{\n  \"corpus\": {\"files\": " + std::to_string(config.files) +
+                       ", \"depth\": " + std::to_string(config.depth) +
+                       ", \"fanout\": " + std::to_string(config.fanout) +
+                       ", \"values\": " + std::to_string(config.values) +
+                       ", \"valueSize\": " + std::to_string(config.valueSize) + ", \"mix\": ";
+    AppendJsonString(config.FormatMix(), &json);
+    json += std::string(", \"encoding\": ") + (config.ansi ? "\"ansi\"" : "\"utf16\"") +
+            ", \"seed\": " + std::to_string(config.seed) + ", \"bytes\": " + std::to_string(corpus.bytes) +
+            ", \"keys\": " + std::to_string(corpus.keys) + ", \"valueCount\": " + std::to_string(corpus.values) +
+            ", \"fingerprint\": \"" + FormatFingerprint(corpus.fingerprint) + "\"},\n";
+    json += "  \"jobs\": " + std::to_string(jobs) + ",\n  \"repeat\": " + std::to_string(repeat) +
+            ",\n  \"results\": [\n";
+    char number[32];
+    for (size_t i = 0; i < results.size(); i++) {
+        std::snprintf(number, sizeof(number), "%.3f", results[i].value);
+        json += "    {\"name\": ";
+        AppendJsonString(results[i].name, &json);
+        json += ", \"unit\": ";
+        AppendJsonString(results[i].unit, &json);
+        json += std::string(", \"value\": ") + number + (i + 1 < results.size() ? "},\n" : "}\n");
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+// 从JSON文本中取出 "key": 之后的字符串或数字（只用于读取本程序写出的基线）
+static bool FindJsonField(const std::string& json, size_t from, size_t to, const std::string& key, std::string* value) {
+    std::string needle = "\"" + key + "\":";
+    size_t pos = json.find(needle, from);
+    if (pos == std::string::npos || pos >= to) {
+        return false;
+    }
+    pos += needle.size();
+    while (pos < to && json[pos] == ' ') {
+        pos++;
+    }
+    size_t end = pos;
+    if (pos < to && json[pos] == '"') {
+        end = json.find('"', pos + 1);
+        if (end == std::string::npos || end >= to) {
+            return false;
+        }
+        *value = json.substr(pos + 1, end - pos - 1);
+        return true;
+    }
+    while (end < to && json[end] != ',' && json[end] != '}' && json[end] != '\n') {
+        end++;
+    }
+    *value = json.substr(pos, end - pos);
+    return !value->empty();
+}
+
+// 读取基线：语料指纹和各项结果
+static bool LoadBaseline(const std::string& path, std::string* fingerprint, std::map<std::string, double>* values) {
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string json = buffer.str();
+    if (!FindJsonField(json, 0, json.size(), "fingerprint", fingerprint)) {
+        return false;
+    }
+    size_t results = json.find("\"results\"");
+    if (results == std::string::npos) {
+        return false;
+    }
+    for (size_t pos = json.find('{', results); pos != std::string::npos; pos = json.find('{', pos + 1)) {
+        size_t end = json.find('}', pos);
+        if (end == std::string::npos) {
+            break;
+        }
+        std::string name;
+        std::string value;
+        if (FindJsonField(json, pos, end, "name", &name) && FindJsonField(json, pos, end, "value", &value)) {
+            (*values)[name] = std::atof(value.c_str());
+        }
+    }
+    return !values->empty();
+}
+
+int main(int argc, char** argv) {
+    RegCorpusConfig config;
+    size_t jobs = RegDefaultJobCount() < 4 ? 4 : RegDefaultJobCount();
+    int repeat = 5;
+    double tolerance = 10.0;
+    std::string jsonPath;
+    std::string baselinePath;
+    std::string corpusDir;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        size_t number = static_cast<size_t>(std::strtoul(value.c_str(), NULL, 10));
+        if (arg == "--files") {
+            config.files = number;
+        } else if (arg == "--depth") {
+            config.depth = number;
+        } else if (arg == "--fanout") {
+            config.fanout = number;
+        } else if (arg == "--values") {
+            config.values = number;
+        } else if (arg == "--value-size") {
+            config.valueSize = number;
+        } else if (arg == "--seed") {
+            config.seed = std::strtoull(value.c_str(), NULL, 10);
+        } else if (arg == "--encoding") {
+            config.ansi = value == "ansi";
+        } else if (arg == "--mix") {
+            if (!config.ParseMix(value)) {
+                std::fprintf(stderr, "Invalid --mix: %s\n", value.c_str());
+                return 1;
+            }
+        } else if (arg == "--jobs") {
+            jobs = number;
+        } else if (arg == "--repeat") {
+            repeat = static_cast<int>(number);
+        } else if (arg == "--json") {
+            jsonPath = value;
+        } else if (arg == "--baseline") {
+            baselinePath = value;
+        } else if (arg == "--tolerance") {
+            tolerance = std::atof(value.c_str());
+        } else if (arg == "--write-corpus") {
+            corpusDir = value;
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+    if (repeat < 1) {
+        repeat = 1;
+    }
+    if (jobs < 2) {
+        jobs = 2;
+    }
+
+    RegCorpus corpus;
+    RegCorpusGenerator generator(config);
+    generator.Generate(&corpus);
+    std::printf("corpus: %zu files, %.1f MB, %zu keys, %zu values, %s, mix %s, fingerprint %s\n",
+                corpus.files.size(), static_cast<double>(corpus.bytes) / (1024.0 * 1024.0), corpus.keys,
+                corpus.values, config.ansi ? "ansi" : "utf16", config.FormatMix().c_str(),
+                FormatFingerprint(corpus.fingerprint).c_str());
+    if (!corpusDir.empty()) {
+        for (size_t i = 0; i < corpus.files.size(); i++) {
+            std::ofstream out((corpusDir + "/" + corpus.files[i].name).c_str(), std::ios::out | std::ios::binary);
+            out.write(corpus.files[i].bytes.data(), static_cast<std::streamsize>(corpus.files[i].bytes.size()));
+        }
+    }
+
+    bool correct = true;
+    std::vector<SuiteResult> results;
+    const double mb = 1024.0 * 1024.0;
+
+    // parse
+    size_t createOps = 0;
+    size_t setOps = 0;
+    double seconds = Best(repeat, [&]() {
+        createOps = 0;
+        setOps = 0;
+        for (size_t i = 0; i < corpus.files.size(); i++) {
+            RegFileParser parser([&](const RegOp& op) {
+                createOps += op.kind == RegOpCreateKey ? 1 : 0;
+                setOps += op.kind == RegOpSetValue ? 1 : 0;
+            });
+            if (!ParseBuffer(corpus.files[i].bytes, parser)) {
+                std::fprintf(stderr, "%s: %s\n", corpus.files[i].name.c_str(), parser.GetError().c_str());
+                correct = false;
+            }
+        }
+    });
+    if (createOps != corpus.keys || setOps != corpus.values) {
+        std::fprintf(stderr, "parse: %zu keys and %zu values, expected %zu and %zu\n", createOps, setOps,
+                     corpus.keys, corpus.values);
+        correct = false;
+    }
+    results.push_back(SuiteResult{"parse", "MB/s", static_cast<double>(corpus.bytes) / mb / seconds});
+
+    // apply
+    std::unique_ptr<RegHive> hive;
+    seconds = Best(repeat, [&]() {
+        hive.reset(new RegHive());
+        RegApplier applier(*hive, false);
+        for (size_t i = 0; i < corpus.files.size(); i++) {
+            RegFileParser parser([&applier](const RegOp& op) { applier.Apply(op); });
+            ParseBuffer(corpus.files[i].bytes, parser);
+        }
+        applier.CloseCurrentKey();
+    });
+    results.push_back(SuiteResult{"apply", "values/s", static_cast<double>(corpus.values) / seconds});
+
+    // format
+    std::vector<std::pair<uint32_t, std::vector<uint8_t>>> values;
+    CollectValues(*hive, "HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchCorpus", &values);
+    size_t formattedBytes = 0;
+    seconds = Best(repeat, [&]() {
+        formattedBytes = 0;
+        for (size_t i = 0; i < values.size(); i++) {
+            formattedBytes += FormatRegValueData(values[i].first, values[i].second.data(), values[i].second.size())
+                                  .size();
+        }
+    });
+    results.push_back(SuiteResult{"format", "values/s", static_cast<double>(values.size()) / seconds});
+
+    // query/export：1个线程和jobs个线程
+    std::vector<std::string> roots(1, "HKEY_LOCAL_MACHINE\\SOFTWARE\\BenchCorpus");
+    uint64_t queryHash = 0;
+    uint64_t exportHash = 0;
+    const size_t jobCounts[] = {1, jobs};
+    for (size_t j = 0; j < 2; j++) {
+        size_t keys = 0;
+        uint64_t hash = 0;
+        seconds = Best(repeat, [&]() {
+            CountingBuffer buffer;
+            std::ostream out(&buffer);
+            RegQueryPrinter printer(*hive, out, jobCounts[j]);
+            printer.Query(roots);
+            keys = printer.GetKeyCount();
+            hash = buffer.GetHash();
+        });
+        if (j == 0) {
+            queryHash = hash;
+        }
+        correct = correct && hash == queryHash && keys >= corpus.keys;
+        results.push_back(SuiteResult{"query_jobs" + std::to_string(jobCounts[j]), "keys/s",
+                                      static_cast<double>(keys) / seconds});
+
+        seconds = Best(repeat, [&]() {
+            hash = 0;
+            RegExporter exporter(*hive, [&hash](const uint8_t* data, size_t size) {
+                hash = RegHash64::Hash(data, size, hash);
+                return true;
+            }, 1024 * 1024, jobCounts[j]);
+            std::string error;
+            exporter.Export(roots, &error);
+            keys = exporter.GetStats().keys;
+        });
+        if (j == 0) {
+            exportHash = hash;
+        }
+        correct = correct && hash == exportHash && keys >= corpus.keys;
+        results.push_back(SuiteResult{"export_jobs" + std::to_string(jobCounts[j]), "keys/s",
+                                      static_cast<double>(keys) / seconds});
+    }
+
+    for (size_t i = 0; i < results.size(); i++) {
+        std::printf("%-14s %14.1f %s\n", results[i].name.c_str(), results[i].value, results[i].unit.c_str());
+    }
+    if (!correct) {
+        std::printf("CORRECTNESS CHECK FAILED\n");
+    }
+
+    std::string json = ToJson(config, corpus, jobs, repeat, results);
+    if (jsonPath == "-") {
+        std::fputs(json.c_str(), stdout);
+    } else if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        out << json;
+        if (!out) {
+            std::fprintf(stderr, "Cannot write %s\n", jsonPath.c_str());
+            return 1;
+        }
+    }
+    if (!correct) {
+        return 1;
+    }
+
+    // 与基线比较
+    if (baselinePath.empty()) {
+        return 0;
+    }
+    std::string baselineFingerprint;
+    std::map<std::string, double> baseline;
+    if (!LoadBaseline(baselinePath, &baselineFingerprint, &baseline)) {
+        std::fprintf(stderr, "Cannot read baseline: %s\n", baselinePath.c_str());
+        return 1;
+    }
+    if (baselineFingerprint != FormatFingerprint(corpus.fingerprint)) {
+        std::printf("baseline %s was recorded with a different corpus (%s), not compared\n", baselinePath.c_str(),
+                    baselineFingerprint.c_str());
+        return 3;
+    }
+    size_t regressions = 0;
+    std::printf("\nversus baseline %s (tolerance %.1f%%):\n", baselinePath.c_str(), tolerance);
+    for (size_t i = 0; i < results.size(); i++) {
+        std::map<std::string, double>::const_iterator it = baseline.find(results[i].name);
+        if (it == baseline.end() || it->second <= 0) {
+            std::printf("%-14s %14.1f %-9s (no baseline)\n", results[i].name.c_str(), results[i].value,
+                        results[i].unit.c_str());
+            continue;
+        }
+        double change = (results[i].value / it->second - 1.0) * 100.0;
+        bool regressed = change < -tolerance;
+        regressions += regressed ? 1 : 0;
+        std::printf("%-14s %14.1f %-9s baseline %14.1f  %+6.1f%%%s\n", results[i].name.c_str(), results[i].value,
+                    results[i].unit.c_str(), it->second, change, regressed ? "  REGRESSION" : "");
+    }
+    return regressions > 0 ? 2 : 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * 静默注册表导入程序 - 运行时间线基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_trace [--spans N] [--keys N] [--jobs N] [--out file]
+ * - 未启用时每个区间的耗时（与空循环对比），启用时记录一个区间和被采样丢弃一个区间的耗时
+ * - 多个线程同时记录，校验事件数和每个线程的名称
+ * - 模拟监视模式逐批启动新线程并在两批之间清空，校验只保留最近一批且线程缓冲区不累积
+ * - 在内存配置单元上并行导出N个键（默认200000个），对比未启用、启用（每键采样）时的耗时，
+ *   校验导出结果一致，报告记录和丢弃的键区间数
+ * - 生成的JSON结构校验（事件数、括号配对）；--out把时间线写入文件，可在Perfetto中打开
+ */
+
+#include "reg_export.h"
+#include "reg_hive.h"
+#include "reg_parallel.h"
+#include "reg_trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void BuildTree(RegHive* hive, size_t keys) {
+    char path[160];
+    uint8_t data[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    for (size_t k = 0; k < keys; k++) {
+        std::snprintf(path, sizeof(path), "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Product%03zu\\Group%02zu\\Item%07zu",
+                      k % 97, (k / 97) % 16, k);
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        hive->SetValue(key, "Flags", kRegDword, data, 4);
+        hive->SetValue(key, "Data", kRegBinary, data, sizeof(data));
+    }
+}
+
+static bool Export(RegHive& hive, size_t jobs, std::string* out, double* seconds) {
+    std::vector<std::string> roots(1, "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor");
+    RegExporter exporter(hive, [out](const uint8_t* data, size_t size) {
+        out->append(reinterpret_cast<const char*>(data), size);
+        return true;
+    }, 1024 * 1024, jobs);
+    std::string error;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = exporter.Export(roots, &error);
+    *seconds = Seconds(start);
+    return ok;
+}
+
+static size_t CountOccurrences(const std::string& text, const std::string& needle) {
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + needle.size())) {
+        count++;
+    }
+    return count;
+}
+
+int main(int argc, char** argv) {
+    size_t spans = 20000000;
+    size_t keys = 200000;
+    size_t jobs = 4;
+    std::string outPath;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--spans") {
+            spans = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--keys") {
+            keys = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--jobs") {
+            jobs = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--out") {
+            outPath = argv[i + 1];
+        }
+    }
+    bool ok = true;
+    std::string detail = "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Product001\\Group01\\Item0000001";
+
+    // 未启用：与只有计数的空循环对比
+    volatile size_t sink = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < spans; i++) {
+        sink = sink + 1;
+    }
+    double emptySeconds = Seconds(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < spans; i++) {
+        RegTraceSpan span("bench", "Disabled", detail, true);
+        sink = sink + 1;
+    }
+    double disabledSeconds = Seconds(start);
+    std::printf("disabled: %.2f ns/span (empty loop %.2f ns/iteration)\n", disabledSeconds * 1e9 / spans,
+                emptySeconds * 1e9 / spans);
+
+    // 启用：记录和采样丢弃
+    size_t recorded = spans / 20;
+    {
+        RegTracer tracer(1000000);
+        SetRegActiveTracer(&tracer);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < recorded; i++) {
+            RegTraceSpan span("bench", "Recorded", detail);
+        }
+        double recordSeconds = Seconds(start);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < recorded; i++) {
+            RegTraceSpan span("bench", "Sampled", detail, true);
+        }
+        double sampledSeconds = Seconds(start);
+        SetRegActiveTracer(NULL);
+        bool countOk = tracer.GetEventCount() == recorded && tracer.GetSampledOutCount() == recorded;
+        ok = ok && countOk;
+        std::printf("enabled:  %.1f ns/recorded span, %.1f ns/sampled-out span (%s)\n",
+                    recordSeconds * 1e9 / recorded, sampledSeconds * 1e9 / recorded, countOk ? "ok" : "WRONG COUNT");
+    }
+
+    // 多线程同时记录
+    {
+        const size_t threads = 4;
+        const size_t perThread = 100000;
+        RegTracer tracer;
+        SetRegActiveTracer(&tracer);
+        SetRegTraceThreadName("main");
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.push_back(std::thread([t, perThread]() {
+                SetRegTraceThreadName("bench worker", static_cast<int>(t));
+                for (size_t i = 0; i < perThread; i++) {
+                    RegTraceSpan span("bench", "Worker");
+                }
+            }));
+        }
+        for (size_t t = 0; t < threads; t++) {
+            workers[t].join();
+        }
+        SetRegActiveTracer(NULL);
+        std::string json = tracer.ToJson();
+        bool threadOk = tracer.GetEventCount() == threads * perThread &&
+                        CountOccurrences(json, "\"ph\":\"X\"") == threads * perThread &&
+                        CountOccurrences(json, "\"thread_name\"") == threads + 1 &&
+                        json.find("\"bench worker 3\"") != std::string::npos;
+        ok = ok && threadOk;
+        std::printf("threads:  %zu threads x %zu spans, %zu events: %s\n", threads, perThread,
+                    tracer.GetEventCount(), threadOk ? "ok" : "WRONG");
+    }
+
+    // 监视模式：每批启动新的工作线程，两批之间清空
+    {
+        const size_t batches = 50;
+        const size_t threads = 4;
+        const size_t perThread = 1000;
+        RegTracer tracer;
+        SetRegActiveTracer(&tracer);
+        SetRegTraceThreadName("main");
+        bool resetOk = true;
+        for (size_t b = 0; b < batches; b++) {
+            if (b > 0) {
+                tracer.Reset();
+            }
+            RegTraceSpan batchSpan("phase", "WatchBatch");
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; t++) {
+                workers.push_back(std::thread([t, perThread]() {
+                    SetRegTraceThreadName("bench worker", static_cast<int>(t));
+                    for (size_t i = 0; i < perThread; i++) {
+                        RegTraceSpan span("bench", "Worker");
+                    }
+                }));
+            }
+            for (size_t t = 0; t < threads; t++) {
+                workers[t].join();
+            }
+            batchSpan.End();
+            std::string json = tracer.ToJson();
+            resetOk = resetOk && tracer.GetEventCount() == threads * perThread + 1 &&
+                      CountOccurrences(json, "\"thread_name\"") == threads + 1 &&
+                      json.find("\"main\"") != std::string::npos;
+        }
+        SetRegActiveTracer(NULL);
+        ok = ok && resetOk;
+        std::printf("reset:    %zu batches x %zu threads, %zu events kept: %s\n", batches, threads,
+                    tracer.GetEventCount(), resetOk ? "latest batch only" : "ACCUMULATED");
+    }
+
+    // 并行导出：未启用与启用对比
+    RegHive hive;
+    BuildTree(&hive, keys);
+    std::string baseline;
+    double disabledExport = 0;
+    double best = 1e30;
+    for (int repeat = 0; repeat < 3; repeat++) {
+        baseline.clear();
+        Export(hive, jobs, &baseline, &disabledExport);
+        best = std::min(best, disabledExport);
+    }
+    disabledExport = best;
+
+    RegTracer tracer;
+    SetRegActiveTracer(&tracer);
+    SetRegTraceThreadName("main");
+    std::string traced;
+    double tracedExport = 0;
+    {
+        RegTraceSpan span("phase", "ExportRegistry");
+        Export(hive, jobs, &traced, &tracedExport);
+    }
+    SetRegActiveTracer(NULL);
+    bool exportOk = traced == baseline;
+    ok = ok && exportOk;
+    std::printf("export %zu keys, %zu jobs: disabled %.1f ms, traced %.1f ms (%+.1f%%), %zu spans kept, "
+                "%zu below %lld us: %s\n",
+                keys, jobs, disabledExport * 1000.0, tracedExport * 1000.0,
+                (tracedExport / disabledExport - 1.0) * 100.0, tracer.GetEventCount(), tracer.GetSampledOutCount(),
+                static_cast<long long>(tracer.GetSampleThreshold() / 1000), exportOk ? "identical" : "DIFFERS");
+
+    // JSON结构
+    std::string json = tracer.ToJson();
+    bool jsonOk = json.compare(0, 2, "{\"") == 0 &&
+                  CountOccurrences(json, "{") == CountOccurrences(json, "}") &&
+                  CountOccurrences(json, "\"ph\":\"X\"") == tracer.GetEventCount();
+    ok = ok && jsonOk;
+    std::printf("json: %zu bytes: %s\n", json.size(), jsonOk ? "ok" : "MALFORMED");
+    if (!outPath.empty()) {
+        std::printf("trace written to %s: %s\n", outPath.c_str(), tracer.WriteFile(outPath) ? "ok" : "FAILED");
+    }
+    return ok ? 0 : 1;
+}
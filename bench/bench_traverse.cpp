@@ -0,0 +1,134 @@
+/*
+ * 静默注册表导入程序 - 并行子树遍历基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_traverse [--keys N] [--open-us U] [--max-jobs J]
+ * 在内存配置单元中构造N个键（宽度和深度不均匀的子树），
+ * 分别用1、2、4...J个线程查询和导出整棵树，报告吞吐量和加速比，
+ * 并检查每种线程数的输出与单线程逐字节一致
+ * --open-us为每次打开键附加的忙等时间，模拟真实注册表的系统调用开销
+ */
+
+#include "reg_export.h"
+#include "reg_hive.h"
+#include "reg_parallel.h"
+#include "reg_query.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 打开键时附加固定延迟的配置单元
+class SlowOpenHive : public RegHive {
+public:
+    explicit SlowOpenHive(double openMicros) : m_openMicros(openMicros) {}
+
+    long OpenKey(const std::string& keyPath, RegKeyHandle* key) override {
+        if (m_openMicros > 0) {
+            std::chrono::steady_clock::time_point until =
+                std::chrono::steady_clock::now() +
+                std::chrono::nanoseconds(static_cast<long long>(m_openMicros * 1000.0));
+            while (std::chrono::steady_clock::now() < until) {
+            }
+        }
+        return RegHive::OpenKey(keyPath, key);
+    }
+
+private:
+    double m_openMicros;
+};
+
+// 构造不均匀的树：少数产品下有大量组件，多数产品只有几个键
+static void BuildTree(RegHive* hive, size_t keys) {
+    char path[160];
+    uint8_t data[48];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+    std::vector<uint8_t> text;
+    Utf8ToUtf16Le("C:\\Program Files\\Vendor\\component.dll", 38, &text);
+    text.push_back(0);
+    text.push_back(0);
+    for (size_t k = 0; k < keys; k++) {
+        size_t product = (k % 4 == 0) ? k % 3 : 3 + (k * 2654435761u) % 509;
+        std::snprintf(path, sizeof(path), "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Product%03zu\\Group%02zu\\Item%07zu",
+                      product, (k / 7) % 16, k);
+        RegKeyHandle key = NULL;
+        hive->CreateKey(path, &key);
+        hive->SetValue(key, "", kRegSz, text.data(), text.size());
+        hive->SetValue(key, "Flags", kRegDword, data, 4);
+        hive->SetValue(key, "Data", kRegBinary, data, sizeof(data));
+    }
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t keys = 200000;
+    double openMicros = 0;
+    size_t maxJobs = RegDefaultJobCount();
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--keys") {
+            keys = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        } else if (arg == "--open-us") {
+            openMicros = std::atof(argv[i + 1]);
+        } else if (arg == "--max-jobs") {
+            maxJobs = static_cast<size_t>(std::strtoul(argv[i + 1], NULL, 10));
+        }
+    }
+
+    SlowOpenHive hive(openMicros);
+    BuildTree(&hive, keys);
+    std::printf("hive: %zu keys, %zu values, open latency %.1f us\n", hive.GetKeyCount(), hive.GetValueCount(),
+                openMicros);
+
+    std::vector<std::string> roots(1, "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor");
+    std::string baseQuery;
+    std::string baseExport;
+    double baseQuerySeconds = 0;
+    double baseExportSeconds = 0;
+    for (size_t jobs = 1; jobs <= maxJobs; jobs *= 2) {
+        std::ostringstream queryOut;
+        RegQueryPrinter printer(hive, queryOut, jobs);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        printer.Query(roots);
+        double querySeconds = Seconds(start);
+
+        std::string exportOut;
+        RegExporter exporter(hive, [&exportOut](const uint8_t* data, size_t size) {
+            exportOut.append(reinterpret_cast<const char*>(data), size);
+            return true;
+        }, 1024 * 1024, jobs);
+        std::string error;
+        start = std::chrono::steady_clock::now();
+        if (!exporter.Export(roots, &error)) {
+            std::fprintf(stderr, "Export failed: %s\n", error.c_str());
+            return 1;
+        }
+        double exportSeconds = Seconds(start);
+
+        if (jobs == 1) {
+            baseQuery = queryOut.str();
+            baseExport = exportOut;
+            baseQuerySeconds = querySeconds;
+            baseExportSeconds = exportSeconds;
+        }
+        bool identical = queryOut.str() == baseQuery && exportOut == baseExport;
+        std::printf("jobs %2zu  query %10.0f keys/s (x%4.2f)  export %10.0f keys/s (x%4.2f)  %s\n", jobs,
+                    static_cast<double>(printer.GetKeyCount()) / querySeconds, baseQuerySeconds / querySeconds,
+                    static_cast<double>(exporter.GetStats().keys) / exportSeconds, baseExportSeconds / exportSeconds,
+                    identical ? "identical" : "OUTPUT DIFFERS");
+        if (!identical) {
+            return 1;
+        }
+    }
+    return 0;
+}
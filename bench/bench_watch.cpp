@@ -0,0 +1,240 @@
+/*
+ * 静默注册表导入程序 - 目录监视基准测试
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 用法: bench_watch [--files N] [--burst N] [--values N]
+ * 在临时目录中成批放入.reg文件（每个文件分几次写入，模拟复制中的文件），
+ * 用与--watch相同的监视、去抖和分批流程（Linux下为inotify）解析并写入内存配置单元，
+ * 对比不同去抖间隔下的导入次数、批次数、队列深度和从放入到导入完成的延迟，
+ * 并校验最终配置单元包含所有文件的全部值
+ */
+
+#include "reg_apply.h"
+#include "reg_hive.h"
+#include "reg_parser.h"
+#include "reg_watch.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* const kKeyPrefix = "HKEY_LOCAL_MACHINE\\SOFTWARE\\Vendor\\Watch\\File";
+
+// 生成一个策略文件（UTF-16LE带BOM），文件i的每个值都是dword:i
+static std::string GenerateRegFile(size_t file, size_t values) {
+    std::string text = "Windows Registry Editor Version 5.00\r\n\r\n[" + std::string(kKeyPrefix) +
+                       std::to_string(file) + "]\r\n";
+    char line[64];
+    for (size_t v = 0; v < values; v++) {
+        std::snprintf(line, sizeof(line), "\"Value%zu\"=dword:%08zx\r\n", v, file);
+        text += line;
+    }
+    std::vector<uint8_t> utf16;
+    utf16.push_back(0xFF);
+    utf16.push_back(0xFE);
+    Utf8ToUtf16Le(text.data(), text.size(), &utf16);
+    return std::string(reinterpret_cast<const char*>(utf16.data()), utf16.size());
+}
+
+struct RunResult {
+    size_t imports;             // 实际解析导入的次数（未去抖时同一文件会被导入多次）
+    size_t incomplete;          // 导入时文件尚未写完（值不全或解析失败）
+    std::vector<double> latencyMs;      // 每个文件从开始写入到最后一次导入完成
+    RegWatchStats stats;
+    bool complete;
+};
+
+// 放入files个文件，每burst个一批；每个文件分4次写入，间隔2毫秒
+static void Produce(const std::string& dir, size_t files, size_t burst, size_t values, std::mutex* mutex,
+                    std::vector<RegWatchTime>* dropped) {
+    for (size_t i = 0; i < files; i++) {
+        if (i > 0 && i % burst == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        {
+            std::lock_guard<std::mutex> lock(*mutex);
+            (*dropped)[i] = std::chrono::steady_clock::now();
+        }
+        std::string data = GenerateRegFile(i, values);
+        std::ofstream file((dir + "/policy_" + std::to_string(i) + ".reg").c_str(),
+                           std::ios::out | std::ios::binary | std::ios::trunc);
+        size_t chunk = (data.size() / 4) & ~static_cast<size_t>(1);
+        for (size_t offset = 0; offset < data.size(); offset += chunk) {
+            size_t size = std::min(chunk, data.size() - offset);
+            file.write(data.data() + offset, static_cast<std::streamsize>(size));
+            file.flush();
+            if (offset + size < data.size()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    }
+}
+
+// 与WatchDirectory相同的监视循环：等待变化、去抖、整批导入；生产者结束且静默200毫秒后返回
+static RunResult Run(const std::string& dir, size_t files, size_t burst, size_t values, unsigned debounceMs) {
+    RunResult result;
+    result.imports = 0;
+    result.incomplete = 0;
+    result.complete = false;
+    RegHive hive;
+    RegDirectoryWatcher watcher;
+    std::string error;
+    if (!watcher.Open(dir, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return result;
+    }
+    std::chrono::milliseconds debounce(debounceMs);
+    RegWatchQueue queue(debounce);
+    std::mutex mutex;
+    std::vector<RegWatchTime> dropped(files);
+    std::vector<RegWatchTime> lastApplied(files);
+    std::thread producer(Produce, dir, files, burst, values, &mutex, &dropped);
+
+    RegWatchTime quietSince = std::chrono::steady_clock::now();
+    bool producerDone = false;
+    std::vector<std::string> names;
+    std::vector<std::string> ready;
+    std::vector<RegWatchTime> firstSeen;
+    for (;;) {
+        std::chrono::milliseconds wait = queue.NextWait(std::chrono::steady_clock::now(),
+                                                        std::chrono::milliseconds(20));
+        names.clear();
+        bool overflow = false;
+        watcher.Wait(static_cast<unsigned>(wait.count()), &names, &overflow);
+        RegWatchTime now = std::chrono::steady_clock::now();
+        result.stats.events += names.size();
+        if (overflow) {
+            result.stats.rescans++;
+            watcher.List(&names);
+        }
+        for (size_t i = 0; i < names.size(); i++) {
+            if (IsRegWatchCandidate(names[i])) {
+                queue.Touch(names[i], now);
+            }
+        }
+        if (!names.empty()) {
+            quietSince = now;
+        }
+        result.stats.UpdateQueueDepth(queue.Size());
+
+        ready.clear();
+        firstSeen.clear();
+        queue.TakeReady(now, &ready, &firstSeen);
+        size_t failed = 0;
+        for (size_t i = 0; i < ready.size(); i++) {
+            RegApplier applier(hive, false);
+            size_t before = applier.GetStats().valuesWritten;
+            RegFileParser parser([&applier](const RegOp& op) { applier.Apply(op); });
+            bool parsed = ParseRegFile(dir + "/" + ready[i], parser, &error);
+            applier.CloseCurrentKey();
+            result.imports++;
+            if (!parsed || applier.GetStats().valuesWritten - before != values) {
+                result.incomplete++;
+            }
+            if (!parsed) {
+                failed++;
+            }
+            size_t index = static_cast<size_t>(std::strtoul(ready[i].c_str() + 7, NULL, 10));
+            lastApplied[index] = std::chrono::steady_clock::now();
+        }
+        if (!ready.empty()) {
+            result.stats.AddBatch(ready.size() - failed, failed, firstSeen, std::chrono::steady_clock::now());
+            result.stats.UpdateQueueDepth(queue.Size());
+        }
+
+        // 最后一个文件开始写入100毫秒后视为生产者结束
+        if (!producerDone) {
+            std::lock_guard<std::mutex> lock(mutex);
+            producerDone = dropped[files - 1] != RegWatchTime() &&
+                           std::chrono::steady_clock::now() - dropped[files - 1] > std::chrono::milliseconds(100);
+        }
+        if (producerDone && queue.Size() == 0 && now - quietSince > std::chrono::milliseconds(200)) {
+            break;
+        }
+    }
+    producer.join();
+
+    // 校验：每个文件的全部值都已写入
+    result.complete = true;
+    for (size_t i = 0; i < files && result.complete; i++) {
+        RegKeyHandle key;
+        if (hive.OpenKey(kKeyPrefix + std::to_string(i), &key) != kRegSuccess) {
+            result.complete = false;
+            break;
+        }
+        for (size_t v = 0; v < values; v++) {
+            uint32_t type = 0;
+            std::vector<uint8_t> data;
+            if (hive.QueryValue(key, "Value" + std::to_string(v), &type, &data) != kRegSuccess ||
+                type != kRegDword || data.size() != 4 || data[0] != static_cast<uint8_t>(i)) {
+                result.complete = false;
+                break;
+            }
+        }
+        hive.CloseKey(key);
+        result.latencyMs.push_back(
+            std::chrono::duration<double, std::milli>(lastApplied[i] - dropped[i]).count());
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    size_t files = 200;
+    size_t burst = 20;
+    size_t values = 200;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--files" && i + 1 < argc) {
+            files = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--burst" && i + 1 < argc) {
+            burst = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        } else if (arg == "--values" && i + 1 < argc) {
+            values = static_cast<size_t>(std::strtoul(argv[++i], NULL, 10));
+        }
+    }
+    if (files == 0 || burst == 0) {
+        return 1;
+    }
+
+    std::printf("%zu files in bursts of %zu, %zu values each, written in 4 chunks 2 ms apart\n", files, burst, values);
+    bool allComplete = true;
+    const unsigned debounceValues[] = {0, 20, 100};
+    for (size_t d = 0; d < sizeof(debounceValues) / sizeof(debounceValues[0]); d++) {
+        char dirTemplate[] = "/tmp/bench_watch_XXXXXX";
+        if (::mkdtemp(dirTemplate) == NULL) {
+            std::fprintf(stderr, "Cannot create temp directory\n");
+            return 1;
+        }
+        std::string dir = dirTemplate;
+        RunResult result = Run(dir, files, burst, values, debounceValues[d]);
+        allComplete = allComplete && result.complete;
+
+        std::vector<double> latency = result.latencyMs;
+        std::sort(latency.begin(), latency.end());
+        double p50 = latency.empty() ? 0 : latency[latency.size() / 2];
+        double p95 = latency.empty() ? 0 : latency[latency.size() * 95 / 100];
+        double max = latency.empty() ? 0 : latency.back();
+        std::printf("debounce %3u ms: %4zu imports (%4zu of incomplete files), %3zu batches, max queue depth %3zu, "
+                    "drop->apply p50 %6.1f ms p95 %6.1f ms max %6.1f ms, hive %s\n",
+                    debounceValues[d], result.imports, result.incomplete, result.stats.batches,
+                    result.stats.maxQueueDepth, p50, p95, max,
+                    result.complete ? "complete" : "INCOMPLETE");
+
+        for (size_t i = 0; i < files; i++) {
+            std::remove((dir + "/policy_" + std::to_string(i) + ".reg").c_str());
+        }
+        ::rmdir(dir.c_str());
+    }
+    return allComplete ? 0 : 1;
+}
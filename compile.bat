@@ -33,10 +33,10 @@ if %ERRORLEVEL% EQU 0 (
     echo 使用MinGW编译器编译（最小体积优化）...
     if exist version.rc (
         windres -i version.rc -O coff -o version.o
-        g++ -std=c++11 -Os -s -flto -fmerge-constants -fdata-sections -ffunction-sections -Wl,--gc-sections -o reg_import_silent.exe reg_import_silent.cpp version.o -static-libgcc -static-libstdc++ -mwindows
+        g++ -std=c++11 -Os -s -flto -fmerge-constants -fdata-sections -ffunction-sections -Wl,--gc-sections -o reg_import_silent.exe reg_import_silent.cpp version.o -static -static-libgcc -static-libstdc++ -mwindows
         del version.o 2>nul
     ) else (
-        g++ -std=c++11 -Os -s -flto -fmerge-constants -fdata-sections -ffunction-sections -Wl,--gc-sections -o reg_import_silent.exe reg_import_silent.cpp -static-libgcc -static-libstdc++ -mwindows
+        g++ -std=c++11 -Os -s -flto -fmerge-constants -fdata-sections -ffunction-sections -Wl,--gc-sections -o reg_import_silent.exe reg_import_silent.cpp -static -static-libgcc -static-libstdc++ -mwindows
     )
     if %ERRORLEVEL% EQU 0 (
         echo 编译成功！生成文件：reg_import_silent.exe
@@ -0,0 +1,34 @@
+#!/bin/bash
+# 基准测试编译脚本（Linux/macOS本机编译，无需Windows头文件）
+# 作者: Mison
+# 联系方式: 1360962086@qq.com
+# 许可证: MIT License
+
+echo "=== 静默注册表导入程序 - 基准测试编译 ==="
+echo ""
+
+CXX=${CXX:-g++}
+
+if ! command -v "$CXX" &> /dev/null; then
+    echo "错误: 未找到C++编译器: $CXX"
+    exit 1
+fi
+
+echo "✓ 使用编译器: $CXX"
+
+mkdir -p bench/bin
+
+for SRC in bench/bench_*.cpp; do
+    NAME=$(basename "$SRC" .cpp)
+    echo "正在编译 $NAME ..."
+    "$CXX" -std=c++11 -O2 -Wall -Wextra -Wpedantic -I. -pthread -o "bench/bin/$NAME" "$SRC"
+    if [ $? -ne 0 ]; then
+        echo ""
+        echo "✗ $NAME 编译失败！"
+        exit 1
+    fi
+done
+
+echo ""
+echo "✓ 编译成功！生成目录: bench/bin"
+echo "  运行基准测试套件: bench/bin/bench_suite --json results.json [--baseline baseline.json]"
@@ -47,14 +47,14 @@ if [ $USE_VERSION_RESOURCE -eq 1 ]; then
     x86_64-w64-mingw32-g++ -std=c++11 -Os -s -flto -fmerge-constants \
         -fdata-sections -ffunction-sections -Wl,--gc-sections \
         -Wall -Wextra -Wpedantic -o reg_import_silent.exe reg_import_silent.cpp version.o \
-        -static-libgcc -static-libstdc++ -mwindows
+        -static -static-libgcc -static-libstdc++ -mwindows
     COMPILE_RESULT=$?
     rm -f version.o
 else
     x86_64-w64-mingw32-g++ -std=c++11 -Os -s -flto -fmerge-constants \
         -fdata-sections -ffunction-sections -Wl,--gc-sections \
         -Wall -Wextra -Wpedantic -o reg_import_silent.exe reg_import_silent.cpp \
-        -static-libgcc -static-libstdc++ -mwindows
+        -static -static-libgcc -static-libstdc++ -mwindows
     COMPILE_RESULT=$?
 fi
 
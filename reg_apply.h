@@ -0,0 +1,182 @@
+/*
+ * 静默注册表导入程序 - 写操作应用器
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 将解析或规划得到的写操作应用到任意注册表后端：
+ * - 当前键句柄在连续的值操作之间复用
+ * - 差异模式下先读取当前类型和数据，完全相同时跳过写入，
+ *   避免更新键的最后写入时间和产生注册表事务日志
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_APPLY_H
+#define REG_APPLY_H
+
+#include "reg_backend.h"
+#include "reg_types.h"
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 应用统计
+struct RegApplyStats {
+    size_t keysOpened;
+    size_t keysDeleted;
+    size_t valuesWritten;
+    size_t valuesSkipped;       // 差异模式：类型和数据已一致
+    size_t valuesDeleted;
+    size_t deletesSkipped;      // 差异模式：值本就不存在
+    size_t failures;
+
+    RegApplyStats() : keysOpened(0), keysDeleted(0), valuesWritten(0), valuesSkipped(0), valuesDeleted(0),
+                      deletesSkipped(0), failures(0) {}
+};
+
+// 错误消息回调
+typedef std::function<void(const std::string& message)> RegErrorSink;
+
+// 写操作应用器
+class RegApplier {
+public:
+    RegApplier(RegBackend& backend, bool onlyDifferences)
+        : m_backend(backend), m_onlyDifferences(onlyDifferences), m_key(NULL), m_keyOpen(false),
+          m_currentType(kRegNone) {}
+    ~RegApplier() { CloseCurrentKey(); }
+
+    // 禁止拷贝
+    RegApplier(const RegApplier&) = delete;
+    RegApplier& operator=(const RegApplier&) = delete;
+
+    void SetErrorSink(const RegErrorSink& sink) { m_errorSink = sink; }
+
+    // 把所有操作的根键替换为root（如把为HKCU编写的文件写入 HKEY_USERS\<SID>），空表示不替换
+    void SetRootOverride(const std::string& root) { m_rootOverride = root; }
+
+    // 应用一个操作，失败时返回false（并计入failures）
+    bool Apply(const RegOp& op) {
+        return Apply(op.kind, op.keyPath, op.valueName, op.type, op.data.data(), op.data.size());
+    }
+
+    // 应用一个操作，数据直接引用调用方的内存（如映射的导入包），不复制
+    bool Apply(RegOpKind kind, const std::string& keyPath, const std::string& valueName, uint32_t type,
+               const uint8_t* data, size_t size) {
+        if (!m_rootOverride.empty()) {
+            ReplaceRegKeyRoot(keyPath, m_rootOverride, &m_mappedPath);
+            return ApplyMapped(kind, m_mappedPath, valueName, type, data, size);
+        }
+        return ApplyMapped(kind, keyPath, valueName, type, data, size);
+    }
+
+    void CloseCurrentKey() {
+        if (m_keyOpen) {
+            m_backend.CloseKey(m_key);
+            m_key = NULL;
+            m_keyOpen = false;
+        }
+        m_keyPath.clear();
+    }
+
+    const RegApplyStats& GetStats() const { return m_stats; }
+
+private:
+    bool ApplyMapped(RegOpKind kind, const std::string& keyPath, const std::string& valueName, uint32_t type,
+                     const uint8_t* data, size_t size) {
+        switch (kind) {
+            case RegOpCreateKey:
+                return OpenCurrentKey(keyPath);
+            case RegOpDeleteKey:
+                return DeleteKeyTree(keyPath);
+            case RegOpSetValue:
+                return EnsureCurrentKey(keyPath) && SetValue(keyPath, valueName, type, data, size);
+            case RegOpDeleteValue:
+                return EnsureCurrentKey(keyPath) && DeleteValue(keyPath, valueName);
+        }
+        return false;
+    }
+
+    bool EnsureCurrentKey(const std::string& keyPath) {
+        if (m_keyOpen && m_keyPath == keyPath) {
+            return true;
+        }
+        return OpenCurrentKey(keyPath);
+    }
+
+    bool OpenCurrentKey(const std::string& keyPath) {
+        CloseCurrentKey();
+        long result = m_backend.CreateKey(keyPath, &m_key);
+        if (result != kRegSuccess) {
+            return Fail("Failed to create registry key: " + keyPath, result);
+        }
+        m_keyOpen = true;
+        m_keyPath = keyPath;
+        m_stats.keysOpened++;
+        return true;
+    }
+
+    bool DeleteKeyTree(const std::string& keyPath) {
+        CloseCurrentKey();
+        long result = m_backend.DeleteKeyTree(keyPath);
+        if (result != kRegSuccess && result != kRegErrorNotFound) {
+            return Fail("Failed to delete registry key: " + keyPath, result);
+        }
+        m_stats.keysDeleted++;
+        return true;
+    }
+
+    bool SetValue(const std::string& keyPath, const std::string& valueName, uint32_t type, const uint8_t* data,
+                  size_t size) {
+        if (m_onlyDifferences &&
+            m_backend.QueryValue(m_key, valueName, &m_currentType, &m_currentData) == kRegSuccess &&
+            m_currentType == type && m_currentData.size() == size &&
+            (size == 0 || std::memcmp(m_currentData.data(), data, size) == 0)) {
+            m_stats.valuesSkipped++;
+            return true;
+        }
+        long result = m_backend.SetValue(m_key, valueName, type, data, size);
+        if (result != kRegSuccess) {
+            return Fail("Failed to set value: " + keyPath + "\\" + valueName, result);
+        }
+        m_stats.valuesWritten++;
+        return true;
+    }
+
+    bool DeleteValue(const std::string& keyPath, const std::string& valueName) {
+        if (m_onlyDifferences &&
+            m_backend.QueryValue(m_key, valueName, &m_currentType, &m_currentData) == kRegErrorNotFound) {
+            m_stats.deletesSkipped++;
+            return true;
+        }
+        long result = m_backend.DeleteValue(m_key, valueName);
+        if (result != kRegSuccess && result != kRegErrorNotFound) {
+            return Fail("Failed to delete value: " + keyPath + "\\" + valueName, result);
+        }
+        m_stats.valuesDeleted++;
+        return true;
+    }
+
+    bool Fail(const std::string& message, long result) {
+        m_stats.failures++;
+        if (m_errorSink) {
+            m_errorSink("Error: " + message + " (Error code: " + std::to_string(result) + ")");
+        }
+        return false;
+    }
+
+    RegBackend& m_backend;
+    bool m_onlyDifferences;
+    RegKeyHandle m_key;
+    bool m_keyOpen;
+    std::string m_keyPath;
+    std::string m_rootOverride;
+    std::string m_mappedPath;               // 替换根键后的路径（复用缓冲区）
+    uint32_t m_currentType;
+    std::vector<uint8_t> m_currentData;     // 差异比较时复用的读取缓冲区
+    RegErrorSink m_errorSink;
+    RegApplyStats m_stats;
+};
+
+#endif // REG_APPLY_H
@@ -0,0 +1,73 @@
+/*
+ * 静默注册表导入程序 - 注册表后端接口
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 查询、导入、导出通过此接口访问注册表：
+ * - Win32实现见reg_backend_win32.h
+ * - 内存实现见reg_hive.h（用于在Linux上测试和基准测试）
+ * 返回值沿用Win32错误码（0表示成功）
+ */
+
+#ifndef REG_BACKEND_H
+#define REG_BACKEND_H
+
+#include "reg_types.h"
+
+#include <string>
+#include <vector>
+
+// 后端返回码（数值与Win32错误码一致）
+const long kRegSuccess = 0;
+const long kRegErrorNotFound = 2;
+const long kRegErrorAccessDenied = 5;
+const long kRegErrorInvalidParameter = 87;
+const long kRegErrorMoreData = 234;
+const long kRegErrorNoMoreItems = 259;
+
+// 键句柄（含义由具体后端定义）
+typedef void* RegKeyHandle;
+
+// 键的计数和最大尺寸（名称长度为UTF-16单元数，不含结尾NUL；数据为字节数）
+struct RegKeyInfo {
+    uint32_t subKeyCount;
+    uint32_t maxSubKeyLength;
+    uint32_t valueCount;
+    uint32_t maxValueNameLength;
+    uint32_t maxValueDataSize;
+    uint64_t lastWriteTime;     // 键自身的值或直接子键最后一次变化的时间（FILETIME刻度），0表示后端不提供
+
+    RegKeyInfo()
+        : subKeyCount(0), maxSubKeyLength(0), valueCount(0), maxValueNameLength(0), maxValueDataSize(0),
+          lastWriteTime(0) {}
+};
+
+// 注册表后端接口，键路径为完整路径（根键可用全称或简称），字符串均为UTF-8
+class RegBackend {
+public:
+    virtual ~RegBackend() {}
+
+    // 打开已存在的键
+    virtual long OpenKey(const std::string& keyPath, RegKeyHandle* key) = 0;
+    // 打开键，不存在时连同中间路径一起创建
+    virtual long CreateKey(const std::string& keyPath, RegKeyHandle* key) = 0;
+    virtual void CloseKey(RegKeyHandle key) = 0;
+    // 删除键及其所有子键（根键不允许删除）
+    virtual long DeleteKeyTree(const std::string& keyPath) = 0;
+
+    // 查询键的子键/值数量和最大名称、数据尺寸（用于预先分配枚举缓冲区）
+    virtual long QueryKeyInfo(RegKeyHandle key, RegKeyInfo* info) = 0;
+
+    // 按序号枚举子键和值，序号越界时返回kRegErrorNoMoreItems
+    // name和data的已有容量会被复用：按QueryKeyInfo的结果预留后枚举不再分配内存
+    virtual long EnumSubKey(RegKeyHandle key, uint32_t index, std::string* name) = 0;
+    virtual long EnumValue(RegKeyHandle key, uint32_t index, std::string* name, uint32_t* type,
+                           std::vector<uint8_t>* data) = 0;
+
+    virtual long QueryValue(RegKeyHandle key, const std::string& name, uint32_t* type, std::vector<uint8_t>* data) = 0;
+    virtual long SetValue(RegKeyHandle key, const std::string& name, uint32_t type, const uint8_t* data, size_t size) = 0;
+    virtual long DeleteValue(RegKeyHandle key, const std::string& name) = 0;
+};
+
+#endif // REG_BACKEND_H
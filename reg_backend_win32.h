@@ -0,0 +1,226 @@
+/*
+ * 静默注册表导入程序 - Win32注册表后端
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 使用W系列注册表API实现RegBackend，路径和名称在UTF-8与UTF-16之间转换
+ * 仅在Windows上编译
+ */
+
+#ifndef REG_BACKEND_WIN32_H
+#define REG_BACKEND_WIN32_H
+
+#include <windows.h>
+
+#include "reg_backend.h"
+#include "reg_encoding.h"
+
+#include <string>
+#include <vector>
+
+// UTF-8字符串转换为宽字符串（用于Win32 W系列API）
+inline std::wstring Utf8ToWide(const std::string& text) {
+    if (text.empty()) {
+        return std::wstring();
+    }
+    int length = MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), NULL, 0);
+    std::wstring wide(static_cast<size_t>(length), L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), &wide[0], length);
+    return wide;
+}
+
+// UTF-8字符串转换到已有的宽字符串中（复用其容量，容量足够时不分配内存）
+inline void Utf8ToWide(const std::string& text, std::wstring* wide) {
+    wide->clear();
+    if (text.empty()) {
+        return;
+    }
+    int length = MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), NULL, 0);
+    wide->resize(static_cast<size_t>(length));
+    MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), &(*wide)[0], length);
+}
+
+// 根键全称映射到预定义HKEY
+inline HKEY RootKeyFromName(const std::string& rootName) {
+    if (rootName == "HKEY_LOCAL_MACHINE") return HKEY_LOCAL_MACHINE;
+    if (rootName == "HKEY_CURRENT_USER") return HKEY_CURRENT_USER;
+    if (rootName == "HKEY_CLASSES_ROOT") return HKEY_CLASSES_ROOT;
+    if (rootName == "HKEY_USERS") return HKEY_USERS;
+    if (rootName == "HKEY_CURRENT_CONFIG") return HKEY_CURRENT_CONFIG;
+    return NULL;
+}
+
+// Win32注册表后端（无内部状态，可在多个线程中同时使用）
+class Win32RegBackend : public RegBackend {
+public:
+    long OpenKey(const std::string& keyPath, RegKeyHandle* key) override {
+        HKEY root;
+        std::wstring subPath;
+        if (!SplitPath(keyPath, &root, &subPath)) {
+            return kRegErrorInvalidParameter;
+        }
+        HKEY hKey = NULL;
+        LONG result = RegOpenKeyExW(root, subPath.c_str(), 0, KEY_READ, &hKey);
+        *key = hKey;
+        return result;
+    }
+
+    long CreateKey(const std::string& keyPath, RegKeyHandle* key) override {
+        HKEY root;
+        std::wstring subPath;
+        if (!SplitPath(keyPath, &root, &subPath)) {
+            return kRegErrorInvalidParameter;
+        }
+        HKEY hKey = NULL;
+        LONG result = RegCreateKeyExW(root, subPath.c_str(), 0, NULL, REG_OPTION_NON_VOLATILE,
+                                      KEY_READ | KEY_WRITE, NULL, &hKey, NULL);
+        *key = hKey;
+        return result;
+    }
+
+    void CloseKey(RegKeyHandle key) override {
+        if (key != NULL) {
+            RegCloseKey(static_cast<HKEY>(key));
+        }
+    }
+
+    long DeleteKeyTree(const std::string& keyPath) override {
+        HKEY root;
+        std::wstring subPath;
+        if (!SplitPath(keyPath, &root, &subPath)) {
+            return kRegErrorInvalidParameter;
+        }
+        if (subPath.empty()) {
+            return kRegErrorAccessDenied;
+        }
+        LONG result = RegDeleteTreeW(root, subPath.c_str());
+        if (result == ERROR_SUCCESS) {
+            result = RegDeleteKeyW(root, subPath.c_str());
+        }
+        return result;
+    }
+
+    long QueryKeyInfo(RegKeyHandle key, RegKeyInfo* info) override {
+        DWORD subKeys = 0;
+        DWORD maxSubKeyLength = 0;
+        DWORD values = 0;
+        DWORD maxValueNameLength = 0;
+        DWORD maxValueDataSize = 0;
+        FILETIME lastWriteTime = {0, 0};
+        LONG result = RegQueryInfoKeyW(static_cast<HKEY>(key), NULL, NULL, NULL, &subKeys, &maxSubKeyLength, NULL,
+                                       &values, &maxValueNameLength, &maxValueDataSize, NULL, &lastWriteTime);
+        if (result == ERROR_SUCCESS) {
+            info->subKeyCount = subKeys;
+            info->maxSubKeyLength = maxSubKeyLength;
+            info->valueCount = values;
+            info->maxValueNameLength = maxValueNameLength;
+            info->maxValueDataSize = maxValueDataSize;
+            // 每个键按最大数据尺寸预留一次本线程的枚举缓冲区（只增不减）
+            std::vector<uint8_t>& buffer = EnumBuffer();
+            if (buffer.size() < maxValueDataSize) {
+                buffer.resize(maxValueDataSize);
+            }
+            info->lastWriteTime = (static_cast<uint64_t>(lastWriteTime.dwHighDateTime) << 32) |
+                                  lastWriteTime.dwLowDateTime;
+        }
+        return result;
+    }
+
+    long EnumSubKey(RegKeyHandle key, uint32_t index, std::string* name) override {
+        wchar_t buffer[256];    // 键名最长255个字符
+        DWORD length = 256;
+        LONG result = RegEnumKeyExW(static_cast<HKEY>(key), index, buffer, &length, NULL, NULL, NULL, NULL);
+        if (result == ERROR_SUCCESS) {
+            name->clear();
+            Utf16LeToUtf8(reinterpret_cast<const uint8_t*>(buffer), length, name);
+        }
+        return result;
+    }
+
+    long EnumValue(RegKeyHandle key, uint32_t index, std::string* name, uint32_t* type,
+                   std::vector<uint8_t>* data) override {
+        wchar_t nameBuffer[16384];    // 值名最长16383个字符，放在栈上避免每次枚举分配
+        // 数据读入本线程的枚举缓冲区（已按QueryKeyInfo预留时一次系统调用即可取回），
+        // 再按实际大小复制给调用方，不再逐值把调用方的缓冲区填零到最大容量
+        std::vector<uint8_t>& buffer = EnumBuffer();
+        if (buffer.size() < 256) {
+            buffer.resize(256);
+        }
+        while (true) {
+            DWORD nameLength = 16384;
+            DWORD dataSize = static_cast<DWORD>(buffer.size());
+            DWORD valueType = 0;
+            LONG result = RegEnumValueW(static_cast<HKEY>(key), index, nameBuffer, &nameLength, NULL, &valueType,
+                                        buffer.data(), &dataSize);
+            if (result == ERROR_MORE_DATA) {
+                // 值在QueryKeyInfo之后变大，按实际大小重试
+                buffer.resize(dataSize > buffer.size() ? dataSize : buffer.size() * 2);
+                continue;
+            }
+            if (result == ERROR_SUCCESS) {
+                name->clear();
+                Utf16LeToUtf8(reinterpret_cast<const uint8_t*>(nameBuffer), nameLength, name);
+                *type = valueType;
+                data->assign(buffer.begin(), buffer.begin() + dataSize);
+            }
+            return result;
+        }
+    }
+
+    long QueryValue(RegKeyHandle key, const std::string& name, uint32_t* type, std::vector<uint8_t>* data) override {
+        std::wstring wideName = Utf8ToWide(name);
+        if (data->size() < 256) {
+            data->resize(256);
+        }
+        while (true) {
+            DWORD dataSize = static_cast<DWORD>(data->size());
+            DWORD valueType = 0;
+            LONG result = RegQueryValueExW(static_cast<HKEY>(key), name.empty() ? NULL : wideName.c_str(), NULL,
+                                           &valueType, data->data(), &dataSize);
+            if (result == ERROR_MORE_DATA) {
+                data->resize(dataSize > data->size() ? dataSize : data->size() * 2);
+                continue;
+            }
+            if (result == ERROR_SUCCESS) {
+                *type = valueType;
+                data->resize(dataSize);
+            }
+            return result;
+        }
+    }
+
+    // 值名转换使用线程局部缓冲区，逐值写入时不再每次分配
+    long SetValue(RegKeyHandle key, const std::string& name, uint32_t type, const uint8_t* data, size_t size) override {
+        static thread_local std::wstring wideName;
+        Utf8ToWide(name, &wideName);
+        return RegSetValueExW(static_cast<HKEY>(key), name.empty() ? NULL : wideName.c_str(), 0, type,
+                              size == 0 ? NULL : data, static_cast<DWORD>(size));
+    }
+
+    long DeleteValue(RegKeyHandle key, const std::string& name) override {
+        static thread_local std::wstring wideName;
+        Utf8ToWide(name, &wideName);
+        return RegDeleteValueW(static_cast<HKEY>(key), name.empty() ? NULL : wideName.c_str());
+    }
+
+private:
+    // 本线程的值枚举缓冲区
+    static std::vector<uint8_t>& EnumBuffer() {
+        static thread_local std::vector<uint8_t> buffer;
+        return buffer;
+    }
+
+    static bool SplitPath(const std::string& keyPath, HKEY* root, std::wstring* subPath) {
+        std::string rootName;
+        std::string sub;
+        if (!SplitRegKeyPath(keyPath, &rootName, &sub)) {
+            return false;
+        }
+        *root = RootKeyFromName(rootName);
+        *subPath = Utf8ToWide(sub);
+        return true;
+    }
+};
+
+#endif // REG_BACKEND_WIN32_H
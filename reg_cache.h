@@ -0,0 +1,167 @@
+/*
+ * 静默注册表导入程序 - 导入状态缓存
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 记录每个成功导入的文件的大小、修改时间和内容哈希，内容未变的文件再次运行时跳过：
+ * - 大小和修改时间都与记录一致时直接命中，不读取文件内容
+ * - 否则流式计算内容哈希，内容一致（如重新复制的同一文件包）也命中，并更新记录的修改时间
+ * - 导入失败的文件从缓存中移除，下次运行重新导入
+ * 缓存文件为文本格式，每行一项：哈希 大小 修改时间 键；键由调用方决定（如用户名|小写完整路径）
+ * 平台无关：文件大小和修改时间由调用方获取
+ */
+
+#ifndef REG_CACHE_H
+#define REG_CACHE_H
+
+#include "reg_hash.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+
+// 缓存文件首行，格式变化时递增版本号，旧缓存整体失效
+static const char* const kRegApplyCacheHeader = "reg_import_silent apply cache v1";
+
+// 单个文件的状态
+struct RegApplyCacheEntry {
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t hash;
+
+    RegApplyCacheEntry() : size(0), mtime(0), hash(0) {}
+};
+
+// 检查结果
+enum RegApplyCacheResult {
+    kRegCacheMiss,        // 无记录或内容已变化，需要导入
+    kRegCacheHitStat,     // 大小和修改时间一致
+    kRegCacheHitContent   // 修改时间变化但内容哈希一致
+};
+
+// 缓存命中统计
+struct RegApplyCacheStats {
+    size_t statHits;
+    size_t contentHits;
+    size_t misses;
+
+    RegApplyCacheStats() : statHits(0), contentHits(0), misses(0) {}
+    size_t Hits() const { return statHits + contentHits; }
+};
+
+// 导入状态缓存
+class RegApplyCache {
+public:
+    RegApplyCache() : m_dirty(false) {}
+
+    // 加载缓存文件；文件不存在或版本不符时得到空缓存，格式错误的行被忽略
+    void Load(const std::string& path) {
+        m_entries.clear();
+        std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+        std::string line;
+        if (!std::getline(file, line) || TrimLine(line) != kRegApplyCacheHeader) {
+            return;
+        }
+        while (std::getline(file, line)) {
+            line = TrimLine(line);
+            // 哈希 大小 修改时间 键（键可包含空格，放在最后）
+            const char* p = line.c_str();
+            char* end = NULL;
+            RegApplyCacheEntry entry;
+            entry.hash = std::strtoull(p, &end, 16);
+            if (end == p || *end != ' ') {
+                continue;
+            }
+            p = end + 1;
+            entry.size = std::strtoull(p, &end, 10);
+            if (end == p || *end != ' ') {
+                continue;
+            }
+            p = end + 1;
+            entry.mtime = std::strtoull(p, &end, 10);
+            if (end == p || *end != ' ' || end[1] == '\0') {
+                continue;
+            }
+            m_entries[std::string(end + 1)] = entry;
+        }
+    }
+
+    // 序列化为缓存文件内容
+    std::string Serialize() const {
+        std::string output = kRegApplyCacheHeader;
+        output += "\r\n";
+        char prefix[64];
+        for (std::map<std::string, RegApplyCacheEntry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+            std::snprintf(prefix, sizeof(prefix), "%016llx %llu %llu ",
+                          static_cast<unsigned long long>(it->second.hash),
+                          static_cast<unsigned long long>(it->second.size),
+                          static_cast<unsigned long long>(it->second.mtime));
+            output += prefix;
+            output += it->first;
+            output += "\r\n";
+        }
+        return output;
+    }
+
+    // 检查文件自上次成功导入以来是否未变化；current传入当前大小和修改时间，
+    // 返回时补全内容哈希（命中修改时间时沿用记录的哈希，读取失败时为0），供导入成功后Record使用
+    RegApplyCacheResult Check(const std::string& key, const std::string& path, RegApplyCacheEntry* current) {
+        std::map<std::string, RegApplyCacheEntry>::iterator it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.size == current->size && it->second.mtime == current->mtime) {
+            current->hash = it->second.hash;
+            m_stats.statHits++;
+            return kRegCacheHitStat;
+        }
+
+        std::string error;
+        if (!RegHashFile(path, &current->hash, &error)) {
+            current->hash = 0;
+            m_stats.misses++;
+            return kRegCacheMiss;
+        }
+        if (it != m_entries.end() && it->second.size == current->size && it->second.hash == current->hash) {
+            it->second.mtime = current->mtime;
+            m_dirty = true;
+            m_stats.contentHits++;
+            return kRegCacheHitContent;
+        }
+        m_stats.misses++;
+        return kRegCacheMiss;
+    }
+
+    // 记录导入成功的文件
+    void Record(const std::string& key, const RegApplyCacheEntry& entry) {
+        m_entries[key] = entry;
+        m_dirty = true;
+    }
+
+    // 移除导入失败的文件
+    void Remove(const std::string& key) {
+        if (m_entries.erase(key) > 0) {
+            m_dirty = true;
+        }
+    }
+
+    bool IsDirty() const { return m_dirty; }
+    size_t GetEntryCount() const { return m_entries.size(); }
+    const RegApplyCacheStats& GetStats() const { return m_stats; }
+
+private:
+    static std::string TrimLine(const std::string& line) {
+        size_t end = line.length();
+        while (end > 0 && (line[end - 1] == '\r' || line[end - 1] == '\n')) {
+            end--;
+        }
+        return line.substr(0, end);
+    }
+
+    std::map<std::string, RegApplyCacheEntry> m_entries;
+    RegApplyCacheStats m_stats;
+    bool m_dirty;
+};
+
+#endif // REG_CACHE_H
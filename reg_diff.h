@@ -0,0 +1,797 @@
+/*
+ * 静默注册表导入程序 - 结构化差异
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 比较两个来源（.reg文件、导入包、快照或注册表子树），输出把前者变为后者的最小补丁.reg（--diff）：
+ * - 每个来源的操作编码为记录交给外部排序器：内存中的记录达到上限后排序写入临时文件（有序段），
+ *   读出时多路归并，内存占用与来源大小无关
+ * - 排序键为大写折叠的键路径（'\'映射为0x01，子树紧跟在键之后连续排列）、记录类别和大写折叠的值名，
+ *   排序键相同的记录按原操作顺序排列
+ * - 读出时按导入语义还原每个键的最终状态：[-key]使该子树中更早的操作失效，同一值只保留最后一次写入，
+ *   只有子键出现的上级键视为存在的空键（导入子键时自动创建）
+ * - 两个有序键流逐键归并：只在后者中的键输出[key]和全部值（有新增子键的空键不单独输出），
+ *   只在前者中的键输出[-key]（只输出被删除子树的根，根键本身不删除），两者都有的键只输出新增、
+ *   修改的值和"name"=-（值按类型和原始字节比较，键名和值名的大小写差异忽略）
+ * 排序O(n log n)、归并O(n)，补丁边比较边写出
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_DIFF_H
+#define REG_DIFF_H
+
+#include "reg_backend.h"
+#include "reg_encoding.h"
+#include "reg_export.h"
+#include "reg_parser.h"
+#include "reg_traverse.h"
+#include "reg_types.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 差异记录：一个键操作或值操作
+struct RegDiffRecord {
+    std::string sortKey;        // 折叠路径 + '\0' + 类别（0为键，1为值）+ 折叠值名
+    uint64_t seq;               // 在来源中的操作顺序（从1开始）
+    uint8_t kind;               // RegOpKind
+    std::string text;           // 键操作为原始大小写的路径，值操作为原始值名
+    uint32_t type;
+    std::vector<uint8_t> data;
+
+    RegDiffRecord() : seq(0), kind(RegOpCreateKey), type(kRegNone) {}
+
+    // 排序键的路径部分长度
+    size_t PathLength() const { return sortKey.find('\0'); }
+
+    // 估算内存占用
+    size_t MemorySize() const { return sizeof(RegDiffRecord) + sortKey.size() + text.size() + data.size(); }
+};
+
+inline bool RegDiffRecordLess(const RegDiffRecord& a, const RegDiffRecord& b) {
+    int cmp = a.sortKey.compare(b.sortKey);
+    return cmp < 0 || (cmp == 0 && a.seq < b.seq);
+}
+
+// 追加折叠后的路径（'\'映射为0x01，使"A\B"排在"A B"、"A-B"等兄弟键之前）
+inline void AppendRegDiffFoldedPath(const char* path, size_t size, std::string* out) {
+    size_t base = out->size();
+    out->resize(base + size);
+    for (size_t i = 0; i < size; i++) {
+        char c = RegAsciiUpper(path[i]);
+        (*out)[base + i] = c == '\\' ? '\x01' : c;
+    }
+}
+
+// 键操作的记录
+inline void MakeRegDiffKeyRecord(RegOpKind kind, const std::string& path, RegDiffRecord* record) {
+    record->sortKey.clear();
+    AppendRegDiffFoldedPath(path.data(), path.size(), &record->sortKey);
+    record->sortKey.append(2, '\0');
+    record->kind = static_cast<uint8_t>(kind);
+    record->text = path;
+    record->type = kRegNone;
+    record->data.clear();
+}
+
+// 值操作的记录，foldedPath为AppendRegDiffFoldedPath的结果
+inline void MakeRegDiffValueRecord(RegOpKind kind, const std::string& foldedPath, const std::string& name,
+                                   uint32_t type, const uint8_t* data, size_t size, RegDiffRecord* record) {
+    record->sortKey.assign(foldedPath);
+    record->sortKey.push_back('\0');
+    record->sortKey.push_back('\x01');
+    for (size_t i = 0; i < name.size(); i++) {
+        record->sortKey.push_back(RegAsciiUpper(name[i]));
+    }
+    record->kind = static_cast<uint8_t>(kind);
+    record->text = name;
+    record->type = type;
+    record->data.assign(data, data + size);
+}
+
+// path等于ancestor或位于其下（均为折叠路径）
+inline bool RegDiffPathWithin(const std::string& path, const std::string& ancestor) {
+    return path.size() >= ancestor.size() && path.compare(0, ancestor.size(), ancestor) == 0 &&
+           (path.size() == ancestor.size() || path[ancestor.size()] == '\x01');
+}
+
+inline void AppendRegDiffU32(uint32_t value, std::vector<uint8_t>* out) {
+    for (int i = 0; i < 4; i++) {
+        out->push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+inline uint32_t ReadRegDiffU32(const uint8_t* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// 编码一条记录（整数为小端序）：排序键、序号、类别、文本、类型、数据
+inline void EncodeRegDiffRecord(const RegDiffRecord& record, std::vector<uint8_t>* out) {
+    AppendRegDiffU32(static_cast<uint32_t>(record.sortKey.size()), out);
+    out->insert(out->end(), record.sortKey.begin(), record.sortKey.end());
+    AppendRegDiffU32(static_cast<uint32_t>(record.seq), out);
+    AppendRegDiffU32(static_cast<uint32_t>(record.seq >> 32), out);
+    out->push_back(record.kind);
+    AppendRegDiffU32(static_cast<uint32_t>(record.text.size()), out);
+    out->insert(out->end(), record.text.begin(), record.text.end());
+    AppendRegDiffU32(record.type, out);
+    AppendRegDiffU32(static_cast<uint32_t>(record.data.size()), out);
+    out->insert(out->end(), record.data.begin(), record.data.end());
+}
+
+// 解码一条记录，数据不完整时返回false；成功时*used为记录的字节数
+inline bool DecodeRegDiffRecord(const uint8_t* data, size_t size, size_t* used, RegDiffRecord* record) {
+    size_t pos = 0;
+    if (size < 4) {
+        return false;
+    }
+    size_t keySize = ReadRegDiffU32(data);
+    pos = 4;
+    if (size - pos < keySize + 13) {
+        return false;
+    }
+    record->sortKey.assign(reinterpret_cast<const char*>(data + pos), keySize);
+    pos += keySize;
+    record->seq = static_cast<uint64_t>(ReadRegDiffU32(data + pos)) |
+                  (static_cast<uint64_t>(ReadRegDiffU32(data + pos + 4)) << 32);
+    record->kind = data[pos + 8];
+    size_t textSize = ReadRegDiffU32(data + pos + 9);
+    pos += 13;
+    if (size - pos < textSize + 8) {
+        return false;
+    }
+    record->text.assign(reinterpret_cast<const char*>(data + pos), textSize);
+    pos += textSize;
+    record->type = ReadRegDiffU32(data + pos);
+    size_t dataSize = ReadRegDiffU32(data + pos + 4);
+    pos += 8;
+    if (size - pos < dataSize) {
+        return false;
+    }
+    record->data.assign(data + pos, data + pos + dataSize);
+    *used = pos + dataSize;
+    return true;
+}
+
+// 外部排序器：先逐条Add，Finish后按排序键和序号依次Next读出
+class RegDiffSorter {
+public:
+    // tempPrefix为临时有序段文件的路径前缀，memoryLimit为内存中记录的上限（字节）
+    RegDiffSorter(const std::string& tempPrefix, size_t memoryLimit)
+        : m_tempPrefix(tempPrefix), m_memoryLimit(memoryLimit), m_memory(0), m_peakMemory(0), m_count(0),
+          m_next(0), m_failed(false) {}
+
+    ~RegDiffSorter() {
+        m_runs.clear();
+        for (size_t i = 0; i < m_runPaths.size(); i++) {
+            std::remove(m_runPaths[i].c_str());
+        }
+    }
+
+    // 禁止拷贝
+    RegDiffSorter(const RegDiffSorter&) = delete;
+    RegDiffSorter& operator=(const RegDiffSorter&) = delete;
+
+    // 加入一条记录（内容被移走），写临时文件失败时返回false
+    bool Add(RegDiffRecord& record) {
+        if (m_failed) {
+            return false;
+        }
+        m_memory += record.MemorySize();
+        m_peakMemory = std::max(m_peakMemory, m_memory);
+        m_records.push_back(RegDiffRecord());
+        std::swap(m_records.back(), record);
+        m_count++;
+        if (m_memory >= m_memoryLimit) {
+            Spill();
+        }
+        return !m_failed;
+    }
+
+    // 结束输入：没有写出过有序段时直接在内存中排序，否则写出最后一段并打开所有段
+    bool Finish() {
+        if (m_failed) {
+            return false;
+        }
+        if (m_runPaths.empty()) {
+            std::sort(m_records.begin(), m_records.end(), RegDiffRecordLess);
+            return true;
+        }
+        if (!m_records.empty()) {
+            Spill();
+        }
+        for (size_t i = 0; i < m_runPaths.size() && !m_failed; i++) {
+            std::unique_ptr<Run> run(new Run());
+            run->file.open(m_runPaths[i].c_str(), std::ios::in | std::ios::binary);
+            if (!run->file.is_open()) {
+                Fail("Cannot open temporary file: " + m_runPaths[i]);
+                break;
+            }
+            run->buffer.resize(256 * 1024);
+            m_runs.push_back(std::move(run));
+            if (Advance(m_runs.size() - 1)) {
+                m_heap.push_back(m_runs.size() - 1);
+            }
+        }
+        std::make_heap(m_heap.begin(), m_heap.end(), HeapCompare(m_runs));
+        return !m_failed;
+    }
+
+    // 读出下一条记录，全部读完或读取失败时返回false
+    bool Next(RegDiffRecord* record) {
+        if (m_runPaths.empty()) {
+            if (m_next >= m_records.size()) {
+                return false;
+            }
+            std::swap(*record, m_records[m_next++]);
+            return true;
+        }
+        if (m_heap.empty() || m_failed) {
+            return false;
+        }
+        HeapCompare compare(m_runs);
+        std::pop_heap(m_heap.begin(), m_heap.end(), compare);
+        size_t index = m_heap.back();
+        std::swap(*record, m_runs[index]->current);
+        if (Advance(index)) {
+            std::push_heap(m_heap.begin(), m_heap.end(), compare);
+        } else {
+            m_heap.pop_back();
+        }
+        return !m_failed;
+    }
+
+    bool Failed() const { return m_failed; }
+    const std::string& GetError() const { return m_error; }
+    size_t GetRecordCount() const { return m_count; }
+    size_t GetRunCount() const { return m_runPaths.size(); }
+    size_t GetPeakMemory() const { return m_peakMemory; }
+
+private:
+    // 一个有序段的读取状态
+    struct Run {
+        std::ifstream file;
+        std::vector<uint8_t> buffer;
+        size_t begin;
+        size_t end;
+        RegDiffRecord current;
+
+        Run() : begin(0), end(0) {}
+    };
+
+    // 当前记录较大的段排在堆底（std::*_heap为大顶堆）
+    struct HeapCompare {
+        explicit HeapCompare(const std::vector<std::unique_ptr<Run>>& runs) : runs(runs) {}
+        bool operator()(size_t a, size_t b) const { return RegDiffRecordLess(runs[b]->current, runs[a]->current); }
+        const std::vector<std::unique_ptr<Run>>& runs;
+    };
+
+    // 排序内存中的记录并写出为一个有序段
+    void Spill() {
+        std::sort(m_records.begin(), m_records.end(), RegDiffRecordLess);
+        std::string path = m_tempPrefix + std::to_string(m_runPaths.size()) + ".tmp";
+        m_runPaths.push_back(path);
+        std::ofstream file(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        std::vector<uint8_t> buffer;
+        buffer.reserve(1024 * 1024 + 64 * 1024);
+        for (size_t i = 0; i < m_records.size() && file; i++) {
+            EncodeRegDiffRecord(m_records[i], &buffer);
+            if (buffer.size() >= 1024 * 1024 || i + 1 == m_records.size()) {
+                file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+        file.close();
+        if (!file) {
+            Fail("Cannot write temporary file: " + path);
+        }
+        std::vector<RegDiffRecord>().swap(m_records);
+        m_memory = 0;
+    }
+
+    // 解码段中的下一条记录到current，段已读完时返回false
+    bool Advance(size_t index) {
+        Run& run = *m_runs[index];
+        for (;;) {
+            size_t used = 0;
+            if (DecodeRegDiffRecord(run.buffer.data() + run.begin, run.end - run.begin, &used, &run.current)) {
+                run.begin += used;
+                return true;
+            }
+            // 数据不完整：把剩余部分移到开头再读，单条记录超过缓冲区时扩大缓冲区
+            size_t rest = run.end - run.begin;
+            std::copy(run.buffer.begin() + static_cast<std::ptrdiff_t>(run.begin),
+                      run.buffer.begin() + static_cast<std::ptrdiff_t>(run.end), run.buffer.begin());
+            run.begin = 0;
+            run.end = rest;
+            if (rest == run.buffer.size()) {
+                run.buffer.resize(run.buffer.size() * 2);
+            }
+            run.file.read(reinterpret_cast<char*>(run.buffer.data() + rest),
+                          static_cast<std::streamsize>(run.buffer.size() - rest));
+            std::streamsize got = run.file.gcount();
+            if (got <= 0) {
+                if (rest != 0) {
+                    Fail("Truncated temporary file: " + m_runPaths[index]);
+                }
+                return false;
+            }
+            run.end += static_cast<size_t>(got);
+        }
+    }
+
+    void Fail(const std::string& message) {
+        if (!m_failed) {
+            m_failed = true;
+            m_error = message;
+        }
+    }
+
+    std::string m_tempPrefix;
+    size_t m_memoryLimit;
+    size_t m_memory;
+    size_t m_peakMemory;
+    size_t m_count;
+    std::vector<RegDiffRecord> m_records;
+    size_t m_next;                              // 未写出有序段时下一条读出的记录
+    std::vector<std::string> m_runPaths;
+    std::vector<std::unique_ptr<Run>> m_runs;
+    std::vector<size_t> m_heap;                 // 各段的最小堆（按当前记录）
+    bool m_failed;
+    std::string m_error;
+};
+
+// 还原后的一个键：路径和按折叠值名排序的值（值记录的kind均为RegOpSetValue）
+struct RegDiffKey {
+    std::string sortPath;       // 折叠路径
+    std::string path;           // 原始大小写的路径
+    std::vector<RegDiffRecord> values;
+};
+
+// 注册表子树的记录收集器：工作线程把每个键和它的值编码为记录，调用线程解码后交给排序器
+class RegDiffCollector : public RegTraversalVisitor {
+public:
+    bool VisitKey(RegBackend& backend, RegKeyHandle key, const std::string& path, int,
+                  RegTraversalContext& context, RegTraversalOutput* out) override {
+        RegDiffRecord record;
+        MakeRegDiffKeyRecord(RegOpCreateKey, path, &record);
+        EncodeRegDiffRecord(record, &out->data);
+        std::string foldedPath;
+        AppendRegDiffFoldedPath(path.data(), path.size(), &foldedPath);
+        for (uint32_t index = 0; ; index++) {
+            long result = backend.EnumValue(key, index, &context.name, &context.type, &context.data);
+            if (result == kRegErrorNoMoreItems) {
+                break;
+            }
+            if (result == kRegSuccess) {
+                MakeRegDiffValueRecord(RegOpSetValue, foldedPath, context.name, context.type, context.data.data(),
+                                       context.data.size(), &record);
+                EncodeRegDiffRecord(record, &out->data);
+                out->values++;
+            }
+        }
+        return true;
+    }
+
+    // 无法打开的子键（如权限不足）与导出一样跳过
+    void VisitError(const std::string&, int, long, RegTraversalOutput*) override {}
+};
+
+// 一个比较来源：先加入操作（.reg文件、操作列表或注册表子树），Finish后按折叠路径依次读出存在的键
+class RegDiffSource {
+public:
+    RegDiffSource(const std::string& tempPrefix, size_t memoryLimit)
+        : m_sorter(tempPrefix, memoryLimit), m_seq(0), m_hasRecord(false) {}
+
+    // 禁止拷贝
+    RegDiffSource(const RegDiffSource&) = delete;
+    RegDiffSource& operator=(const RegDiffSource&) = delete;
+
+    // 加入一个操作（按调用顺序编号）
+    bool AddOp(const RegOp& op) {
+        if (op.kind == RegOpCreateKey || op.kind == RegOpDeleteKey) {
+            MakeRegDiffKeyRecord(op.kind, op.keyPath, &m_record);
+        } else {
+            // 同一节中的值操作路径相同，只折叠一次
+            if (op.keyPath != m_lastPath) {
+                m_lastPath = op.keyPath;
+                m_foldedPath.clear();
+                AppendRegDiffFoldedPath(op.keyPath.data(), op.keyPath.size(), &m_foldedPath);
+            }
+            MakeRegDiffValueRecord(op.kind, m_foldedPath, op.valueName, op.type, op.data.data(), op.data.size(),
+                                   &m_record);
+        }
+        m_record.seq = ++m_seq;
+        return m_sorter.Add(m_record);
+    }
+
+    // 流式解析并加入一个.reg文件，失败时返回false并设置error
+    bool AddRegFile(const std::string& path, AnsiToUtf8Fn ansiDecoder, std::string* error) {
+        bool added = true;
+        RegFileParser parser([this, &added](const RegOp& op) { added = AddOp(op) && added; });
+        parser.SetAnsiDecoder(ansiDecoder);
+        if (!ParseRegFile(path, parser, error)) {
+            return false;
+        }
+        if (!added) {
+            *error = m_sorter.GetError();
+            return false;
+        }
+        return true;
+    }
+
+    // 并行遍历并加入注册表子树，任一根路径无效或无法打开时返回false并设置error
+    bool AddSubtree(RegBackend& backend, const std::vector<std::string>& keyPaths, size_t jobs, std::string* error) {
+        std::vector<std::string> roots;
+        for (size_t i = 0; i < keyPaths.size(); i++) {
+            std::string path;
+            if (!NormalizeRegKeyPath(keyPaths[i], &path)) {
+                *error = "Invalid registry path format: " + keyPaths[i];
+                return false;
+            }
+            while (path.length() > 1 && path[path.length() - 1] == '\\') {
+                path.erase(path.length() - 1);
+            }
+            RegKeyHandle key = NULL;
+            long result = backend.OpenKey(path, &key);
+            if (result != kRegSuccess) {
+                *error = "Failed to open registry key: " + path + " (Error code: " + std::to_string(result) + ")";
+                return false;
+            }
+            backend.CloseKey(key);
+            roots.push_back(path);
+        }
+
+        RegDiffCollector collector;
+        RegTraversal traversal(backend, collector, jobs);
+        bool added = true;
+        traversal.Run(roots, [this, &added](const std::string&, int, RegTraversalOutput& output) {
+            const uint8_t* data = output.data.data();
+            size_t size = output.data.size();
+            size_t used = 0;
+            while (added && size > 0 && DecodeRegDiffRecord(data, size, &used, &m_record)) {
+                m_record.seq = ++m_seq;
+                added = m_sorter.Add(m_record);
+                data += used;
+                size -= used;
+            }
+        });
+        if (!added) {
+            *error = m_sorter.GetError();
+            return false;
+        }
+        return true;
+    }
+
+    // 结束输入，开始读出
+    bool Finish(std::string* error) {
+        if (!m_sorter.Finish()) {
+            *error = m_sorter.GetError();
+            return false;
+        }
+        m_hasRecord = m_sorter.Next(&m_record);
+        return !m_sorter.Failed();
+    }
+
+    // 读出下一个存在的键（含只由子键隐含的上级键），读完或读取失败时返回false
+    bool NextKey(RegDiffKey* key) {
+        while (m_ready.empty()) {
+            if (!ReadGroup()) {
+                return false;
+            }
+        }
+        std::swap(*key, m_ready.front());
+        m_ready.pop_front();
+        return true;
+    }
+
+    bool Failed() const { return m_sorter.Failed(); }
+    const std::string& GetError() const { return m_sorter.GetError(); }
+    const RegDiffSorter& GetSorter() const { return m_sorter; }
+
+private:
+    // 处理同一路径的全部记录（键操作在前，值按折叠值名排序），还原该键的最终状态
+    bool ReadGroup() {
+        if (!m_hasRecord) {
+            return false;
+        }
+        size_t pathLength = m_record.PathLength();
+        std::string sortPath = m_record.sortKey.substr(0, pathLength);
+        uint64_t createSeq = 0;
+        uint64_t deleteSeq = 0;
+        std::string path;
+        std::vector<RegDiffRecord> values;
+        while (m_hasRecord && m_record.sortKey.size() > pathLength && m_record.sortKey[pathLength] == '\0' &&
+               m_record.sortKey.compare(0, pathLength, sortPath) == 0) {
+            if (m_record.kind == RegOpCreateKey) {
+                createSeq = m_record.seq;
+                path.swap(m_record.text);
+            } else if (m_record.kind == RegOpDeleteKey) {
+                deleteSeq = m_record.seq;
+            } else if (!values.empty() && values.back().sortKey == m_record.sortKey) {
+                // 同一值的多次操作按顺序排列，最后一次有效
+                std::swap(values.back(), m_record);
+            } else {
+                values.push_back(RegDiffRecord());
+                std::swap(values.back(), m_record);
+            }
+            m_hasRecord = m_sorter.Next(&m_record);
+        }
+
+        // 上级键和本键的删除使序号更小的操作失效
+        while (!m_deleted.empty() && !RegDiffPathWithin(sortPath, m_deleted.back().first)) {
+            m_deleted.pop_back();
+        }
+        uint64_t killSeq = m_deleted.empty() ? 0 : m_deleted.back().second;
+        if (deleteSeq > 0) {
+            killSeq = std::max(killSeq, deleteSeq);
+            m_deleted.push_back(std::make_pair(sortPath, killSeq));
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < values.size(); i++) {
+            if (values[i].kind == RegOpSetValue && values[i].seq > killSeq) {
+                if (kept != i) {
+                    std::swap(values[kept], values[i]);
+                }
+                kept++;
+            }
+        }
+        values.resize(kept);
+        if (createSeq <= killSeq && values.empty()) {
+            return true;
+        }
+        if (path.size() != sortPath.size()) {
+            path = UnfoldPath(sortPath);
+        }
+
+        // 补出没有单独出现的上级键
+        while (!m_chain.empty() && !RegDiffPathWithin(sortPath, m_chain.back())) {
+            m_chain.pop_back();
+        }
+        size_t start = m_chain.empty() ? 0 : m_chain.back().size() + 1;
+        for (size_t pos = sortPath.find('\x01', start); pos != std::string::npos; pos = sortPath.find('\x01', pos + 1)) {
+            m_ready.push_back(RegDiffKey());
+            m_ready.back().sortPath = sortPath.substr(0, pos);
+            m_ready.back().path = path.substr(0, pos);
+            m_chain.push_back(m_ready.back().sortPath);
+        }
+        m_chain.push_back(sortPath);
+        m_ready.push_back(RegDiffKey());
+        m_ready.back().sortPath.swap(sortPath);
+        m_ready.back().path.swap(path);
+        m_ready.back().values.swap(values);
+        return true;
+    }
+
+    static std::string UnfoldPath(const std::string& sortPath) {
+        std::string path(sortPath);
+        std::replace(path.begin(), path.end(), '\x01', '\\');
+        return path;
+    }
+
+    RegDiffSorter m_sorter;
+    uint64_t m_seq;
+    RegDiffRecord m_record;                     // 输入时的临时记录，读出时为下一条未处理的记录
+    std::string m_lastPath;                     // 上一个值操作的路径及其折叠结果
+    std::string m_foldedPath;
+    bool m_hasRecord;
+    std::vector<std::pair<std::string, uint64_t> > m_deleted;  // 当前路径上的键删除（折叠路径，生效序号）
+    std::vector<std::string> m_chain;           // 已读出的当前路径上的键
+    std::deque<RegDiffKey> m_ready;
+};
+
+// 差异统计
+struct RegDiffStats {
+    size_t fromKeys;
+    size_t toKeys;
+    size_t keysAdded;
+    size_t keysDeleted;         // 含被删除子树中的全部键
+    size_t keysChanged;         // 两者都有且值有变化的键
+    size_t valuesAdded;
+    size_t valuesChanged;
+    size_t valuesDeleted;       // 含被删除键中的值
+    size_t bytes;               // 补丁文件大小
+
+    RegDiffStats()
+        : fromKeys(0), toKeys(0), keysAdded(0), keysDeleted(0), keysChanged(0), valuesAdded(0), valuesChanged(0),
+          valuesDeleted(0), bytes(0) {}
+
+    bool Empty() const { return keysAdded == 0 && keysDeleted == 0 && keysChanged == 0; }
+};
+
+// 补丁写入器：归并两个来源的键流，输出把from变为to的UTF-16LE .reg
+class RegDiffWriter {
+public:
+    explicit RegDiffWriter(const RegOutputSink& sink, size_t bufferSize = 1024 * 1024)
+        : m_sink(sink), m_bufferSize(bufferSize), m_failed(false) {
+        m_buffer.reserve(bufferSize + 64 * 1024);
+    }
+
+    // 禁止拷贝
+    RegDiffWriter(const RegDiffWriter&) = delete;
+    RegDiffWriter& operator=(const RegDiffWriter&) = delete;
+
+    // 比较两个已Finish的来源，失败时返回false并设置error
+    bool Diff(RegDiffSource& from, RegDiffSource& to, std::string* error) {
+        static const uint8_t bom[] = {0xFF, 0xFE};
+        m_buffer.insert(m_buffer.end(), bom, bom + 2);
+        RegExporter::AppendAscii(&m_buffer, "Windows Registry Editor Version 5.00\r\n");
+
+        RegDiffKey a;
+        RegDiffKey b;
+        bool hasA = from.NextKey(&a);
+        bool hasB = to.NextKey(&b);
+        while (hasA || hasB) {
+            int cmp = !hasA ? 1 : !hasB ? -1 : a.sortPath.compare(b.sortPath);
+            if (cmp < 0) {
+                DeleteKey(a);
+                m_stats.fromKeys++;
+                hasA = from.NextKey(&a);
+            } else if (cmp > 0) {
+                AddKey(b);
+                m_stats.toKeys++;
+                hasB = to.NextKey(&b);
+            } else {
+                ChangeKey(a, b);
+                m_stats.fromKeys++;
+                m_stats.toKeys++;
+                hasA = from.NextKey(&a);
+                hasB = to.NextKey(&b);
+            }
+            if (m_buffer.size() >= m_bufferSize) {
+                Flush();
+            }
+        }
+        ResolvePending(std::string());
+        RegExporter::AppendAscii(&m_buffer, "\r\n");
+        Flush();
+
+        if (from.Failed() || to.Failed()) {
+            *error = from.Failed() ? from.GetError() : to.GetError();
+            return false;
+        }
+        if (m_failed) {
+            *error = "Failed to write diff output";
+            return false;
+        }
+        return true;
+    }
+
+    const RegDiffStats& GetStats() const { return m_stats; }
+
+private:
+    // 只在to中的键：有值时输出节标题和全部值；没有值时先挂起，下一个键是它的子键时由子键隐含创建
+    void AddKey(const RegDiffKey& key) {
+        ResolvePending(key.sortPath);
+        m_stats.keysAdded++;
+        m_stats.valuesAdded += key.values.size();
+        if (key.values.empty()) {
+            m_pendingSortPath = key.sortPath;
+            m_pendingPath = key.path;
+            return;
+        }
+        AppendSection("", key.path);
+        for (size_t i = 0; i < key.values.size(); i++) {
+            AppendValue(key.values[i]);
+        }
+    }
+
+    // 只在from中的键：输出被删除子树的根，根键（HKEY_*）本身不删除
+    void DeleteKey(const RegDiffKey& key) {
+        ResolvePending(key.sortPath);
+        m_stats.keysDeleted++;
+        m_stats.valuesDeleted += key.values.size();
+        if (!m_deletedSortPath.empty() && RegDiffPathWithin(key.sortPath, m_deletedSortPath)) {
+            return;
+        }
+        if (key.sortPath.find('\x01') == std::string::npos) {
+            return;
+        }
+        AppendSection("-", key.path);
+        m_deletedSortPath = key.sortPath;
+    }
+
+    // 两者都有的键：按折叠值名归并，第一次有变化时输出节标题（使用to中的路径大小写）
+    void ChangeKey(const RegDiffKey& from, const RegDiffKey& to) {
+        ResolvePending(to.sortPath);
+        bool changed = false;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < from.values.size() || j < to.values.size()) {
+            int cmp = i == from.values.size() ? 1 : j == to.values.size() ? -1 :
+                      from.values[i].sortKey.compare(to.values[j].sortKey);
+            if (cmp < 0) {
+                StartChange(to.path, &changed);
+                AppendDeleteValue(from.values[i].text);
+                m_stats.valuesDeleted++;
+                i++;
+            } else if (cmp > 0) {
+                StartChange(to.path, &changed);
+                AppendValue(to.values[j]);
+                m_stats.valuesAdded++;
+                j++;
+            } else {
+                if (from.values[i].type != to.values[j].type || from.values[i].data != to.values[j].data) {
+                    StartChange(to.path, &changed);
+                    AppendValue(to.values[j]);
+                    m_stats.valuesChanged++;
+                }
+                i++;
+                j++;
+            }
+        }
+        if (changed) {
+            m_stats.keysChanged++;
+        }
+    }
+
+    void StartChange(const std::string& path, bool* changed) {
+        if (!*changed) {
+            AppendSection("", path);
+            *changed = true;
+        }
+    }
+
+    // 挂起的空键：下一个键不在它下面时输出节标题
+    void ResolvePending(const std::string& nextSortPath) {
+        if (m_pendingSortPath.empty()) {
+            return;
+        }
+        if (nextSortPath.empty() || !RegDiffPathWithin(nextSortPath, m_pendingSortPath)) {
+            AppendSection("", m_pendingPath);
+        }
+        m_pendingSortPath.clear();
+        m_pendingPath.clear();
+    }
+
+    void AppendSection(const char* prefix, const std::string& path) {
+        RegExporter::AppendAscii(&m_buffer, "\r\n[");
+        RegExporter::AppendAscii(&m_buffer, prefix);
+        Utf8ToUtf16Le(path.data(), path.size(), &m_buffer);
+        RegExporter::AppendAscii(&m_buffer, "]\r\n");
+    }
+
+    void AppendValue(const RegDiffRecord& value) {
+        RegExporter::AppendValue(value.text, value.type, value.data.data(), value.data.size(), &m_buffer);
+    }
+
+    void AppendDeleteValue(const std::string& name) {
+        if (name.empty()) {
+            RegExporter::AppendAscii(&m_buffer, "@=-\r\n");
+            return;
+        }
+        RegExporter::AppendAscii(&m_buffer, "\"");
+        RegExporter::AppendEscapedUtf8(name, &m_buffer);
+        RegExporter::AppendAscii(&m_buffer, "\"=-\r\n");
+    }
+
+    void Flush() {
+        if (m_buffer.empty()) {
+            return;
+        }
+        if (!m_failed && !m_sink(m_buffer.data(), m_buffer.size())) {
+            m_failed = true;
+        }
+        m_stats.bytes += m_buffer.size();
+        m_buffer.clear();
+    }
+
+    RegOutputSink m_sink;
+    size_t m_bufferSize;
+    std::vector<uint8_t> m_buffer;
+    bool m_failed;
+    RegDiffStats m_stats;
+    std::string m_pendingSortPath;          // 挂起的新增空键（折叠路径，空表示没有）
+    std::string m_pendingPath;
+    std::string m_deletedSortPath;          // 最近输出的被删除子树的根
+};
+
+#endif // REG_DIFF_H
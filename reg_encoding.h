@@ -0,0 +1,161 @@
+/*
+ * 静默注册表导入程序 - 文本编码转换
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 平台无关：内部统一使用UTF-8，注册表字符串数据使用UTF-16LE
+ * 连续ASCII段由reg_simd.h中的向量化内核批量转换
+ */
+
+#ifndef REG_ENCODING_H
+#define REG_ENCODING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "reg_simd.h"
+
+// 写入一个Unicode码点的UTF-8编码，返回写入的字节数（最多4字节）
+inline size_t WriteUtf8(uint32_t cp, char* dst) {
+    if (cp < 0x80) {
+        dst[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        dst[0] = static_cast<char>(0xC0 | (cp >> 6));
+        dst[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        dst[0] = static_cast<char>(0xE0 | (cp >> 12));
+        dst[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        dst[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    dst[0] = static_cast<char>(0xF0 | (cp >> 18));
+    dst[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    dst[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    dst[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// 追加一个Unicode码点的UTF-8编码
+inline void AppendUtf8(uint32_t cp, std::string* out) {
+    char buffer[4];
+    out->append(buffer, WriteUtf8(cp, buffer));
+}
+
+// 写入一个Unicode码点的UTF-16LE编码，返回写入的字节数（2或4字节）
+inline size_t WriteUtf16Le(uint32_t cp, uint8_t* dst) {
+    if (cp >= 0x10000) {
+        cp -= 0x10000;
+        uint32_t high = 0xD800 + (cp >> 10);
+        uint32_t low = 0xDC00 + (cp & 0x3FF);
+        dst[0] = static_cast<uint8_t>(high & 0xFF);
+        dst[1] = static_cast<uint8_t>(high >> 8);
+        dst[2] = static_cast<uint8_t>(low & 0xFF);
+        dst[3] = static_cast<uint8_t>(low >> 8);
+        return 4;
+    }
+    dst[0] = static_cast<uint8_t>(cp & 0xFF);
+    dst[1] = static_cast<uint8_t>(cp >> 8);
+    return 2;
+}
+
+// 追加一个Unicode码点的UTF-16LE编码
+inline void AppendUtf16Le(uint32_t cp, std::vector<uint8_t>* out) {
+    uint8_t buffer[4];
+    out->insert(out->end(), buffer, buffer + WriteUtf16Le(cp, buffer));
+}
+
+// UTF-16LE字节转换为UTF-8并追加到out（units为16位单元个数，无效代理项替换为U+FFFD）
+inline void Utf16LeToUtf8(const uint8_t* data, size_t units, std::string* out) {
+    if (units == 0) {
+        return;
+    }
+    // 每个16位单元最多产生3字节UTF-8，先按上限扩容再回缩
+    size_t base = out->size();
+    out->resize(base + units * 3);
+    char* start = &(*out)[base];
+    char* dst = start;
+    size_t i = 0;
+    while (i < units) {
+        size_t run = RegUtf16AsciiToUtf8(data + i * 2, units - i, dst);
+        dst += run;
+        i += run;
+        if (i >= units) {
+            break;
+        }
+        uint32_t unit = static_cast<uint32_t>(data[i * 2]) | (static_cast<uint32_t>(data[i * 2 + 1]) << 8);
+        if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < units) {
+            uint32_t next = static_cast<uint32_t>(data[(i + 1) * 2]) | (static_cast<uint32_t>(data[(i + 1) * 2 + 1]) << 8);
+            if (next >= 0xDC00 && next <= 0xDFFF) {
+                dst += WriteUtf8(0x10000 + ((unit - 0xD800) << 10) + (next - 0xDC00), dst);
+                i += 2;
+                continue;
+            }
+        }
+        if (unit >= 0xD800 && unit <= 0xDFFF) {
+            unit = 0xFFFD;
+        }
+        dst += WriteUtf8(unit, dst);
+        i++;
+    }
+    out->resize(base + static_cast<size_t>(dst - start));
+}
+
+// UTF-8转换为UTF-16LE字节并追加到out（无效字节序列替换为U+FFFD）
+inline void Utf8ToUtf16Le(const char* data, size_t size, std::vector<uint8_t>* out) {
+    if (size == 0) {
+        return;
+    }
+    // 每个UTF-8字节最多产生2字节UTF-16LE，先按上限扩容再回缩
+    size_t base = out->size();
+    out->resize(base + size * 2);
+    uint8_t* start = &(*out)[base];
+    uint8_t* dst = start;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+    while (i < size) {
+        size_t run = RegAsciiToUtf16Le(data + i, size - i, dst);
+        dst += run * 2;
+        i += run;
+        if (i >= size) {
+            break;
+        }
+        uint32_t c = p[i];
+        size_t extra = (c >= 0xF8) ? 0 : (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC2) ? 1 : 0;
+        uint32_t cp = (extra == 3) ? (c & 0x07) : (extra == 2) ? (c & 0x0F) : (c & 0x1F);
+        bool valid = extra > 0;
+        for (size_t k = 1; valid && k <= extra; k++) {
+            if (i + k >= size || (p[i + k] & 0xC0) != 0x80) {
+                valid = false;
+            } else {
+                cp = (cp << 6) | (p[i + k] & 0x3F);
+            }
+        }
+        if (valid && ((extra == 2 && cp < 0x800) || (extra == 3 && (cp < 0x10000 || cp > 0x10FFFF)) ||
+                      (cp >= 0xD800 && cp <= 0xDFFF))) {
+            valid = false;
+        }
+        if (!valid) {
+            dst += WriteUtf16Le(0xFFFD, dst);
+            i++;
+            continue;
+        }
+        dst += WriteUtf16Le(cp, dst);
+        i += extra + 1;
+    }
+    out->resize(base + static_cast<size_t>(dst - start));
+}
+
+// Latin-1（单字节ANSI回退方案）转换为UTF-8并追加到out
+inline void Latin1ToUtf8(const char* data, size_t size, std::string* out) {
+    for (size_t i = 0; i < size; i++) {
+        AppendUtf8(static_cast<uint8_t>(data[i]), out);
+    }
+}
+
+#endif // REG_ENCODING_H
@@ -0,0 +1,293 @@
+/*
+ * 静默注册表导入程序 - REGEDIT5导出
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 遍历（可并行）RegBackend中的子树，按regedit/reg export的格式流式输出：
+ * - UTF-16LE带BOM，CRLF换行，键之间以空行分隔
+ * - 字符串转义\和"，dword:%08x，其余类型输出为小写hex:/hex(N):
+ * - hex数据由reg_hex.h按regedit布局编码：每行不超过80列，续行以",\"结尾并缩进两个空格
+ * - REG_SZ数据不是规范的NUL结尾UTF-16，或含有控制字符（CR、LF等小于0x20的字符，写在引号内会被
+ *   解析器按行拆开）时输出为hex(1)，保证重新导入后字节完全一致
+ * - 值名中的CR、LF转义为\r、\n（值名没有hex形式，解析器会还原这两个转义）
+ * 输出按遍历顺序汇总到可复用的大缓冲区，满后整块交给输出回调
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_EXPORT_H
+#define REG_EXPORT_H
+
+#include "reg_backend.h"
+#include "reg_encoding.h"
+#include "reg_hex.h"
+#include "reg_parser.h"
+#include "reg_simd.h"
+#include "reg_traverse.h"
+#include "reg_types.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 导出进度回调
+typedef std::function<void(size_t keys, size_t bytes)> RegExportProgressSink;
+
+// hex数据行宽（与regedit一致，行长达到77后换行）
+const size_t kRegExportHexLineLimit = 77;
+
+// 导出统计
+struct RegExportStats {
+    size_t keys;
+    size_t values;
+    size_t bytes;
+
+    RegExportStats() : keys(0), values(0), bytes(0) {}
+};
+
+// 值名中需要转义的字符：引号、反斜杠、CR和LF
+inline const RegCharSet& RegNameEscapeChars() {
+    static const RegCharSet set("\"\\\r\n");
+    return set;
+}
+
+// REGEDIT5格式导出器（每个键的文本由遍历引擎的工作线程并行格式化）
+class RegExporter : public RegTraversalVisitor {
+public:
+    RegExporter(RegBackend& backend, const RegOutputSink& sink, size_t bufferSize = 1024 * 1024, size_t jobs = 1)
+        : m_backend(backend), m_sink(sink), m_bufferSize(bufferSize), m_jobs(jobs), m_failed(false),
+          m_filter(NULL) {
+        m_buffer.reserve(bufferSize + 64 * 1024);
+    }
+
+    // 禁止拷贝
+    RegExporter(const RegExporter&) = delete;
+    RegExporter& operator=(const RegExporter&) = delete;
+
+    // 只导出过滤器选中的键和值（过滤器须在导出期间保持有效）
+    void SetFilter(const RegKeyFilter* filter) { m_filter = filter; }
+
+    void SetProgressSink(const RegExportProgressSink& sink) { m_progress = sink; }
+
+    // 导出一个或多个子树（共用一个文件头），失败时返回false并设置error
+    bool Export(const std::vector<std::string>& keyPaths, std::string* error) {
+        std::vector<std::string> roots;
+        for (size_t i = 0; i < keyPaths.size(); i++) {
+            std::string path;
+            if (!NormalizeRegKeyPath(keyPaths[i], &path)) {
+                *error = "Invalid registry path format: " + keyPaths[i];
+                return false;
+            }
+            while (path.length() > 1 && path[path.length() - 1] == '\\') {
+                path.erase(path.length() - 1);
+            }
+            RegKeyHandle key = NULL;
+            long result = m_backend.OpenKey(path, &key);
+            if (result != kRegSuccess) {
+                *error = "Failed to open registry key: " + path + " (Error code: " + std::to_string(result) + ")";
+                return false;
+            }
+            m_backend.CloseKey(key);
+            roots.push_back(path);
+        }
+
+        static const uint8_t bom[] = {0xFF, 0xFE};
+        m_buffer.insert(m_buffer.end(), bom, bom + 2);
+        AppendAscii(&m_buffer, "Windows Registry Editor Version 5.00\r\n");
+        RegTraversal traversal(m_backend, *this, m_jobs);
+        traversal.SetFilter(m_filter);
+        traversal.Run(roots, [this](const std::string&, int, RegTraversalOutput& output) {
+            // 只经过的中间键不输出节标题，导入时由其下的键自动创建
+            if (!output.opened || !output.selected) {
+                return;
+            }
+            m_buffer.insert(m_buffer.end(), output.data.begin(), output.data.end());
+            m_stats.keys++;
+            m_stats.values += output.values;
+            if (m_buffer.size() >= m_bufferSize) {
+                Flush();
+            }
+            if (m_progress && (m_stats.keys & 0xFFF) == 0) {
+                m_progress(m_stats.keys, m_stats.bytes + m_buffer.size());
+            }
+        });
+        AppendAscii(&m_buffer, "\r\n");
+        Flush();
+        m_traversalStats = traversal.GetStats();
+        if (m_failed) {
+            *error = "Failed to write export output";
+            return false;
+        }
+        return true;
+    }
+
+    const RegExportStats& GetStats() const { return m_stats; }
+    const RegTraversalStats& GetTraversalStats() const { return m_traversalStats; }
+
+    bool VisitKey(RegBackend& backend, RegKeyHandle key, const std::string& path, int,
+                  RegTraversalContext& context, RegTraversalOutput* out) override {
+        AppendAscii(&out->data, "\r\n[");
+        Utf8ToUtf16Le(path.data(), path.size(), &out->data);
+        AppendAscii(&out->data, "]\r\n");
+        for (uint32_t index = 0; ; index++) {
+            long result = backend.EnumValue(key, index, &context.name, &context.type, &context.data);
+            if (result == kRegErrorNoMoreItems) {
+                break;
+            }
+            if (result == kRegSuccess && context.ValueSelected()) {
+                AppendValue(context.name, context.type, context.data.data(), context.data.size(), &out->data);
+                out->values++;
+            }
+        }
+        return true;
+    }
+
+    // 无法打开的子键（如权限不足）与regedit一样跳过
+    void VisitError(const std::string&, int, long, RegTraversalOutput*) override {}
+
+    // 输出一个值行（含结尾CRLF）
+    static void AppendValue(const std::string& name, uint32_t type, const uint8_t* data, size_t size,
+                            std::vector<uint8_t>* out) {
+        // 值名部分的长度（UTF-16单元）计入hex首行的行长
+        size_t lineStart = out->size();
+        if (name.empty()) {
+            AppendAscii(out, "@=");
+        } else {
+            AppendAscii(out, "\"");
+            AppendEscapedUtf8(name, out);
+            AppendAscii(out, "\"=");
+        }
+        size_t lineLength = (out->size() - lineStart) / 2;
+
+        if (type == kRegSz && IsPlainString(data, size)) {
+            AppendAscii(out, "\"");
+            AppendEscapedUtf16(data, size == 0 ? 0 : size / 2 - 1, out);
+            AppendAscii(out, "\"");
+        } else if (type == kRegDword && size == 4) {
+            uint32_t value = static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                             (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+            AppendAscii(out, "dword:");
+            AppendHexDword(value, out);
+        } else {
+            AppendHex(type, lineLength, data, size, out);
+        }
+        AppendAscii(out, "\r\n");
+    }
+
+    // 追加ASCII文本（转为UTF-16LE）
+    static void AppendAscii(std::vector<uint8_t>* out, const char* text) {
+        AppendAsciiRun(text, std::strlen(text), out);
+    }
+
+    // 追加UTF-8文本（转为UTF-16LE），引号和反斜杠加转义，CR、LF转义为\r、\n
+    static void AppendEscapedUtf8(const std::string& text, std::vector<uint8_t>* out) {
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t special = start + RegFindAnyOf(text.data() + start, text.size() - start, RegNameEscapeChars());
+            Utf8ToUtf16Le(text.data() + start, special - start, out);
+            if (special == text.size()) {
+                break;
+            }
+            char c = text[special];
+            char escaped[2] = {'\\', c == '\r' ? 'r' : c == '\n' ? 'n' : c};
+            AppendAsciiRun(escaped, 2, out);
+            start = special + 1;
+        }
+    }
+
+private:
+    // 空数据，或恰好以一个NUL结尾且中间没有NUL和其他控制字符的UTF-16数据
+    static bool IsPlainString(const uint8_t* data, size_t size) {
+        if (size == 0) {
+            return true;
+        }
+        if (size % 2 != 0) {
+            return false;
+        }
+        size_t units = size / 2;
+        return RegFindUtf16Control(data, units) == units - 1 && data[size - 2] == 0 && data[size - 1] == 0;
+    }
+
+    // hex:或hex(N):，首行从值名之后开始计算行长
+    static void AppendHex(uint32_t type, size_t lineLength, const uint8_t* data, size_t size,
+                          std::vector<uint8_t>* out) {
+        if (type == kRegBinary) {
+            AppendAscii(out, "hex:");
+            lineLength += 4;
+        } else {
+            char prefix[16];
+            int length = std::snprintf(prefix, sizeof(prefix), "hex(%x):", type);
+            AppendAscii(out, prefix);
+            lineLength += static_cast<size_t>(length);
+        }
+        // 按最坏情况一次性扩容，分段编码为ASCII后转为UTF-16LE写入，数据长度不限
+        RegHexLayoutEncoder encoder(lineLength, kRegExportHexLineLimit);
+        size_t base = out->size();
+        out->resize(base + encoder.MaxEncodedSize(size) * 2);
+        uint8_t* dst = out->data() + base;
+        char text[4096];
+        const size_t chunk = 1024;
+        for (size_t i = 0; i < size; i += chunk) {
+            size_t length = encoder.Encode(data + i, size - i < chunk ? size - i : chunk, text);
+            RegAsciiToUtf16Le(text, length, dst);
+            dst += length * 2;
+        }
+        out->resize(static_cast<size_t>(dst - out->data()));
+    }
+
+    static void AppendHexDword(uint32_t value, std::vector<uint8_t>* out) {
+        static const char digits[] = "0123456789abcdef";
+        char text[8];
+        for (int i = 7; i >= 0; i--) {
+            text[i] = digits[value & 0x0F];
+            value >>= 4;
+        }
+        AppendAsciiRun(text, 8, out);
+    }
+
+    static void AppendAsciiRun(const char* text, size_t length, std::vector<uint8_t>* out) {
+        size_t base = out->size();
+        out->resize(base + length * 2);
+        RegAsciiToUtf16Le(text, length, out->data() + base);
+    }
+
+    static void AppendEscapedUtf16(const uint8_t* data, size_t units, std::vector<uint8_t>* out) {
+        size_t start = 0;
+        while (start < units) {
+            size_t special = start + RegFindUtf16AnyOf(data + start * 2, units - start, RegQuoteChars());
+            out->insert(out->end(), data + start * 2, data + special * 2);
+            if (special == units) {
+                break;
+            }
+            char escaped[2] = {'\\', static_cast<char>(data[special * 2])};
+            AppendAsciiRun(escaped, 2, out);
+            start = special + 1;
+        }
+    }
+
+    void Flush() {
+        if (m_buffer.empty()) {
+            return;
+        }
+        if (!m_failed && !m_sink(m_buffer.data(), m_buffer.size())) {
+            m_failed = true;
+        }
+        m_stats.bytes += m_buffer.size();
+        m_buffer.clear();
+    }
+
+    RegBackend& m_backend;
+    RegOutputSink m_sink;
+    RegExportProgressSink m_progress;
+    size_t m_bufferSize;
+    size_t m_jobs;
+    std::vector<uint8_t> m_buffer;
+    bool m_failed;
+    RegExportStats m_stats;
+    const RegKeyFilter* m_filter;
+    RegTraversalStats m_traversalStats;
+};
+
+#endif // REG_EXPORT_H
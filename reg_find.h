@@ -0,0 +1,284 @@
+/*
+ * 静默注册表导入程序 - 子树内并行查找
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 在查询路径下查找键名、值名或值数据中包含模式的键和值（--find），不必先导出再搜索文本：
+ * - 复用查询的并行遍历引擎，每个键在工作线程中匹配，命中的键按先序写出并立即刷新，边遍历边输出
+ * - 字面（可忽略大小写）匹配：REG_SZ/REG_EXPAND_SZ/REG_MULTI_SZ直接在UTF-16LE原始数据上
+ *   按单元做向量化子串查找（模式预先转为UTF-16LE），不解码，也不会跨越REG_MULTI_SZ的字符串边界
+ * - 正则匹配（ECMAScript语法）：字符串值解码为UTF-8后匹配，REG_MULTI_SZ逐个字符串匹配
+ * - 其他类型按查询输出的格式化文本匹配（如DWORD的"0x00000001 (1)"、二进制的十六进制列表）
+ * - 忽略大小写只折叠ASCII字母，与注册表键名的比较一致
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_FIND_H
+#define REG_FIND_H
+
+#include "reg_backend.h"
+#include "reg_encoding.h"
+#include "reg_keyfilter.h"
+#include "reg_query.h"
+#include "reg_simd.h"
+#include "reg_traverse.h"
+#include "reg_types.h"
+
+#include <ostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+// 查找范围（可组合）
+enum RegFindScope {
+    kRegFindKeyNames = 1,
+    kRegFindValueNames = 2,
+    kRegFindData = 4,
+    kRegFindAll = 7
+};
+
+// 解析查找范围：逗号分隔的keys、names、data
+inline bool ParseRegFindScope(const std::string& text, unsigned* scope) {
+    unsigned result = 0;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string part = text.substr(start, end - start);
+        if (RegEqualsIgnoreCase(part.data(), part.size(), "keys", 4)) {
+            result |= kRegFindKeyNames;
+        } else if (RegEqualsIgnoreCase(part.data(), part.size(), "names", 5)) {
+            result |= kRegFindValueNames;
+        } else if (RegEqualsIgnoreCase(part.data(), part.size(), "data", 4)) {
+            result |= kRegFindData;
+        } else {
+            return false;
+        }
+        start = end + 1;
+    }
+    *scope = result;
+    return result != 0;
+}
+
+// 编译后的查找模式（只读，可在多个遍历线程中同时使用）
+class RegFindPattern {
+public:
+    RegFindPattern() : m_ignoreCase(false), m_regex(false) {}
+
+    // 编译模式；模式为空或正则语法错误时返回false并设置error
+    bool Compile(const std::string& pattern, bool ignoreCase, bool regex, std::string* error) {
+        if (pattern.empty()) {
+            *error = "Empty search pattern";
+            return false;
+        }
+        m_ignoreCase = ignoreCase;
+        m_regex = regex;
+        if (regex) {
+            // std::regex只以异常报告语法错误，在此转为返回值
+            try {
+                std::regex::flag_type flags = std::regex::ECMAScript | std::regex::optimize;
+                m_compiled = std::regex(pattern, ignoreCase ? (flags | std::regex::icase) : flags);
+            } catch (const std::regex_error& e) {
+                *error = "Invalid regular expression: " + pattern + " (" + e.what() + ")";
+                return false;
+            }
+            return true;
+        }
+        m_needle = pattern;
+        if (ignoreCase) {
+            for (size_t i = 0; i < m_needle.size(); i++) {
+                m_needle[i] = RegAsciiLower(m_needle[i]);
+            }
+        }
+        m_needleUtf16.clear();
+        Utf8ToUtf16Le(m_needle.data(), m_needle.size(), &m_needleUtf16);
+        return true;
+    }
+
+    // UTF-8文本（键名、值名或格式化后的数据）是否包含模式
+    bool MatchText(const char* text, size_t size) const {
+        if (m_regex) {
+            return std::regex_search(text, text + size, m_compiled);
+        }
+        return RegFindSubstring(text, size, m_needle.data(), m_needle.size(), m_ignoreCase) < size;
+    }
+
+    bool MatchText(const std::string& text) const { return MatchText(text.data(), text.size()); }
+
+    // 值数据是否包含模式；scratch为调用方的解码缓冲区
+    bool MatchValueData(uint32_t type, const uint8_t* data, size_t size, std::string* scratch) const {
+        if (type == kRegSz || type == kRegExpandSz || type == kRegMultiSz) {
+            size_t units = size / 2;
+            if (!m_regex) {
+                size_t units16 = m_needleUtf16.size() / 2;
+                return RegFindSubstringUtf16(data, units, m_needleUtf16.data(), units16, m_ignoreCase) < units;
+            }
+            if (type != kRegMultiSz) {
+                scratch->clear();
+                AppendRegStringData(data, size, scratch);
+                return MatchText(*scratch);
+            }
+            // 逐个字符串匹配，模式不跨越字符串边界
+            size_t start = 0;
+            for (size_t i = 0; i <= units; i++) {
+                if (i < units && (data[i * 2] != 0 || data[i * 2 + 1] != 0)) {
+                    continue;
+                }
+                if (i > start) {
+                    scratch->clear();
+                    Utf16LeToUtf8(data + start * 2, i - start, scratch);
+                    if (MatchText(*scratch)) {
+                        return true;
+                    }
+                }
+                start = i + 1;
+            }
+            return false;
+        }
+        scratch->clear();
+        AppendRegValueData(type, data, size, scratch);
+        return MatchText(*scratch);
+    }
+
+private:
+    bool m_ignoreCase;
+    bool m_regex;
+    std::string m_needle;                   // 字面模式（忽略大小写时已转为小写）
+    std::vector<uint8_t> m_needleUtf16;     // 字面模式的UTF-16LE编码
+    std::regex m_compiled;
+};
+
+// 查找输出器：命中的键输出路径行，其下输出命中的值（格式与查询输出相同）
+class RegFindPrinter : public RegTraversalVisitor {
+public:
+    // jobs > 1时子树由多个线程并行遍历，输出顺序不变
+    RegFindPrinter(RegBackend& backend, const RegFindPattern& pattern, unsigned scope, std::ostream& out,
+                   size_t jobs = 1)
+        : m_backend(backend), m_pattern(pattern), m_scope(scope), m_out(out), m_jobs(jobs), m_matchedKeys(0),
+          m_matchedValues(0), m_filter(NULL) {}
+
+    void SetLogSink(const RegLogSink& sink) { m_log = sink; }
+
+    // 只查找过滤器选中的键和值（过滤器须在查找期间保持有效）
+    void SetFilter(const RegKeyFilter* filter) { m_filter = filter; }
+
+    // 依次查找各路径下的所有键和值，任一路径无效或无法打开时返回false
+    bool Find(const std::vector<std::string>& paths) {
+        bool success = true;
+        std::vector<std::string> roots;
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!SplitRegKeyPath(paths[i], NULL, NULL)) {
+                Log("Error: Invalid registry path format: " + paths[i]);
+                success = false;
+            } else {
+                roots.push_back(paths[i]);
+            }
+        }
+        RegTraversal traversal(m_backend, *this, m_jobs);
+        traversal.SetFilter(m_filter);
+        traversal.Run(roots, [this, &success](const std::string&, int depth, RegTraversalOutput& output) {
+            size_t start = 0;
+            for (size_t i = 0; i < output.logEnds.size(); i++) {
+                Log(output.logs.substr(start, output.logEnds[i] - start));
+                start = output.logEnds[i];
+            }
+            if (!output.opened) {
+                success = success && depth != 0;
+                return;
+            }
+            // 命中的键立即写出并刷新，不等整个遍历结束
+            if (!output.data.empty()) {
+                m_out.write(reinterpret_cast<const char*>(output.data.data()),
+                            static_cast<std::streamsize>(output.data.size()));
+                m_out.flush();
+                m_matchedKeys++;
+                m_matchedValues += output.values;
+            }
+        });
+        m_traversalStats = traversal.GetStats();
+        return success;
+    }
+
+    size_t GetMatchedKeyCount() const { return m_matchedKeys; }
+    size_t GetMatchedValueCount() const { return m_matchedValues; }
+    const RegTraversalStats& GetTraversalStats() const { return m_traversalStats; }
+
+    bool VisitKey(RegBackend& backend, RegKeyHandle key, const std::string& path, int,
+                  RegTraversalContext& context, RegTraversalOutput* out) override {
+        bool shown = false;
+        if ((m_scope & kRegFindKeyNames) != 0) {
+            size_t slash = path.rfind('\\');
+            size_t nameStart = slash == std::string::npos ? 0 : slash + 1;
+            if (m_pattern.MatchText(path.data() + nameStart, path.size() - nameStart)) {
+                ShowKey(path, out, &shown);
+            }
+        }
+        if ((m_scope & (kRegFindValueNames | kRegFindData)) == 0) {
+            return true;
+        }
+
+        std::string& text = context.text;
+        for (uint32_t index = 0; ; index++) {
+            long result = backend.EnumValue(key, index, &context.name, &context.type, &context.data);
+            if (result == kRegErrorNoMoreItems) {
+                break;
+            }
+            if (result != kRegSuccess || !context.ValueSelected()) {
+                continue;
+            }
+            bool matched = (m_scope & kRegFindValueNames) != 0 && m_pattern.MatchText(context.name);
+            if (!matched && (m_scope & kRegFindData) != 0) {
+                matched = m_pattern.MatchValueData(context.type, context.data.data(), context.data.size(),
+                                                   &context.decoded);
+            }
+            if (!matched) {
+                continue;
+            }
+            ShowKey(path, out, &shown);
+            text.assign("  \"").append(context.name).append("\" = ");
+            AppendRegValueData(context.type, context.data.data(), context.data.size(), &text);
+            text.append(" (").append(GetRegTypeName(context.type)).append(")\n");
+            out->data.insert(out->data.end(), text.begin(), text.end());
+            out->values++;
+        }
+        return true;
+    }
+
+    void VisitError(const std::string& path, int, long result, RegTraversalOutput* out) override {
+        out->logs.append("Error: Failed to open registry key: ").append(path);
+        out->logs.append(" (Error code: ").append(std::to_string(result)).append(")");
+        out->EndLog();
+    }
+
+private:
+    // 第一次命中时输出键路径行
+    static void ShowKey(const std::string& path, RegTraversalOutput* out, bool* shown) {
+        if (!*shown) {
+            out->data.insert(out->data.end(), path.begin(), path.end());
+            out->data.push_back('\n');
+            *shown = true;
+        }
+    }
+
+    void Log(const std::string& message) {
+        if (m_log) {
+            m_log(message);
+        }
+    }
+
+    RegBackend& m_backend;
+    const RegFindPattern& m_pattern;
+    unsigned m_scope;
+    std::ostream& m_out;
+    size_t m_jobs;
+    size_t m_matchedKeys;
+    size_t m_matchedValues;
+    const RegKeyFilter* m_filter;
+    RegTraversalStats m_traversalStats;
+    RegLogSink m_log;
+};
+
+#endif // REG_FIND_H
@@ -0,0 +1,417 @@
+/*
+ * 静默注册表导入程序 - 机器可读查询输出
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 以NDJSON、JSON数组或CSV格式流式输出查询结果，每个键、值、错误各一条记录：
+ * - 字符串解码为UTF-8，DWORD/QWORD输出为数字，REG_MULTI_SZ输出为字符串数组
+ * - 其他类型及不规范的数据输出为base64（encoding字段为"base64"）
+ * - 记录由遍历引擎的工作线程并行格式化，按先序写入带大缓冲区的输出流，
+ *   内存占用与子树大小无关
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_FORMAT_H
+#define REG_FORMAT_H
+
+#include "reg_backend.h"
+#include "reg_encoding.h"
+#include "reg_query.h"
+#include "reg_traverse.h"
+#include "reg_types.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// 查询输出格式
+enum RegQueryFormat {
+    kRegFormatText,     // 缩进的可读文本
+    kRegFormatNdjson,   // 每行一个JSON对象
+    kRegFormatJson,     // 单个JSON数组
+    kRegFormatCsv       // RFC 4180 CSV（含表头）
+};
+
+// 解析格式名称（text、ndjson、json、csv）
+inline bool ParseRegQueryFormat(const std::string& text, RegQueryFormat* format) {
+    if (text == "text") *format = kRegFormatText;
+    else if (text == "ndjson") *format = kRegFormatNdjson;
+    else if (text == "json") *format = kRegFormatJson;
+    else if (text == "csv") *format = kRegFormatCsv;
+    else return false;
+    return true;
+}
+
+// 把输出流的数据按大块交给输出回调的流缓冲区
+class RegBufferedOutput : public std::streambuf {
+public:
+    explicit RegBufferedOutput(const RegOutputSink& sink, size_t bufferSize = 1024 * 1024)
+        : m_sink(sink), m_buffer(bufferSize), m_failed(false) {
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+
+    ~RegBufferedOutput() { FlushBuffer(); }
+
+    // 禁止拷贝
+    RegBufferedOutput(const RegBufferedOutput&) = delete;
+    RegBufferedOutput& operator=(const RegBufferedOutput&) = delete;
+
+    bool Failed() const { return m_failed; }
+
+protected:
+    int overflow(int c) override {
+        if (!FlushBuffer()) {
+            return traits_type::eof();
+        }
+        if (c != traits_type::eof()) {
+            *pptr() = static_cast<char>(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize count) override {
+        size_t size = static_cast<size_t>(count);
+        size_t free = static_cast<size_t>(epptr() - pptr());
+        if (size <= free) {
+            std::memcpy(pptr(), data, size);
+            pbump(static_cast<int>(size));
+            return count;
+        }
+        // 超过剩余空间：先写出缓冲区，大块数据直接交给回调
+        if (!FlushBuffer()) {
+            return 0;
+        }
+        if (size >= m_buffer.size()) {
+            if (!m_sink(reinterpret_cast<const uint8_t*>(data), size)) {
+                m_failed = true;
+                return 0;
+            }
+            return count;
+        }
+        std::memcpy(pptr(), data, size);
+        pbump(static_cast<int>(size));
+        return count;
+    }
+
+    int sync() override { return FlushBuffer() ? 0 : -1; }
+
+private:
+    bool FlushBuffer() {
+        size_t size = static_cast<size_t>(pptr() - pbase());
+        if (size > 0 && !m_failed && !m_sink(reinterpret_cast<const uint8_t*>(pbase()), size)) {
+            m_failed = true;
+        }
+        setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+        return !m_failed;
+    }
+
+    RegOutputSink m_sink;
+    std::vector<char> m_buffer;
+    bool m_failed;
+};
+
+// 追加CSV字段，包含逗号、引号或换行时加引号并把引号加倍
+inline void AppendCsvField(const char* text, size_t length, std::string* out) {
+    bool quote = false;
+    for (size_t i = 0; i < length && !quote; i++) {
+        quote = text[i] == ',' || text[i] == '"' || text[i] == '\r' || text[i] == '\n';
+    }
+    if (!quote) {
+        out->append(text, length);
+        return;
+    }
+    out->push_back('"');
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '"') {
+            out->push_back('"');
+        }
+        out->push_back(text[i]);
+    }
+    out->push_back('"');
+}
+
+// 追加标准base64编码（带填充）
+inline void AppendBase64(const uint8_t* data, size_t size, std::string* out) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t base = out->size();
+    out->resize(base + (size + 2) / 3 * 4);
+    char* dst = &(*out)[base];
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        uint32_t bits = (static_cast<uint32_t>(data[i]) << 16) | (static_cast<uint32_t>(data[i + 1]) << 8) | data[i + 2];
+        *dst++ = table[bits >> 18];
+        *dst++ = table[(bits >> 12) & 0x3F];
+        *dst++ = table[(bits >> 6) & 0x3F];
+        *dst++ = table[bits & 0x3F];
+    }
+    if (i < size) {
+        uint32_t bits = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < size) {
+            bits |= static_cast<uint32_t>(data[i + 1]) << 8;
+        }
+        *dst++ = table[bits >> 18];
+        *dst++ = table[(bits >> 12) & 0x3F];
+        *dst++ = i + 1 < size ? table[(bits >> 6) & 0x3F] : '=';
+        *dst++ = '=';
+    }
+}
+
+// 机器可读的查询输出器
+class RegRecordPrinter : public RegTraversalVisitor {
+public:
+    RegRecordPrinter(RegBackend& backend, std::ostream& out, RegQueryFormat format, size_t jobs = 1)
+        : m_backend(backend), m_out(out), m_format(format), m_jobs(jobs), m_keys(0), m_values(0), m_records(0),
+          m_filter(NULL) {}
+
+    void SetLogSink(const RegLogSink& sink) { m_log = sink; }
+
+    // 只输出过滤器选中的键和值（过滤器须在查询期间保持有效）
+    void SetFilter(const RegKeyFilter* filter) { m_filter = filter; }
+
+    // 依次输出各路径下的所有键和值，任一路径无效或无法打开时返回false
+    bool Query(const std::vector<std::string>& paths) {
+        bool success = true;
+        std::vector<std::string> roots;
+        // 记录中的路径使用根键全称
+        for (size_t i = 0; i < paths.size(); i++) {
+            std::string path;
+            if (!NormalizeRegKeyPath(paths[i], &path)) {
+                Log("Error: Invalid registry path format: " + paths[i]);
+                success = false;
+                continue;
+            }
+            while (path.length() > 1 && path[path.length() - 1] == '\\') {
+                path.erase(path.length() - 1);
+            }
+            roots.push_back(path);
+        }
+
+        if (m_format == kRegFormatJson) {
+            m_out << "[";
+        } else if (m_format == kRegFormatCsv) {
+            m_out << "kind,path,name,type,size,encoding,data\r\n";
+        }
+        RegTraversal traversal(m_backend, *this, m_jobs);
+        traversal.SetFilter(m_filter);
+        traversal.Run(roots, [this, &success](const std::string& path, int depth, RegTraversalOutput& output) {
+            // 只经过的中间键没有记录
+            if (output.opened && !output.selected) {
+                return;
+            }
+            if (output.opened) {
+                m_keys++;
+                m_values += output.values;
+                if (m_log) {
+                    m_log("Querying registry path: " + path);
+                }
+            } else {
+                Log("Error: Failed to open registry key: " + path);
+                if (depth == 0) {
+                    success = false;
+                }
+            }
+            // JSON数组中每条记录以",\n"开头，第一条去掉逗号
+            size_t skip = (m_format == kRegFormatJson && m_records == 0 && !output.data.empty()) ? 1 : 0;
+            m_out.write(reinterpret_cast<const char*>(output.data.data()) + skip,
+                        static_cast<std::streamsize>(output.data.size() - skip));
+            m_records += output.values + 1;
+        });
+        if (m_format == kRegFormatJson) {
+            m_out << "\n]\n";
+        }
+        m_out.flush();
+        m_traversalStats = traversal.GetStats();
+        return success;
+    }
+
+    size_t GetKeyCount() const { return m_keys; }
+    size_t GetValueCount() const { return m_values; }
+    const RegTraversalStats& GetTraversalStats() const { return m_traversalStats; }
+
+    bool VisitKey(RegBackend& backend, RegKeyHandle key, const std::string& path, int depth,
+                  RegTraversalContext& context, RegTraversalOutput* out) override {
+        std::string& text = context.text;
+        text.clear();
+        BeginRecord(&text);
+        if (m_format == kRegFormatCsv) {
+            text.append("key,");
+            AppendCsvField(path.data(), path.size(), &text);
+            text.append(",,,,,\r\n");
+        } else {
+            text.append("{\"kind\":\"key\",\"path\":");
+            AppendJsonString(path, &text);
+            text.append(",\"depth\":").append(std::to_string(depth));
+            text.append(",\"subkeys\":").append(std::to_string(context.info.subKeyCount));
+            text.append(",\"values\":").append(std::to_string(context.info.valueCount));
+            EndRecord(&text);
+        }
+
+        for (uint32_t index = 0; ; index++) {
+            long result = backend.EnumValue(key, index, &context.name, &context.type, &context.data);
+            if (result == kRegErrorNoMoreItems) {
+                break;
+            }
+            if (result == kRegSuccess && context.ValueSelected()) {
+                AppendValueRecord(path, context);
+                out->values++;
+            }
+        }
+        out->data.assign(text.begin(), text.end());
+        return true;
+    }
+
+    void VisitError(const std::string& path, int, long result, RegTraversalOutput* out) override {
+        std::string text;
+        BeginRecord(&text);
+        if (m_format == kRegFormatCsv) {
+            text.append("error,");
+            AppendCsvField(path.data(), path.size(), &text);
+            text.append(",,,,,").append(std::to_string(result)).append("\r\n");
+        } else {
+            text.append("{\"kind\":\"error\",\"path\":");
+            AppendJsonString(path, &text);
+            text.append(",\"error\":").append(std::to_string(result));
+            EndRecord(&text);
+        }
+        out->data.assign(text.begin(), text.end());
+    }
+
+private:
+    void BeginRecord(std::string* text) const {
+        if (m_format == kRegFormatJson) {
+            text->append(",\n");
+        }
+    }
+
+    void EndRecord(std::string* text) const {
+        text->append(m_format == kRegFormatNdjson ? "}\n" : "}");
+    }
+
+    // 值数据按类型编码：字符串、数字、字符串数组，其余为base64
+    void AppendValueRecord(const std::string& path, RegTraversalContext& context) const {
+        std::string* text = &context.text;
+        const uint8_t* data = context.data.data();
+        size_t size = context.data.size();
+        uint32_t type = context.type;
+        bool csv = m_format == kRegFormatCsv;
+
+        BeginRecord(text);
+        if (csv) {
+            text->append("value,");
+            AppendCsvField(path.data(), path.size(), text);
+            text->push_back(',');
+            AppendCsvField(context.name.data(), context.name.size(), text);
+            text->append(",").append(GetRegTypeName(type)).append(",").append(std::to_string(size)).append(",");
+        } else {
+            text->append("{\"kind\":\"value\",\"path\":");
+            AppendJsonString(path, text);
+            text->append(",\"name\":");
+            AppendJsonString(context.name, text);
+            text->append(",\"type\":\"").append(GetRegTypeName(type));
+            text->append("\",\"size\":").append(std::to_string(size));
+        }
+
+        std::string& decoded = context.decoded;
+        if ((type == kRegSz || type == kRegExpandSz) && size % 2 == 0) {
+            decoded.clear();
+            AppendRegStringData(data, size, &decoded);
+            if (csv) {
+                text->push_back(',');
+                AppendCsvField(decoded.data(), decoded.size(), text);
+            } else {
+                text->append(",\"data\":");
+                AppendJsonString(decoded, text);
+            }
+        } else if ((type == kRegDword || type == kRegDwordBigEndian) && size == 4) {
+            uint32_t value = type == kRegDword
+                                 ? static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                                       (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24)
+                                 : static_cast<uint32_t>(data[3]) | (static_cast<uint32_t>(data[2]) << 8) |
+                                       (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[0]) << 24);
+            text->append(csv ? "," : ",\"data\":").append(std::to_string(value));
+        } else if (type == kRegQword && size == 8) {
+            uint64_t value = 0;
+            for (int i = 7; i >= 0; i--) {
+                value = (value << 8) | data[i];
+            }
+            text->append(csv ? "," : ",\"data\":").append(std::to_string(value));
+        } else if (type == kRegMultiSz && size % 2 == 0) {
+            AppendMultiString(data, size, &decoded, text);
+        } else {
+            text->append(csv ? "base64," : ",\"encoding\":\"base64\",\"data\":\"");
+            AppendBase64(data, size, text);
+            if (!csv) {
+                text->push_back('"');
+            }
+        }
+
+        if (csv) {
+            text->append("\r\n");
+        } else {
+            EndRecord(text);
+        }
+    }
+
+    // REG_MULTI_SZ：JSON为字符串数组，CSV为以换行分隔的单个字段（到第一个空串为止）
+    void AppendMultiString(const uint8_t* data, size_t size, std::string* decoded, std::string* text) const {
+        bool csv = m_format == kRegFormatCsv;
+        decoded->clear();
+        text->append(csv ? "," : ",\"data\":[");
+        size_t units = size / 2;
+        size_t start = 0;
+        bool first = true;
+        for (size_t i = 0; i <= units; i++) {
+            bool end = (i == units) || (data[i * 2] == 0 && data[i * 2 + 1] == 0);
+            if (!end) {
+                continue;
+            }
+            if (i == start) {
+                break;
+            }
+            if (csv) {
+                if (!first) {
+                    decoded->push_back('\n');
+                }
+                Utf16LeToUtf8(data + start * 2, i - start, decoded);
+            } else {
+                if (!first) {
+                    text->push_back(',');
+                }
+                decoded->clear();
+                Utf16LeToUtf8(data + start * 2, i - start, decoded);
+                AppendJsonString(*decoded, text);
+            }
+            first = false;
+            start = i + 1;
+        }
+        if (csv) {
+            AppendCsvField(decoded->data(), decoded->size(), text);
+        } else {
+            text->push_back(']');
+        }
+    }
+
+    void Log(const std::string& message) {
+        if (m_log) {
+            m_log(message);
+        }
+    }
+
+    RegBackend& m_backend;
+    std::ostream& m_out;
+    RegQueryFormat m_format;
+    size_t m_jobs;
+    size_t m_keys;
+    size_t m_values;
+    size_t m_records;
+    const RegKeyFilter* m_filter;
+    RegTraversalStats m_traversalStats;
+    RegLogSink m_log;
+};
+
+#endif // REG_FORMAT_H
@@ -0,0 +1,109 @@
+/*
+ * 静默注册表导入程序 - 文件系统
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 目录枚举和路径拼接的最小可移植层：Windows使用FindFirstFileA，其他平台使用opendir/readdir，
+ * 通配符展开和目录监视在Linux上也可以运行和测试
+ * - 不进入符号链接或重解析点（目录联接）指向的目录，避免目录环
+ */
+
+#ifndef REG_FS_H
+#define REG_FS_H
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+const char kRegPathSeparator = '\\';
+#else
+const char kRegPathSeparator = '/';
+#endif
+
+// 目录项
+struct RegDirEntry {
+    std::string name;
+    bool directory;     // 可以进入的目录（不含符号链接和重解析点）
+};
+
+inline bool IsRegPathSeparator(char c) {
+    return c == '\\' || c == '/';
+}
+
+// 拼接目录和名称（dir为空表示当前目录）
+inline std::string RegJoinPath(const std::string& dir, const std::string& name) {
+    if (dir.empty()) {
+        return name;
+    }
+    if (IsRegPathSeparator(dir[dir.length() - 1]) || (dir.length() == 2 && dir[1] == ':')) {
+        return dir + name;
+    }
+    return dir + kRegPathSeparator + name;
+}
+
+// 列出目录中的文件和子目录（不含.和..），dir为空表示当前目录；目录无法打开时返回false
+inline bool RegListDirectory(const std::string& dir, std::vector<RegDirEntry>* entries) {
+#ifdef _WIN32
+    WIN32_FIND_DATAA findData;
+    HANDLE find = FindFirstFileA(RegJoinPath(dir, "*").c_str(), &findData);
+    if (find == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    do {
+        const char* name = findData.cFileName;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        RegDirEntry entry;
+        entry.name = name;
+        entry.directory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (entry.directory && (findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) {
+            continue;
+        }
+        entries->push_back(entry);
+    } while (FindNextFileA(find, &findData));
+    FindClose(find);
+#else
+    DIR* handle = ::opendir(dir.empty() ? "." : dir.c_str());
+    if (handle == NULL) {
+        return false;
+    }
+    while (struct dirent* item = ::readdir(handle)) {
+        const char* name = item->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        RegDirEntry entry;
+        entry.name = name;
+        entry.directory = false;
+        unsigned char type = item->d_type;
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            // 文件系统未提供类型或为符号链接：指向文件的链接按文件处理，指向目录的不进入
+            struct stat info;
+            std::string path = RegJoinPath(dir, entry.name);
+            if (type == DT_UNKNOWN && ::lstat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+                entry.directory = true;
+            } else if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+                continue;
+            }
+        } else if (type == DT_DIR) {
+            entry.directory = true;
+        } else if (type != DT_REG) {
+            continue;
+        }
+        entries->push_back(entry);
+    }
+    ::closedir(handle);
+#endif
+    return true;
+}
+
+#endif // REG_FS_H
@@ -0,0 +1,449 @@
+/*
+ * 静默注册表导入程序 - 通配符展开
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 展开命令行中的文件通配符：
+ * - 每一级路径支持*和?，单独一级的**匹配零到多级子目录（如 configs\**\*.reg）
+ * - 通配符之前的固定部分作为起始目录，只遍历可能匹配的目录
+ * - 多线程并行遍历目录：每个目录是一个任务，工作线程把子目录任务压入自己的双端队列，
+ *   空闲线程从其他队列窃取，与注册表子树遍历相同
+ * - 结果按路径排序，与线程数和目录枚举顺序无关
+ * - 排除模式：不含路径分隔符时匹配任意一级的文件或目录名，否则匹配完整路径；
+ *   被排除的目录整体跳过，不再遍历
+ * - 多个模式匹配到的同一文件只保留第一次出现
+ * Windows下匹配不区分大小写，其他平台区分大小写
+ */
+
+#ifndef REG_GLOB_H
+#define REG_GLOB_H
+
+#include "reg_fs.h"
+#include "reg_trace.h"
+#include "reg_types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 是否包含通配符
+inline bool IsRegGlobPattern(const std::string& pattern) {
+    return pattern.find_first_of("*?") != std::string::npos;
+}
+
+inline bool RegGlobCharEquals(char a, char b) {
+#ifdef _WIN32
+    return RegAsciiLower(a) == RegAsciiLower(b);
+#else
+    return a == b;
+#endif
+}
+
+// 单级名称匹配（*匹配任意个字符，?匹配一个字符）
+inline bool RegGlobMatch(const std::string& pattern, const std::string& name) {
+    size_t p = 0;
+    size_t n = 0;
+    size_t starP = std::string::npos;
+    size_t starN = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            starP = p++;
+            starN = n;
+        } else if (p < pattern.size() && (pattern[p] == '?' || RegGlobCharEquals(pattern[p], name[n]))) {
+            p++;
+            n++;
+        } else if (starP != std::string::npos) {
+            // 回溯：上一个*多匹配一个字符
+            p = starP + 1;
+            n = ++starN;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+// 按路径分隔符拆分（忽略空的级）
+inline std::vector<std::string> RegSplitPath(const std::string& path) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (size_t i = 0; i <= path.size(); i++) {
+        if (i == path.size() || IsRegPathSeparator(path[i])) {
+            if (i > start) {
+                parts.push_back(path.substr(start, i - start));
+            }
+            start = i + 1;
+        }
+    }
+    return parts;
+}
+
+// 多级匹配，parts[j..]与patterns[i..]完全匹配时返回true（**匹配零到多级）
+inline bool RegGlobMatchParts(const std::vector<std::string>& patterns, size_t i, const std::vector<std::string>& parts,
+                              size_t j) {
+    while (i < patterns.size()) {
+        if (patterns[i] == "**") {
+            for (size_t k = j; k <= parts.size(); k++) {
+                if (RegGlobMatchParts(patterns, i + 1, parts, k)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (j == parts.size() || !RegGlobMatch(patterns[i], parts[j])) {
+            return false;
+        }
+        i++;
+        j++;
+    }
+    return j == parts.size();
+}
+
+// 路径的比较键：统一分隔符，去掉.级并折叠..级，Windows下转为小写
+inline std::string RegPathKey(const std::string& path) {
+    std::vector<std::string> parts = RegSplitPath(path);
+    std::vector<std::string> kept;
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (parts[i] == ".") {
+            continue;
+        }
+        if (parts[i] == ".." && !kept.empty() && kept.back() != "..") {
+            kept.pop_back();
+            continue;
+        }
+        kept.push_back(parts[i]);
+    }
+    std::string key = (!path.empty() && IsRegPathSeparator(path[0])) ? "/" : "";
+    for (size_t i = 0; i < kept.size(); i++) {
+        key += (i > 0 ? "/" : "") + kept[i];
+    }
+#ifdef _WIN32
+    std::transform(key.begin(), key.end(), key.begin(), RegAsciiLower);
+#endif
+    return key;
+}
+
+// 去除重复的文件（按keyOf的结果比较，默认为RegPathKey），保留第一次出现的位置，返回去除的个数
+inline size_t RegRemoveDuplicatePaths(std::vector<std::string>* files,
+                                      const std::function<std::string(const std::string&)>& keyOf = nullptr) {
+    std::set<std::string> seen;
+    size_t kept = 0;
+    for (size_t i = 0; i < files->size(); i++) {
+        std::string key = keyOf ? keyOf((*files)[i]) : RegPathKey((*files)[i]);
+        if (seen.insert(key).second) {
+            if (kept != i) {
+                (*files)[kept] = std::move((*files)[i]);
+            }
+            kept++;
+        }
+    }
+    size_t removed = files->size() - kept;
+    files->resize(kept);
+    return removed;
+}
+
+// 展开统计
+struct RegGlobStats {
+    size_t directories;     // 列出的目录
+    size_t entries;         // 检查的目录项
+    size_t matched;
+    size_t excluded;        // 被排除的文件和目录（目录整体跳过）
+    size_t steals;
+
+    RegGlobStats() : directories(0), entries(0), matched(0), excluded(0), steals(0) {}
+};
+
+// 通配符展开器
+class RegGlob {
+public:
+    // jobs <= 1时在调用线程中顺序遍历
+    explicit RegGlob(size_t jobs) : m_jobs(jobs), m_pending(0), m_steals(0) {}
+
+    // 禁止拷贝
+    RegGlob(const RegGlob&) = delete;
+    RegGlob& operator=(const RegGlob&) = delete;
+
+    // 添加排除模式
+    void AddExclude(const std::string& pattern) {
+        std::vector<std::string> parts = RegSplitPath(pattern);
+        if (parts.size() == 1) {
+            m_nameExcludes.push_back(parts[0]);
+        } else if (!parts.empty()) {
+            m_pathExcludes.push_back(parts);
+        }
+    }
+
+    // 路径（或其最后一级名称）是否被排除
+    bool IsExcluded(const std::string& path) const {
+        std::vector<std::string> parts = RegSplitPath(path);
+        return !parts.empty() && IsExcluded(parts.back(), parts);
+    }
+
+    // 展开一个模式，匹配的文件按路径排序后追加到files；不含通配符时原样追加（未排除时）
+    void Expand(const std::string& pattern, std::vector<std::string>* files) {
+        if (!IsRegGlobPattern(pattern)) {
+            if (!IsExcluded(pattern)) {
+                files->push_back(pattern);
+            }
+            return;
+        }
+
+        // 第一个含通配符的级之前是固定的起始目录（保留原写法，如 C:\ 或 \\server\share\）
+        size_t componentStart = 0;
+        for (size_t i = 0; i < pattern.size(); i++) {
+            if (IsRegPathSeparator(pattern[i])) {
+                componentStart = i + 1;
+            } else if (pattern[i] == '*' || pattern[i] == '?') {
+                break;
+            }
+        }
+        m_base = pattern.substr(0, componentStart);
+        m_patterns = RegSplitPath(pattern.substr(componentStart));
+        m_baseParts = RegSplitPath(m_base);
+
+        std::unique_ptr<Task> root(new Task());
+        root->path = m_base;
+        root->parts = m_baseParts;
+        root->states = Closure(std::vector<size_t>(1, 0));
+
+        std::vector<std::string> matched;
+        if (m_jobs <= 1) {
+            Worker worker;
+            std::vector<std::unique_ptr<Task>> stack;
+            stack.push_back(std::move(root));
+            while (!stack.empty()) {
+                std::unique_ptr<Task> task = std::move(stack.back());
+                stack.pop_back();
+                Process(*task, worker, [&stack](Task* child) { stack.push_back(std::unique_ptr<Task>(child)); });
+            }
+            Collect(worker, &matched);
+        } else {
+            m_queues.clear();
+            std::vector<std::unique_ptr<Worker>> workers;
+            for (size_t w = 0; w < m_jobs; w++) {
+                m_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+                workers.push_back(std::unique_ptr<Worker>(new Worker()));
+            }
+            m_pending = 1;
+            m_steals = 0;
+            m_queues[0]->items.push_back(root.release());
+            std::vector<std::thread> threads;
+            for (size_t w = 0; w < m_jobs; w++) {
+                threads.push_back(std::thread([this, w, &workers]() { WorkerLoop(w, *workers[w]); }));
+            }
+            for (size_t w = 0; w < threads.size(); w++) {
+                threads[w].join();
+                Collect(*workers[w], &matched);
+            }
+            m_stats.steals += m_steals;
+        }
+
+        std::sort(matched.begin(), matched.end(), LessPath);
+        m_stats.matched += matched.size();
+        files->insert(files->end(), matched.begin(), matched.end());
+    }
+
+    const RegGlobStats& GetStats() const { return m_stats; }
+
+private:
+    // 一个待列出的目录
+    struct Task {
+        std::string path;                   // 列出用的目录路径（起始目录原写法 + 各级名称）
+        std::vector<std::string> parts;     // 各级名称（用于排除模式匹配）
+        std::vector<size_t> states;         // 本目录中的项可以匹配的模式级
+    };
+
+    // 工作线程的结果和统计
+    struct Worker {
+        std::vector<std::string> matched;
+        std::vector<RegDirEntry> entries;
+        RegGlobStats stats;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task*> items;
+    };
+
+    static bool LessPath(const std::string& a, const std::string& b) {
+#ifdef _WIN32
+        int result = RegCompareIgnoreCase(a.data(), a.size(), b.data(), b.size());
+        return result != 0 ? result < 0 : a < b;
+#else
+        return a < b;
+#endif
+    }
+
+    // 加入**可以匹配零级时的后继状态
+    std::vector<size_t> Closure(std::vector<size_t> states) const {
+        for (size_t i = 0; i < states.size(); i++) {
+            size_t state = states[i];
+            if (state < m_patterns.size() && m_patterns[state] == "**" &&
+                std::find(states.begin(), states.end(), state + 1) == states.end()) {
+                states.push_back(state + 1);
+            }
+        }
+        std::sort(states.begin(), states.end());
+        return states;
+    }
+
+    bool IsExcluded(const std::string& name, const std::vector<std::string>& parts) const {
+        for (size_t i = 0; i < m_nameExcludes.size(); i++) {
+            if (RegGlobMatch(m_nameExcludes[i], name)) {
+                return true;
+            }
+        }
+        for (size_t i = 0; i < m_pathExcludes.size(); i++) {
+            if (RegGlobMatchParts(m_pathExcludes[i], 0, parts, 0)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 列出一个目录，匹配的文件记入worker，需要继续遍历的子目录交给push
+    template <typename Push>
+    void Process(const Task& task, Worker& worker, Push push) const {
+        RegTraceSpan span("glob", "Directory", task.path, true);
+        worker.entries.clear();
+        if (!RegListDirectory(task.path, &worker.entries)) {
+            return;
+        }
+        worker.stats.directories++;
+        worker.stats.entries += worker.entries.size();
+        size_t last = m_patterns.size() - 1;
+        bool excludes = !m_nameExcludes.empty() || !m_pathExcludes.empty();
+        std::vector<std::string> parts;
+        for (size_t e = 0; e < worker.entries.size(); e++) {
+            const RegDirEntry& entry = worker.entries[e];
+            if (entry.directory) {
+                std::vector<size_t> next;
+                for (size_t s = 0; s < task.states.size(); s++) {
+                    size_t state = task.states[s];
+                    if (state < m_patterns.size() && m_patterns[state] == "**") {
+                        next.push_back(state);
+                    } else if (state < last && RegGlobMatch(m_patterns[state], entry.name)) {
+                        next.push_back(state + 1);
+                    }
+                }
+                if (next.empty()) {
+                    continue;
+                }
+                parts = task.parts;
+                parts.push_back(entry.name);
+                if (excludes && IsExcluded(entry.name, parts)) {
+                    worker.stats.excluded++;
+                    continue;
+                }
+                Task* child = new Task();
+                child->path = RegJoinPath(task.path, entry.name);
+                child->parts.swap(parts);
+                child->states = Closure(next);
+                push(child);
+                continue;
+            }
+            bool match = false;
+            for (size_t s = 0; s < task.states.size() && !match; s++) {
+                size_t state = task.states[s];
+                match = (state == last && (m_patterns[state] == "**" || RegGlobMatch(m_patterns[state], entry.name)));
+            }
+            if (!match) {
+                continue;
+            }
+            if (excludes) {
+                parts = task.parts;
+                parts.push_back(entry.name);
+                if (IsExcluded(entry.name, parts)) {
+                    worker.stats.excluded++;
+                    continue;
+                }
+            }
+            worker.matched.push_back(RegJoinPath(task.path, entry.name));
+        }
+    }
+
+    void Collect(Worker& worker, std::vector<std::string>* matched) {
+        matched->insert(matched->end(), worker.matched.begin(), worker.matched.end());
+        m_stats.directories += worker.stats.directories;
+        m_stats.entries += worker.stats.entries;
+        m_stats.excluded += worker.stats.excluded;
+    }
+
+    bool PopLocal(size_t worker, Task** task) {
+        WorkQueue& queue = *m_queues[worker];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.items.empty()) {
+            return false;
+        }
+        *task = queue.items.back();
+        queue.items.pop_back();
+        return true;
+    }
+
+    bool Steal(size_t worker, Task** task) {
+        for (size_t i = 1; i < m_queues.size(); i++) {
+            WorkQueue& queue = *m_queues[(worker + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.items.empty()) {
+                *task = queue.items.front();
+                queue.items.pop_front();
+                m_steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(size_t index, Worker& worker) {
+        SetRegTraceThreadName("glob worker", static_cast<int>(index));
+        WorkQueue& own = *m_queues[index];
+        int idle = 0;
+        while (true) {
+            Task* task = NULL;
+            if (PopLocal(index, &task) || Steal(index, &task)) {
+                idle = 0;
+                std::unique_ptr<Task> owned(task);
+                Process(*owned, worker, [this, &own](Task* child) {
+                    m_pending++;
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    own.items.push_back(child);
+                });
+                m_pending--;
+                continue;
+            }
+            if (m_pending.load() == 0) {
+                return;
+            }
+            if (++idle < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+
+    size_t m_jobs;
+    std::string m_base;
+    std::vector<std::string> m_baseParts;
+    std::vector<std::string> m_patterns;
+    std::vector<std::string> m_nameExcludes;
+    std::vector<std::vector<std::string>> m_pathExcludes;
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::atomic<size_t> m_pending;      // 已创建但尚未处理完的目录任务数
+    std::atomic<size_t> m_steals;
+    RegGlobStats m_stats;
+};
+
+#endif // REG_GLOB_H
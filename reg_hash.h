@@ -0,0 +1,180 @@
+/*
+ * 静默注册表导入程序 - 内容哈希
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 64位非加密内容哈希（xxHash64算法，结果与XXH64一致）：
+ * - 每次处理32字节，四路独立累加，单核可达数GB/s，适合判断文件内容是否变化
+ * - 支持分块增量计算，大文件按固定大小的缓冲区流式读取，内存占用与文件大小无关
+ * 仅用于检测变化，不能抵御有意构造的碰撞
+ * 平台无关：按小端序读取
+ */
+
+#ifndef REG_HASH_H
+#define REG_HASH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// 增量计算的64位内容哈希
+class RegHash64 {
+public:
+    explicit RegHash64(uint64_t seed = 0)
+        : m_seed(seed), m_total(0), m_buffered(0) {
+        m_acc[0] = seed + kPrime1 + kPrime2;
+        m_acc[1] = seed + kPrime2;
+        m_acc[2] = seed;
+        m_acc[3] = seed - kPrime1;
+    }
+
+    void Update(const void* data, size_t size) {
+        if (size == 0) {
+            return;
+        }
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        m_total += size;
+        // 先补满上次剩余的不足32字节
+        if (m_buffered > 0) {
+            size_t take = std::min(size, sizeof(m_buffer) - m_buffered);
+            std::memcpy(m_buffer + m_buffered, p, take);
+            m_buffered += take;
+            p += take;
+            size -= take;
+            if (m_buffered < sizeof(m_buffer)) {
+                return;
+            }
+            Stripe(m_buffer);
+            m_buffered = 0;
+        }
+        while (size >= 32) {
+            Stripe(p);
+            p += 32;
+            size -= 32;
+        }
+        if (size > 0) {
+            std::memcpy(m_buffer, p, size);
+            m_buffered = size;
+        }
+    }
+
+    uint64_t Digest() const {
+        uint64_t hash;
+        if (m_total >= 32) {
+            hash = Rotl(m_acc[0], 1) + Rotl(m_acc[1], 7) + Rotl(m_acc[2], 12) + Rotl(m_acc[3], 18);
+            for (int i = 0; i < 4; i++) {
+                hash = (hash ^ Round(0, m_acc[i])) * kPrime1 + kPrime4;
+            }
+        } else {
+            hash = m_seed + kPrime5;
+        }
+        hash += m_total;
+
+        const uint8_t* p = m_buffer;
+        size_t left = m_buffered;
+        while (left >= 8) {
+            hash ^= Round(0, Read64(p));
+            hash = Rotl(hash, 27) * kPrime1 + kPrime4;
+            p += 8;
+            left -= 8;
+        }
+        if (left >= 4) {
+            hash ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+            hash = Rotl(hash, 23) * kPrime2 + kPrime3;
+            p += 4;
+            left -= 4;
+        }
+        while (left > 0) {
+            hash ^= *p * kPrime5;
+            hash = Rotl(hash, 11) * kPrime1;
+            p++;
+            left--;
+        }
+
+        hash ^= hash >> 33;
+        hash *= kPrime2;
+        hash ^= hash >> 29;
+        hash *= kPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    // 一次性计算整块数据的哈希
+    static uint64_t Hash(const void* data, size_t size, uint64_t seed = 0) {
+        RegHash64 hasher(seed);
+        hasher.Update(data, size);
+        return hasher.Digest();
+    }
+
+private:
+    static const uint64_t kPrime1 = 11400714785074694791ULL;
+    static const uint64_t kPrime2 = 14029467366897019727ULL;
+    static const uint64_t kPrime3 = 1609587929392839161ULL;
+    static const uint64_t kPrime4 = 9650029242287828579ULL;
+    static const uint64_t kPrime5 = 2870177450012600261ULL;
+
+    static uint64_t Rotl(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    static uint64_t Round(uint64_t acc, uint64_t input) {
+        acc += input * kPrime2;
+        return Rotl(acc, 31) * kPrime1;
+    }
+
+    static uint64_t Read64(const uint8_t* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    static uint32_t Read32(const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    void Stripe(const uint8_t* p) {
+        m_acc[0] = Round(m_acc[0], Read64(p));
+        m_acc[1] = Round(m_acc[1], Read64(p + 8));
+        m_acc[2] = Round(m_acc[2], Read64(p + 16));
+        m_acc[3] = Round(m_acc[3], Read64(p + 24));
+    }
+
+    uint64_t m_seed;
+    uint64_t m_acc[4];
+    uint64_t m_total;
+    uint8_t m_buffer[32];
+    size_t m_buffered;
+};
+
+// 按块流式计算文件内容的哈希，失败时返回false并设置error
+inline bool RegHashFile(const std::string& path, uint64_t* hash, std::string* error,
+                        size_t bufferSize = 256 * 1024) {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        *error = "Cannot open file: " + path;
+        return false;
+    }
+    RegHash64 hasher;
+    std::vector<char> buffer(bufferSize);
+    while (file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        std::streamsize got = file.gcount();
+        if (got <= 0) {
+            break;
+        }
+        hasher.Update(buffer.data(), static_cast<size_t>(got));
+    }
+    if (file.bad()) {
+        *error = "Cannot read file: " + path;
+        return false;
+    }
+    *hash = hasher.Digest();
+    return true;
+}
+
+#endif // REG_HASH_H
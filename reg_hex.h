@@ -0,0 +1,327 @@
+/*
+ * 静默注册表导入程序 - 十六进制编解码
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * REG_BINARY和hex(N)数据与"xx,xx,..."文本之间的转换，供查询输出、导出和解析共用：
+ * - 编码按字节查两位数字表，解码按字符查半字节表，不调用snprintf/strtoul
+ * - AVX2级别（含SSSE3的pshufb）每次处理16个字节/48个字符，其余级别使用查表实现
+ * - regedit布局编码器按行宽插入",\"续行，列位置保存在对象中，可分段编码任意长度的数据
+ * - 解码与原解析规则一致：逗号分隔，允许空白和1位数字，';'之后为注释，末尾可有逗号
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_HEX_H
+#define REG_HEX_H
+
+#include "reg_simd.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// 每个字节对应的两位十六进制数字（小写在前256项，大写在后256项）
+inline const char* RegHexDigitPairs(bool upper) {
+    static const std::vector<char> table = []() {
+        static const char lower[] = "0123456789abcdef";
+        static const char capital[] = "0123456789ABCDEF";
+        std::vector<char> pairs(256 * 2 * 2);
+        for (int i = 0; i < 256; i++) {
+            pairs[i * 2] = lower[i >> 4];
+            pairs[i * 2 + 1] = lower[i & 0x0F];
+            pairs[512 + i * 2] = capital[i >> 4];
+            pairs[512 + i * 2 + 1] = capital[i & 0x0F];
+        }
+        return pairs;
+    }();
+    return table.data() + (upper ? 512 : 0);
+}
+
+// 每个字符对应的半字节值，非十六进制数字为-1
+inline const int8_t* RegHexNibbleTable() {
+    static const std::vector<int8_t> table = []() {
+        std::vector<int8_t> nibbles(256, -1);
+        for (int i = 0; i < 10; i++) {
+            nibbles['0' + i] = static_cast<int8_t>(i);
+        }
+        for (int i = 0; i < 6; i++) {
+            nibbles['a' + i] = static_cast<int8_t>(10 + i);
+            nibbles['A' + i] = static_cast<int8_t>(10 + i);
+        }
+        return nibbles;
+    }();
+    return table.data();
+}
+
+inline int RegHexNibble(char c) {
+    return RegHexNibbleTable()[static_cast<unsigned char>(c)];
+}
+
+// ---------------------------------------------------------------------------
+// 查表实现
+// ---------------------------------------------------------------------------
+
+// 编码size个字节，字节之间插入separator，写入3*size-1个字符（size为0时不写入）
+inline size_t RegHexEncodeListScalar(const uint8_t* src, size_t size, char separator, bool upper, char* dst) {
+    if (size == 0) {
+        return 0;
+    }
+    const char* pairs = RegHexDigitPairs(upper);
+    char* p = dst;
+    for (size_t i = 0; i + 1 < size; i++) {
+        std::memcpy(p, pairs + src[i] * 2, 2);
+        p[2] = separator;
+        p += 3;
+    }
+    std::memcpy(p, pairs + src[size - 1] * 2, 2);
+    return static_cast<size_t>(p + 2 - dst);
+}
+
+// 解码开头连续的"hh,"（两位数字加逗号），最多count组，返回解码的组数
+inline size_t RegHexDecodeTriplesScalar(const char* text, size_t count, uint8_t* dst) {
+    const int8_t* nibbles = RegHexNibbleTable();
+    size_t i = 0;
+    for (; i < count; i++) {
+        const char* p = text + i * 3;
+        int high = nibbles[static_cast<unsigned char>(p[0])];
+        int low = nibbles[static_cast<unsigned char>(p[1])];
+        if ((high | low) < 0 || p[2] != ',') {
+            break;
+        }
+        dst[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return i;
+}
+
+#if REG_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// AVX2级别实现（使用128位的SSSE3指令）
+// ---------------------------------------------------------------------------
+
+// 16个字节与48个字符（3个向量）之间搬移半字节的pshufb索引，0x80表示置0
+struct RegHexShuffleTables {
+    uint8_t encodeHigh[3][16];      // 输出字符取自高半字节数字的第几个字节
+    uint8_t encodeLow[3][16];
+    uint8_t separator[3][16];       // 分隔符位置为0xFF
+    uint8_t decodeHigh[3][16];      // 输出字节的高半字节取自输入向量的第几个字符
+    uint8_t decodeLow[3][16];
+    uint32_t commaMask[3];          // 每个输入向量中逗号位置的位掩码
+
+    RegHexShuffleTables() {
+        for (int v = 0; v < 3; v++) {
+            commaMask[v] = 0;
+            for (int k = 0; k < 16; k++) {
+                int pos = v * 16 + k;
+                encodeHigh[v][k] = static_cast<uint8_t>(pos % 3 == 0 ? pos / 3 : 0x80);
+                encodeLow[v][k] = static_cast<uint8_t>(pos % 3 == 1 ? pos / 3 : 0x80);
+                separator[v][k] = static_cast<uint8_t>(pos % 3 == 2 ? 0xFF : 0);
+                if (pos % 3 == 2) {
+                    commaMask[v] |= 1u << k;
+                }
+                int high = k * 3 - v * 16;
+                int low = high + 1;
+                decodeHigh[v][k] = static_cast<uint8_t>(high >= 0 && high < 16 ? high : 0x80);
+                decodeLow[v][k] = static_cast<uint8_t>(low >= 0 && low < 16 ? low : 0x80);
+            }
+        }
+    }
+};
+
+inline const RegHexShuffleTables& RegHexShuffles() {
+    static const RegHexShuffleTables tables;
+    return tables;
+}
+
+REG_TARGET_AVX2 inline __m128i RegHexLoadIndex(const uint8_t* index) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(index));
+}
+
+REG_TARGET_AVX2 inline size_t RegHexEncodeListAvx2(const uint8_t* src, size_t size, char separator, bool upper,
+                                                   char* dst) {
+    const RegHexShuffleTables& tables = RegHexShuffles();
+    const __m128i digits = upper ? _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C',
+                                                 'D', 'E', 'F')
+                                 : _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c',
+                                                 'd', 'e', 'f');
+    const __m128i lowMask = _mm_set1_epi8(0x0F);
+    const __m128i separators = _mm_set1_epi8(separator);
+    size_t i = 0;
+    char* p = dst;
+    // 每块16个字节输出48个字符（含第16个字节之后的分隔符），最后一个字节留给查表实现
+    for (; i + 16 < size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(block, 4), lowMask));
+        __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(block, lowMask));
+        for (int v = 0; v < 3; v++) {
+            __m128i chars = _mm_or_si128(_mm_shuffle_epi8(high, RegHexLoadIndex(tables.encodeHigh[v])),
+                                         _mm_shuffle_epi8(low, RegHexLoadIndex(tables.encodeLow[v])));
+            chars = _mm_or_si128(chars, _mm_and_si128(separators, RegHexLoadIndex(tables.separator[v])));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + v * 16), chars);
+        }
+        p += 48;
+    }
+    return static_cast<size_t>(p - dst) + RegHexEncodeListScalar(src + i, size - i, separator, upper, p);
+}
+
+// 16个字符的半字节值，valid返回有效数字位置的位掩码
+REG_TARGET_AVX2 inline __m128i RegHexNibblesAvx2(__m128i chars, uint32_t* valid) {
+    const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    const __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+    *valid = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)));
+    return _mm_or_si128(_mm_and_si128(isDigit, digit),
+                        _mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+REG_TARGET_AVX2 inline size_t RegHexDecodeTriplesAvx2(const char* text, size_t count, uint8_t* dst) {
+    const RegHexShuffleTables& tables = RegHexShuffles();
+    const __m128i commas = _mm_set1_epi8(',');
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i high = _mm_setzero_si128();
+        __m128i low = _mm_setzero_si128();
+        bool ok = true;
+        for (int v = 0; v < 3; v++) {
+            __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i * 3 + v * 16));
+            uint32_t valid = 0;
+            __m128i nibbles = RegHexNibblesAvx2(chars, &valid);
+            uint32_t comma = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, commas)));
+            ok = ok && comma == tables.commaMask[v] && (valid | comma) == 0xFFFF;
+            high = _mm_or_si128(high, _mm_shuffle_epi8(nibbles, RegHexLoadIndex(tables.decodeHigh[v])));
+            low = _mm_or_si128(low, _mm_shuffle_epi8(nibbles, RegHexLoadIndex(tables.decodeLow[v])));
+        }
+        if (!ok) {
+            break;
+        }
+        // 高半字节不超过0x0F，16位移位不会进入相邻字节
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(_mm_slli_epi16(high, 4), low));
+    }
+    return i + RegHexDecodeTriplesScalar(text + i * 3, count - i, dst + i);
+}
+
+#endif // REG_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// 分派入口
+// ---------------------------------------------------------------------------
+
+// 编码size个字节，字节之间插入separator，返回写入的字符数（3*size-1，size为0时为0）
+inline size_t RegHexEncodeList(const uint8_t* src, size_t size, char separator, bool upper, char* dst) {
+#if REG_SIMD_X86
+    if (RegGetSimdLevel() == RegSimdAvx2) {
+        return RegHexEncodeListAvx2(src, size, separator, upper, dst);
+    }
+#endif
+    return RegHexEncodeListScalar(src, size, separator, upper, dst);
+}
+
+inline size_t RegHexDecodeTriples(const char* text, size_t count, uint8_t* dst) {
+#if REG_SIMD_X86
+    if (RegGetSimdLevel() == RegSimdAvx2) {
+        return RegHexDecodeTriplesAvx2(text, count, dst);
+    }
+#endif
+    return RegHexDecodeTriplesScalar(text, count, dst);
+}
+
+// 解码逗号分隔的十六进制字节并追加到out（续行须已合并）；格式错误返回false，out中可能已追加部分字节
+inline bool RegHexDecodeList(const char* text, size_t size, std::vector<uint8_t>* out) {
+    const int8_t* nibbles = RegHexNibbleTable();
+    int current = -1;
+    size_t i = 0;
+    while (i < size) {
+        // 字节边界上先整组解码规范的"hh,"
+        if (current < 0 && size - i >= 3) {
+            size_t base = out->size();
+            size_t count = (size - i) / 3;
+            out->resize(base + count);
+            size_t decoded = RegHexDecodeTriples(text + i, count, out->data() + base);
+            out->resize(base + decoded);
+            i += decoded * 3;
+            if (i >= size) {
+                break;
+            }
+        }
+        char c = text[i++];
+        if (c == ',') {
+            if (current < 0) {
+                return false;
+            }
+            out->push_back(static_cast<uint8_t>(current));
+            current = -1;
+            continue;
+        }
+        if (c == ' ' || c == '\t') {
+            continue;
+        }
+        if (c == ';') {
+            break;
+        }
+        int nibble = nibbles[static_cast<unsigned char>(c)];
+        if (nibble < 0 || current > 0xF) {
+            return false;
+        }
+        current = (current < 0) ? nibble : ((current << 4) | nibble);
+    }
+    if (current >= 0) {
+        out->push_back(static_cast<uint8_t>(current));
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// regedit布局
+// ---------------------------------------------------------------------------
+
+// regedit的hex布局：小写数字，字节之间为逗号，逗号之后行长达到行宽时以"\"+CRLF+两个空格续行
+// 同一个值的数据可分多段依次传给Encode，输出与一次编码完全相同
+class RegHexLayoutEncoder {
+public:
+    // column：首个字节之前的行长（值名和hex:前缀）；lineLimit：行宽（regedit为77）
+    RegHexLayoutEncoder(size_t column, size_t lineLimit)
+        : m_column(column), m_lineLimit(lineLimit < 5 ? 5 : lineLimit), m_started(false) {}
+
+    // 编码size个字节最多写入的字符数
+    size_t MaxEncodedSize(size_t size) const {
+        return size * 3 + (size / (m_lineLimit / 3) + 2) * kContinuationSize;
+    }
+
+    // 编码一段数据，返回写入dst的字符数（dst至少MaxEncodedSize(size)个字符）
+    size_t Encode(const uint8_t* data, size_t size, char* dst) {
+        char* p = dst;
+        size_t i = 0;
+        while (i < size) {
+            // 上一个字节之后的逗号及续行
+            if (m_started) {
+                *p++ = ',';
+                m_column += 3;
+                if (m_column >= m_lineLimit) {
+                    std::memcpy(p, "\\\r\n  ", kContinuationSize);
+                    p += kContinuationSize;
+                    m_column = 2;
+                }
+            }
+            // 本行剩余的字节数：之后的逗号使行长达到行宽为止
+            size_t room = m_column >= m_lineLimit ? 1 : (m_lineLimit - m_column + 2) / 3;
+            size_t run = size - i < room ? size - i : room;
+            p += RegHexEncodeList(data + i, run, ',', false, p);
+            m_column += (run - 1) * 3;
+            m_started = true;
+            i += run;
+        }
+        return static_cast<size_t>(p - dst);
+    }
+
+private:
+    static const size_t kContinuationSize = 5;
+
+    size_t m_column;        // 最后写入的字节（尚未写入时为首个字节）开始处的行长
+    size_t m_lineLimit;
+    bool m_started;
+};
+
+#endif // REG_HEX_H
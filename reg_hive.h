@@ -0,0 +1,397 @@
+/*
+ * 静默注册表导入程序 - 内存注册表配置单元
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * RegBackend的内存实现，用于在Linux上按生产规模测试和分析查询、导入、导出：
+ * - 键名、值名和值数据分配在按块增长的内存池中，不逐个调用new
+ * - 子键保存在按大写折叠排序的数组中，元素内联名称指针和长度，
+ *   二分查找时不必访问子节点本身；按顺序加载的导出文件走追加快速路径
+ * - 值按写入顺序保存（与Win32枚举顺序一致）
+ * - 删除的键和被覆盖的值数据不回收，内存在配置单元析构时统一释放
+ * - 每个键记录最后写入时间：与Win32一致，只在键自身的值或直接子键变化时更新，
+ *   时间取自合成时钟（每次修改前进1个刻度，可用SetClock设定），用于测试增量查询
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_HIVE_H
+#define REG_HIVE_H
+
+#include "reg_apply.h"
+#include "reg_backend.h"
+#include "reg_parser.h"
+#include "reg_types.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 按块分配的内存池（只分配不单独释放）
+class RegArena {
+public:
+    explicit RegArena(size_t blockSize = 1024 * 1024)
+        : m_blockSize(blockSize), m_current(NULL), m_left(0), m_used(0), m_reserved(0) {}
+
+    // 禁止拷贝
+    RegArena(const RegArena&) = delete;
+    RegArena& operator=(const RegArena&) = delete;
+
+    char* Allocate(size_t size) {
+        if (size > m_left) {
+            // 大块单独分配，避免浪费当前块的剩余空间
+            if (size > m_blockSize / 4) {
+                return NewBlock(size);
+            }
+            m_current = NewBlock(m_blockSize);
+            m_left = m_blockSize;
+        }
+        char* result = m_current;
+        m_current += size;
+        m_left -= size;
+        m_used += size;
+        return result;
+    }
+
+    char* Copy(const void* data, size_t size) {
+        if (size == 0) {
+            return NULL;
+        }
+        char* result = Allocate(size);
+        std::memcpy(result, data, size);
+        return result;
+    }
+
+    size_t BytesUsed() const { return m_used; }
+    size_t BytesReserved() const { return m_reserved; }
+
+private:
+    char* NewBlock(size_t size) {
+        m_blocks.push_back(std::unique_ptr<char[]>(new char[size]));
+        m_reserved += size;
+        if (size != m_blockSize) {
+            m_used += size;
+        }
+        return m_blocks.back().get();
+    }
+
+    size_t m_blockSize;
+    char* m_current;
+    size_t m_left;
+    size_t m_used;
+    size_t m_reserved;
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+};
+
+// 内存注册表配置单元
+class RegHive : public RegBackend {
+public:
+    RegHive() : m_keyCount(0), m_valueCount(0), m_clock(0) {
+        const size_t rootCount = sizeof(kRegRootKeys) / sizeof(kRegRootKeys[0]);
+        for (size_t i = 0; i < rootCount; i++) {
+            m_nodes.push_back(Node());
+            Node& root = m_nodes.back();
+            root.name = kRegRootKeys[i].fullName;
+            root.nameLength = static_cast<uint32_t>(std::strlen(kRegRootKeys[i].fullName));
+            m_roots[i] = &root;
+        }
+    }
+
+    // 禁止拷贝
+    RegHive(const RegHive&) = delete;
+    RegHive& operator=(const RegHive&) = delete;
+
+    // 加载.reg文件（与导入相同的解析器和应用逻辑），失败时返回false并设置error
+    bool LoadRegFile(const std::string& path, std::string* error) {
+        RegApplier applier(*this, false);
+        RegFileParser parser([&applier](const RegOp& op) { applier.Apply(op); });
+        bool parsed = ParseRegFile(path, parser, error);
+        applier.CloseCurrentKey();
+        if (parsed && applier.GetStats().failures > 0) {
+            *error = std::to_string(applier.GetStats().failures) + " operations failed";
+            return false;
+        }
+        return parsed;
+    }
+
+    size_t GetKeyCount() const { return m_keyCount; }
+    size_t GetValueCount() const { return m_valueCount; }
+    size_t GetArenaBytes() const { return m_arena.BytesReserved(); }
+
+    // 设定合成时钟（之后的修改从time+1开始计时）
+    void SetClock(uint64_t time) { m_clock = time; }
+    uint64_t GetClock() const { return m_clock; }
+
+    long OpenKey(const std::string& keyPath, RegKeyHandle* key) override {
+        Node* node = Walk(keyPath, false);
+        if (node == NULL) {
+            return kRegErrorNotFound;
+        }
+        *key = node;
+        return kRegSuccess;
+    }
+
+    long CreateKey(const std::string& keyPath, RegKeyHandle* key) override {
+        Node* node = Walk(keyPath, true);
+        if (node == NULL) {
+            return kRegErrorInvalidParameter;
+        }
+        *key = node;
+        return kRegSuccess;
+    }
+
+    void CloseKey(RegKeyHandle) override {}
+
+    long DeleteKeyTree(const std::string& keyPath) override {
+        Node* node = Walk(keyPath, false);
+        if (node == NULL) {
+            return kRegErrorNotFound;
+        }
+        if (node->parent == NULL) {
+            return kRegErrorAccessDenied;
+        }
+        std::vector<Child>& siblings = node->parent->children;
+        std::vector<Child>::iterator it = LowerBound(node->parent, node->name, node->nameLength);
+        siblings.erase(it);
+        node->parent->lastWriteTime = ++m_clock;
+        Detach(node);
+        return kRegSuccess;
+    }
+
+    // 名称长度按UTF-8字节数返回（不小于UTF-16单元数，作为预留上限足够）
+    long QueryKeyInfo(RegKeyHandle key, RegKeyInfo* info) override {
+        const Node* node = static_cast<const Node*>(key);
+        *info = RegKeyInfo();
+        info->subKeyCount = static_cast<uint32_t>(node->children.size());
+        for (size_t i = 0; i < node->children.size(); i++) {
+            info->maxSubKeyLength = std::max(info->maxSubKeyLength, node->children[i].nameLength);
+        }
+        info->valueCount = static_cast<uint32_t>(node->values.size());
+        for (size_t i = 0; i < node->values.size(); i++) {
+            info->maxValueNameLength = std::max(info->maxValueNameLength, node->values[i].nameLength);
+            info->maxValueDataSize = std::max(info->maxValueDataSize, node->values[i].size);
+        }
+        info->lastWriteTime = node->lastWriteTime;
+        return kRegSuccess;
+    }
+
+    long EnumSubKey(RegKeyHandle key, uint32_t index, std::string* name) override {
+        const Node* node = static_cast<const Node*>(key);
+        if (index >= node->children.size()) {
+            return kRegErrorNoMoreItems;
+        }
+        const Child& child = node->children[index];
+        name->assign(child.name, child.nameLength);
+        return kRegSuccess;
+    }
+
+    long EnumValue(RegKeyHandle key, uint32_t index, std::string* name, uint32_t* type,
+                   std::vector<uint8_t>* data) override {
+        const Node* node = static_cast<const Node*>(key);
+        if (index >= node->values.size()) {
+            return kRegErrorNoMoreItems;
+        }
+        const Value& value = node->values[index];
+        name->assign(value.name, value.nameLength);
+        *type = value.type;
+        data->assign(value.data, value.data + value.size);
+        return kRegSuccess;
+    }
+
+    long QueryValue(RegKeyHandle key, const std::string& name, uint32_t* type, std::vector<uint8_t>* data) override {
+        const Value* value = FindValue(static_cast<Node*>(key), name);
+        if (value == NULL) {
+            return kRegErrorNotFound;
+        }
+        *type = value->type;
+        data->assign(value->data, value->data + value->size);
+        return kRegSuccess;
+    }
+
+    long SetValue(RegKeyHandle key, const std::string& name, uint32_t type, const uint8_t* data, size_t size) override {
+        Node* node = static_cast<Node*>(key);
+        Value* value = FindValue(node, name);
+        if (value == NULL) {
+            node->values.push_back(Value());
+            value = &node->values.back();
+            value->name = m_arena.Copy(name.data(), name.size());
+            value->nameLength = static_cast<uint32_t>(name.size());
+            m_valueCount++;
+        }
+        value->type = type;
+        // 新数据不超过原有空间时原地覆盖
+        if (size > value->capacity) {
+            value->data = reinterpret_cast<uint8_t*>(m_arena.Allocate(size));
+            value->capacity = static_cast<uint32_t>(size);
+        }
+        if (size > 0) {
+            std::memcpy(value->data, data, size);
+        }
+        value->size = static_cast<uint32_t>(size);
+        node->lastWriteTime = ++m_clock;
+        return kRegSuccess;
+    }
+
+    long DeleteValue(RegKeyHandle key, const std::string& name) override {
+        Node* node = static_cast<Node*>(key);
+        Value* value = FindValue(node, name);
+        if (value == NULL) {
+            return kRegErrorNotFound;
+        }
+        node->values.erase(node->values.begin() + (value - node->values.data()));
+        m_valueCount--;
+        node->lastWriteTime = ++m_clock;
+        return kRegSuccess;
+    }
+
+private:
+    struct Value {
+        const char* name;
+        uint32_t nameLength;
+        uint32_t type;
+        uint8_t* data;
+        uint32_t size;
+        uint32_t capacity;
+
+        Value() : name(NULL), nameLength(0), type(kRegNone), data(NULL), size(0), capacity(0) {}
+    };
+
+    struct Node;
+
+    // 子键数组元素：名称与节点内的名称指向同一块内存
+    struct Child {
+        const char* name;
+        uint32_t nameLength;
+        Node* node;
+    };
+
+    struct Node {
+        const char* name;
+        uint32_t nameLength;
+        Node* parent;
+        std::vector<Child> children;    // 按大写折叠排序
+        std::vector<Value> values;      // 按写入顺序
+        uint64_t lastWriteTime;
+
+        Node() : name(NULL), nameLength(0), parent(NULL), lastWriteTime(0) {}
+    };
+
+    static int CompareName(const Child& child, const char* name, size_t length) {
+        return RegCompareIgnoreCase(child.name, child.nameLength, name, length);
+    }
+
+    // 在有序子键数组中查找，返回插入位置
+    static std::vector<Child>::iterator LowerBound(Node* parent, const char* name, size_t length) {
+        std::vector<Child>::iterator first = parent->children.begin();
+        size_t count = parent->children.size();
+        while (count > 0) {
+            size_t step = count / 2;
+            std::vector<Child>::iterator middle = first + static_cast<std::ptrdiff_t>(step);
+            if (CompareName(*middle, name, length) < 0) {
+                first = middle + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    Node* FindOrCreateChild(Node* parent, const char* name, size_t length, bool create) {
+        std::vector<Child>& children = parent->children;
+        std::vector<Child>::iterator it;
+        // 按序加载时新键总是排在最后
+        if (children.empty() || CompareName(children.back(), name, length) < 0) {
+            it = children.end();
+        } else {
+            it = LowerBound(parent, name, length);
+            if (it != children.end() && CompareName(*it, name, length) == 0) {
+                return it->node;
+            }
+        }
+        if (!create) {
+            return NULL;
+        }
+        m_nodes.push_back(Node());
+        Node* child = &m_nodes.back();
+        child->name = m_arena.Copy(name, length);
+        child->nameLength = static_cast<uint32_t>(length);
+        child->parent = parent;
+        child->lastWriteTime = ++m_clock;
+        parent->lastWriteTime = child->lastWriteTime;
+        Child entry = {child->name, child->nameLength, child};
+        children.insert(it, entry);
+        m_keyCount++;
+        return child;
+    }
+
+    // 按路径逐段定位键，不分配临时字符串
+    Node* Walk(const std::string& keyPath, bool create) {
+        size_t slash = keyPath.find('\\');
+        size_t rootLength = (slash == std::string::npos) ? keyPath.length() : slash;
+        Node* node = NULL;
+        const size_t rootCount = sizeof(kRegRootKeys) / sizeof(kRegRootKeys[0]);
+        for (size_t i = 0; i < rootCount; i++) {
+            if (RegEqualsIgnoreCase(keyPath.data(), rootLength, kRegRootKeys[i].fullName,
+                                    std::strlen(kRegRootKeys[i].fullName)) ||
+                RegEqualsIgnoreCase(keyPath.data(), rootLength, kRegRootKeys[i].shortName,
+                                    std::strlen(kRegRootKeys[i].shortName))) {
+                node = m_roots[i];
+                break;
+            }
+        }
+        if (node == NULL || slash == std::string::npos) {
+            return node;
+        }
+        const char* p = keyPath.data() + slash + 1;
+        const char* end = keyPath.data() + keyPath.size();
+        while (p < end) {
+            const char* segmentEnd = static_cast<const char*>(std::memchr(p, '\\', static_cast<size_t>(end - p)));
+            if (segmentEnd == NULL) {
+                segmentEnd = end;
+            }
+            if (segmentEnd > p) {
+                node = FindOrCreateChild(node, p, static_cast<size_t>(segmentEnd - p), create);
+                if (node == NULL) {
+                    return NULL;
+                }
+            }
+            p = segmentEnd + 1;
+        }
+        return node;
+    }
+
+    static Value* FindValue(Node* node, const std::string& name) {
+        for (size_t i = 0; i < node->values.size(); i++) {
+            Value& value = node->values[i];
+            if (RegEqualsIgnoreCase(value.name, value.nameLength, name.data(), name.size())) {
+                return &value;
+            }
+        }
+        return NULL;
+    }
+
+    // 从计数中移除整棵子树并释放其数组（节点本身留在m_nodes中）
+    void Detach(Node* node) {
+        for (size_t i = 0; i < node->children.size(); i++) {
+            Detach(node->children[i].node);
+        }
+        m_keyCount--;
+        m_valueCount -= node->values.size();
+        std::vector<Child>().swap(node->children);
+        std::vector<Value>().swap(node->values);
+        node->parent = NULL;
+    }
+
+    RegArena m_arena;
+    std::deque<Node> m_nodes;       // 节点地址稳定，作为键句柄使用
+    Node* m_roots[sizeof(kRegRootKeys) / sizeof(kRegRootKeys[0])];
+    size_t m_keyCount;
+    size_t m_valueCount;
+    uint64_t m_clock;           // 合成的最后写入时间时钟
+};
+
+#endif // REG_HIVE_H
@@ -12,19 +12,66 @@
  * - 支持调试模式，详细日志记录
  * - 新增：注册表查询功能（--query-registry）
  * - 新增：注册表导出功能（--export-registry）
+ * - 新增：进程内流式解析.reg文件并直接写入注册表（不再调用reg import）
+ * - 新增：多文件并行解析、按命令行顺序提交（--jobs）
+ * - 新增：跨文件写入合并规划（--plan 预览，--coalesce 按计划导入）
+ * - 新增：调试日志由后台线程异步批量写入，支持日志级别（--log-level）
+ * - 新增：查询结果输出为NDJSON/JSON/CSV（--format），可写入文件（--output）
+ * - 新增：二进制快照导出（--snapshot），可直接映射用于查询、导出（--from）和导入
+ * - 新增：导入状态缓存，内容未变且上次导入成功的文件自动跳过（--force 强制导入）
+ * - 新增：预编译导入包（--compile），映射后直接写入，不解析文本
+ * - 新增：常驻监视目录（--watch），新放入或修改的文件去抖后分批导入
+ * - 新增：递归通配符（**）并行展开，排除模式（--exclude），重复文件只导入一次
+ * - 新增：文件清单（@清单、--manifest），边读边导入，支持优先级和目标根键；命令行路径支持双引号
+ * - 新增：运行时间线（--trace），各阶段、每个文件和遍历的键输出为Chrome trace-event JSON
+ * - 新增：查询和导出的键路径/值名过滤（--include-key等），不可能匹配的子树不打开
+ * - 新增：增量查询（--incremental），对照上次查询的索引只输出变化的键和值
+ * - 新增：子树内并行查找（--find），匹配键名、值名和值数据，边遍历边输出
+ * - 新增：结构化差异（--diff），外部排序后归并比较.reg文件和注册表子树，输出最小补丁.reg
  * - 无外部依赖项，单文件运行
  * - 兼容Windows 10/11
  */
 
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0A00
+#endif
 #include <windows.h>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <fstream>
+#include <atomic>
 #include <ctime>
 #include <algorithm>
 #include <memory>
 #include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <unordered_set>
+
+#include "reg_log.h"
+#include "reg_parser.h"
+#include "reg_parallel.h"
+#include "reg_split.h"
+#include "reg_plan.h"
+#include "reg_apply.h"
+#include "reg_backend_win32.h"
+#include "reg_query.h"
+#include "reg_format.h"
+#include "reg_export.h"
+#include "reg_snapshot.h"
+#include "reg_index.h"
+#include "reg_find.h"
+#include "reg_diff.h"
+#include "reg_cache.h"
+#include "reg_pack.h"
+#include "reg_watch.h"
+#include "reg_glob.h"
+#include "reg_manifest.h"
+#include "reg_trace.h"
+#include "reg_keyfilter.h"
 
 // 版本信息
 #define VERSION_MAJOR 1
@@ -36,6 +83,12 @@
 bool g_debugMode = false;
 std::ofstream g_logFile;
 
+// 异步日志器（在g_logFile之后定义，程序退出时先于日志文件析构并写出剩余消息）
+RegAsyncLogger g_logger;
+
+// 日志文件打开且写入线程已启动（工作线程只读此标志，不访问g_logFile；日志文件只由写入线程使用）
+std::atomic<bool> g_logEnabled(false);
+
 // 注册表查询模式标志
 bool g_queryMode = false;
 std::string g_queryPath = "";
@@ -45,6 +98,66 @@ bool g_exportMode = false;
 std::string g_exportPath = "";
 std::string g_exportFile = "";
 
+// 并行导入线程数（0表示使用CPU核心数）
+size_t g_jobs = 0;
+
+// 写入合并规划模式标志（--plan只打印计划，--coalesce按计划导入）
+bool g_planMode = false;
+bool g_coalesceMode = false;
+
+// 差异导入模式标志（类型和数据已一致的值不再写入）
+bool g_skipUnchanged = false;
+
+// 查询输出格式和输出文件（空表示标准输出）
+RegQueryFormat g_queryFormat = kRegFormatText;
+std::string g_outputFile = "";
+
+// 二进制快照：--snapshot导出为快照，--from从快照文件（而非本机注册表）查询或导出
+bool g_snapshotMode = false;
+std::string g_snapshotSource = "";
+
+// 强制导入标志（忽略导入状态缓存，全部重新导入）
+bool g_force = false;
+
+// 预编译导入包输出文件（--compile，空表示不编译）
+std::string g_compileFile = "";
+
+// 监视目录（--watch，空表示不监视）和去抖间隔（--debounce，毫秒）
+std::string g_watchDirectory = "";
+unsigned g_debounceMs = 500;
+
+// 通配符展开时排除的文件和目录（--exclude，可多次指定）
+std::vector<std::string> g_excludePatterns;
+
+// 查询和导出的键路径/值名过滤器（--include-key/--exclude-key/--include-value/--exclude-value，可多次指定）
+RegKeyFilter g_keyFilter;
+
+// 增量查询的索引文件（--incremental，空表示完整查询）
+std::string g_indexFile = "";
+
+// 查询路径下查找的模式（--find，与--ignore-case/--regex/--find-in一起使用）
+bool g_findMode = false;
+RegFindPattern g_findPattern;
+unsigned g_findScope = kRegFindAll;
+
+// 结构化差异的两个来源（--diff <from> <to>，.reg/导入包/快照文件或注册表路径），补丁写入--output
+bool g_diffMode = false;
+std::string g_diffFrom = "";
+std::string g_diffTo = "";
+
+// 差异比较时每个来源在内存中排序的记录上限，超出部分写入临时文件后归并
+const size_t kDiffSortMemory = 128 * 1024 * 1024;
+
+// 文件清单（@清单 或 --manifest 清单，- 表示标准输入）
+std::vector<std::string> g_manifests;
+
+// 清单中指定了目标根键的文件（文件路径 -> 根键），只保存正在导入的一批
+std::map<std::string, std::string> g_hiveOverrides;
+
+// 运行时间线文件（--trace，为空时不记录）
+std::string g_traceFile;
+std::unique_ptr<RegTracer> g_tracer;
+
 // RAII类用于安全处理Windows句柄
 struct HandleRAII {
     HANDLE h;
@@ -59,28 +172,62 @@ struct HandleRAII {
     HandleRAII& operator=(const HandleRAII&) = delete;
 };
 
+// 按级别记录日志 - 线程安全，只入队不等待写入
+void WriteLogLevel(RegLogLevel level, const std::string& message) {
+    if (g_logEnabled.load(std::memory_order_acquire)) {
+        g_logger.Log(level, message);
+    }
+}
+
 // 日志记录函数 - 线程安全版本
 void WriteLog(const std::string& message) {
-    if (g_debugMode && g_logFile.is_open()) {
-        time_t now = std::time(nullptr);
-        tm localTime;
-        // 使用线程安全的本地时间函数
-        if (localtime_s(&localTime, &now) == 0) {
-            char timestamp[32];
-            if (std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &localTime) > 0) {
-                g_logFile << "[" << timestamp << "] " << message << std::endl;
-                g_logFile.flush();
-
-                // 在调试模式下也输出到控制台（如果存在）
-                HWND consoleWindow = GetConsoleWindow();
-                if (consoleWindow != NULL) {
-                    std::cout << "[" << timestamp << "] " << message << std::endl;
-                }
-            }
+    WriteLogLevel(kRegLogInfo, message);
+}
+
+// 启动后台日志写入线程（整批写入日志文件，存在控制台时同时输出）
+void StartLogWriter() {
+    bool opened = g_logFile.is_open();
+    g_logger.Start([](const char* data, size_t size) {
+        g_logFile.write(data, static_cast<std::streamsize>(size));
+        g_logFile.flush();
+        if (GetConsoleWindow() != NULL) {
+            std::cout.write(data, static_cast<std::streamsize>(size));
+            std::cout.flush();
         }
+    });
+    g_logEnabled.store(opened, std::memory_order_release);
+}
+
+// 写出剩余日志并关闭日志文件
+void CloseLog() {
+    g_logEnabled.store(false, std::memory_order_release);
+    g_logger.Stop();
+    if (g_logFile.is_open()) {
+        g_logFile.close();
+    }
+}
+
+// 写出运行时间线（监视模式每批导入后也写出一次，此时没有工作线程在记录）
+void WriteTraceFile() {
+    if (g_tracer && !g_tracer->WriteFile(g_traceFile)) {
+        WriteLogLevel(kRegLogError, "Cannot write trace file: " + g_traceFile);
     }
 }
 
+// 在WinMain的每个返回路径上停止记录并写出运行时间线
+struct TraceFileRAII {
+    TraceFileRAII() = default;
+    ~TraceFileRAII() {
+        if (g_tracer) {
+            SetRegActiveTracer(NULL);
+            WriteTraceFile();
+        }
+    }
+    // 禁止拷贝
+    TraceFileRAII(const TraceFileRAII&) = delete;
+    TraceFileRAII& operator=(const TraceFileRAII&) = delete;
+};
+
 // 显示帮助信息
 void ShowHelp() {
     // 设置控制台编码为UTF-8
@@ -93,20 +240,68 @@ void ShowHelp() {
         "Usage: reg_import_silent.exe [options] [file_paths...]\n\n"
         "Options:\n"
         "  --debug              Enable debug mode, generate detailed logs\n"
-        "  --query-registry <path>    Query registry path (auto-enables debug mode)\n"
+        "  --log-level <level>  Minimum debug log level: debug, info, warning, error (default: debug)\n"
+        "  --query-registry <path>    Query registry path (auto-enables debug mode and a console window;\n"
+        "                             with --output or redirected stdout it runs without either)\n"
         "  --export-registry <path> [file]  Export registry path to file\n"
+        "  --format <fmt>       Query output format: text, ndjson, json, csv (default: text)\n"
+        "  --output <file>      Write query output (or the --diff patch) to file instead of the console\n"
+        "  --incremental <index>  Query: print only keys/values changed since the query that wrote index\n"
+        "  --find <pattern>     Query: print only keys/values whose name or data contains pattern\n"
+        "  --find-in <scopes>   Where --find looks: comma-separated keys, names, data (default: all)\n"
+        "  --ignore-case        --find ignores ASCII case\n"
+        "  --regex              --find pattern is a regular expression (ECMAScript)\n"
+        "  --diff <from> <to>   Write a minimal .reg patch that turns from into to; each is a .reg/.regpack/.regsnap\n"
+        "                       file or a registry path (live, or the --from snapshot)\n"
+        "  --snapshot           Export a binary snapshot instead of a .reg file\n"
+        "  --from <snapshot>    Query/export from a snapshot file instead of the live registry\n"
+        "  --jobs <N>           Parse files / walk registry subtrees with N worker threads (default: CPU cores)\n"
+        "  --plan               Print the merged minimal write plan without importing\n"
+        "  --coalesce           Merge all files into one minimal write plan, then import\n"
+        "  --skip-unchanged     Read each target value first and only write values that differ\n"
+        "  --force              Import every file even if it is unchanged since its last successful import\n"
+        "  --compile <file>     Compile the given files into one pre-planned binary pack (.regpack)\n"
+        "  --exclude <pattern>  Skip matching files/directories when expanding wildcards (repeatable)\n"
+        "  --manifest <file>    Read file paths line by line from file ('-' for stdin) and import as they are read\n"
+        "  --watch <dir>        Stay resident and import .reg/.regpack files dropped into or modified in dir\n"
+        "  --debounce <ms>      Watch mode: wait until a file has been quiet for ms before importing (default: 500)\n"
+        "  --trace <file>       Record a timeline of phases, files and slow registry keys (Chrome trace JSON)\n"
+        "  --include-key <pattern>    Query/export only keys whose path matches (repeatable)\n"
+        "  --exclude-key <pattern>    Skip matching keys and their whole subtrees in query/export (repeatable)\n"
+        "  --include-value <pattern>  Query/export only values whose name matches; @ is the default value (repeatable)\n"
+        "  --exclude-value <pattern>  Skip values whose name matches in query/export (repeatable)\n"
         "  --help               Show this help information\n\n"
         "File Paths:\n"
         "  Support single or multiple reg file paths\n"
-        "  Support wildcards (* and ?) for batch matching\n\n"
+        "  Support wildcards (* and ?) for batch matching\n"
+        "  Support recursive wildcards (** matches any number of subdirectories)\n"
+        "  Support @file for a manifest (same as --manifest file); quote paths containing spaces\n\n"
         "Examples:\n"
         "  reg_import_silent.exe                           # Import default file\n"
         "  reg_import_silent.exe test1.reg                  # Import specified file\n"
         "  reg_import_silent.exe *.reg                      # Import all reg files\n"
         "  reg_import_silent.exe --debug test1.reg          # Debug mode import\n"
+        "  reg_import_silent.exe configs\\**\\*.reg           # Import reg files in all subdirectories\n"
+        "  reg_import_silent.exe configs\\**\\*.reg --exclude legacy  # Skip any directory or file named legacy\n"
+        "  reg_import_silent.exe @policies.txt               # Import files listed in a manifest\n"
+        "  dir /b /s *.reg | reg_import_silent.exe --manifest -  # Import paths piped through stdin\n"
+        "  reg_import_silent.exe --force *.reg              # Reimport all files, ignoring the apply cache\n"
+        "  reg_import_silent.exe --compile bundle.regpack *.reg  # Compile a bundle for deployment\n"
+        "  reg_import_silent.exe bundle.regpack             # Import a compiled bundle without parsing\n"
+        "  reg_import_silent.exe --watch C:\\Policies        # Import files as they are dropped into a folder\n"
         "  reg_import_silent.exe --query-registry HKLM\\SOFTWARE\\Microsoft  # Query registry\n"
         "  reg_import_silent.exe --export-registry HKLM\\SOFTWARE\\Microsoft  # Export with auto filename\n"
         "  reg_import_silent.exe --export-registry HKLM\\SOFTWARE\\Microsoft export.reg  # Export to specific file\n"
+        "  reg_import_silent.exe --export-registry HKLM\\SOFTWARE\\Vendor vendor.regsnap --snapshot  # Binary snapshot\n"
+        "  reg_import_silent.exe --query-registry HKLM\\SOFTWARE\\Vendor --from vendor.regsnap  # Query a snapshot\n"
+        "  reg_import_silent.exe --export-registry HKLM\\SOFTWARE sw.reg --exclude-key \\Classes --exclude-key \\WOW6432Node\n"
+        "  reg_import_silent.exe --query-registry HKLM\\SOFTWARE --include-key **\\Policies\\**  # Only policy subtrees\n"
+        "  reg_import_silent.exe --query-registry HKLM\\SOFTWARE\\Vendor --incremental vendor.idx  # Changes since last run\n"
+        "  reg_import_silent.exe --query-registry HKLM\\SOFTWARE --find proxy.corp --ignore-case  # Search a hive\n"
+        "  reg_import_silent.exe --query-registry HKCU\\Software --find \"v[0-9]+\\.[0-9]+\" --regex --find-in data\n"
+        "  reg_import_silent.exe --diff HKLM\\SOFTWARE\\Vendor bundle.reg --output preview.reg  # What bundle changes\n"
+        "  reg_import_silent.exe --diff before.reg after.reg --output changes.reg  # Compare two exports\n"
+        "  reg_import_silent.exe --trace run.json *.reg     # Import and record a timeline for Perfetto\n"
         "  reg_import_silent.exe --help                     # Show help\n\n"
         "Registry Path Examples:\n"
         "  HKLM\\SOFTWARE\\Microsoft          (HKEY_LOCAL_MACHINE)\n"
@@ -119,6 +314,35 @@ void ShowHelp() {
         "  - Debug mode generates timestamped log files\n"
         "  - Query mode shows all subkeys and values recursively\n"
         "  - Export mode creates .reg file (overwrites existing)\n"
+        "  - Files are always applied in command line order, whatever --jobs is\n"
+        "  - A large .reg file (8 MB or more) is split at key sections and parsed by all --jobs threads\n"
+        "  - Wildcard matches are sorted by path; a file matched by several patterns is imported once\n"
+        "  - --exclude without a path separator matches a name at any level, otherwise the whole path\n"
+        "  - Query/export accept several paths separated by ';' (e.g. \"HKLM\\A;HKCU\\B\")\n"
+        "  - Query/export output is identical whatever --jobs is\n"
+        "  - Key patterns match the path below each queried/exported path (case-insensitive, * ? and **);\n"
+        "    a pattern without '\\' matches a key name at any level, a leading '\\' anchors it below the path;\n"
+        "    subtrees that cannot contain a matching key are not opened (keys visited/pruned are logged)\n"
+        "  - Incremental query prints [+] added, [*] changed and [-] deleted keys with +/*/- value lines;\n"
+        "    the index is rewritten after each successful query (first run prints everything as added)\n"
+        "  - Option values containing spaces can be quoted (e.g. --find \"Program Files\")\n"
+        "  - --find searches string values in their raw UTF-16 form (REG_MULTI_SZ string by string) and other\n"
+        "    types in their query text form; matching keys are written as soon as the walk reaches them\n"
+        "  - --diff compares keys and value names case-insensitively and values by type and raw bytes; the patch\n"
+        "    deletes whole subtrees with [-key] and removed values with \"name\"=-, and is empty for equal sources\n"
+        "  - --diff sorts sources larger than memory through temporary files (multi-million-value exports)\n"
+        "  - Query with --output or redirected stdout runs without console or pause\n"
+        "  - Snapshot files are imported like .reg files (detected by content)\n"
+        "  - Pack files are applied directly from the mapped file (detected by content)\n"
+        "  - Without file arguments disable_local_network_access.regpack is preferred over the .reg file\n"
+        "  - Files unchanged since their last successful import are skipped (state in reg_import_cache.txt)\n"
+        "  - Manifest line: path [priority=N] [hive=ROOT]; higher priority is applied later across the whole\n"
+        "    manifest (a manifest file with any priority= is read completely before importing; priority= is\n"
+        "    ignored for --manifest -, which imports in line order), hive= remaps every key of the file to ROOT\n"
+        "    (e.g. hive=HKU\\.DEFAULT); # or ; starts a comment\n"
+        "  - Watch mode runs until the process is terminated; counters are kept in reg_import_watch_status.txt\n"
+        "  - Trace files open in ui.perfetto.dev or chrome://tracing; registry keys faster than 100 us are only counted\n"
+        "  - In watch mode the trace file is rewritten after each batch and holds only the latest batch\n"
         "  - Support Windows 10/11\n"
         "  - No external dependencies\n"
         "  - Open source under MIT License\n";
@@ -135,6 +359,7 @@ void ShowHelp() {
 
 // 清理旧日志文件（保留最近5个）
 void CleanOldLogs() {
+    RegTraceSpan span("phase", "CleanOldLogs");
     char exePath[MAX_PATH];
     if (GetModuleFileNameA(NULL, exePath, MAX_PATH) == 0) {
         return;
@@ -202,267 +427,1178 @@ void CleanOldLogs() {
     }
 }
 
-// 递归查找匹配通配符的文件
-void FindFiles(const std::string& pattern, std::vector<std::string>& files) {
-    WIN32_FIND_DATAA findData;
-    HANDLE hFind = FindFirstFileA(pattern.c_str(), &findData);
-    
-    if (hFind != INVALID_HANDLE_VALUE) {
-        do {
-            if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
-                std::string filePath = pattern;
-                size_t lastSlash = filePath.find_last_of("\\/");
-                if (lastSlash != std::string::npos) {
-                    filePath = filePath.substr(0, lastSlash + 1) + findData.cFileName;
-                } else {
-                    filePath = findData.cFileName;
+// 拆分以';'分隔的多个注册表路径（忽略空项）
+std::vector<std::string> SplitRegPathList(const std::string& list) {
+    std::vector<std::string> paths;
+    size_t start = 0;
+    while (start <= list.length()) {
+        size_t end = list.find(';', start);
+        if (end == std::string::npos) {
+            end = list.length();
+        }
+        std::string path = list.substr(start, end - start);
+        while (!path.empty() && path[0] == ' ') {
+            path.erase(0, 1);
+        }
+        while (!path.empty() && path[path.length() - 1] == ' ') {
+            path.erase(path.length() - 1);
+        }
+        if (!path.empty()) {
+            paths.push_back(path);
+        }
+        start = end + 1;
+    }
+    return paths;
+}
+
+// 打开查询和导出的数据源：指定--from时为快照文件，否则为本机注册表
+std::unique_ptr<RegBackend> OpenSourceBackend() {
+    if (g_snapshotSource.empty()) {
+        return std::unique_ptr<RegBackend>(new Win32RegBackend());
+    }
+    std::unique_ptr<RegSnapshot> snapshot(new RegSnapshot());
+    std::string error;
+    if (!snapshot->Open(g_snapshotSource, &error)) {
+        WriteLogLevel(kRegLogError, "Cannot load snapshot: " + error);
+        return std::unique_ptr<RegBackend>();
+    }
+    WriteLog("Reading from snapshot: " + g_snapshotSource + " (" + std::to_string(snapshot->GetKeyCount()) +
+             " keys, " + std::to_string(snapshot->GetValueCount()) + " values)");
+    return std::unique_ptr<RegBackend>(snapshot.release());
+}
+
+// 替换文件内容：先写临时文件再替换，中途退出不会留下写了一半的文件
+bool ReplaceFileContent(const std::string& path, const std::string& content) {
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!file) {
+            WriteLogLevel(kRegLogWarning, "Cannot write file: " + tempPath);
+            return false;
+        }
+    }
+    if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        WriteLogLevel(kRegLogWarning, "Cannot replace file: " + path);
+        DeleteFileA(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 设置了过滤器时记录访问的键数和剪掉的键数（被剪掉的键及其子树都没有打开）
+void LogTraversalStats(const RegTraversalStats& stats) {
+    if (!g_keyFilter.Empty()) {
+        WriteLog("Key filter: " + std::to_string(stats.keys) + " keys visited, " + std::to_string(stats.pruned) +
+                 " keys pruned (subtrees not opened)");
+    }
+}
+
+// 增量查询：对照索引文件只输出变化，成功后用本次查询的结果替换索引
+bool QueryRegistryIncremental(RegBackend& backend, const std::vector<std::string>& paths, size_t jobs,
+                              std::ostream& out, const RegLogSink& log) {
+    if (g_queryFormat != kRegFormatText) {
+        WriteLogLevel(kRegLogWarning, "Incremental query only supports text output, --format is ignored");
+    }
+    if (!g_keyFilter.Empty()) {
+        WriteLogLevel(kRegLogWarning, "Incremental query does not support key/value filters, they are ignored");
+    }
+    RegQueryIndex index;
+    index.Load(g_indexFile);
+    WriteLog("Query index: " + g_indexFile + " (" + std::to_string(index.GetKeyCount()) + " keys)");
+    RegIncrementalQuery query(backend, index, out, jobs);
+    query.SetLogSink(log);
+    std::string newIndex;
+    bool success = query.Query(paths, &newIndex);
+    const RegIncrementalStats& stats = query.GetStats();
+    WriteLog("Incremental query: " + std::to_string(stats.keys) + " keys visited, " +
+             std::to_string(stats.unchangedKeys) + " unchanged (not enumerated), " +
+             std::to_string(stats.addedKeys) + " added, " + std::to_string(stats.modifiedKeys) + " modified, " +
+             std::to_string(stats.deletedKeys) + " deleted; values " + std::to_string(stats.addedValues) +
+             " added, " + std::to_string(stats.modifiedValues) + " modified, " +
+             std::to_string(stats.deletedValues) + " deleted");
+    // 查询失败时保留旧索引，下次仍对照上次成功的结果
+    if (success && !ReplaceFileContent(g_indexFile, newIndex)) {
+        WriteLogLevel(kRegLogError, "Cannot save query index: " + g_indexFile);
+        return false;
+    }
+    return success;
+}
+
+// 在查询路径下查找匹配的键和值，命中的键边遍历边输出
+bool FindInRegistry(RegBackend& backend, const std::vector<std::string>& paths, size_t jobs, std::ostream& out,
+                    const RegLogSink& log) {
+    if (g_queryFormat != kRegFormatText) {
+        WriteLogLevel(kRegLogWarning, "Find only supports text output, --format is ignored");
+    }
+    RegFindPrinter printer(backend, g_findPattern, g_findScope, out, jobs);
+    printer.SetLogSink(log);
+    printer.SetFilter(&g_keyFilter);
+    bool success = printer.Find(paths);
+    WriteLog("Find: " + std::to_string(printer.GetTraversalStats().keys) + " keys searched, " +
+             std::to_string(printer.GetMatchedKeyCount()) + " keys matched, " +
+             std::to_string(printer.GetMatchedValueCount()) + " values matched");
+    return success;
+}
+
+// 查询注册表路径下的所有信息（jobs个线程并行遍历子树）
+bool QueryRegistry(const std::vector<std::string>& paths, size_t jobs, std::ostream& out, RegQueryFormat format) {
+    RegTraceSpan span("phase", "QueryRegistry");
+    std::unique_ptr<RegBackend> source = OpenSourceBackend();
+    if (!source) {
+        return false;
+    }
+    RegBackend& backend = *source;
+    RegLogSink log = [](const std::string& message) { WriteLogLevel(kRegLogDebug, message); };
+    bool success;
+    if (g_findMode) {
+        success = FindInRegistry(backend, paths, jobs, out, log);
+    } else if (!g_indexFile.empty()) {
+        success = QueryRegistryIncremental(backend, paths, jobs, out, log);
+    } else if (format == kRegFormatText) {
+        RegQueryPrinter printer(backend, out, jobs);
+        printer.SetLogSink(log);
+        printer.SetFilter(&g_keyFilter);
+        success = printer.Query(paths);
+        LogTraversalStats(printer.GetTraversalStats());
+    } else {
+        RegRecordPrinter printer(backend, out, format, jobs);
+        printer.SetLogSink(log);
+        printer.SetFilter(&g_keyFilter);
+        success = printer.Query(paths);
+        LogTraversalStats(printer.GetTraversalStats());
+        WriteLog("Query records: " + std::to_string(printer.GetKeyCount()) + " keys, " +
+                 std::to_string(printer.GetValueCount()) + " values");
+    }
+    out.flush();
+    return success;
+}
+
+// 标准输出是否被重定向到文件或管道（GUI程序未重定向时没有标准输出句柄）
+bool IsStdOutRedirected() {
+    HANDLE stdOut = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (stdOut == NULL || stdOut == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD type = GetFileType(stdOut);
+    return type == FILE_TYPE_DISK || type == FILE_TYPE_PIPE;
+}
+
+// 非交互查询：结果经大缓冲区写入输出文件或重定向的标准输出，不打开控制台
+bool QueryRegistryToOutput(const std::vector<std::string>& paths, size_t jobs) {
+    std::ofstream file;
+    RegOutputSink sink;
+    if (!g_outputFile.empty()) {
+        file.open(g_outputFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            WriteLogLevel(kRegLogError, "Registry query failed: Cannot create file: " + g_outputFile);
+            return false;
+        }
+        sink = [&file](const uint8_t* data, size_t size) {
+            file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+            return static_cast<bool>(file);
+        };
+    } else {
+        HANDLE stdOut = GetStdHandle(STD_OUTPUT_HANDLE);
+        sink = [stdOut](const uint8_t* data, size_t size) {
+            while (size > 0) {
+                DWORD written = 0;
+                DWORD chunk = size > 0x40000000 ? 0x40000000 : static_cast<DWORD>(size);
+                if (!WriteFile(stdOut, data, chunk, &written, NULL) || written == 0) {
+                    return false;
                 }
-                files.push_back(filePath);
+                data += written;
+                size -= written;
             }
-        } while (FindNextFileA(hFind, &findData));
-        FindClose(hFind);
-    }
-}
-
-// 获取注册表数据类型名称
-std::string GetRegTypeName(DWORD type) {
-    if (type == REG_NONE) return "REG_NONE";
-    if (type == REG_SZ) return "REG_SZ";
-    if (type == REG_EXPAND_SZ) return "REG_EXPAND_SZ";
-    if (type == REG_BINARY) return "REG_BINARY";
-    if (type == REG_DWORD || type == REG_DWORD_LITTLE_ENDIAN) return "REG_DWORD";
-    if (type == REG_DWORD_BIG_ENDIAN) return "REG_DWORD_BIG_ENDIAN";
-    if (type == REG_LINK) return "REG_LINK";
-    if (type == REG_MULTI_SZ) return "REG_MULTI_SZ";
-    if (type == REG_RESOURCE_LIST) return "REG_RESOURCE_LIST";
-    if (type == REG_FULL_RESOURCE_DESCRIPTOR) return "REG_FULL_RESOURCE_DESCRIPTOR";
-    if (type == REG_RESOURCE_REQUIREMENTS_LIST) return "REG_RESOURCE_REQUIREMENTS_LIST";
-    return "UNKNOWN";
-}
-
-// 格式化注册表值数据
-std::string FormatRegValueData(DWORD type, const BYTE* data, DWORD dataSize) {
-    if (data == NULL || dataSize == 0) {
-        return "(empty)";
-    }
-
-    switch (type) {
-        case REG_SZ:
-        case REG_EXPAND_SZ: {
-            return std::string((char*)data, dataSize - 1);
-        }
-        case REG_DWORD: {
-            if (dataSize >= sizeof(DWORD)) {
-                DWORD value = *((DWORD*)data);
-                return "0x" + std::to_string(value) + " (" + std::to_string(value) + ")";
+            return true;
+        };
+    }
+
+    RegBufferedOutput buffer(sink);
+    std::ostream out(&buffer);
+    bool success = QueryRegistry(paths, jobs, out, g_queryFormat);
+    if (buffer.Failed()) {
+        WriteLogLevel(kRegLogError, "Registry query failed: Cannot write output");
+        return false;
+    }
+    return success;
+}
+
+// 导出注册表路径到文件（进程内并行遍历，按REGEDIT5格式或二进制快照流式写出）
+bool ExportRegistry(const std::vector<std::string>& regPaths, const std::string& outputFile, size_t jobs) {
+    RegTraceSpan span("phase", "ExportRegistry");
+    for (size_t i = 0; i < regPaths.size(); i++) {
+        WriteLog("Starting registry export: " + regPaths[i]);
+    }
+
+    std::ofstream file(outputFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        WriteLogLevel(kRegLogError, "Registry export failed: Cannot create file: " + outputFile);
+        return false;
+    }
+
+    std::unique_ptr<RegBackend> source = OpenSourceBackend();
+    if (!source) {
+        file.close();
+        std::remove(outputFile.c_str());
+        return false;
+    }
+    RegOutputSink sink = [&file](const uint8_t* data, size_t size) {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    };
+    RegExportProgressSink progress = [](size_t keys, size_t bytes) {
+        WriteLog("Exported " + std::to_string(keys) + " keys (" + std::to_string(bytes) + " bytes)");
+    };
+
+    std::string error;
+    bool success;
+    RegExportStats stats;
+    if (g_snapshotMode) {
+        RegSnapshotWriter writer(*source, sink, 1024 * 1024, jobs);
+        writer.SetProgressSink(progress);
+        writer.SetFilter(&g_keyFilter);
+        success = writer.Export(regPaths, &error);
+        stats = writer.GetStats();
+        LogTraversalStats(writer.GetTraversalStats());
+    } else {
+        RegExporter exporter(*source, sink, 1024 * 1024, jobs);
+        exporter.SetProgressSink(progress);
+        exporter.SetFilter(&g_keyFilter);
+        success = exporter.Export(regPaths, &error);
+        stats = exporter.GetStats();
+        LogTraversalStats(exporter.GetTraversalStats());
+    }
+    file.close();
+    if (!success || !file) {
+        std::remove(outputFile.c_str());
+        WriteLogLevel(kRegLogError, "Registry export failed: " + (error.empty() ? "Cannot write file: " + outputFile : error));
+        return false;
+    }
+
+    WriteLog("Registry export successful to: " + outputFile + " (" + std::to_string(stats.keys) + " keys, " +
+             std::to_string(stats.values) + " values, " + std::to_string(stats.bytes) + " bytes)");
+    return true;
+}
+
+// 使用系统ANSI代码页解码REGEDIT4文件内容
+void AnsiToUtf8Win32(const char* data, size_t size, std::string* out) {
+    if (size == 0) {
+        return;
+    }
+    int length = MultiByteToWideChar(CP_ACP, 0, data, static_cast<int>(size), NULL, 0);
+    std::wstring wide(static_cast<size_t>(length), L'\0');
+    MultiByteToWideChar(CP_ACP, 0, data, static_cast<int>(size), &wide[0], length);
+    Utf16LeToUtf8(reinterpret_cast<const uint8_t*>(wide.data()), wide.size(), out);
+}
+
+// 把一个比较来源加入差异排序：存在的文件按导入包、快照或.reg读取，否则按注册表路径（可用';'分隔多个）
+// 遍历本机注册表或--from指定的快照
+bool AddDiffSource(const std::string& source, size_t jobs, RegDiffSource* diff) {
+    RegTraceSpan span("file", "DiffSource", source);
+    std::string error;
+    bool added;
+    std::vector<std::string> paths = SplitRegPathList(source);
+    if (GetFileAttributesA(source.c_str()) == INVALID_FILE_ATTRIBUTES && !paths.empty() &&
+        SplitRegKeyPath(paths[0], NULL, NULL)) {
+        std::unique_ptr<RegBackend> backend = OpenSourceBackend();
+        if (!backend) {
+            return false;
+        }
+        added = diff->AddSubtree(*backend, paths, jobs, &error);
+    } else if (IsRegSnapshotFile(source)) {
+        RegSnapshot snapshot;
+        added = snapshot.Open(source, &error);
+        if (added) {
+            snapshot.ForEachOp([diff, &added](const RegOp& op) { added = diff->AddOp(op) && added; });
+        }
+    } else if (IsRegPackFile(source)) {
+        // 与快照相同，直接从映射的文件逐条送入排序器，不复制整个导入包
+        RegPack pack;
+        added = pack.Open(source, &error);
+        if (added) {
+            pack.ForEachOp([diff, &added](const RegOp& op) { added = diff->AddOp(op) && added; });
+        }
+    } else {
+        added = diff->AddRegFile(source, AnsiToUtf8Win32, &error);
+    }
+    if (!added && error.empty()) {
+        error = diff->GetError();
+    }
+    if (!added || !diff->Finish(&error)) {
+        WriteLogLevel(kRegLogError, "Registry diff failed: " + source + ": " + error);
+        return false;
+    }
+    const RegDiffSorter& sorter = diff->GetSorter();
+    WriteLog("Diff source " + source + ": " + std::to_string(sorter.GetRecordCount()) + " records, " +
+             std::to_string(sorter.GetRunCount()) + " sorted runs");
+    return true;
+}
+
+// 比较两个来源，把from变为to的最小补丁写入outputFile
+bool DiffSources(const std::string& from, const std::string& to, const std::string& outputFile, size_t jobs) {
+    RegTraceSpan span("phase", "DiffSources");
+    WriteLog("Starting registry diff: " + from + " -> " + to);
+
+    // 有序段写入系统临时目录，文件名含进程ID，RegDiffSource析构时删除
+    char tempDir[MAX_PATH + 1];
+    DWORD tempLength = GetTempPathA(sizeof(tempDir), tempDir);
+    std::string tempPrefix = (tempLength > 0 && tempLength <= MAX_PATH) ? std::string(tempDir, tempLength) : ".\\";
+    tempPrefix += "reg_diff_" + std::to_string(GetCurrentProcessId()) + "_";
+    RegDiffSource fromSource(tempPrefix + "from_", kDiffSortMemory);
+    RegDiffSource toSource(tempPrefix + "to_", kDiffSortMemory);
+    if (!AddDiffSource(from, jobs, &fromSource) || !AddDiffSource(to, jobs, &toSource)) {
+        return false;
+    }
+
+    std::ofstream file(outputFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        WriteLogLevel(kRegLogError, "Registry diff failed: Cannot create file: " + outputFile);
+        return false;
+    }
+    RegDiffWriter writer([&file](const uint8_t* data, size_t size) {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    });
+    std::string error;
+    bool success = writer.Diff(fromSource, toSource, &error);
+    file.close();
+    if (!success || !file) {
+        std::remove(outputFile.c_str());
+        WriteLogLevel(kRegLogError, "Registry diff failed: " + (error.empty() ? "Cannot write file: " + outputFile : error));
+        return false;
+    }
+
+    const RegDiffStats& stats = writer.GetStats();
+    WriteLog("Registry diff written to: " + outputFile + " (keys: " + std::to_string(stats.keysAdded) + " added, " +
+             std::to_string(stats.keysDeleted) + " deleted, " + std::to_string(stats.keysChanged) + " changed; values: " +
+             std::to_string(stats.valuesAdded) + " added, " + std::to_string(stats.valuesDeleted) + " deleted, " +
+             std::to_string(stats.valuesChanged) + " changed; " + std::to_string(stats.bytes) + " bytes)");
+    if (stats.Empty()) {
+        WriteLog("Sources are identical");
+    }
+    return true;
+}
+
+// 输出写操作应用统计
+std::string FormatApplyStats(const RegApplyStats& stats) {
+    std::string text = std::to_string(stats.keysOpened) + " keys opened, " +
+                       std::to_string(stats.valuesWritten) + " values written, ";
+    if (g_skipUnchanged) {
+        text += std::to_string(stats.valuesSkipped) + " values unchanged, ";
+    }
+    text += std::to_string(stats.valuesDeleted) + " values deleted, ";
+    if (g_skipUnchanged) {
+        text += std::to_string(stats.deletesSkipped) + " deletes skipped, ";
+    }
+    return text + std::to_string(stats.keysDeleted) + " keys deleted, " +
+           std::to_string(stats.failures) + " failures";
+}
+
+// 清单为文件指定的目标根键（空表示不替换）
+std::string GetHiveOverride(const std::string& regFilePath) {
+    std::map<std::string, std::string>::const_iterator it = g_hiveOverrides.find(regFilePath);
+    return it == g_hiveOverrides.end() ? std::string() : it->second;
+}
+
+// 是否为需要分段并行解析的大文件（至少两段）
+bool IsLargeRegFile(const std::string& regFilePath) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(regFilePath.c_str(), GetFileExInfoStandard, &data)) {
+        return false;
+    }
+    uint64_t size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    return size >= 2 * kRegSplitSegmentSize;
+}
+
+// 映射大文件并切分，jobs个线程并行解析各段，按文件顺序写入
+bool ApplyRegFileSegments(const std::string& regFilePath, size_t jobs, RegApplier& applier, std::string* error) {
+    RegFileSplitter splitter;
+    if (!splitter.Open(regFilePath, error)) {
+        return false;
+    }
+    size_t segments = splitter.Split(kRegSplitSegmentSize);
+    WriteLog("Parallel parse: " + std::to_string(segments) + " segments of " +
+             std::to_string(splitter.GetSize()) + " bytes with " + std::to_string(jobs) + " worker threads");
+    bool parsed = true;
+    size_t lineOffset = 0;
+    RunOrderedPipeline<RegParsedSegment>(segments, jobs,
+        [&splitter](size_t index, RegParsedSegment* segment) {
+            splitter.ParseSegment(index, AnsiToUtf8Win32, segment);
+        },
+        [&applier, &parsed, &lineOffset, error](size_t, RegParsedSegment& segment) {
+            if (!parsed) {
+                return;
             }
-            return "(invalid DWORD)";
-        }
-        case REG_BINARY: {
-            std::string result;
-            for (DWORD i = 0; i < dataSize && i < 256; i++) {
-                char hex[4];
-                snprintf(hex, sizeof(hex), "%02X ", data[i]);
-                result += hex;
+            const RegParsedFile& file = segment.file;
+            for (size_t i = 0; i < file.warnings.size(); i++) {
+                WriteLogLevel(kRegLogWarning, "Warning: line " + std::to_string(lineOffset + file.warnings[i].first) +
+                                                  ": " + file.warnings[i].second);
             }
-            if (dataSize > 256) {
-                result += "... (" + std::to_string(dataSize) + " bytes total)";
+            if (!file.parsed) {
+                parsed = false;
+                *error = file.error;
+                return;
             }
-            return result;
-        }
-        case REG_MULTI_SZ: {
-            std::string result;
-            std::string multiStr((char*)data, dataSize);
-            for (size_t pos = 0; pos < multiStr.length(); ) {
-                size_t nextPos = multiStr.find('\0', pos);
-                if (nextPos == std::string::npos) {
-                    result += multiStr.substr(pos);
-                    break;
-                }
-                if (nextPos > pos) {
-                    if (!result.empty()) result += "; ";
-                    result += multiStr.substr(pos, nextPos - pos);
-                }
-                pos = nextPos + 1;
+            for (size_t i = 0; i < file.ops.size(); i++) {
+                applier.Apply(file.ops[i]);
             }
-            return result;
-        }
-        default: {
-            std::string result = "(" + GetRegTypeName(type) + ", " + std::to_string(dataSize) + " bytes)";
-            return result;
-        }
-    }
-}
-
-// 查询注册表路径下的所有信息
-void QueryRegistry(const std::string& path, int indent = 0, bool isRoot = true) {
-    std::string indentStr(indent * 2, ' ');
-
-    // 解析根键简称
-    HKEY rootKey = NULL;
-    std::string subPath;
-    std::string pathToUse = path;
-
-    // 支持简化路径格式
-    if (path.rfind("HKLM\\", 0) == 0 || path.rfind("HKEY_LOCAL_MACHINE\\", 0) == 0) {
-        rootKey = HKEY_LOCAL_MACHINE;
-        subPath = path.substr(path.find('\\') + 1);
-    } else if (path.rfind("HKCU\\", 0) == 0 || path.rfind("HKEY_CURRENT_USER\\", 0) == 0) {
-        rootKey = HKEY_CURRENT_USER;
-        subPath = path.substr(path.find('\\') + 1);
-    } else if (path.rfind("HKCR\\", 0) == 0 || path.rfind("HKEY_CLASSES_ROOT\\", 0) == 0) {
-        rootKey = HKEY_CLASSES_ROOT;
-        subPath = path.substr(path.find('\\') + 1);
-    } else if (path.rfind("HKU\\", 0) == 0 || path.rfind("HKEY_USERS\\", 0) == 0) {
-        rootKey = HKEY_USERS;
-        subPath = path.substr(path.find('\\') + 1);
-    } else if (path.rfind("HKCC\\", 0) == 0 || path.rfind("HKEY_CURRENT_CONFIG\\", 0) == 0) {
-        rootKey = HKEY_CURRENT_CONFIG;
-        subPath = path.substr(path.find('\\') + 1);
+            lineOffset += segment.lines;
+        });
+    return parsed;
+}
+
+// 静默导入单个reg文件（进程内流式解析，直接写入注册表；导入包和快照文件直接从映射内存写入）
+// jobs大于1时大文件分段并行解析
+bool ImportRegFile(const std::string& regFilePath, size_t jobs = 1) {
+    RegTraceSpan span("file", "ImportRegFile", regFilePath);
+    WriteLog("Starting registry import: " + regFilePath);
+
+    Win32RegBackend backend;
+    RegApplier applier(backend, g_skipUnchanged);
+    applier.SetErrorSink([](const std::string& message) { WriteLogLevel(kRegLogError, message); });
+    std::string hive = GetHiveOverride(regFilePath);
+    if (!hive.empty()) {
+        WriteLog("Target hive: " + hive);
+        applier.SetRootOverride(hive);
+    }
+
+    std::string error;
+    bool parsed;
+    if (IsRegPackFile(regFilePath)) {
+        RegPack pack;
+        parsed = pack.Open(regFilePath, &error);
+        if (parsed) {
+            WriteLog("Registry pack: " + std::to_string(pack.GetOpCount()) + " operations on " +
+                     std::to_string(pack.GetKeyCount()) + " keys, compiled from " +
+                     std::to_string(pack.GetSourceCount()) + " files");
+            pack.Apply(applier);
+        }
+    } else if (IsRegSnapshotFile(regFilePath)) {
+        RegSnapshot snapshot;
+        parsed = snapshot.Open(regFilePath, &error);
+        if (parsed) {
+            snapshot.ForEachOp([&applier](const RegOp& op) { applier.Apply(op); });
+        }
+    } else if (jobs > 1 && IsLargeRegFile(regFilePath)) {
+        parsed = ApplyRegFileSegments(regFilePath, jobs, applier, &error);
     } else {
-        WriteLog("Error: Invalid registry path format: " + path);
-        return;
+        RegFileParser parser([&applier](const RegOp& op) { applier.Apply(op); });
+        parser.SetAnsiDecoder(AnsiToUtf8Win32);
+        parser.SetWarningSink([](size_t line, const std::string& message) {
+            WriteLogLevel(kRegLogWarning, "Warning: line " + std::to_string(line) + ": " + message);
+        });
+        parsed = ParseRegFile(regFilePath, parser, &error);
     }
+    applier.CloseCurrentKey();
 
-    // 打开注册表键
-    HKEY hKey;
-    LONG result = RegOpenKeyExA(rootKey, subPath.empty() ? NULL : subPath.c_str(), 0, KEY_READ, &hKey);
+    if (!parsed) {
+        WriteLogLevel(kRegLogError, "Registry import failed: " + error);
+        return false;
+    }
 
-    if (result != ERROR_SUCCESS) {
-        WriteLog("Error: Failed to open registry key: " + path + " (Error code: " + std::to_string(result) + ")");
-        return;
+    WriteLog("Registry import finished: " + FormatApplyStats(applier.GetStats()));
+    if (applier.GetStats().failures > 0) {
+        WriteLogLevel(kRegLogError, "Registry import failed");
+        return false;
     }
+    WriteLog("Registry import successful");
+    return true;
+}
 
-    WriteLog("Querying registry path: " + path);
+// 读取一个reg文件、导入包或快照文件的全部操作（在工作线程中调用），按清单替换根键
+void LoadRegFileOps(const std::string& regFilePath, RegParsedFile* parsed) {
+    RegTraceSpan span("file", "Parse", regFilePath);
+    if (IsRegPackFile(regFilePath)) {
+        LoadRegPackOps(regFilePath, parsed);
+    } else if (IsRegSnapshotFile(regFilePath)) {
+        LoadRegSnapshotOps(regFilePath, parsed);
+    } else {
+        ParseRegFileToOps(regFilePath, AnsiToUtf8Win32, parsed);
+    }
+    std::string hive = GetHiveOverride(regFilePath);
+    if (!hive.empty()) {
+        std::string mapped;
+        for (size_t i = 0; i < parsed->ops.size(); i++) {
+            ReplaceRegKeyRoot(parsed->ops[i].keyPath, hive, &mapped);
+            parsed->ops[i].keyPath.swap(mapped);
+        }
+    }
+}
 
-    // 打印键路径
-    std::cout << indentStr << (isRoot ? "[ " : "") << path << (isRoot ? " ]" : "") << std::endl;
+// 按顺序应用一个已在工作线程中解析完成的reg文件
+bool CommitParsedRegFile(const std::string& regFilePath, const RegParsedFile& parsed) {
+    RegTraceSpan span("file", "Apply", regFilePath);
+    WriteLog("Starting registry import: " + regFilePath);
+    for (size_t i = 0; i < parsed.warnings.size(); i++) {
+        WriteLogLevel(kRegLogWarning, "Warning: line " + std::to_string(parsed.warnings[i].first) + ": " + parsed.warnings[i].second);
+    }
+    if (!parsed.parsed) {
+        WriteLogLevel(kRegLogError, "Registry import failed: " + parsed.error);
+        return false;
+    }
 
-    // 枚举键值
-    DWORD valueIndex = 0;
-    char valueName[MAX_PATH];
-    DWORD valueNameSize;
-    DWORD valueType;
-    BYTE valueData[4096];
-    DWORD valueDataSize;
+    Win32RegBackend backend;
+    RegApplier applier(backend, g_skipUnchanged);
+    applier.SetErrorSink([](const std::string& message) { WriteLogLevel(kRegLogError, message); });
+    for (size_t i = 0; i < parsed.ops.size(); i++) {
+        applier.Apply(parsed.ops[i]);
+    }
+    applier.CloseCurrentKey();
 
-    while (true) {
-        valueNameSize = MAX_PATH;
-        valueDataSize = sizeof(valueData);
-        result = RegEnumValueA(hKey, valueIndex, valueName, &valueNameSize, NULL, &valueType, valueData, &valueDataSize);
+    WriteLog("Registry import finished: " + FormatApplyStats(applier.GetStats()));
+    if (applier.GetStats().failures > 0) {
+        WriteLogLevel(kRegLogError, "Registry import failed");
+        return false;
+    }
+    WriteLog("Registry import successful");
+    return true;
+}
 
-        if (result == ERROR_NO_MORE_ITEMS) {
-            break;
+// 导入所有reg文件：读取和解析并行进行，注册表写入按命令行顺序串行提交
+// fileOk返回每个文件是否导入成功
+int ImportRegFiles(const std::vector<std::string>& regFiles, size_t jobs, std::vector<bool>* fileOk) {
+    RegTraceSpan span("phase", "ImportRegFiles");
+    fileOk->assign(regFiles.size(), false);
+    if (jobs <= 1 || regFiles.size() <= 1) {
+        for (size_t i = 0; i < regFiles.size(); i++) {
+            (*fileOk)[i] = ImportRegFile(regFiles[i], jobs);
         }
+        return static_cast<int>(std::count(fileOk->begin(), fileOk->end(), true));
+    }
 
-        if (result == ERROR_SUCCESS) {
-            std::string formattedValue = FormatRegValueData(valueType, valueData, valueDataSize);
-            WriteLog("  Value: " + std::string(valueName) + " (" + GetRegTypeName(valueType) + ") = " + formattedValue);
-            std::cout << indentStr << "  \"" << valueName << "\" = " << formattedValue << " (" << GetRegTypeName(valueType) << ")" << std::endl;
+    // 导入包不需要解析，轮到时直接从映射内存写入；大文件轮到时再分段并行解析
+    std::vector<bool> direct(regFiles.size());
+    for (size_t i = 0; i < regFiles.size(); i++) {
+        direct[i] = IsRegPackFile(regFiles[i]) || IsLargeRegFile(regFiles[i]);
+    }
+
+    WriteLog("Parallel import with " + std::to_string(jobs) + " worker threads");
+    RunOrderedPipeline<RegParsedFile>(regFiles.size(), jobs,
+        [&regFiles, &direct](size_t index, RegParsedFile* parsed) {
+            if (!direct[index]) {
+                LoadRegFileOps(regFiles[index], parsed);
+            }
+        },
+        [&regFiles, &direct, jobs, fileOk](size_t index, RegParsedFile& parsed) {
+            (*fileOk)[index] = direct[index] ? ImportRegFile(regFiles[index], jobs)
+                                             : CommitParsedRegFile(regFiles[index], parsed);
+        });
+    return static_cast<int>(std::count(fileOk->begin(), fileOk->end(), true));
+}
+
+// 并行解析所有文件，按命令行顺序合并到写入规划器中，返回成功解析的文件数
+int BuildWritePlan(const std::vector<std::string>& regFiles, size_t jobs, RegWritePlanner* planner,
+                   std::vector<bool>* parsedFiles) {
+    RegTraceSpan span("phase", "BuildWritePlan");
+    int parsedCount = 0;
+    parsedFiles->assign(regFiles.size(), false);
+    RunOrderedPipeline<RegParsedFile>(regFiles.size(), jobs,
+        [&regFiles](size_t index, RegParsedFile* parsed) {
+            LoadRegFileOps(regFiles[index], parsed);
+        },
+        [&regFiles, planner, parsedFiles, &parsedCount](size_t index, RegParsedFile& parsed) {
+            WriteLog("Planning registry file: " + regFiles[index]);
+            for (size_t i = 0; i < parsed.warnings.size(); i++) {
+                WriteLogLevel(kRegLogWarning, "Warning: line " + std::to_string(parsed.warnings[i].first) + ": " + parsed.warnings[i].second);
+            }
+            if (!parsed.parsed) {
+                WriteLog("Registry file skipped: " + parsed.error);
+                return;
+            }
+            for (size_t i = 0; i < parsed.ops.size(); i++) {
+                planner->Add(parsed.ops[i], index);
+            }
+            (*parsedFiles)[index] = true;
+            parsedCount++;
+        });
+    return parsedCount;
+}
+
+// 输出写入计划的统计信息
+std::string FormatPlanStats(const RegPlanStats& stats) {
+    return "Input operations: " + std::to_string(stats.inputOps) +
+           ", planned: " + std::to_string(stats.plannedOps) +
+           ", eliminated: " + std::to_string(stats.Eliminated()) +
+           " (overwritten values: " + std::to_string(stats.overwrittenValues) +
+           ", redundant value deletes: " + std::to_string(stats.redundantValueDeletes) +
+           ", redundant key deletes: " + std::to_string(stats.redundantKeyDeletes) +
+           ", discarded by key delete: " + std::to_string(stats.discardedBySubtreeDelete) +
+           ", repeated key opens: " + std::to_string(stats.repeatedKeyOpens) + ")";
+}
+
+// 打印合并后的写入计划
+void PrintWritePlan(const std::vector<RegOp>& ops, const RegPlanStats& stats) {
+    for (size_t i = 0; i < ops.size(); i++) {
+        const RegOp& op = ops[i];
+        std::string name = op.valueName.empty() ? "@" : "\"" + op.valueName + "\"";
+        switch (op.kind) {
+            case RegOpDeleteKey:
+                std::cout << "\n[-" << op.keyPath << "]\n";
+                break;
+            case RegOpCreateKey:
+                std::cout << "\n[" << op.keyPath << "]\n";
+                break;
+            case RegOpSetValue:
+                std::cout << name << " = " << GetRegTypeName(op.type) << " (" << op.data.size() << " bytes)\n";
+                break;
+            case RegOpDeleteValue:
+                std::cout << name << " = -\n";
+                break;
         }
+    }
+    std::cout << "\n=== Plan summary ===\n"
+              << "Input operations:            " << stats.inputOps << "\n"
+              << "Planned operations:          " << stats.plannedOps << "\n"
+              << "Eliminated operations:       " << stats.Eliminated() << "\n"
+              << "  Overwritten values:        " << stats.overwrittenValues << "\n"
+              << "  Redundant value deletes:   " << stats.redundantValueDeletes << "\n"
+              << "  Redundant key deletes:     " << stats.redundantKeyDeletes << "\n"
+              << "  Discarded by key delete:   " << stats.discardedBySubtreeDelete << "\n"
+              << "  Repeated key opens:        " << stats.repeatedKeyOpens << std::endl;
+}
 
-        valueIndex++;
+// 按合并后的写入计划导入，写入失败归因到最后写入该项的文件
+int ImportRegFilesCoalesced(const std::vector<std::string>& regFiles, size_t jobs, std::vector<bool>* fileOk) {
+    RegWritePlanner planner;
+    BuildWritePlan(regFiles, jobs, &planner, fileOk);
+
+    std::vector<RegOp> ops;
+    std::vector<size_t> sources;
+    planner.Build(&ops, &sources);
+    WriteLog(FormatPlanStats(planner.GetStats()));
+
+    RegTraceSpan span("phase", "ApplyPlan");
+    Win32RegBackend backend;
+    RegApplier applier(backend, g_skipUnchanged);
+    applier.SetErrorSink([](const std::string& message) { WriteLogLevel(kRegLogError, message); });
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (!applier.Apply(ops[i]) && (*fileOk)[sources[i]]) {
+            (*fileOk)[sources[i]] = false;
+            WriteLogLevel(kRegLogError, "Registry import failed: " + regFiles[sources[i]]);
+        }
     }
+    applier.CloseCurrentKey();
 
-    // 枚举子键
-    DWORD subKeyIndex = 0;
-    char subKeyName[MAX_PATH];
-    DWORD subKeyNameSize;
+    WriteLog("Coalesced import finished: " + FormatApplyStats(applier.GetStats()));
+    return static_cast<int>(std::count(fileOk->begin(), fileOk->end(), true));
+}
+
+// 把所有文件合并规划后编译为一个导入包（任一文件解析失败时不生成）
+bool CompileRegFiles(const std::vector<std::string>& regFiles, const std::string& outputFile, size_t jobs) {
+    WriteLog("Compiling " + std::to_string(regFiles.size()) + " files into: " + outputFile);
+    RegWritePlanner planner;
+    std::vector<bool> parsedFiles;
+    int parsedCount = BuildWritePlan(regFiles, jobs, &planner, &parsedFiles);
+    if (parsedCount != static_cast<int>(regFiles.size())) {
+        WriteLogLevel(kRegLogError, "Compile failed: " + std::to_string(regFiles.size() - static_cast<size_t>(parsedCount)) +
+                                    " files could not be parsed");
+        return false;
+    }
 
-    while (true) {
-        subKeyNameSize = MAX_PATH;
-        result = RegEnumKeyExA(hKey, subKeyIndex, subKeyName, &subKeyNameSize, NULL, NULL, NULL, NULL);
+    std::vector<RegOp> ops;
+    std::vector<size_t> sources;
+    planner.Build(&ops, &sources);
+    WriteLog(FormatPlanStats(planner.GetStats()));
+
+    RegTraceSpan span("phase", "WritePack", outputFile);
+    RegPackWriter writer;
+    writer.SetSourceCount(static_cast<uint32_t>(regFiles.size()));
+    for (size_t i = 0; i < ops.size(); i++) {
+        writer.Add(ops[i]);
+    }
+    if (writer.IsOverflowed()) {
+        WriteLogLevel(kRegLogError, "Compile failed: input is too large for a pack "
+                                    "(string pool, name or value data over 4 GB)");
+        return false;
+    }
 
-        if (result == ERROR_NO_MORE_ITEMS) {
+    std::ofstream file(outputFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        WriteLogLevel(kRegLogError, "Cannot create file: " + outputFile);
+        return false;
+    }
+    size_t bytes = 0;
+    bool written = writer.Write([&file, &bytes](const uint8_t* data, size_t size) {
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        bytes += size;
+        return static_cast<bool>(file);
+    });
+    file.close();
+    if (!written || !file) {
+        WriteLogLevel(kRegLogError, "Cannot write file: " + outputFile);
+        DeleteFileA(outputFile.c_str());
+        return false;
+    }
+    WriteLog("Compiled pack: " + std::to_string(writer.GetOpCount()) + " operations on " +
+             std::to_string(writer.GetKeyCount()) + " keys, " + std::to_string(bytes) + " bytes");
+    return true;
+}
+
+// 获取程序所在目录
+std::string GetExeDirectory() {
+    char exePath[MAX_PATH];
+    if (GetModuleFileNameA(NULL, exePath, MAX_PATH) == 0) {
+        return ".";
+    }
+    char* lastSlash = std::strrchr(exePath, '\\');
+    if (lastSlash != NULL) {
+        *lastSlash = '\0';
+    }
+    return exePath;
+}
+
+// 获取文件大小和最后修改时间（FILETIME的100纳秒计数），失败返回false
+bool GetFileStamp(const std::string& path, RegApplyCacheEntry* entry) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return false;
+    }
+    entry->size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    entry->mtime = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                   data.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+// 小写的完整路径（同一文件的不同写法得到相同结果）
+std::string GetFullPathKey(const std::string& path) {
+    char fullPath[MAX_PATH];
+    DWORD length = GetFullPathNameA(path.c_str(), MAX_PATH, fullPath, NULL);
+    std::string canonical = (length > 0 && length < MAX_PATH) ? std::string(fullPath, length) : path;
+    std::transform(canonical.begin(), canonical.end(), canonical.begin(), RegAsciiLower);
+    return canonical;
+}
+
+// 缓存键：当前用户名|小写完整路径（HKCU的导入结果因用户而异，同一文件按用户分别记录），
+// 清单指定了目标根键时追加|根键（同一文件导入不同根键分别记录）
+std::string GetApplyCacheKey(const std::string& path) {
+    char userName[256];
+    DWORD userNameLength = sizeof(userName);
+    std::string key = GetUserNameA(userName, &userNameLength) ? userName : "";
+    std::string hive = GetHiveOverride(path);
+    return key + "|" + GetFullPathKey(path) + (hive.empty() ? "" : "|" + hive);
+}
+
+// 读取导入状态缓存
+void LoadApplyCache(RegApplyCache& cache, const std::string& cachePath) {
+    RegTraceSpan span("phase", "LoadApplyCache");
+    cache.Load(cachePath);
+}
+
+// 保存导入状态缓存
+bool SaveApplyCache(const RegApplyCache& cache, const std::string& cachePath) {
+    RegTraceSpan span("phase", "SaveApplyCache");
+    return ReplaceFileContent(cachePath, cache.Serialize());
+}
+
+// 导入状态缓存文件
+std::string GetApplyCachePath() {
+    return GetExeDirectory() + "\\reg_import_cache.txt";
+}
+
+// 导入所有reg文件，跳过自上次成功导入以来未变化的文件（--force时全部导入），并更新内存中的导入状态缓存
+// 返回成功数（含跳过的文件）
+int ImportRegFilesWithCache(const std::vector<std::string>& regFiles, size_t jobs, RegApplyCache& cache) {
+    std::vector<std::string> importFiles;
+    std::vector<std::string> importKeys;
+    std::vector<RegApplyCacheEntry> importStamps;
+    std::vector<bool> importStamped;
+    int skippedCount = 0;
+    size_t statHits = cache.GetStats().statHits;
+    size_t contentHits = cache.GetStats().contentHits;
+    RegTraceSpan checkSpan("phase", "CheckApplyCache");
+    for (size_t i = 0; i < regFiles.size(); i++) {
+        RegApplyCacheEntry stamp;
+        std::string key = GetApplyCacheKey(regFiles[i]);
+        bool stamped = GetFileStamp(regFiles[i], &stamp);
+        // --force时仍计算哈希，导入成功后刷新缓存
+        if (stamped && cache.Check(key, regFiles[i], &stamp) != kRegCacheMiss && !g_force) {
+            WriteLog("Skipped unchanged file: " + regFiles[i]);
+            skippedCount++;
+            continue;
+        }
+        importFiles.push_back(regFiles[i]);
+        importKeys.push_back(key);
+        importStamps.push_back(stamp);
+        importStamped.push_back(stamped);
+    }
+    checkSpan.End();
+
+    const RegApplyCacheStats& stats = cache.GetStats();
+    if (g_force) {
+        WriteLog("Apply cache: --force, importing all " + std::to_string(importFiles.size()) + " files");
+    } else {
+        WriteLog("Apply cache: " + std::to_string(skippedCount) + " unchanged files skipped (" +
+                 std::to_string(stats.statHits - statHits) + " by size/time, " +
+                 std::to_string(stats.contentHits - contentHits) + " by content hash), " +
+                 std::to_string(importFiles.size()) + " files to import");
+    }
+
+    int successCount = 0;
+    if (!importFiles.empty()) {
+        std::vector<bool> fileOk;
+        successCount = g_coalesceMode ? ImportRegFilesCoalesced(importFiles, jobs, &fileOk)
+                                      : ImportRegFiles(importFiles, jobs, &fileOk);
+        for (size_t i = 0; i < importFiles.size(); i++) {
+            if (fileOk[i] && importStamped[i]) {
+                cache.Record(importKeys[i], importStamps[i]);
+            } else {
+                cache.Remove(importKeys[i]);
+            }
+        }
+    }
+    return skippedCount + successCount;
+}
+
+// 导入所有reg文件并保存导入状态缓存，返回成功数（含跳过的文件）
+int ImportRegFilesCached(const std::vector<std::string>& regFiles, size_t jobs) {
+    std::string cachePath = GetApplyCachePath();
+    RegApplyCache cache;
+    LoadApplyCache(cache, cachePath);
+    int successCount = ImportRegFilesWithCache(regFiles, jobs, cache);
+    if (cache.IsDirty()) {
+        SaveApplyCache(cache, cachePath);
+    }
+    return successCount;
+}
+
+// 已加入导入列表的文件（小写完整路径和目标根键的哈希），清单很长时只占每个文件8字节
+typedef std::unordered_set<uint64_t> ImportedFileSet;
+
+// 记录文件已加入导入列表，已加入过时返回false
+bool MarkFileImported(const std::string& path, const std::string& hive, ImportedFileSet& imported) {
+    std::string key = GetFullPathKey(path) + "|" + hive;
+    return imported.insert(RegHash64::Hash(key.data(), key.size())).second;
+}
+
+// 正在读取的清单
+struct ManifestInput {
+    RegManifestReader reader;
+    std::vector<RegManifestEntry> carried;  // 本批中已有同一文件（目标根键不同），留到下一批
+    bool usePriority;                       // 是否按priority排序（标准输入流式导入时忽略）
+    bool priorityIgnored;                   // 是否已报告忽略priority
+
+    ManifestInput() : usePriority(true), priorityIgnored(false) {}
+};
+
+// 从清单读取下一批文件（达到maxFiles个或清单读完为止）：展开通配符、排除、跳过已加入过的文件，
+// 记录目标根键，按优先级稳定排序（优先级高的后导入，冲突的值以它为准；usePriority为false时保持行序）后写入batch；
+// 清单已读完且没有留到下一批的文件时返回false
+bool ReadManifestBatch(ManifestInput& input, RegGlob& glob, ImportedFileSet& imported, size_t maxFiles,
+                       std::vector<std::string>* batch) {
+    std::vector<RegManifestEntry> pending;
+    pending.swap(input.carried);
+    std::reverse(pending.begin(), pending.end());
+    std::vector<RegManifestEntry> files;
+    std::set<std::string> paths;
+    std::vector<std::string> expanded;
+    bool more = true;
+    while (files.size() < maxFiles) {
+        RegManifestEntry entry;
+        if (!pending.empty()) {
+            entry = pending.back();
+            pending.pop_back();
+        } else if (!input.reader.Next(&entry)) {
+            more = false;
             break;
         }
+        if (entry.priority != 0 && !input.usePriority && !input.priorityIgnored) {
+            WriteLogLevel(kRegLogWarning, "Warning: priority= is ignored for a manifest read from standard input "
+                                          "(line " + std::to_string(entry.line) + "), files are imported in line order");
+            input.priorityIgnored = true;
+        }
+        expanded.clear();
+        glob.Expand(entry.path, &expanded);
+        for (size_t i = 0; i < expanded.size(); i++) {
+            // 目标根键按文件路径记录，同一文件的另一个根键留到下一批
+            if (paths.count(expanded[i]) > 0) {
+                RegManifestEntry carried = entry;
+                carried.path = expanded[i];
+                input.carried.push_back(carried);
+                continue;
+            }
+            if (!MarkFileImported(expanded[i], entry.hive, imported)) {
+                WriteLog("Skipped duplicate file: " + expanded[i] + " (manifest line " +
+                         std::to_string(entry.line) + ")");
+                continue;
+            }
+            paths.insert(expanded[i]);
+            if (!entry.hive.empty()) {
+                g_hiveOverrides[expanded[i]] = entry.hive;
+            }
+            RegManifestEntry file = entry;
+            file.path = expanded[i];
+            files.push_back(file);
+        }
+    }
+    // 达到批大小时尚未处理的条目放在留到下一批的条目之前
+    input.carried.insert(input.carried.begin(), pending.rbegin(), pending.rend());
+    if (input.usePriority) {
+        std::stable_sort(files.begin(), files.end(), [](const RegManifestEntry& a, const RegManifestEntry& b) {
+            return a.priority < b.priority;
+        });
+    }
+    batch->clear();
+    for (size_t i = 0; i < files.size(); i++) {
+        batch->push_back(files[i].path);
+    }
+    return more || !input.carried.empty();
+}
 
-        if (result == ERROR_SUCCESS) {
-            std::string subKeyFullPath = subPath.empty() ? subKeyName : subPath + "\\" + subKeyName;
-            std::string subKeyFullPathWithRoot;
-            if (path.rfind("HKLM\\", 0) == 0) subKeyFullPathWithRoot = "HKLM\\" + subKeyFullPath;
-            else if (path.rfind("HKCU\\", 0) == 0) subKeyFullPathWithRoot = "HKCU\\" + subKeyFullPath;
-            else if (path.rfind("HKCR\\", 0) == 0) subKeyFullPathWithRoot = "HKCR\\" + subKeyFullPath;
-            else if (path.rfind("HKU\\", 0) == 0) subKeyFullPathWithRoot = "HKU\\" + subKeyFullPath;
-            else if (path.rfind("HKCC\\", 0) == 0) subKeyFullPathWithRoot = "HKCC\\" + subKeyFullPath;
-            else subKeyFullPathWithRoot = path + "\\" + subKeyName;
+// 打开清单并报告格式错误的行
+bool OpenManifest(const std::string& source, ManifestInput& input) {
+    std::string error;
+    if (!input.reader.Open(source, &error)) {
+        WriteLogLevel(kRegLogError, error);
+        return false;
+    }
+    input.reader.SetWarningSink([&source](size_t line, const std::string& message) {
+        WriteLogLevel(kRegLogWarning, "Warning: manifest " + source + " line " + std::to_string(line) + ": " +
+                                          message);
+    });
+    WriteLog("Reading manifest: " + (source == "-" ? std::string("standard input") : source));
+    return true;
+}
 
-            // 递归查询子键
-            QueryRegistry(subKeyFullPathWithRoot, indent + 1, false);
+// 清单文件中是否有非0的priority（只扫描行，不展开通配符；标准输入无法预先扫描，返回false）
+bool ManifestHasPriority(const std::string& source) {
+    RegManifestReader reader;
+    std::string error;
+    if (source == "-" || !reader.Open(source, &error)) {
+        return false;
+    }
+    RegManifestEntry entry;
+    while (reader.Next(&entry)) {
+        if (entry.priority != 0) {
+            return true;
         }
+    }
+    return false;
+}
 
-        subKeyIndex++;
+// 流式导入清单中的文件：边读边按批导入（第一批只有jobs个文件，之后逐批加倍，最多256个），
+// 内存占用与清单长度无关；返回成功数（含跳过的文件），total累加文件数。
+// priority在整个清单内生效：清单文件含非0优先级时整个读入一批再排序，结果与--jobs无关；
+// 标准输入无法预先扫描，忽略priority按行序导入
+int ImportManifest(const std::string& source, size_t jobs, RegGlob& glob, RegApplyCache& cache,
+                   ImportedFileSet& imported, size_t* total) {
+    ManifestInput input;
+    bool whole = ManifestHasPriority(source);
+    input.usePriority = source != "-";
+    if (!OpenManifest(source, input)) {
+        (*total)++;
+        return 0;
+    }
+    if (whole) {
+        WriteLog("Manifest uses priority=, reading all entries before importing");
     }
+    int successCount = 0;
+    size_t batchSize = whole ? static_cast<size_t>(-1) : std::max<size_t>(jobs, 1);
+    std::vector<std::string> batch;
+    bool more = true;
+    while (more) {
+        RegTraceSpan readSpan("phase", "ReadManifestBatch", source);
+        more = ReadManifestBatch(input, glob, imported, batchSize, &batch);
+        readSpan.End();
+        if (!batch.empty()) {
+            WriteLog("Manifest batch: " + std::to_string(batch.size()) + " files");
+            successCount += ImportRegFilesWithCache(batch, jobs, cache);
+            *total += batch.size();
+        }
+        g_hiveOverrides.clear();
+        if (!whole) {
+            batchSize = std::min<size_t>(batchSize * 2, 256);
+        }
+    }
+    WriteLog("Manifest finished: " + std::to_string(input.reader.GetEntryCount()) + " entries, " +
+             std::to_string(input.reader.GetInvalidCount()) + " invalid lines");
+    return successCount;
+}
 
-    RegCloseKey(hKey);
+// 读取清单中的全部文件（规划和编译需要完整的文件列表），追加到regFiles
+void ReadManifestFiles(const std::string& source, RegGlob& glob, ImportedFileSet& imported,
+                       std::vector<std::string>* regFiles) {
+    ManifestInput input;
+    if (!OpenManifest(source, input)) {
+        return;
+    }
+    std::vector<std::string> batch;
+    ReadManifestBatch(input, glob, imported, static_cast<size_t>(-1), &batch);
+    regFiles->insert(regFiles->end(), batch.begin(), batch.end());
+    // 一个计划中每个文件只能对应一个目标根键
+    for (size_t i = 0; i < input.carried.size(); i++) {
+        WriteLogLevel(kRegLogWarning, "Skipped file already planned for another hive: " + input.carried[i].path);
+    }
 }
 
-// 导出注册表路径到文件
-bool ExportRegistry(const std::string& regPath, const std::string& outputFile) {
-    WriteLog("Starting registry export: " + regPath);
-    std::string command = "reg export \"" + regPath + "\" \"" + outputFile + "\" /y";
-    WriteLog("Executing command: " + command);
+// 格式化监视统计
+std::string FormatWatchStats(const RegWatchStats& stats) {
+    char latency[64];
+    std::snprintf(latency, sizeof(latency), "%.0f ms avg, %.0f ms max", stats.AverageLatencyMs(),
+                  stats.maxLatencyMs);
+    return "Watch: " + std::to_string(stats.filesApplied) + " files applied, " + std::to_string(stats.filesFailed) +
+           " failed in " + std::to_string(stats.batches) + " batches, latency " + latency + ", queue depth " +
+           std::to_string(stats.queueDepth) + " (max " + std::to_string(stats.maxQueueDepth) + "), " +
+           std::to_string(stats.events) + " events, " + std::to_string(stats.rescans) + " rescans";
+}
 
-    STARTUPINFOA si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;
-    ZeroMemory(&pi, sizeof(pi));
+// 把目录中的候选文件加入队列
+void EnqueueWatchCandidates(const std::vector<std::string>& names, RegWatchTime now, RegWatchQueue* queue) {
+    for (size_t i = 0; i < names.size(); i++) {
+        if (IsRegWatchCandidate(names[i])) {
+            queue->Touch(names[i], now);
+        }
+    }
+}
 
-    bool success = false;
-    if (CreateProcessA(NULL, (LPSTR)command.c_str(), NULL, NULL, FALSE,
-                      CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-        WriteLog("Process created successfully, waiting for completion...");
-        WaitForSingleObject(pi.hProcess, INFINITE);
-        DWORD exitCode;
-        if (GetExitCodeProcess(pi.hProcess, &exitCode) && exitCode == 0) {
-            success = true;
-            WriteLog("Registry export successful to: " + outputFile);
-        } else {
-            WriteLog("Registry export failed, exit code: " + std::to_string(exitCode));
+// 常驻监视目录：新放入或修改的文件在静默满去抖间隔后分批导入（进程内，经导入状态缓存），
+// 目录中已有的文件在启动时处理一次；出错时返回false，否则一直运行到进程被终止
+bool WatchDirectory(const std::string& directory, size_t jobs) {
+    RegDirectoryWatcher watcher;
+    std::string error;
+    if (!watcher.Open(directory, &error)) {
+        WriteLogLevel(kRegLogError, "Watch failed: " + error);
+        return false;
+    }
+    WriteLog("Watching directory: " + directory + " (debounce " + std::to_string(g_debounceMs) + " ms)");
+
+    std::string statusPath = GetExeDirectory() + "\\reg_import_watch_status.txt";
+    std::chrono::milliseconds debounce(g_debounceMs);
+    RegWatchQueue queue(debounce);
+    RegWatchStats stats;
+    std::vector<std::string> names;
+    watcher.List(&names);
+    EnqueueWatchCandidates(names, std::chrono::steady_clock::now(), &queue);
+
+    std::vector<std::string> ready;
+    std::vector<RegWatchTime> firstSeen;
+    for (;;) {
+        std::chrono::milliseconds wait = queue.NextWait(std::chrono::steady_clock::now(), std::chrono::minutes(1));
+        names.clear();
+        bool overflow = false;
+        if (!watcher.Wait(static_cast<unsigned>(wait.count()), &names, &overflow)) {
+            WriteLogLevel(kRegLogError, "Watch failed: Cannot read directory changes: " + directory);
+            return false;
         }
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
-    } else {
-        WriteLog("Process creation failed, error code: " + std::to_string(GetLastError()));
+        RegWatchTime now = std::chrono::steady_clock::now();
+        stats.events += names.size();
+        EnqueueWatchCandidates(names, now, &queue);
+        if (overflow) {
+            // 通知丢失：重新扫描目录，未变化的文件由导入状态缓存跳过
+            WriteLogLevel(kRegLogWarning, "Watch: change notifications lost, rescanning " + directory);
+            stats.rescans++;
+            names.clear();
+            watcher.List(&names);
+            EnqueueWatchCandidates(names, now, &queue);
+        }
+        stats.UpdateQueueDepth(queue.Size());
+
+        ready.clear();
+        firstSeen.clear();
+        queue.TakeReady(now, &ready, &firstSeen);
+        if (ready.empty()) {
+            continue;
+        }
+        std::vector<std::string> regFiles;
+        for (size_t i = 0; i < ready.size(); i++) {
+            regFiles.push_back(directory + "\\" + ready[i]);
+        }
+        WriteLog("Watch: importing batch of " + std::to_string(regFiles.size()) + " files");
+        // 时间线只保留最近一批（第一批含启动阶段），内存和文件大小不随运行时间增长
+        if (g_tracer && stats.batches > 0) {
+            g_tracer->Reset();
+        }
+        RegTraceSpan batchSpan("phase", "WatchBatch");
+        int successCount = ImportRegFilesCached(regFiles, jobs);
+        batchSpan.End();
+        stats.AddBatch(static_cast<size_t>(successCount), regFiles.size() - static_cast<size_t>(successCount),
+                       firstSeen, std::chrono::steady_clock::now());
+        stats.UpdateQueueDepth(queue.Size());
+        std::string summary = FormatWatchStats(stats);
+        WriteLog(summary);
+        ReplaceFileContent(statusPath, summary + "\r\n");
+        WriteTraceFile();
     }
-    return success;
 }
 
-// 静默导入单个reg文件
-bool ImportRegFile(const std::string& regFilePath) {
-    WriteLog("Starting registry import: " + regFilePath);
-    std::string command = "reg import \"" + regFilePath + "\"";
-    WriteLog("Executing command: " + command);
-    
-    STARTUPINFOA si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;
-    ZeroMemory(&pi, sizeof(pi));
-    
-    bool success = false;
-    if (CreateProcessA(NULL, (LPSTR)command.c_str(), NULL, NULL, FALSE, 
-                      CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-        WriteLog("Process created successfully, waiting for completion...");
-        WaitForSingleObject(pi.hProcess, INFINITE);
-        DWORD exitCode;
-        if (GetExitCodeProcess(pi.hProcess, &exitCode) && exitCode == 0) {
-            success = true;
-            WriteLog("Registry import successful");
-        } else {
-            WriteLog("Registry import failed, exit code: " + std::to_string(exitCode));
-        }
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
-    } else {
-        WriteLog("Process creation failed, error code: " + std::to_string(GetLastError()));
+// 去除命令行中多余的空格
+void CollapseSpaces(std::string& cmdLine) {
+    while (cmdLine.find("  ") != std::string::npos) {
+        cmdLine.replace(cmdLine.find("  "), 2, " ");
+    }
+    if (!cmdLine.empty() && cmdLine[0] == ' ') {
+        cmdLine.erase(0, 1);
+    }
+    if (!cmdLine.empty() && cmdLine[cmdLine.length() - 1] == ' ') {
+        cmdLine.erase(cmdLine.length() - 1, 1);
     }
-    return success;
+}
+
+// 从pos开始读取一个选项值：以双引号开始的值到下一个双引号为止（可含空格，如--find的模式），
+// 否则到下一个空格为止；返回值结束的位置
+size_t ReadOptionToken(const std::string& cmdLine, size_t pos, std::string* value) {
+    while (pos < cmdLine.length() && cmdLine[pos] == ' ') {
+        pos++;
+    }
+    if (pos < cmdLine.length() && cmdLine[pos] == '"') {
+        size_t quoteEnd = cmdLine.find('"', pos + 1);
+        if (quoteEnd != std::string::npos) {
+            *value = cmdLine.substr(pos + 1, quoteEnd - pos - 1);
+            return quoteEnd + 1;
+        }
+    }
+    size_t end = cmdLine.find(' ', pos);
+    if (end == std::string::npos) {
+        end = cmdLine.length();
+    }
+    *value = cmdLine.substr(pos, end - pos);
+    return end;
+}
+
+// 提取并移除带一个值的命令行选项（如 --jobs 4）
+bool ExtractOptionValue(std::string& cmdLine, const std::string& option, std::string* value) {
+    size_t optionPos = cmdLine.find(option);
+    if (optionPos == std::string::npos) {
+        return false;
+    }
+    size_t valueEnd = ReadOptionToken(cmdLine, optionPos + option.length(), value);
+    cmdLine.erase(optionPos, valueEnd - optionPos);
+    CollapseSpaces(cmdLine);
+    return true;
+}
+
+// 提取并移除带多个值的命令行选项（如 --diff a.reg b.reg），遇到下一个选项或命令行结束时停止
+bool ExtractOptionValues(std::string& cmdLine, const std::string& option, size_t count,
+                         std::vector<std::string>* values) {
+    size_t optionPos = cmdLine.find(option);
+    if (optionPos == std::string::npos) {
+        return false;
+    }
+    size_t valuesEnd = optionPos + option.length();
+    while (values->size() < count) {
+        std::string value;
+        size_t end = ReadOptionToken(cmdLine, valuesEnd, &value);
+        if (value.empty() || value.compare(0, 2, "--") == 0) {
+            break;
+        }
+        values->push_back(value);
+        valuesEnd = end;
+    }
+    cmdLine.erase(optionPos, valuesEnd - optionPos);
+    CollapseSpaces(cmdLine);
+    return true;
+}
+
+// 提取并移除不带值的命令行开关（如 --plan）
+bool ExtractFlag(std::string& cmdLine, const std::string& flag) {
+    size_t flagPos = cmdLine.find(flag);
+    if (flagPos == std::string::npos) {
+        return false;
+    }
+    cmdLine.erase(flagPos, flag.length());
+    CollapseSpaces(cmdLine);
+    return true;
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
@@ -480,11 +1616,23 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         return 0;
     }
 
+    // 检查是否包含--trace参数（记录运行时间线），最先处理以包含参数解析阶段
+    TraceFileRAII traceFile;
+    if (ExtractOptionValue(cmdLine, "--trace", &g_traceFile)) {
+        g_tracer.reset(new RegTracer());
+        SetRegActiveTracer(g_tracer.get());
+        SetRegTraceThreadName("main");
+    }
+    RegTraceSpan parseSpan("phase", "ParseArguments");
+
+    // 检查是否包含--snapshot/--from参数（需在导出默认文件名生成之前处理）
+    g_snapshotMode = ExtractFlag(cmdLine, "--snapshot");
+    ExtractOptionValue(cmdLine, "--from", &g_snapshotSource);
+
     // 检查是否包含--query-registry参数（需要单独处理，因为后面有路径）
     size_t queryPos = cmdLine.find("--query-registry");
     if (queryPos != std::string::npos) {
         g_queryMode = true;
-        g_debugMode = true;  // 自动启用debug模式
 
         // 提取查询路径
         size_t pathStart = queryPos + 15; // "--query-registry" 的长度
@@ -570,14 +1718,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 
         // 生成默认文件名（如果未指定）
         if (g_exportFile.empty()) {
-            // 获取注册表路径的最后一部分作为文件名
-            size_t lastBackslash = g_exportPath.find_last_of("\\/");
+            // 获取（第一个）注册表路径的最后一部分作为文件名
+            std::string firstPath = g_exportPath.substr(0, g_exportPath.find(';'));
+            size_t lastBackslash = firstPath.find_last_of("\\/");
             std::string fileNameBase = (lastBackslash == std::string::npos) ?
-                g_exportPath : g_exportPath.substr(lastBackslash + 1);
+                firstPath : firstPath.substr(lastBackslash + 1);
             // 替换路径分隔符为下划线
             std::replace(fileNameBase.begin(), fileNameBase.end(), '\\', '_');
             std::replace(fileNameBase.begin(), fileNameBase.end(), '/', '_');
-            g_exportFile = fileNameBase + "_" + std::to_string(std::time(nullptr)) + ".reg";
+            g_exportFile = fileNameBase + "_" + std::to_string(std::time(nullptr)) + (g_snapshotMode ? ".regsnap" : ".reg");
         }
 
         WriteLog("=== Registry export mode enabled ===");
@@ -609,6 +1758,116 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         }
     }
 
+    // 检查是否包含--jobs参数（并行解析线程数）
+    std::string jobsValue;
+    if (ExtractOptionValue(cmdLine, "--jobs", &jobsValue)) {
+        g_jobs = static_cast<size_t>(std::strtoul(jobsValue.c_str(), NULL, 10));
+    }
+
+    // 检查是否包含--format/--output参数（查询输出格式和输出文件）
+    std::string formatValue;
+    if (ExtractOptionValue(cmdLine, "--format", &formatValue) && !ParseRegQueryFormat(formatValue, &g_queryFormat)) {
+        // 非交互运行时不显示需要按键关闭的帮助
+        if (!IsStdOutRedirected()) {
+            ShowHelp();
+        }
+        return 1;
+    }
+    ExtractOptionValue(cmdLine, "--output", &g_outputFile);
+    ExtractOptionValue(cmdLine, "--incremental", &g_indexFile);
+
+    // 检查是否包含--diff参数（比较两个来源，补丁写入--output）
+    std::vector<std::string> diffSources;
+    if (ExtractOptionValues(cmdLine, "--diff", 2, &diffSources)) {
+        if (diffSources.size() != 2) {
+            if (!IsStdOutRedirected()) {
+                ShowHelp();
+            }
+            return 1;
+        }
+        g_diffMode = true;
+        g_diffFrom = diffSources[0];
+        g_diffTo = diffSources[1];
+    }
+
+    // 检查是否包含--find参数（查询路径下查找），--find-in需在--find之前处理
+    std::string findScopeValue;
+    if (ExtractOptionValue(cmdLine, "--find-in", &findScopeValue) && !ParseRegFindScope(findScopeValue, &g_findScope)) {
+        if (!IsStdOutRedirected()) {
+            ShowHelp();
+        }
+        return 1;
+    }
+    bool findIgnoreCase = ExtractFlag(cmdLine, "--ignore-case");
+    bool findRegex = ExtractFlag(cmdLine, "--regex");
+    std::string findValue;
+    if (ExtractOptionValue(cmdLine, "--find", &findValue)) {
+        std::string error;
+        if (!g_findPattern.Compile(findValue, findIgnoreCase, findRegex, &error)) {
+            if (!IsStdOutRedirected()) {
+                ShowHelp();
+            }
+            return 1;
+        }
+        g_findMode = true;
+    }
+
+    // 检查是否包含--log-level参数（调试日志的最低级别）
+    std::string levelValue;
+    if (ExtractOptionValue(cmdLine, "--log-level", &levelValue)) {
+        RegLogLevel level;
+        if (ParseRegLogLevel(levelValue, &level)) {
+            g_logger.SetLevel(level);
+        }
+    }
+
+    // 检查是否包含--plan/--coalesce参数（写入合并规划）
+    g_planMode = ExtractFlag(cmdLine, "--plan");
+    g_coalesceMode = ExtractFlag(cmdLine, "--coalesce");
+    g_skipUnchanged = ExtractFlag(cmdLine, "--skip-unchanged");
+    g_force = ExtractFlag(cmdLine, "--force");
+
+    // 检查是否包含--compile参数（编译导入包）
+    ExtractOptionValue(cmdLine, "--compile", &g_compileFile);
+
+    // 检查是否包含--include-key/--exclude-key/--include-value/--exclude-value参数（查询和导出过滤，可多次指定），
+    // 需在--exclude之前处理
+    const char* filterOptions[] = {"--include-key", "--exclude-key", "--include-value", "--exclude-value"};
+    for (size_t i = 0; i < 4; i++) {
+        bool include = i % 2 == 0;
+        std::string patternValue;
+        while (ExtractOptionValue(cmdLine, filterOptions[i], &patternValue)) {
+            std::string error;
+            if (i >= 2) {
+                g_keyFilter.AddValuePattern(patternValue, include);
+            } else if (!g_keyFilter.AddKeyPattern(patternValue, include, &error)) {
+                if (!IsStdOutRedirected()) {
+                    ShowHelp();
+                }
+                return 1;
+            }
+        }
+    }
+
+    // 检查是否包含--exclude参数（可多次指定）
+    std::string excludeValue;
+    while (ExtractOptionValue(cmdLine, "--exclude", &excludeValue)) {
+        g_excludePatterns.push_back(excludeValue);
+    }
+
+    // 检查是否包含--manifest参数（可多次指定，- 表示标准输入）
+    std::string manifestValue;
+    while (ExtractOptionValue(cmdLine, "--manifest", &manifestValue)) {
+        g_manifests.push_back(manifestValue);
+    }
+
+    // 检查是否包含--watch/--debounce参数（常驻监视目录）
+    ExtractOptionValue(cmdLine, "--watch", &g_watchDirectory);
+    std::string debounceValue;
+    if (ExtractOptionValue(cmdLine, "--debounce", &debounceValue)) {
+        g_debounceMs = static_cast<unsigned>(std::strtoul(debounceValue.c_str(), NULL, 10));
+    }
+
     // 检查是否包含--debug参数（支持任意位置）
     size_t debugPos = cmdLine.find("--debug");
     if (debugPos != std::string::npos) {
@@ -644,14 +1903,21 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
                 if (std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &localTime) > 0) {
                     std::string logPath = std::string(exePath) + "\\reg_import_debug_" + std::string(timestamp) + ".log";
                     g_logFile.open(logPath, std::ios::app);
+                    StartLogWriter();
                     WriteLog("=== Program started, debug mode enabled ===");
                 }
             }
         }
     }
 
+    // 指定了输出文件或标准输出被重定向的查询为非交互运行：不打开控制台，不等待按键
+    bool nonInteractiveQuery = g_queryMode && (!g_outputFile.empty() || IsStdOutRedirected());
+    if (g_queryMode && !nonInteractiveQuery) {
+        g_debugMode = true;  // 交互查询自动启用debug模式
+    }
+
     // 如果启用了debug模式（无论通过哪种方式），初始化日志
-    if (g_debugMode && !g_logFile.is_open()) {
+    if (g_debugMode && !g_logEnabled.load(std::memory_order_acquire)) {
         char exePath[MAX_PATH];
         GetModuleFileNameA(NULL, exePath, MAX_PATH);
         char* lastSlash = strrchr(exePath, '\\');
@@ -668,14 +1934,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
             if (std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", &localTime) > 0) {
                 std::string logPath = std::string(exePath) + "\\reg_import_debug_" + std::string(timestamp) + ".log";
                 g_logFile.open(logPath, std::ios::app);
+                StartLogWriter();
                 WriteLog("=== Program started, debug mode enabled ===");
                 WriteLog("Version: " + std::string(VERSION_STRING));
             }
         }
     }
     
-    // 调试模式下显示控制台窗口
-    if (g_debugMode) {
+    // 调试模式下显示控制台窗口（非交互查询的标准输出保持重定向目标）
+    if (g_debugMode && !nonInteractiveQuery) {
         AllocConsole();
         FILE* pCout;
         freopen_s(&pCout, "CONOUT$", "w", stdout);
@@ -691,58 +1958,108 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     }
     
     WriteLog("Command line arguments: " + cmdLine);
+    if (g_tracer) {
+        WriteLog("Trace file: " + g_traceFile);
+    }
+    parseSpan.End();
     
+    size_t jobs = g_jobs == 0 ? RegDefaultJobCount() : g_jobs;
+
     // 解析命令行参数
+    RegGlob glob(jobs);
+    for (size_t i = 0; i < g_excludePatterns.size(); i++) {
+        glob.AddExclude(g_excludePatterns[i]);
+    }
+    ImportedFileSet importedFiles;
     if (!cmdLine.empty()) {
-        // 支持多个文件路径，用空格分隔
-        char* cmdLineCopy = _strdup(cmdLine.c_str());
-        char* token = strtok(cmdLineCopy, " ");
-        while (token != NULL) {
-            std::string pattern = token;
+        // 支持多个文件路径，用空格分隔（含空格的路径用双引号括起）
+        std::vector<std::string> args = RegSplitArguments(cmdLine);
+        for (size_t a = 0; a < args.size(); a++) {
+            const std::string& pattern = args[a];
             WriteLog("Processing argument: " + pattern);
             
-            // 如果包含通配符，查找匹配的文件
-            if (pattern.find('*') != std::string::npos || pattern.find('?') != std::string::npos) {
-                FindFiles(pattern, regFiles);
-                WriteLog("Wildcard match found " + std::to_string(regFiles.size()) + " files");
+            // @清单：文件列表从清单读取
+            if (pattern.length() > 1 && pattern[0] == '@') {
+                g_manifests.push_back(pattern.substr(1));
+            } else if (IsRegGlobPattern(pattern)) {
+                // 如果包含通配符（含递归的**），并行遍历目录查找匹配的文件
+                RegTraceSpan span("phase", "ExpandWildcard", pattern);
+                size_t before = regFiles.size();
+                glob.Expand(pattern, &regFiles);
+                WriteLog("Wildcard match found " + std::to_string(regFiles.size() - before) + " files");
+            } else if (glob.IsExcluded(pattern)) {
+                WriteLog("Excluded file: " + pattern);
             } else {
                 // 直接添加文件路径
                 regFiles.push_back(pattern);
                 WriteLog("Added file: " + pattern);
             }
-            token = strtok(NULL, " ");
         }
-        free(cmdLineCopy);
-    } else {
-        // 如果没有参数，使用默认的reg文件
-        char exePath[MAX_PATH];
-        GetModuleFileNameA(NULL, exePath, MAX_PATH);
-        
-        char* lastSlash = strrchr(exePath, '\\');
-        if (lastSlash != NULL) {
-            *lastSlash = '\0';
+
+        const RegGlobStats& globStats = glob.GetStats();
+        if (globStats.directories > 0) {
+            WriteLog("Wildcard expansion: " + std::to_string(globStats.matched) + " files matched, " +
+                     std::to_string(globStats.directories) + " directories and " +
+                     std::to_string(globStats.entries) + " entries scanned, " +
+                     std::to_string(globStats.excluded) + " excluded");
+        }
+        // 多个模式匹配到的同一文件只导入一次（保留第一次出现的位置）
+        size_t duplicates = RegRemoveDuplicatePaths(&regFiles, GetFullPathKey);
+        if (duplicates > 0) {
+            WriteLog("Removed " + std::to_string(duplicates) + " duplicate files");
+        }
+        for (size_t i = 0; i < regFiles.size(); i++) {
+            MarkFileImported(regFiles[i], std::string(), importedFiles);
         }
-        
-        std::string defaultRegPath = std::string(exePath) + "\\disable_local_network_access.reg";
+    } else if (g_manifests.empty()) {
+        // 如果没有参数，优先使用默认的导入包，不存在时使用默认的reg文件
+        std::string defaultBase = GetExeDirectory() + "\\disable_local_network_access";
+        RegApplyCacheEntry stamp;
+        std::string defaultRegPath = (g_compileFile.empty() && GetFileStamp(defaultBase + ".regpack", &stamp))
+                                         ? defaultBase + ".regpack"
+                                         : defaultBase + ".reg";
         regFiles.push_back(defaultRegPath);
         WriteLog("Using default file: " + defaultRegPath);
     }
     
-    WriteLog("Total files to import: " + std::to_string(regFiles.size()));
+    // 规划和编译需要完整的文件列表，先读入清单中的全部文件
+    if (!g_manifests.empty() && (g_planMode || !g_compileFile.empty())) {
+        for (size_t i = 0; i < g_manifests.size(); i++) {
+            ReadManifestFiles(g_manifests[i], glob, importedFiles, &regFiles);
+        }
+        g_manifests.clear();
+    }
+
+    WriteLog("Total files to import: " + std::to_string(regFiles.size()) +
+             (g_manifests.empty() ? "" : " (plus files from " + std::to_string(g_manifests.size()) + " manifests)"));
+
+    // 如果是差异模式，比较两个来源并写出补丁
+    if (g_diffMode) {
+        std::string patchFile = g_outputFile.empty() ? "diff_" + std::to_string(std::time(nullptr)) + ".reg"
+                                                     : g_outputFile;
+        bool diffSuccess = DiffSources(g_diffFrom, g_diffTo, patchFile, jobs);
+
+        WriteLog("Registry diff completed: " + std::string(diffSuccess ? "success" : "failed"));
+        WriteLog("=== Program finished ===");
+        CloseLog();
+
+        return diffSuccess ? 0 : 1;
+    }
 
     // 如果是导出模式，执行注册表导出
     if (g_exportMode) {
         WriteLog("Executing registry export...");
 
-        // 确保输出文件有.reg扩展名
-        if (g_exportFile.rfind(".reg", 4) != g_exportFile.length() - 4) {
+        // 确保输出文件有.reg扩展名（快照文件按内容识别，保留指定的文件名）
+        if (!g_snapshotMode && g_exportFile.rfind(".reg", 4) != g_exportFile.length() - 4) {
             g_exportFile += ".reg";
         }
 
-        bool exportSuccess = ExportRegistry(g_exportPath, g_exportFile);
+        bool exportSuccess = ExportRegistry(SplitRegPathList(g_exportPath), g_exportFile, jobs);
 
         WriteLog("Registry export completed: " + std::string(exportSuccess ? "success" : "failed"));
         WriteLog("=== Program finished ===");
+        CloseLog();
 
         return exportSuccess ? 0 : 1;
     }
@@ -751,6 +2068,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     if (g_queryMode) {
         WriteLog("Executing registry query...");
 
+        if (nonInteractiveQuery) {
+            bool querySuccess = QueryRegistryToOutput(SplitRegPathList(g_queryPath), jobs);
+            WriteLog("Registry query completed: " + std::string(querySuccess ? "success" : "failed"));
+            WriteLog("=== Program finished ===");
+            CloseLog();
+            return querySuccess ? 0 : 1;
+        }
+
         // 打开控制台显示查询结果
         AllocConsole();
         FILE* pCout;
@@ -758,9 +2083,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         SetConsoleOutputCP(65001);
         std::cout << "=== Silent Registry Import Tool v" VERSION_STRING " - Registry Query Mode ===" << std::endl;
         std::cout << "Query Path: " << g_queryPath << std::endl;
+        if (!g_snapshotSource.empty()) {
+            std::cout << "Snapshot: " << g_snapshotSource << std::endl;
+        }
         std::cout << std::endl;
 
-        QueryRegistry(g_queryPath);
+        QueryRegistry(SplitRegPathList(g_queryPath), jobs, std::cout, g_queryFormat);
 
         WriteLog("Registry query completed");
         WriteLog("=== Program finished ===");
@@ -770,21 +2098,76 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         system("pause > nul");
         FreeConsole();
 
-        if (g_logFile.is_open()) {
-            g_logFile.close();
-        }
+        CloseLog();
         return 0;
     }
 
-    // 导入所有找到的reg文件
+    // 如果是监视模式，常驻导入放入目录的文件
+    if (!g_watchDirectory.empty()) {
+        bool watchSuccess = WatchDirectory(g_watchDirectory, jobs);
+        WriteLog("=== Program finished ===");
+        CloseLog();
+        return watchSuccess ? 0 : 1;
+    }
+
+    // 如果是编译模式，把所有文件编译为一个导入包
+    if (!g_compileFile.empty()) {
+        bool compileSuccess = CompileRegFiles(regFiles, g_compileFile, jobs);
+        WriteLog("Compile completed: " + std::string(compileSuccess ? "success" : "failed"));
+        WriteLog("=== Program finished ===");
+        CloseLog();
+        return compileSuccess ? 0 : 1;
+    }
+
+    // 如果是规划模式，只打印合并后的写入计划
+    if (g_planMode) {
+        WriteLog("Building write plan...");
+        RegWritePlanner planner;
+        std::vector<bool> parsedFiles;
+        int parsedCount = BuildWritePlan(regFiles, jobs, &planner, &parsedFiles);
+        std::vector<RegOp> ops;
+        std::vector<size_t> sources;
+        planner.Build(&ops, &sources);
+        WriteLog(FormatPlanStats(planner.GetStats()));
+
+        AllocConsole();
+        FILE* pCout;
+        freopen_s(&pCout, "CONOUT$", "w", stdout);
+        SetConsoleOutputCP(65001);
+        std::cout << "=== Silent Registry Import Tool v" VERSION_STRING " - Write Plan ===" << std::endl;
+        std::cout << "Files parsed: " << parsedCount << " of " << regFiles.size() << std::endl;
+        PrintWritePlan(ops, planner.GetStats());
+
+        WriteLog("=== Program finished ===");
+        std::cout << "Press any key to exit..." << std::endl;
+        system("pause > nul");
+        FreeConsole();
+
+        CloseLog();
+        return parsedCount == static_cast<int>(regFiles.size()) ? 0 : 1;
+    }
+
+    // 导入所有找到的reg文件（跳过未变化的文件），清单中的文件边读边导入
     int successCount = 0;
-    for (const auto& regFile : regFiles) {
-        if (ImportRegFile(regFile)) {
-            successCount++;
+    size_t totalCount = regFiles.size();
+    if (g_manifests.empty()) {
+        successCount = ImportRegFilesCached(regFiles, jobs);
+    } else {
+        std::string cachePath = GetApplyCachePath();
+        RegApplyCache cache;
+        LoadApplyCache(cache, cachePath);
+        if (!regFiles.empty()) {
+            successCount = ImportRegFilesWithCache(regFiles, jobs, cache);
+        }
+        for (size_t i = 0; i < g_manifests.size(); i++) {
+            successCount += ImportManifest(g_manifests[i], jobs, glob, cache, importedFiles, &totalCount);
+        }
+        if (cache.IsDirty()) {
+            SaveApplyCache(cache, cachePath);
         }
     }
 
-    WriteLog("Import completed, success: " + std::to_string(successCount) + ", failed: " + std::to_string(regFiles.size() - static_cast<size_t>(successCount)));
+    WriteLog("Import completed, success: " + std::to_string(successCount) + ", failed: " + std::to_string(totalCount - static_cast<size_t>(successCount)));
     WriteLog("=== Program finished ===");
 
     // 调试模式下等待用户按键
@@ -794,10 +2177,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
         FreeConsole();
     }
     
-    // 关闭日志文件
-    if (g_logFile.is_open()) {
-        g_logFile.close();
-    }
+    // 写出剩余日志并关闭日志文件
+    CloseLog();
     
     return (successCount > 0) ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,568 @@
+/*
+ * 静默注册表导入程序 - 增量查询索引
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 定期查询同一子树时只输出自上次查询以来变化的键和值：
+ * - 索引记录每个键的路径、最后写入时间、子键数、值数和内容哈希，以及每个值的名称和数据哈希
+ * - 注册表只在键自身的值或直接子键变化时更新该键的最后写入时间，不向上级传播，
+ *   因此每个键仍打开一次并查询键信息；最后写入时间和计数都与索引一致的键不枚举值，
+ *   子键名直接取自索引，也不枚举子键
+ * - 其余的键逐个值计算哈希并与索引比较：新键（[+]）输出全部值，变化的键（[*]）
+ *   只输出新增（+）、修改（*）和删除（-）的值；索引中有而本次未访问到的键在最后输出为已删除（[-]，只列出子树的根）
+ * - 后端不提供最后写入时间（如快照）时每个键都按内容比较
+ * - 新索引按先序边遍历边生成，由调用方在查询成功后替换旧索引；索引只对应最近一次查询的路径
+ * - 无法打开的键（如权限不足）及其在索引中的子树沿用上次的索引行，不报告为删除
+ * 索引为文本文件，每个键一行（K 内容哈希 最后写入时间 子键数 值数 路径），其后每个值一行（V 数据哈希 值名），
+ * 路径和值名中的%、CR和LF按%XX转义
+ * 平台无关：最后写入时间由后端提供（内存配置单元使用合成时钟）
+ */
+
+#ifndef REG_INDEX_H
+#define REG_INDEX_H
+
+#include "reg_backend.h"
+#include "reg_hash.h"
+#include "reg_hex.h"
+#include "reg_query.h"
+#include "reg_traverse.h"
+#include "reg_types.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 索引文件首行，格式变化时递增版本号，旧索引整体失效（下次查询按全部新增输出）
+static const char* const kRegQueryIndexHeader = "reg_import_silent query index v1";
+
+// 索引中不存在的键
+const size_t kRegIndexNone = static_cast<size_t>(-1);
+
+// 索引中的值
+struct RegIndexValue {
+    std::string name;
+    uint64_t hash;      // 类型和数据的哈希
+
+    RegIndexValue() : hash(0) {}
+};
+
+// 索引中的键
+struct RegIndexKey {
+    std::string path;
+    uint64_t hash;                          // 各值名称和数据哈希的哈希
+    uint64_t lastWriteTime;
+    uint32_t subKeyCount;
+    uint32_t valueCount;
+    std::vector<RegIndexValue> values;      // 按索引中的顺序（即上次的枚举顺序）
+    std::vector<uint32_t> sortedValues;     // values按名称排序（不区分大小写）后的下标
+    std::vector<std::string> children;      // 子键名（按索引中的顺序，即上次的枚举顺序）
+    size_t parent;                          // 上级键的序号，不在索引中时为kRegIndexNone
+    bool seen;                              // 本次查询是否访问到（只在调用线程中读写）
+
+    RegIndexKey() : hash(0), lastWriteTime(0), subKeyCount(0), valueCount(0), parent(kRegIndexNone), seen(false) {}
+};
+
+// 按%XX转义%、CR和LF后追加到out
+inline void AppendRegIndexEscaped(const std::string& text, std::string* out) {
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c == '%' || c == '\r' || c == '\n') {
+            char escaped[4];
+            std::snprintf(escaped, sizeof(escaped), "%%%02X", static_cast<unsigned char>(c));
+            out->append(escaped, 3);
+        } else {
+            out->push_back(c);
+        }
+    }
+}
+
+inline std::string RegIndexUnescape(const char* text, size_t length) {
+    std::string result;
+    result.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '%' && i + 2 < length && RegHexNibble(text[i + 1]) >= 0 && RegHexNibble(text[i + 2]) >= 0) {
+            result.push_back(static_cast<char>(RegHexNibble(text[i + 1]) << 4 | RegHexNibble(text[i + 2])));
+            i += 2;
+        } else {
+            result.push_back(text[i]);
+        }
+    }
+    return result;
+}
+
+// 值的类型和数据的哈希
+inline uint64_t RegIndexValueHash(uint32_t type, const uint8_t* data, size_t size) {
+    uint8_t typeBytes[4] = {static_cast<uint8_t>(type), static_cast<uint8_t>(type >> 8),
+                            static_cast<uint8_t>(type >> 16), static_cast<uint8_t>(type >> 24)};
+    RegHash64 hash;
+    hash.Update(typeBytes, sizeof(typeBytes));
+    hash.Update(data, size);
+    return hash.Digest();
+}
+
+// 上次查询的索引（加载后只读，可在多个遍历线程中同时查找）
+class RegQueryIndex {
+public:
+    // 加载索引文件；文件不存在或版本不符时得到空索引，格式错误的行被忽略
+    void Load(const std::string& path) {
+        std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+        Load(file);
+    }
+
+    void Load(std::istream& in) {
+        m_keys.clear();
+        m_lookup.clear();
+        std::ostringstream content;
+        content << in.rdbuf();
+        const std::string text = content.str();
+        const char* p = text.c_str();
+        const char* end = p + text.size();
+        size_t headerLength = std::strlen(kRegQueryIndexHeader);
+        if (text.compare(0, headerLength, kRegQueryIndexHeader) != 0 ||
+            (p + headerLength != end && p[headerLength] != '\r' && p[headerLength] != '\n')) {
+            return;
+        }
+        std::string folded;
+        bool current = false;       // 最近一个K行是否有效（重复的键忽略其值行）
+        for (const char* line = p + headerLength; line < end; ) {
+            const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+            lineEnd = lineEnd == NULL ? end : lineEnd;
+            const char* next = lineEnd == end ? end : lineEnd + 1;
+            if (lineEnd > line && lineEnd[-1] == '\r') {
+                lineEnd--;
+            }
+            ParseLine(line, lineEnd, &current, &folded);
+            line = next;
+        }
+
+        // 按名称排序值的下标以便二分查找；子键名由路径推出
+        for (size_t i = 0; i < m_keys.size(); i++) {
+            RegIndexKey& key = m_keys[i];
+            key.sortedValues.resize(key.values.size());
+            for (size_t v = 0; v < key.values.size(); v++) {
+                key.sortedValues[v] = static_cast<uint32_t>(v);
+            }
+            const std::vector<RegIndexValue>& values = key.values;
+            std::sort(key.sortedValues.begin(), key.sortedValues.end(), [&values](uint32_t a, uint32_t b) {
+                return RegCompareIgnoreCase(values[a].name.data(), values[a].name.size(), values[b].name.data(),
+                                            values[b].name.size()) < 0;
+            });
+            size_t slash = key.path.rfind('\\');
+            if (slash == std::string::npos) {
+                continue;
+            }
+            folded.assign(key.path, 0, slash);
+            key.parent = FindFolded(&folded);
+            if (key.parent != kRegIndexNone) {
+                m_keys[key.parent].children.push_back(key.path.substr(slash + 1));
+            }
+        }
+    }
+
+    // 按路径查找（不区分大小写），返回序号或kRegIndexNone；scratch为调用方的临时缓冲区
+    size_t Find(const std::string& path, std::string* scratch) const {
+        scratch->assign(path);
+        return FindFolded(scratch);
+    }
+
+    size_t GetKeyCount() const { return m_keys.size(); }
+    const RegIndexKey& GetKey(size_t index) const { return m_keys[index]; }
+    RegIndexKey& GetKey(size_t index) { return m_keys[index]; }
+
+    // 在键的值中按名称查找（不区分大小写），返回在values中的下标或kRegIndexNone
+    static size_t FindValue(const RegIndexKey& key, const std::string& name) {
+        size_t first = 0;
+        size_t count = key.sortedValues.size();
+        while (count > 0) {
+            size_t step = count / 2;
+            const std::string& probe = key.values[key.sortedValues[first + step]].name;
+            if (RegCompareIgnoreCase(probe.data(), probe.size(), name.data(), name.size()) < 0) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        if (first < key.sortedValues.size()) {
+            const std::string& found = key.values[key.sortedValues[first]].name;
+            if (RegEqualsIgnoreCase(found.data(), found.size(), name.data(), name.size())) {
+                return key.sortedValues[first];
+            }
+        }
+        return kRegIndexNone;
+    }
+
+    // 索引文件的键行和值行
+    static void AppendKeyLine(const std::string& path, uint64_t hash, uint64_t lastWriteTime, uint32_t subKeyCount,
+                              uint32_t valueCount, std::string* out) {
+        char prefix[80];
+        std::snprintf(prefix, sizeof(prefix), "K %016llx %llu %u %u ", static_cast<unsigned long long>(hash),
+                      static_cast<unsigned long long>(lastWriteTime), subKeyCount, valueCount);
+        out->append(prefix);
+        AppendRegIndexEscaped(path, out);
+        out->append("\r\n");
+    }
+
+    static void AppendValueLine(const std::string& name, uint64_t hash, std::string* out) {
+        char prefix[24];
+        std::snprintf(prefix, sizeof(prefix), "V %016llx ", static_cast<unsigned long long>(hash));
+        out->append(prefix);
+        AppendRegIndexEscaped(name, out);
+        out->append("\r\n");
+    }
+
+    // 原样写出未变化的键（路径使用本次遍历的写法）
+    static void AppendKey(const RegIndexKey& key, const std::string& path, std::string* out) {
+        AppendKeyLine(path, key.hash, key.lastWriteTime, key.subKeyCount, key.valueCount, out);
+        for (size_t i = 0; i < key.values.size(); i++) {
+            AppendValueLine(key.values[i].name, key.values[i].hash, out);
+        }
+    }
+
+private:
+    // 把key转为大写后查找
+    size_t FindFolded(std::string* key) const {
+        for (size_t i = 0; i < key->size(); i++) {
+            (*key)[i] = RegAsciiUpper((*key)[i]);
+        }
+        std::unordered_map<std::string, size_t>::const_iterator it = m_lookup.find(*key);
+        return it == m_lookup.end() ? kRegIndexNone : it->second;
+    }
+
+    // 解析一行（不含行尾），K行有效时加入新键并设置current，V行在current时加入最近的键；格式错误的行忽略
+    void ParseLine(const char* p, const char* end, bool* current, std::string* folded) {
+        if (end - p < 2 || p[1] != ' ' || (p[0] != 'K' && p[0] != 'V')) {
+            return;
+        }
+        bool keyLine = p[0] == 'K';
+        uint64_t hash = 0;
+        p += 2;
+        if (!ParseNumber(&p, end, 16, &hash)) {
+            *current = *current && !keyLine;
+            return;
+        }
+        if (!keyLine) {
+            if (*current) {
+                RegIndexValue value;
+                value.hash = hash;
+                value.name = RegIndexUnescape(p, static_cast<size_t>(end - p));
+                m_keys.back().values.push_back(value);
+            }
+            return;
+        }
+        *current = false;
+        RegIndexKey key;
+        key.hash = hash;
+        uint64_t subKeyCount = 0;
+        uint64_t valueCount = 0;
+        if (!ParseNumber(&p, end, 10, &key.lastWriteTime) || !ParseNumber(&p, end, 10, &subKeyCount) ||
+            !ParseNumber(&p, end, 10, &valueCount) || p == end) {
+            return;
+        }
+        key.subKeyCount = static_cast<uint32_t>(subKeyCount);
+        key.valueCount = static_cast<uint32_t>(valueCount);
+        key.path = RegIndexUnescape(p, static_cast<size_t>(end - p));
+        folded->assign(key.path);
+        for (size_t i = 0; i < folded->size(); i++) {
+            (*folded)[i] = RegAsciiUpper((*folded)[i]);
+        }
+        if (!m_lookup.insert(std::make_pair(*folded, m_keys.size())).second) {
+            return;
+        }
+        m_keys.push_back(std::move(key));
+        *current = true;
+    }
+
+    // 解析*p处的一个数字，之后须为空格，成功时*p移到空格之后
+    static bool ParseNumber(const char** p, const char* end, int base, uint64_t* value) {
+        const char* q = *p;
+        *value = 0;
+        const char* start = q;
+        for (; q < end && *q != ' '; q++) {
+            int digit = base == 16 ? RegHexNibble(*q) : (*q >= '0' && *q <= '9' ? *q - '0' : -1);
+            if (digit < 0) {
+                return false;
+            }
+            *value = *value * static_cast<uint64_t>(base) + static_cast<uint64_t>(digit);
+        }
+        if (q == start || q == end) {
+            return false;
+        }
+        *p = q + 1;
+        return true;
+    }
+
+    std::vector<RegIndexKey> m_keys;                    // 按索引文件中的顺序（先序）
+    std::unordered_map<std::string, size_t> m_lookup;   // 大写路径 -> 序号
+};
+
+// 键相对于索引的变化
+enum RegKeyChange {
+    kRegKeyUnchanged,   // 最后写入时间和计数一致，未枚举
+    kRegKeyAdded,
+    kRegKeyModified     // 已枚举比较（值可能并无变化，如只是子键增减）
+};
+
+// 增量查询统计
+struct RegIncrementalStats {
+    size_t keys;
+    size_t unchangedKeys;       // 未枚举值和子键的键
+    size_t addedKeys;
+    size_t modifiedKeys;        // 有值变化的键
+    size_t deletedKeys;         // 含已删除子树中的所有键
+    size_t addedValues;
+    size_t modifiedValues;
+    size_t deletedValues;
+
+    RegIncrementalStats()
+        : keys(0), unchangedKeys(0), addedKeys(0), modifiedKeys(0), deletedKeys(0), addedValues(0),
+          modifiedValues(0), deletedValues(0) {}
+};
+
+// 增量查询：遍历（可并行）子树，对照索引只输出变化，并生成新索引
+class RegIncrementalQuery : public RegTraversalVisitor {
+public:
+    RegIncrementalQuery(RegBackend& backend, RegQueryIndex& index, std::ostream& out, size_t jobs = 1)
+        : m_backend(backend), m_index(index), m_out(out), m_jobs(jobs) {}
+
+    void SetLogSink(const RegLogSink& sink) { m_log = sink; }
+
+    // 依次查询各路径并输出变化，newIndex得到本次查询的索引内容；任一路径无效或无法打开时返回false
+    bool Query(const std::vector<std::string>& paths, std::string* newIndex) {
+        bool success = true;
+        std::vector<std::string> roots;
+        for (size_t i = 0; i < paths.size(); i++) {
+            std::string path;
+            if (!NormalizeRegKeyPath(paths[i], &path)) {
+                Log("Error: Invalid registry path format: " + paths[i]);
+                success = false;
+                continue;
+            }
+            while (path.length() > 1 && path[path.length() - 1] == '\\') {
+                path.erase(path.length() - 1);
+            }
+            roots.push_back(path);
+        }
+
+        newIndex->assign(kRegQueryIndexHeader);
+        newIndex->append("\r\n");
+        RegTraversal traversal(m_backend, *this, m_jobs);
+        traversal.Run(roots, [this, &success, newIndex](const std::string& path, int depth, RegTraversalOutput& output) {
+            size_t start = 0;
+            for (size_t i = 0; i < output.logEnds.size(); i++) {
+                Log(output.logs.substr(start, output.logEnds[i] - start));
+                start = output.logEnds[i];
+            }
+            if (!output.opened) {
+                success = success && depth != 0;
+                KeepUnopened(path, newIndex);
+                return;
+            }
+            Record record;
+            std::memcpy(&record, output.data.data(), sizeof(record));
+            if (record.oldKey != kRegIndexNone) {
+                m_index.GetKey(static_cast<size_t>(record.oldKey)).seen = true;
+            }
+            const char* text = reinterpret_cast<const char*>(output.data.data()) + sizeof(record);
+            size_t displayLength = output.data.size() - sizeof(record) - static_cast<size_t>(record.indexLength);
+            m_out.write(text, static_cast<std::streamsize>(displayLength));
+            newIndex->append(text + displayLength, static_cast<size_t>(record.indexLength));
+
+            m_stats.keys++;
+            m_stats.unchangedKeys += record.change == kRegKeyUnchanged ? 1 : 0;
+            m_stats.addedKeys += record.change == kRegKeyAdded ? 1 : 0;
+            bool valuesChanged = record.addedValues + record.modifiedValues + record.deletedValues > 0;
+            m_stats.modifiedKeys += (record.change == kRegKeyModified && valuesChanged) ? 1 : 0;
+            m_stats.addedValues += record.addedValues;
+            m_stats.modifiedValues += record.modifiedValues;
+            m_stats.deletedValues += record.deletedValues;
+        });
+
+        // 索引中位于查询路径之下、本次未访问到的键已被删除，只输出每个被删除子树的根
+        for (size_t i = 0; i < m_index.GetKeyCount(); i++) {
+            const RegIndexKey& key = m_index.GetKey(i);
+            if (key.seen || !WithinRoots(key.path, roots)) {
+                continue;
+            }
+            m_stats.deletedKeys++;
+            if (key.parent == kRegIndexNone || m_index.GetKey(key.parent).seen ||
+                !WithinRoots(m_index.GetKey(key.parent).path, roots)) {
+                m_out << "[-] " << key.path << "\n";
+            }
+        }
+        m_out.flush();
+        return success;
+    }
+
+    const RegIncrementalStats& GetStats() const { return m_stats; }
+
+    bool VisitKey(RegBackend& backend, RegKeyHandle key, const std::string& path, int,
+                  RegTraversalContext& context, RegTraversalOutput* out) override {
+        Record record;
+        size_t oldKey = m_index.Find(path, &context.decoded);
+        const RegIndexKey* old = oldKey == kRegIndexNone ? NULL : &m_index.GetKey(oldKey);
+        const RegKeyInfo& info = context.info;
+        record.oldKey = oldKey;
+        out->data.resize(sizeof(record));
+
+        // 最后写入时间和计数一致：值和子键都未变化，子键名取自索引
+        if (old != NULL && info.lastWriteTime != 0 && info.lastWriteTime == old->lastWriteTime &&
+            info.subKeyCount == old->subKeyCount && info.valueCount == old->valueCount) {
+            record.change = kRegKeyUnchanged;
+            context.text.clear();
+            RegQueryIndex::AppendKey(*old, path, &context.text);
+            Finish(&record, std::string(), context.text, out);
+            context.knownSubKeys = &old->children;
+            return true;
+        }
+
+        // 逐个值计算哈希并与索引比较；输出写入text，值行写入decoded，键行在全部值之后才能确定哈希
+        record.change = old == NULL ? kRegKeyAdded : kRegKeyModified;
+        std::string& text = context.text;
+        std::string& valueLines = context.decoded;
+        text.clear();
+        valueLines.clear();
+        std::vector<bool> matched(old == NULL ? 0 : old->values.size(), false);
+        RegHash64 keyHash;
+        for (uint32_t index = 0; ; index++) {
+            long result = backend.EnumValue(key, index, &context.name, &context.type, &context.data);
+            if (result == kRegErrorNoMoreItems) {
+                break;
+            }
+            if (result != kRegSuccess) {
+                continue;
+            }
+            uint64_t hash = RegIndexValueHash(context.type, context.data.data(), context.data.size());
+            keyHash.Update(context.name.data(), context.name.size() + 1);
+            keyHash.Update(&hash, sizeof(hash));
+            RegQueryIndex::AppendValueLine(context.name, hash, &valueLines);
+
+            size_t previous = old == NULL ? kRegIndexNone : RegQueryIndex::FindValue(*old, context.name);
+            if (previous != kRegIndexNone) {
+                matched[previous] = true;
+                if (old->values[previous].hash == hash) {
+                    continue;
+                }
+            }
+            BeginKey(path, record, &text);
+            text.append(previous == kRegIndexNone ? "  + \"" : "  * \"").append(context.name).append("\" = ");
+            AppendRegValueData(context.type, context.data.data(), context.data.size(), &text);
+            text.append(" (").append(GetRegTypeName(context.type)).append(")\n");
+            (previous == kRegIndexNone ? record.addedValues : record.modifiedValues)++;
+        }
+        for (size_t i = 0; i < matched.size(); i++) {
+            if (!matched[i]) {
+                BeginKey(path, record, &text);
+                text.append("  - \"").append(old->values[i].name).append("\"\n");
+                record.deletedValues++;
+            }
+        }
+        // 新键即使没有值也输出
+        if (record.change == kRegKeyAdded) {
+            BeginKey(path, record, &text);
+        }
+
+        std::string keyLine;
+        RegQueryIndex::AppendKeyLine(path, keyHash.Digest(), info.lastWriteTime, info.subKeyCount, info.valueCount,
+                                     &keyLine);
+        keyLine.append(valueLines);
+        Finish(&record, text, keyLine, out);
+        return true;
+    }
+
+    void VisitError(const std::string& path, int, long result, RegTraversalOutput* out) override {
+        out->logs.append("Error: Failed to open registry key: ").append(path);
+        out->logs.append(" (Error code: ").append(std::to_string(result)).append(")");
+        out->EndLog();
+    }
+
+private:
+    // 每个键的输出开头的记录头，其后依次为输出文本和索引文本
+    struct Record {
+        uint64_t oldKey;            // 索引中的序号
+        uint64_t indexLength;       // 索引文本的字节数
+        uint32_t change;
+        uint32_t addedValues;
+        uint32_t modifiedValues;
+        uint32_t deletedValues;
+        bool shown;                 // 键行是否已输出
+
+        Record()
+            : oldKey(kRegIndexNone), indexLength(0), change(kRegKeyUnchanged), addedValues(0), modifiedValues(0),
+              deletedValues(0), shown(false) {}
+    };
+
+    // 无法打开的键：索引中的该键及其子树保持上次的状态（不报告为删除，新索引沿用旧行）
+    void KeepUnopened(const std::string& path, std::string* newIndex) {
+        std::string scratch;
+        std::vector<size_t> pending(1, m_index.Find(path, &scratch));
+        while (!pending.empty()) {
+            size_t index = pending.back();
+            pending.pop_back();
+            if (index == kRegIndexNone || m_index.GetKey(index).seen) {
+                continue;
+            }
+            RegIndexKey& key = m_index.GetKey(index);
+            key.seen = true;
+            RegQueryIndex::AppendKey(key, key.path, newIndex);
+            // 逆序压栈，使新索引中的子键保持先序和上次的顺序
+            for (size_t i = key.children.size(); i > 0; i--) {
+                pending.push_back(m_index.Find(key.path + "\\" + key.children[i - 1], &scratch));
+            }
+        }
+    }
+
+    // 第一次有变化时输出键行
+    static void BeginKey(const std::string& path, Record& record, std::string* text) {
+        if (record.shown) {
+            return;
+        }
+        std::string line = (record.change == kRegKeyAdded ? "[+] " : "[*] ") + path + "\n";
+        text->insert(0, line);
+        record.shown = true;
+    }
+
+    static void Finish(Record* record, const std::string& text, const std::string& index, RegTraversalOutput* out) {
+        record->indexLength = index.size();
+        out->data.resize(sizeof(*record));
+        std::memcpy(out->data.data(), record, sizeof(*record));
+        out->data.insert(out->data.end(), text.begin(), text.end());
+        out->data.insert(out->data.end(), index.begin(), index.end());
+    }
+
+    // path是否等于某个查询路径或位于其下（不区分大小写）
+    static bool WithinRoots(const std::string& path, const std::vector<std::string>& roots) {
+        for (size_t i = 0; i < roots.size(); i++) {
+            const std::string& root = roots[i];
+            if (path.size() >= root.size() && RegEqualsIgnoreCase(path.data(), root.size(), root.data(), root.size()) &&
+                (path.size() == root.size() || path[root.size()] == '\\')) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Log(const std::string& message) {
+        if (m_log) {
+            m_log(message);
+        }
+    }
+
+    RegBackend& m_backend;
+    RegQueryIndex& m_index;
+    std::ostream& m_out;
+    size_t m_jobs;
+    RegIncrementalStats m_stats;
+    RegLogSink m_log;
+};
+
+#endif // REG_INDEX_H
@@ -0,0 +1,213 @@
+/*
+ * 静默注册表导入程序 - 键路径和值名过滤
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 查询和导出时按通配符选择键和值，遍历时剪掉不可能匹配的子树：
+ * - 键模式匹配相对于查询/导出根路径的路径，每一级支持*和?，单独一级的**匹配零到多级；
+ *   不含'\'的模式匹配任意一级的键名（等同于**\模式），以'\'开头的模式从根路径下一级开始匹配
+ * - 包含模式（--include-key）：只输出路径匹配的键（要输出整个子树请以\**结尾）；
+ *   不匹配但仍有后代可能匹配的键只打开并枚举子键，不输出，其余子树不打开
+ * - 排除模式（--exclude-key）：匹配的键及其整个子树不打开
+ * - 值模式（--include-value/--exclude-value）匹配值名，默认值按"@"匹配
+ * - 每个键模式编译为各级模式的列表，遍历时每个键保存各模式已匹配到的位置集合（位掩码），
+ *   子键的状态由父键的状态和子键名推出，不重新匹配整条路径
+ * 匹配不区分大小写（ASCII范围），与注册表一致
+ */
+
+#ifndef REG_KEYFILTER_H
+#define REG_KEYFILTER_H
+
+#include "reg_types.h"
+
+#include <string>
+#include <vector>
+
+// 单个键模式最多的级数（状态为64位掩码，位i表示前i级已匹配）
+const size_t kRegKeyPatternMaxLevels = 63;
+
+// 键的匹配状态：每个键模式一个位掩码
+typedef std::vector<uint64_t> RegKeyFilterState;
+
+// 键的过滤结果
+enum RegKeyFilterResult {
+    kRegKeyPruned,          // 自身和所有后代都不输出，不打开
+    kRegKeyPassThrough,     // 自身不输出，但有后代可能匹配，打开并枚举子键
+    kRegKeySelected         // 输出
+};
+
+// 不区分大小写的单级匹配（*匹配任意个字符，?匹配一个字符；pattern已转为小写）
+inline bool RegKeyGlobMatch(const std::string& pattern, const char* name, size_t length) {
+    size_t p = 0;
+    size_t n = 0;
+    size_t starP = std::string::npos;
+    size_t starN = 0;
+    while (n < length) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            starP = p++;
+            starN = n;
+        } else if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == RegAsciiLower(name[n]))) {
+            p++;
+            n++;
+        } else if (starP != std::string::npos) {
+            // 回溯：上一个*多匹配一个字符
+            p = starP + 1;
+            n = ++starN;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+// 编译后的键和值过滤器（只读，可在多个遍历线程中同时使用）
+class RegKeyFilter {
+public:
+    RegKeyFilter() : m_hasKeyIncludes(false) {}
+
+    // 添加键模式，级数过多时返回false并设置error
+    bool AddKeyPattern(const std::string& pattern, bool include, std::string* error) {
+        KeyPattern compiled;
+        compiled.include = include;
+        size_t start = 0;
+        if (pattern.find('\\') == std::string::npos) {
+            compiled.levels.push_back("**");
+        }
+        for (size_t i = 0; i <= pattern.size(); i++) {
+            if (i == pattern.size() || pattern[i] == '\\') {
+                if (i > start) {
+                    std::string level = Lower(pattern.substr(start, i - start));
+                    // 连续的**等同于一个
+                    if (level != "**" || compiled.levels.empty() || compiled.levels.back() != "**") {
+                        compiled.levels.push_back(level);
+                    }
+                }
+                start = i + 1;
+            }
+        }
+        if (compiled.levels.size() > kRegKeyPatternMaxLevels) {
+            *error = "Key pattern has too many levels: " + pattern;
+            return false;
+        }
+        compiled.anyLevels = 0;
+        for (size_t j = 0; j < compiled.levels.size(); j++) {
+            if (compiled.levels[j] == "**") {
+                compiled.anyLevels |= uint64_t(1) << j;
+            }
+        }
+        m_keyPatterns.push_back(compiled);
+        if (include) {
+            m_hasKeyIncludes = true;
+        }
+        return true;
+    }
+
+    // 添加值名模式（整体匹配，不按'\'分级）
+    void AddValuePattern(const std::string& pattern, bool include) {
+        (include ? m_valueIncludes : m_valueExcludes).push_back(Lower(pattern));
+    }
+
+    bool HasKeyPatterns() const { return !m_keyPatterns.empty(); }
+    bool HasValuePatterns() const { return !m_valueIncludes.empty() || !m_valueExcludes.empty(); }
+    bool Empty() const { return !HasKeyPatterns() && !HasValuePatterns(); }
+
+    // 遍历根路径的状态（相对路径为空）
+    RegKeyFilterResult Start(RegKeyFilterState* state) const {
+        state->assign(m_keyPatterns.size(), 0);
+        for (size_t i = 0; i < m_keyPatterns.size(); i++) {
+            (*state)[i] = Closure(m_keyPatterns[i], 1);
+        }
+        return Classify(*state);
+    }
+
+    // 由父键的状态和子键名推出子键的状态
+    RegKeyFilterResult Step(const RegKeyFilterState& parent, const std::string& name, RegKeyFilterState* child) const {
+        child->resize(m_keyPatterns.size());
+        for (size_t i = 0; i < m_keyPatterns.size(); i++) {
+            const KeyPattern& pattern = m_keyPatterns[i];
+            // 位于**的位置消耗这一级后仍在原位置
+            uint64_t to = parent[i] & pattern.anyLevels;
+            uint64_t from = parent[i] & ~pattern.anyLevels;
+            for (size_t j = 0; from != 0 && j < pattern.levels.size(); j++, from >>= 1) {
+                if ((from & 1) != 0 && RegKeyGlobMatch(pattern.levels[j], name.data(), name.size())) {
+                    to |= uint64_t(1) << (j + 1);
+                }
+            }
+            (*child)[i] = Closure(pattern, to);
+        }
+        return Classify(*child);
+    }
+
+    // 值是否输出（name为空表示默认值，按"@"匹配）
+    bool MatchValue(const std::string& name) const {
+        const char* text = name.empty() ? "@" : name.data();
+        size_t length = name.empty() ? 1 : name.size();
+        for (size_t i = 0; i < m_valueExcludes.size(); i++) {
+            if (RegKeyGlobMatch(m_valueExcludes[i], text, length)) {
+                return false;
+            }
+        }
+        if (m_valueIncludes.empty()) {
+            return true;
+        }
+        for (size_t i = 0; i < m_valueIncludes.size(); i++) {
+            if (RegKeyGlobMatch(m_valueIncludes[i], text, length)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct KeyPattern {
+        std::vector<std::string> levels;
+        uint64_t anyLevels;     // 为**的级
+        bool include;
+    };
+
+    static std::string Lower(std::string text) {
+        for (size_t i = 0; i < text.size(); i++) {
+            text[i] = RegAsciiLower(text[i]);
+        }
+        return text;
+    }
+
+    // **可以匹配零级：位于**的位置同时也位于其后一级
+    static uint64_t Closure(const KeyPattern& pattern, uint64_t positions) {
+        for (size_t j = 0; j < pattern.levels.size(); j++) {
+            if ((positions & pattern.anyLevels & (uint64_t(1) << j)) != 0) {
+                positions |= uint64_t(1) << (j + 1);
+            }
+        }
+        return positions;
+    }
+
+    RegKeyFilterResult Classify(const RegKeyFilterState& state) const {
+        bool selected = !m_hasKeyIncludes;
+        bool descend = false;
+        for (size_t i = 0; i < m_keyPatterns.size(); i++) {
+            const KeyPattern& pattern = m_keyPatterns[i];
+            uint64_t complete = uint64_t(1) << pattern.levels.size();
+            if (!pattern.include) {
+                if ((state[i] & complete) != 0) {
+                    return kRegKeyPruned;
+                }
+                continue;
+            }
+            selected = selected || (state[i] & complete) != 0;
+            descend = descend || (state[i] & (complete - 1)) != 0;
+        }
+        return selected ? kRegKeySelected : (descend ? kRegKeyPassThrough : kRegKeyPruned);
+    }
+
+    std::vector<KeyPattern> m_keyPatterns;
+    std::vector<std::string> m_valueIncludes;
+    std::vector<std::string> m_valueExcludes;
+    bool m_hasKeyIncludes;
+};
+
+#endif // REG_KEYFILTER_H
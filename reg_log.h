@@ -0,0 +1,256 @@
+/*
+ * 静默注册表导入程序 - 异步日志
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 调试日志的后台写入：
+ * - 任意线程调用Log，消息放入固定容量的无锁多生产者环形队列（按槽位序号协调，
+ *   生产者之间只竞争一次CAS），调用方从不等待文件或控制台
+ * - 单个后台线程批量取出消息，格式化为"[时间] 消息"后整批交给输出回调
+ * - 时间戳在入队时按秒记录，写入线程缓存当前秒的格式化结果
+ * - 队列满时丢弃新消息并计数，写入线程随后输出一条丢弃统计，内存占用有上限
+ * 平台无关：仅依赖C++11标准线程库
+ */
+
+#ifndef REG_LOG_H
+#define REG_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 日志级别（低于当前级别的消息在入队前丢弃）
+enum RegLogLevel {
+    kRegLogDebug = 0,
+    kRegLogInfo = 1,
+    kRegLogWarning = 2,
+    kRegLogError = 3
+};
+
+// 解析日志级别名称（debug、info、warning、error）
+inline bool ParseRegLogLevel(const std::string& text, RegLogLevel* level) {
+    if (text == "debug") *level = kRegLogDebug;
+    else if (text == "info") *level = kRegLogInfo;
+    else if (text == "warning") *level = kRegLogWarning;
+    else if (text == "error") *level = kRegLogError;
+    else return false;
+    return true;
+}
+
+// 批量输出回调（在写入线程中调用）
+typedef std::function<void(const char* data, size_t size)> RegLogOutput;
+
+// 日志统计
+struct RegLogStats {
+    size_t written;     // 已写出的消息数
+    size_t dropped;     // 队列满时丢弃的消息数
+    size_t batches;     // 输出回调的调用次数
+
+    RegLogStats() : written(0), dropped(0), batches(0) {}
+};
+
+// 异步日志器
+class RegAsyncLogger {
+public:
+    // capacity向上取整为2的幂
+    explicit RegAsyncLogger(size_t capacity = 8192)
+        : m_level(kRegLogDebug), m_enqueuePos(0), m_dequeuePos(0), m_dropped(0), m_reportedDrops(0),
+          m_written(0), m_batches(0), m_running(false), m_stop(false), m_cachedTime(-1), m_cachedLength(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        m_mask = size - 1;
+        m_slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; i++) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~RegAsyncLogger() { Stop(); }
+
+    // 禁止拷贝
+    RegAsyncLogger(const RegAsyncLogger&) = delete;
+    RegAsyncLogger& operator=(const RegAsyncLogger&) = delete;
+
+    // 启动写入线程，Start之前记录的消息在启动后写出
+    void Start(const RegLogOutput& output) {
+        if (m_running) {
+            return;
+        }
+        m_output = output;
+        m_stop = false;
+        m_running = true;
+        m_writer = std::thread([this]() { WriterLoop(); });
+    }
+
+    // 写出已入队的消息并结束写入线程
+    void Stop() {
+        if (!m_running) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_writer.join();
+        m_running = false;
+    }
+
+    void SetLevel(RegLogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+
+    bool IsEnabled(RegLogLevel level) const { return level >= m_level.load(std::memory_order_relaxed); }
+
+    // 入队一条消息（可在任意线程调用），被过滤或队列已满时返回false
+    bool Log(RegLogLevel level, const std::string& message) {
+        if (!IsEnabled(level)) {
+            return false;
+        }
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &m_slots[pos & m_mask];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // 写入线程落后一整圈：丢弃而不是阻塞调用方
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->time = static_cast<int64_t>(std::time(NULL));
+        slot->message.assign(message);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    RegLogStats GetStats() const {
+        RegLogStats stats;
+        stats.written = m_written.load();
+        stats.dropped = m_dropped.load();
+        stats.batches = m_batches.load();
+        return stats;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        int64_t time;
+        std::string message;
+
+        Slot() : sequence(0), time(0) {}
+    };
+
+    // 单条消息保留的最大缓冲区，超出时写出后释放，避免个别长消息长期占用内存
+    static const size_t kMaxRetainedMessage = 64 * 1024;
+
+    void WriterLoop() {
+        while (true) {
+            size_t count = Drain();
+            if (count == 0) {
+                std::unique_lock<std::mutex> lock(m_wakeMutex);
+                if (m_stop) {
+                    return;
+                }
+                m_wake.wait_for(lock, std::chrono::milliseconds(5));
+            }
+        }
+    }
+
+    // 取出已发布的消息（每批最多一整圈）并整批输出，返回消息数
+    size_t Drain() {
+        size_t count = 0;
+        m_batch.clear();
+        while (count <= m_mask) {
+            Slot& slot = m_slots[m_dequeuePos & m_mask];
+            if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1) {
+                break;
+            }
+            AppendTimestamp(slot.time);
+            m_batch.append(slot.message).push_back('\n');
+            if (slot.message.capacity() > kMaxRetainedMessage) {
+                std::string().swap(slot.message);
+            }
+            slot.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+            m_dequeuePos++;
+            count++;
+        }
+
+        size_t dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != m_reportedDrops) {
+            AppendTimestamp(static_cast<int64_t>(std::time(NULL)));
+            m_batch.append("Warning: ")
+                .append(std::to_string(dropped - m_reportedDrops))
+                .append(" log messages dropped (log buffer full)\n");
+            m_reportedDrops = dropped;
+        }
+
+        if (!m_batch.empty()) {
+            if (m_output) {
+                m_output(m_batch.data(), m_batch.size());
+            }
+            m_written += count;
+            m_batches++;
+        }
+        return count;
+    }
+
+    // 追加"[YYYY-MM-DD HH:MM:SS] "，同一秒内复用上次的格式化结果
+    void AppendTimestamp(int64_t time) {
+        if (time != m_cachedTime) {
+            time_t now = static_cast<time_t>(time);
+            tm localTime;
+#ifdef _WIN32
+            bool converted = localtime_s(&localTime, &now) == 0;
+#else
+            bool converted = localtime_r(&now, &localTime) != NULL;
+#endif
+            m_cachedLength = converted ? std::strftime(m_cachedStamp, sizeof(m_cachedStamp),
+                                                       "[%Y-%m-%d %H:%M:%S] ", &localTime) : 0;
+            m_cachedTime = time;
+        }
+        m_batch.append(m_cachedStamp, m_cachedLength);
+    }
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask;
+    std::atomic<int> m_level;
+    std::atomic<size_t> m_enqueuePos;
+    size_t m_dequeuePos;                // 仅写入线程访问
+    std::atomic<size_t> m_dropped;
+    size_t m_reportedDrops;             // 仅写入线程访问
+    std::atomic<size_t> m_written;
+    std::atomic<size_t> m_batches;
+
+    RegLogOutput m_output;
+    std::thread m_writer;
+    bool m_running;
+    bool m_stop;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+
+    // 写入线程的批量缓冲区和时间戳缓存
+    std::string m_batch;
+    int64_t m_cachedTime;
+    char m_cachedStamp[32];
+    size_t m_cachedLength;
+};
+
+#endif // REG_LOG_H
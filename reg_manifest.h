@@ -0,0 +1,245 @@
+/*
+ * 静默注册表导入程序 - 文件清单
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 从清单文件或标准输入逐行读取要导入的文件（@清单 或 --manifest 清单，- 表示标准输入）：
+ * - 每行一个文件路径（可含空格，也可以是通配符），空行和以#或;开头的行被忽略
+ * - 路径后可跟选项：priority=N（在整个清单内优先级高的后导入，冲突的值以它为准）、
+ *   hive=根键（把文件中所有键的根键替换为该键，如 hive=HKEY_USERS\.DEFAULT）
+ * - 路径可以用双引号括起，也可以用制表符与选项分隔；未加引号时只把行尾的已知选项当作选项
+ * - 逐行读取，不预先读入整个清单，调用方可以边读边导入；但清单文件含非0优先级时，
+ *   调用方先扫描一遍，再把整个清单读入一批稳定排序后导入（不再流式）；
+ *   标准输入无法预先扫描，其中的priority被忽略（记录警告，按行序导入）
+ * 另提供按空格拆分命令行（支持双引号）的函数，路径中可以有空格
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_MANIFEST_H
+#define REG_MANIFEST_H
+
+#include "reg_types.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 按空格拆分命令行参数：双引号内的空格不拆分，引号本身被去掉（如 @"C:\My Lists\a.txt"）
+inline std::vector<std::string> RegSplitArguments(const std::string& cmdLine) {
+    std::vector<std::string> args;
+    std::string current;
+    bool quoted = false;
+    bool hasArg = false;
+    for (size_t i = 0; i < cmdLine.size(); i++) {
+        char c = cmdLine[i];
+        if (c == '"') {
+            quoted = !quoted;
+            hasArg = true;
+        } else if ((c == ' ' || c == '\t') && !quoted) {
+            if (hasArg) {
+                args.push_back(current);
+                current.clear();
+                hasArg = false;
+            }
+        } else {
+            current += c;
+            hasArg = true;
+        }
+    }
+    if (hasArg) {
+        args.push_back(current);
+    }
+    return args;
+}
+
+// 清单中的一个条目
+struct RegManifestEntry {
+    std::string path;
+    int priority;
+    std::string hive;       // 规范化后的目标根键（可带子路径），空表示不替换
+    size_t line;
+
+    RegManifestEntry() : priority(0), line(0) {}
+};
+
+// 解析路径后的一个选项，未知选项或取值无效时返回false
+inline bool ParseRegManifestOption(const std::string& option, RegManifestEntry* entry, std::string* error) {
+    size_t equals = option.find('=');
+    std::string name = option.substr(0, equals == std::string::npos ? option.size() : equals);
+    std::string value = equals == std::string::npos ? std::string() : option.substr(equals + 1);
+    if (RegEqualsIgnoreCase(name.data(), name.size(), "priority", 8)) {
+        char* end = NULL;
+        errno = 0;
+        long long priority = std::strtoll(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || errno != 0 || priority < INT_MIN || priority > INT_MAX) {
+            *error = "Invalid priority: " + value;
+            return false;
+        }
+        entry->priority = static_cast<int>(priority);
+        return true;
+    }
+    if (RegEqualsIgnoreCase(name.data(), name.size(), "hive", 4)) {
+        while (!value.empty() && value[value.size() - 1] == '\\') {
+            value.erase(value.size() - 1);
+        }
+        if (!NormalizeRegKeyPath(value, &entry->hive)) {
+            *error = "Invalid hive: " + value;
+            return false;
+        }
+        return true;
+    }
+    *error = "Unknown option: " + option;
+    return false;
+}
+
+// 是否为已知选项（未加引号的路径只把行尾的已知选项当作选项）
+inline bool IsRegManifestOption(const std::string& token) {
+    size_t equals = token.find('=');
+    return equals != std::string::npos &&
+           (RegEqualsIgnoreCase(token.data(), equals, "priority", 8) ||
+            RegEqualsIgnoreCase(token.data(), equals, "hive", 4));
+}
+
+// 解析一行；空行和注释返回false且error为空，格式错误返回false并设置error
+inline bool ParseRegManifestLine(const std::string& text, RegManifestEntry* entry, std::string* error) {
+    error->clear();
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) {
+        begin++;
+    }
+    while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t' || text[end - 1] == '\r')) {
+        end--;
+    }
+    if (begin == end || text[begin] == '#' || text[begin] == ';') {
+        return false;
+    }
+    entry->path.clear();
+    entry->priority = 0;
+    entry->hive.clear();
+
+    std::string options;
+    if (text[begin] == '"') {
+        size_t close = text.find('"', begin + 1);
+        if (close == std::string::npos || close >= end) {
+            *error = "Missing closing quote";
+            return false;
+        }
+        entry->path = text.substr(begin + 1, close - begin - 1);
+        options = text.substr(close + 1, end - close - 1);
+    } else {
+        size_t tab = text.find('\t', begin);
+        if (tab != std::string::npos && tab < end) {
+            entry->path = text.substr(begin, tab - begin);
+            options = text.substr(tab + 1, end - tab - 1);
+        } else {
+            // 未加引号：从行尾依次取出已知选项，其余部分（可含空格）为路径
+            size_t pathEnd = end;
+            while (pathEnd > begin) {
+                size_t space = text.rfind(' ', pathEnd - 1);
+                if (space == std::string::npos || space < begin) {
+                    break;
+                }
+                std::string token = text.substr(space + 1, pathEnd - space - 1);
+                if (!IsRegManifestOption(token)) {
+                    break;
+                }
+                options = token + " " + options;
+                pathEnd = space;
+                while (pathEnd > begin && text[pathEnd - 1] == ' ') {
+                    pathEnd--;
+                }
+            }
+            entry->path = text.substr(begin, pathEnd - begin);
+        }
+    }
+
+    std::vector<std::string> tokens = RegSplitArguments(options);
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (!ParseRegManifestOption(tokens[i], entry, error)) {
+            return false;
+        }
+    }
+    if (entry->path.empty()) {
+        *error = "Missing file path";
+        return false;
+    }
+    return true;
+}
+
+// 清单读取器：逐行读取，只保留当前行
+class RegManifestReader {
+public:
+    typedef std::function<void(size_t line, const std::string& message)> WarningSink;
+
+    RegManifestReader() : m_in(NULL), m_line(0), m_entries(0), m_invalid(0) {}
+
+    // 禁止拷贝
+    RegManifestReader(const RegManifestReader&) = delete;
+    RegManifestReader& operator=(const RegManifestReader&) = delete;
+
+    void SetWarningSink(const WarningSink& sink) { m_warningSink = sink; }
+
+    // 打开清单文件，source为"-"时读取标准输入
+    bool Open(const std::string& source, std::string* error) {
+        m_line = 0;
+        m_entries = 0;
+        m_invalid = 0;
+        if (source == "-") {
+            m_in = &std::cin;
+            return true;
+        }
+        m_file.open(source.c_str(), std::ios::in | std::ios::binary);
+        if (!m_file) {
+            *error = "Cannot open manifest: " + source;
+            return false;
+        }
+        m_in = &m_file;
+        return true;
+    }
+
+    // 读取下一个条目，格式错误的行报告警告后跳过；读完时返回false
+    bool Next(RegManifestEntry* entry) {
+        std::string error;
+        while (m_in != NULL && std::getline(*m_in, m_text)) {
+            m_line++;
+            // 去掉UTF-8 BOM
+            if (m_line == 1 && m_text.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+                m_text.erase(0, 3);
+            }
+            if (ParseRegManifestLine(m_text, entry, &error)) {
+                entry->line = m_line;
+                m_entries++;
+                return true;
+            }
+            if (!error.empty()) {
+                m_invalid++;
+                if (m_warningSink) {
+                    m_warningSink(m_line, error);
+                }
+            }
+        }
+        return false;
+    }
+
+    size_t GetLineCount() const { return m_line; }
+    size_t GetEntryCount() const { return m_entries; }
+    size_t GetInvalidCount() const { return m_invalid; }
+
+private:
+    std::ifstream m_file;
+    std::istream* m_in;
+    std::string m_text;     // 当前行（复用缓冲区）
+    size_t m_line;
+    size_t m_entries;
+    size_t m_invalid;
+    WarningSink m_warningSink;
+};
+
+#endif // REG_MANIFEST_H
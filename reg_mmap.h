@@ -0,0 +1,118 @@
+/*
+ * 静默注册表导入程序 - 只读文件映射
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 把整个文件只读映射到内存，按需由操作系统分页读入：
+ * - Windows使用CreateFileMapping/MapViewOfFile，其他平台使用mmap
+ * - 空文件不建立映射，Data()返回NULL、Size()返回0
+ * - 映射在Close或析构时解除，期间返回的指针保持有效
+ */
+
+#ifndef REG_MMAP_H
+#define REG_MMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 只读文件映射
+class RegMappedFile {
+public:
+    RegMappedFile() : m_data(NULL), m_size(0) {}
+    ~RegMappedFile() { Close(); }
+
+    // 禁止拷贝
+    RegMappedFile(const RegMappedFile&) = delete;
+    RegMappedFile& operator=(const RegMappedFile&) = delete;
+
+    // 映射整个文件，失败时返回false并设置error
+    bool Open(const std::string& path, std::string* error) {
+        Close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            *error = "Cannot open file: " + path;
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            *error = "Cannot read file size: " + path;
+            return false;
+        }
+        if (size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            void* view = (mapping == NULL) ? NULL : MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            // 映射视图独立于文件和映射句柄存在
+            if (mapping != NULL) {
+                CloseHandle(mapping);
+            }
+            if (view == NULL) {
+                CloseHandle(file);
+                *error = "Cannot map file: " + path;
+                return false;
+            }
+            m_data = static_cast<const uint8_t*>(view);
+            m_size = static_cast<size_t>(size.QuadPart);
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            *error = "Cannot open file: " + path;
+            return false;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            *error = "Cannot read file size: " + path;
+            return false;
+        }
+        if (info.st_size > 0) {
+            void* view = ::mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) {
+                ::close(fd);
+                *error = "Cannot map file: " + path;
+                return false;
+            }
+            m_data = static_cast<const uint8_t*>(view);
+            m_size = static_cast<size_t>(info.st_size);
+        }
+        ::close(fd);
+#endif
+        return true;
+    }
+
+    void Close() {
+        if (m_data != NULL) {
+#ifdef _WIN32
+            UnmapViewOfFile(m_data);
+#else
+            ::munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+        }
+        m_data = NULL;
+        m_size = 0;
+    }
+
+    const uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+};
+
+#endif // REG_MMAP_H
@@ -0,0 +1,360 @@
+/*
+ * 静默注册表导入程序 - 预编译导入包
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 把一个或多个.reg文件合并规划后编译为单个二进制导入包（.regpack），部署时映射后直接写入：
+ * - 文件依次为文件头、字符串池、键表、操作表和值数据区
+ * - 操作为写入合并规划器的输出：已按键路径排序，每个键只打开一次，每个值最多写一次
+ * - 键路径和值名去重后保存在字符串池中（UTF-8），操作只保存键序号和名称的偏移、长度
+ * - 值数据为注册表原始字节（字符串已转换为UTF-16LE），写入时直接引用映射内存
+ * - 文件头保存自身和其余全部内容的XXH64校验和，加载时先校验再逐项检查范围
+ * - 字符串池偏移、名称长度、单个值的数据大小和键数均为32位，超出时写入器拒绝写出
+ * 整数均为小端序，表按8字节对齐
+ * 应用时键路径和值名复用预留好容量的缓冲区，不解析文本，每个值不分配内存
+ * 平台无关：文件映射见reg_mmap.h
+ */
+
+#ifndef REG_PACK_H
+#define REG_PACK_H
+
+#include "reg_apply.h"
+#include "reg_hash.h"
+#include "reg_mmap.h"
+#include "reg_parser.h"
+#include "reg_traverse.h"
+#include "reg_types.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const char kRegPackMagic[8] = {'R', 'E', 'G', 'P', 'A', 'C', 'K', '\0'};
+const uint32_t kRegPackVersion = 1;
+
+// 文件头
+struct RegPackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sourceCount;       // 编译时的源文件数（仅用于日志）
+    uint64_t fileSize;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+    uint64_t keyOffset;
+    uint64_t keyCount;
+    uint64_t opOffset;
+    uint64_t opCount;
+    uint64_t dataOffset;
+    uint64_t dataSize;
+    uint64_t bodyChecksum;      // 文件头之后全部内容的XXH64
+    uint64_t headerChecksum;    // 文件头中本字段之前内容的XXH64
+};
+
+// 键记录（完整键路径）
+struct RegPackKey {
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+// 操作记录
+struct RegPackOp {
+    uint32_t kind;              // RegOpKind
+    uint32_t key;               // 键序号
+    uint32_t nameOffset;        // 值名在字符串池中的偏移
+    uint32_t nameLength;
+    uint32_t type;
+    uint32_t dataSize;
+    uint64_t dataOffset;        // 数据在值数据区中的偏移
+};
+
+static_assert(sizeof(RegPackHeader) == 104, "pack header layout");
+static_assert(sizeof(RegPackKey) == 8, "pack key layout");
+static_assert(sizeof(RegPackOp) == 32, "pack op layout");
+
+// 导入包写入器：按顺序添加操作（通常为写入合并规划器的输出），最后一次性写出
+class RegPackWriter {
+public:
+    RegPackWriter() : m_sourceCount(0), m_overflow(false) {}
+
+    // 禁止拷贝
+    RegPackWriter(const RegPackWriter&) = delete;
+    RegPackWriter& operator=(const RegPackWriter&) = delete;
+
+    void SetSourceCount(uint32_t sourceCount) { m_sourceCount = sourceCount; }
+
+    void Add(const RegOp& op) {
+        if (op.keyPath.size() >= 0xFFFFFFFFu || op.valueName.size() >= 0xFFFFFFFFu || op.data.size() >= 0xFFFFFFFFu ||
+            m_keys.size() >= 0xFFFFFFFFu) {
+            m_overflow = true;
+            return;
+        }
+        RegPackOp record;
+        record.kind = static_cast<uint32_t>(op.kind);
+        std::unordered_map<std::string, uint32_t>::iterator found = m_keyIndex.find(op.keyPath);
+        if (found == m_keyIndex.end()) {
+            RegPackKey key;
+            key.pathOffset = Intern(op.keyPath);
+            key.pathLength = static_cast<uint32_t>(op.keyPath.size());
+            found = m_keyIndex.insert(std::make_pair(op.keyPath, static_cast<uint32_t>(m_keys.size()))).first;
+            m_keys.push_back(key);
+        }
+        record.key = found->second;
+        record.nameOffset = op.valueName.empty() ? 0 : Intern(op.valueName);
+        record.nameLength = static_cast<uint32_t>(op.valueName.size());
+        record.type = op.type;
+        record.dataSize = static_cast<uint32_t>(op.data.size());
+        record.dataOffset = m_data.size();
+        m_data.insert(m_data.end(), op.data.begin(), op.data.end());
+        m_ops.push_back(record);
+    }
+
+    size_t GetKeyCount() const { return m_keys.size(); }
+    size_t GetOpCount() const { return m_ops.size(); }
+
+    // 是否有超出32位字段范围的内容（此时Write不写出任何内容）
+    bool IsOverflowed() const { return m_overflow; }
+
+    // 写出整个导入包（先计算校验和，再依次交给sink），sink返回false或内容超出范围时返回false
+    bool Write(const RegOutputSink& sink) const {
+        if (m_overflow) {
+            return false;
+        }
+        static const uint8_t kPadding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        RegPackHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kRegPackMagic, sizeof(header.magic));
+        header.version = kRegPackVersion;
+        header.sourceCount = m_sourceCount;
+        header.stringOffset = sizeof(header);
+        header.stringSize = m_pool.size();
+        size_t stringPadding = Padding(header.stringOffset + header.stringSize);
+        header.keyOffset = header.stringOffset + header.stringSize + stringPadding;
+        header.keyCount = m_keys.size();
+        size_t keyPadding = Padding(m_keys.size() * sizeof(RegPackKey));
+        header.opOffset = header.keyOffset + header.keyCount * sizeof(RegPackKey) + keyPadding;
+        header.opCount = m_ops.size();
+        header.dataOffset = header.opOffset + header.opCount * sizeof(RegPackOp);
+        header.dataSize = m_data.size();
+        header.fileSize = header.dataOffset + header.dataSize;
+
+        RegHash64 body;
+        body.Update(m_pool.data(), m_pool.size());
+        body.Update(kPadding, stringPadding);
+        body.Update(m_keys.data(), m_keys.size() * sizeof(RegPackKey));
+        body.Update(kPadding, keyPadding);
+        body.Update(m_ops.data(), m_ops.size() * sizeof(RegPackOp));
+        body.Update(m_data.data(), m_data.size());
+        header.bodyChecksum = body.Digest();
+        header.headerChecksum = RegHash64::Hash(&header, offsetof(RegPackHeader, headerChecksum));
+
+        return sink(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) &&
+               sink(reinterpret_cast<const uint8_t*>(m_pool.data()), m_pool.size()) &&
+               sink(kPadding, stringPadding) &&
+               sink(reinterpret_cast<const uint8_t*>(m_keys.data()), m_keys.size() * sizeof(RegPackKey)) &&
+               sink(kPadding, keyPadding) &&
+               sink(reinterpret_cast<const uint8_t*>(m_ops.data()), m_ops.size() * sizeof(RegPackOp)) &&
+               sink(m_data.data(), m_data.size());
+    }
+
+private:
+    static size_t Padding(uint64_t offset) { return static_cast<size_t>((8 - offset % 8) % 8); }
+
+    // 名称去重后存入字符串池，返回偏移
+    uint32_t Intern(const std::string& name) {
+        std::unordered_map<std::string, uint32_t>::iterator found = m_strings.find(name);
+        if (found != m_strings.end()) {
+            return found->second;
+        }
+        if (m_pool.size() + name.size() >= 0xFFFFFFFFu) {
+            m_overflow = true;
+            return 0;
+        }
+        uint32_t offset = static_cast<uint32_t>(m_pool.size());
+        m_pool += name;
+        m_strings[name] = offset;
+        return offset;
+    }
+
+    uint32_t m_sourceCount;
+    bool m_overflow;            // 字符串池、名称、数据或键数超出32位字段
+    std::string m_pool;
+    std::unordered_map<std::string, uint32_t> m_strings;
+    std::vector<RegPackKey> m_keys;
+    std::unordered_map<std::string, uint32_t> m_keyIndex;
+    std::vector<RegPackOp> m_ops;
+    std::vector<uint8_t> m_data;
+};
+
+// 只读导入包（记录直接指向映射内存）
+class RegPack {
+public:
+    RegPack()
+        : m_strings(NULL), m_keys(NULL), m_ops(NULL), m_values(NULL), m_keyCount(0),
+          m_opCount(0), m_sourceCount(0), m_maxPathLength(0), m_maxNameLength(0) {}
+
+    // 禁止拷贝
+    RegPack(const RegPack&) = delete;
+    RegPack& operator=(const RegPack&) = delete;
+
+    // 映射并校验导入包，失败时返回false并设置error
+    bool Open(const std::string& path, std::string* error) {
+        m_keyCount = 0;
+        m_opCount = 0;
+        if (!m_file.Open(path, error)) {
+            return false;
+        }
+        if (!Attach(m_file.Data(), m_file.Size(), error)) {
+            *error += ": " + path;
+            m_file.Close();
+            return false;
+        }
+        return true;
+    }
+
+    // 使用内存中的导入包（data须按8字节对齐，并在使用期间保持有效）
+    // 校验文件头、校验和以及每条记录的范围，之后的访问不再检查边界
+    bool Attach(const uint8_t* data, size_t size, std::string* error) {
+        RegPackHeader header;
+        if (size < sizeof(header) || std::memcmp(data, kRegPackMagic, sizeof(kRegPackMagic)) != 0) {
+            *error = "Not a registry pack";
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version != kRegPackVersion) {
+            *error = "Unsupported registry pack version " + std::to_string(header.version);
+            return false;
+        }
+        if (header.headerChecksum != RegHash64::Hash(&header, offsetof(RegPackHeader, headerChecksum)) ||
+            header.fileSize != size ||
+            header.bodyChecksum != RegHash64::Hash(data + sizeof(header), size - sizeof(header))) {
+            *error = "Registry pack checksum mismatch (corrupt or truncated)";
+            return false;
+        }
+        if (reinterpret_cast<uintptr_t>(data) % 8 != 0 || header.stringOffset < sizeof(header) ||
+            !InRange(header.stringOffset, header.stringSize, size) ||
+            header.keyOffset % 8 != 0 || header.keyCount > size / sizeof(RegPackKey) ||
+            !InRange(header.keyOffset, header.keyCount * sizeof(RegPackKey), size) ||
+            header.opOffset % 8 != 0 || header.opCount > size / sizeof(RegPackOp) ||
+            !InRange(header.opOffset, header.opCount * sizeof(RegPackOp), size) ||
+            !InRange(header.dataOffset, header.dataSize, size)) {
+            *error = "Corrupt registry pack layout";
+            return false;
+        }
+
+        const RegPackKey* keys = reinterpret_cast<const RegPackKey*>(data + header.keyOffset);
+        const RegPackOp* ops = reinterpret_cast<const RegPackOp*>(data + header.opOffset);
+        uint32_t maxPathLength = 0;
+        uint32_t maxNameLength = 0;
+        for (uint64_t i = 0; i < header.keyCount; i++) {
+            if (!InRange(keys[i].pathOffset, keys[i].pathLength, header.stringSize)) {
+                *error = "Corrupt registry pack key table";
+                return false;
+            }
+            maxPathLength = std::max(maxPathLength, keys[i].pathLength);
+        }
+        for (uint64_t i = 0; i < header.opCount; i++) {
+            const RegPackOp& op = ops[i];
+            if (op.kind > static_cast<uint32_t>(RegOpDeleteValue) || op.key >= header.keyCount ||
+                !InRange(op.nameOffset, op.nameLength, header.stringSize) ||
+                !InRange(op.dataOffset, op.dataSize, header.dataSize)) {
+                *error = "Corrupt registry pack operation table";
+                return false;
+            }
+            maxNameLength = std::max(maxNameLength, op.nameLength);
+        }
+
+        m_strings = reinterpret_cast<const char*>(data + header.stringOffset);
+        m_keys = keys;
+        m_ops = ops;
+        m_values = data + header.dataOffset;
+        m_keyCount = static_cast<size_t>(header.keyCount);
+        m_opCount = static_cast<size_t>(header.opCount);
+        m_sourceCount = header.sourceCount;
+        m_maxPathLength = maxPathLength;
+        m_maxNameLength = maxNameLength;
+        return true;
+    }
+
+    size_t GetKeyCount() const { return m_keyCount; }
+    size_t GetOpCount() const { return m_opCount; }
+    uint32_t GetSourceCount() const { return m_sourceCount; }
+
+    // 直接从映射内存应用全部操作：键路径和值名写入预留好容量的缓冲区，数据不复制
+    void Apply(RegApplier& applier) const {
+        std::string keyPath;
+        std::string name;
+        keyPath.reserve(m_maxPathLength);
+        name.reserve(m_maxNameLength);
+        uint32_t currentKey = 0xFFFFFFFFu;
+        for (size_t i = 0; i < m_opCount; i++) {
+            const RegPackOp& op = m_ops[i];
+            if (op.key != currentKey) {
+                const RegPackKey& key = m_keys[op.key];
+                keyPath.assign(m_strings + key.pathOffset, key.pathLength);
+                currentKey = op.key;
+            }
+            name.assign(m_strings + op.nameOffset, op.nameLength);
+            applier.Apply(static_cast<RegOpKind>(op.kind), keyPath, name, op.type, m_values + op.dataOffset,
+                          op.dataSize);
+        }
+        applier.CloseCurrentKey();
+    }
+
+    // 转换为写操作（用于与其他文件合并规划）
+    void ForEachOp(const std::function<void(const RegOp&)>& callback) const {
+        RegOp result;
+        for (size_t i = 0; i < m_opCount; i++) {
+            const RegPackOp& op = m_ops[i];
+            const RegPackKey& key = m_keys[op.key];
+            result.kind = static_cast<RegOpKind>(op.kind);
+            result.keyPath.assign(m_strings + key.pathOffset, key.pathLength);
+            result.valueName.assign(m_strings + op.nameOffset, op.nameLength);
+            result.type = op.type;
+            result.data.assign(m_values + op.dataOffset, m_values + op.dataOffset + op.dataSize);
+            callback(result);
+        }
+    }
+
+private:
+    static bool InRange(uint64_t offset, uint64_t length, uint64_t limit) {
+        return offset <= limit && length <= limit - offset;
+    }
+
+    RegMappedFile m_file;
+    const char* m_strings;
+    const RegPackKey* m_keys;
+    const RegPackOp* m_ops;
+    const uint8_t* m_values;
+    size_t m_keyCount;
+    size_t m_opCount;
+    uint32_t m_sourceCount;
+    uint32_t m_maxPathLength;
+    uint32_t m_maxNameLength;
+};
+
+// 文件是否以导入包文件头开始
+inline bool IsRegPackFile(const std::string& path) {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    char magic[sizeof(kRegPackMagic)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, kRegPackMagic, sizeof(magic)) == 0;
+}
+
+// 把导入包转换为操作列表（与ParseRegFileToOps的结果形式相同，可在工作线程中调用）
+inline void LoadRegPackOps(const std::string& path, RegParsedFile* result) {
+    RegPack pack;
+    if (!pack.Open(path, &result->error)) {
+        return;
+    }
+    std::vector<RegOp>& ops = result->ops;
+    ops.reserve(pack.GetOpCount());
+    pack.ForEachOp([&ops](const RegOp& op) { ops.push_back(op); });
+    result->parsed = true;
+}
+
+#endif // REG_PACK_H
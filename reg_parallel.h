@@ -0,0 +1,108 @@
+/*
+ * 静默注册表导入程序 - 有序并行流水线
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 工作线程并行执行各输入的读取与解析，调用线程严格按输入顺序提交结果，
+ * 保证最终效果与顺序执行一致（后写入者生效）
+ * 平台无关：仅依赖C++11标准线程库
+ */
+
+#ifndef REG_PARALLEL_H
+#define REG_PARALLEL_H
+
+#include "reg_trace.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 默认并行度（CPU核心数）
+inline size_t RegDefaultJobCount() {
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : static_cast<size_t>(cores);
+}
+
+// 有序并行执行：produce(i, result)在工作线程上并行运行，
+// commit(i, result)在调用线程上按i递增顺序运行。
+// 工作线程最多领先提交位置window个输入，避免结果堆积占用内存
+template <typename Result>
+void RunOrderedPipeline(size_t count, size_t jobs,
+                        const std::function<void(size_t, Result*)>& produce,
+                        const std::function<void(size_t, Result&)>& commit,
+                        size_t window = 0) {
+    if (jobs <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            Result result;
+            produce(i, &result);
+            commit(i, result);
+        }
+        return;
+    }
+    if (jobs > count) {
+        jobs = count;
+    }
+    if (window == 0) {
+        window = jobs * 4;
+    }
+
+    std::mutex mutex;
+    std::condition_variable readyChanged;
+    std::condition_variable commitChanged;
+    std::vector<std::unique_ptr<Result> > results(count);
+    size_t nextIndex = 0;
+    size_t committed = 0;
+
+    std::vector<std::thread> workers;
+    workers.reserve(jobs);
+    for (size_t w = 0; w < jobs; w++) {
+        workers.push_back(std::thread([&, w]() {
+            SetRegTraceThreadName("pipeline worker", static_cast<int>(w));
+            while (true) {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    commitChanged.wait(lock, [&]() { return nextIndex >= count || nextIndex < committed + window; });
+                    if (nextIndex >= count) {
+                        return;
+                    }
+                    index = nextIndex++;
+                }
+                std::unique_ptr<Result> result(new Result());
+                produce(index, result.get());
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    results[index].swap(result);
+                }
+                readyChanged.notify_one();
+            }
+        }));
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        std::unique_ptr<Result> result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            readyChanged.wait(lock, [&]() { return results[i] != nullptr; });
+            result.swap(results[i]);
+        }
+        commit(i, *result);
+        result.reset();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            committed = i + 1;
+        }
+        commitChanged.notify_all();
+    }
+
+    for (size_t w = 0; w < workers.size(); w++) {
+        workers[w].join();
+    }
+}
+
+#endif // REG_PARALLEL_H
@@ -0,0 +1,595 @@
+/*
+ * 静默注册表导入程序 - .reg文件流式解析器
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 支持格式:
+ * - REGEDIT5（Windows Registry Editor Version 5.00，UTF-16LE带BOM或ANSI/UTF-8）
+ * - REGEDIT4（ANSI）
+ * - [key]、[-key]、"name"=-、@默认值、"字符串"、dword:、hex:、hex(n):及\续行
+ *
+ * 平台无关：单遍分块解析，每个写操作通过回调输出，不访问注册表
+ * 换行、引号和转义字符的查找使用reg_simd.h中的向量化扫描
+ */
+
+#ifndef REG_PARSER_H
+#define REG_PARSER_H
+
+#include "reg_types.h"
+#include "reg_encoding.h"
+#include "reg_hex.h"
+#include "reg_simd.h"
+
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 文件编码
+enum RegFileEncoding {
+    RegEncodingUnknown,
+    RegEncodingAnsi,
+    RegEncodingUtf8,
+    RegEncodingUtf16Le
+};
+
+// 文件格式版本
+enum RegFileVersion {
+    RegVersionUnknown,
+    RegVersion4,    // REGEDIT4
+    RegVersion5     // Windows Registry Editor Version 5.00
+};
+
+// ANSI文本解码函数（Windows上使用系统代码页，默认按Latin-1处理）
+typedef void (*AnsiToUtf8Fn)(const char* data, size_t size, std::string* out);
+
+// 结构字符集合：换行、引号、等号、节标题和转义
+inline const RegCharSet& RegStructuralChars() {
+    static const RegCharSet set("\r\n\"=[\\");
+    return set;
+}
+
+// 字符串扫描集合：闭引号和转义
+inline const RegCharSet& RegQuoteChars() {
+    static const RegCharSet set("\"\\");
+    return set;
+}
+
+// 换行符集合
+inline const RegCharSet& RegNewlineChars() {
+    static const RegCharSet set("\n");
+    return set;
+}
+
+// 操作输出回调（RegOp对象会被复用，回调中如需保留请复制）
+typedef std::function<void(const RegOp&)> RegOpSink;
+
+// 警告回调（行号从1开始）
+typedef std::function<void(size_t line, const std::string& message)> RegWarningSink;
+
+// .reg文件流式解析器
+class RegFileParser {
+public:
+    explicit RegFileParser(const RegOpSink& sink)
+        : m_sink(sink), m_ansiDecoder(Latin1ToUtf8), m_encoding(RegEncodingUnknown),
+          m_version(RegVersionUnknown), m_lineNumber(0), m_logicalLineStart(0),
+          m_continuing(false), m_keyValid(false), m_failed(false), m_warningCount(0),
+          m_opCount(0) {}
+
+    void SetAnsiDecoder(AnsiToUtf8Fn decoder) { m_ansiDecoder = decoder; }
+    void SetWarningSink(const RegWarningSink& sink) { m_warningSink = sink; }
+
+    // 从文件中间续接解析（分段并行解析使用）：编码和格式版本取自文件开头，
+    // 输入从某个节标题行开始，不含BOM和文件头，行号从该段的第一行起算
+    void Resume(RegFileEncoding encoding, RegFileVersion version) {
+        m_encoding = encoding;
+        m_version = version;
+    }
+
+    // 输入下一块原始文件字节，可任意切分
+    bool Feed(const char* data, size_t size) {
+        if (m_failed) {
+            return false;
+        }
+        if (m_encoding == RegEncodingUnknown) {
+            m_head.append(data, size);
+            if (m_head.size() < 3) {
+                return true;
+            }
+            std::string head;
+            head.swap(m_head);
+            DetectEncoding(head);
+            size_t bomSize = (m_encoding == RegEncodingUtf16Le) ? 2 : (m_encoding == RegEncodingUtf8) ? 3 : 0;
+            FeedLines(head.data() + bomSize, head.size() - bomSize);
+            return !m_failed;
+        }
+        FeedLines(data, size);
+        return !m_failed;
+    }
+
+    // 输入结束，处理最后一行
+    bool Finish() {
+        if (m_failed) {
+            return false;
+        }
+        if (m_encoding == RegEncodingUnknown) {
+            std::string head;
+            head.swap(m_head);
+            DetectEncoding(head);
+            size_t bomSize = (m_encoding == RegEncodingUtf16Le) ? 2 : (m_encoding == RegEncodingUtf8) ? 3 : 0;
+            if (head.size() >= bomSize) {
+                FeedLines(head.data() + bomSize, head.size() - bomSize);
+            }
+        }
+        if (!m_failed && !m_pending.empty()) {
+            std::string last;
+            last.swap(m_pending);
+            ProcessRawLine(last.data(), last.size());
+        }
+        if (!m_failed && m_continuing) {
+            m_continuing = false;
+            ParseLogicalLine(m_logical);
+        }
+        if (!m_failed && m_version == RegVersionUnknown) {
+            Fail(1, "Empty registry file or missing header");
+        }
+        return !m_failed;
+    }
+
+    const std::string& GetError() const { return m_error; }
+    RegFileEncoding GetEncoding() const { return m_encoding; }
+    RegFileVersion GetVersion() const { return m_version; }
+    size_t GetWarningCount() const { return m_warningCount; }
+    size_t GetOpCount() const { return m_opCount; }
+    size_t GetLineCount() const { return m_lineNumber; }
+
+private:
+    void DetectEncoding(const std::string& head) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(head.data());
+        if (head.size() >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+            m_encoding = RegEncodingUtf16Le;
+        } else if (head.size() >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+            m_encoding = RegEncodingUtf8;
+        } else {
+            m_encoding = RegEncodingAnsi;
+        }
+    }
+
+    // 按换行符切分原始字节，跨块的不完整行暂存于m_pending
+    void FeedLines(const char* data, size_t size) {
+        if (m_encoding == RegEncodingUtf16Le) {
+            FeedUtf16Lines(data, size);
+            return;
+        }
+        const char* p = data;
+        const char* end = data + size;
+        while (p < end && !m_failed) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (nl == NULL) {
+                m_pending.append(p, end);
+                break;
+            }
+            if (m_pending.empty()) {
+                ProcessRawLine(p, static_cast<size_t>(nl - p));
+            } else {
+                m_pending.append(p, nl);
+                ProcessRawLine(m_pending.data(), m_pending.size());
+                m_pending.clear();
+            }
+            p = nl + 1;
+        }
+    }
+
+    void FeedUtf16Lines(const char* data, size_t size) {
+        // 上一块留下奇数字节时先补齐一个16位单元
+        if ((m_pending.size() & 1) != 0 && size > 0) {
+            m_pending.push_back(data[0]);
+            data++;
+            size--;
+            size_t n = m_pending.size();
+            if (m_pending[n - 2] == '\n' && m_pending[n - 1] == '\0') {
+                std::string line;
+                line.swap(m_pending);
+                ProcessRawLine(line.data(), n - 2);
+            }
+        }
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        size_t units = size / 2;
+        size_t start = 0;
+        while (start < units && !m_failed) {
+            size_t nl = start + RegFindUtf16AnyOf(bytes + start * 2, units - start, RegNewlineChars());
+            if (nl >= units) {
+                break;
+            }
+            if (m_pending.empty()) {
+                ProcessRawLine(data + start * 2, (nl - start) * 2);
+            } else {
+                m_pending.append(data + start * 2, (nl - start) * 2);
+                ProcessRawLine(m_pending.data(), m_pending.size());
+                m_pending.clear();
+            }
+            start = nl + 1;
+        }
+        if (!m_failed) {
+            m_pending.append(data + start * 2, size - start * 2);
+        }
+    }
+
+    // 解码一个物理行（不含换行符）为UTF-8
+    void ProcessRawLine(const char* data, size_t size) {
+        m_lineNumber++;
+        m_line.clear();
+        if (m_encoding == RegEncodingUtf16Le) {
+            size_t units = size / 2;
+            if (units > 0 && data[(units - 1) * 2] == '\r' && data[(units - 1) * 2 + 1] == '\0') {
+                units--;
+            }
+            Utf16LeToUtf8(reinterpret_cast<const uint8_t*>(data), units, &m_line);
+        } else {
+            if (size > 0 && data[size - 1] == '\r') {
+                size--;
+            }
+            if (m_encoding == RegEncodingAnsi) {
+                m_ansiDecoder(data, size, &m_line);
+            } else {
+                m_line.assign(data, size);
+            }
+        }
+        HandlePhysicalLine();
+    }
+
+    // 合并以反斜杠结尾的续行
+    void HandlePhysicalLine() {
+        if (m_continuing) {
+            size_t first = m_line.find_first_not_of(" \t");
+            if (first != std::string::npos) {
+                m_logical.append(m_line, first, std::string::npos);
+            }
+        } else {
+            m_logical.swap(m_line);
+            m_logicalLineStart = m_lineNumber;
+        }
+
+        // 只有值行可以续行，节标题和注释行不参与合并
+        size_t first = m_logical.find_first_not_of(" \t");
+        size_t last = m_logical.find_last_not_of(" \t");
+        bool isValueLine = first != std::string::npos && (m_logical[first] == '"' || m_logical[first] == '@');
+        if (isValueLine && m_logical[last] == '\\' && m_version != RegVersionUnknown) {
+            m_logical.resize(last);
+            m_continuing = true;
+            return;
+        }
+        m_continuing = false;
+        ParseLogicalLine(m_logical);
+    }
+
+    void ParseLogicalLine(const std::string& line) {
+        size_t begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos) {
+            return;
+        }
+        size_t end = line.find_last_not_of(" \t") + 1;
+
+        if (m_version == RegVersionUnknown) {
+            std::string header = line.substr(begin, end - begin);
+            if (header == "Windows Registry Editor Version 5.00") {
+                m_version = RegVersion5;
+            } else if (header == "REGEDIT4") {
+                m_version = RegVersion4;
+            } else {
+                Fail(m_logicalLineStart, "Invalid registry file header: " + header);
+            }
+            return;
+        }
+
+        char first = line[begin];
+        if (first == ';') {
+            return;
+        }
+        if (first == '[') {
+            ParseSection(line, begin, end);
+            return;
+        }
+        if (first == '@' || first == '"') {
+            ParseValue(line, begin, end);
+            return;
+        }
+        Warn("Unrecognized line ignored");
+    }
+
+    void ParseSection(const std::string& line, size_t begin, size_t end) {
+        size_t close = line.rfind(']', end - 1);
+        if (close == std::string::npos || close <= begin) {
+            Warn("Unterminated key section");
+            m_keyValid = false;
+            return;
+        }
+        bool isDelete = (close > begin + 1 && line[begin + 1] == '-');
+        size_t pathStart = begin + (isDelete ? 2 : 1);
+        std::string path = line.substr(pathStart, close - pathStart);
+        std::string normalized;
+        if (!NormalizeRegKeyPath(path, &normalized)) {
+            Warn("Invalid root key: " + path);
+            m_keyValid = false;
+            return;
+        }
+
+        m_op.kind = isDelete ? RegOpDeleteKey : RegOpCreateKey;
+        m_op.keyPath = normalized;
+        m_op.valueName.clear();
+        m_op.type = kRegNone;
+        m_op.data.clear();
+        Emit();
+
+        // 删除键后的值行被忽略（与regedit行为一致）
+        m_keyValid = !isDelete;
+        if (m_keyValid) {
+            m_currentKey.swap(normalized);
+        }
+    }
+
+    void ParseValue(const std::string& line, size_t begin, size_t end) {
+        if (!m_keyValid) {
+            Warn("Value outside of a key section ignored");
+            return;
+        }
+
+        size_t pos = begin;
+        m_op.valueName.clear();
+        if (line[pos] == '@') {
+            pos++;
+        } else if (!ParseQuoted(line, pos + 1, end, &m_op.valueName, &pos)) {
+            Warn("Unterminated value name");
+            return;
+        }
+
+        pos = SkipBlanks(line, pos, end);
+        if (pos >= end || line[pos] != '=') {
+            Warn("Missing '=' after value name");
+            return;
+        }
+        pos = SkipBlanks(line, pos + 1, end);
+
+        m_op.keyPath = m_currentKey;
+        m_op.data.clear();
+
+        if (pos < end && line[pos] == '"') {
+            std::string text;
+            size_t after = 0;
+            if (!ParseQuoted(line, pos + 1, end, &text, &after)) {
+                Warn("Unterminated string data");
+                return;
+            }
+            m_op.kind = RegOpSetValue;
+            m_op.type = kRegSz;
+            Utf8ToUtf16Le(text.data(), text.size(), &m_op.data);
+            m_op.data.push_back(0);
+            m_op.data.push_back(0);
+            Emit();
+            return;
+        }
+
+        if (end - pos == 1 && line[pos] == '-') {
+            m_op.kind = RegOpDeleteValue;
+            m_op.type = kRegNone;
+            Emit();
+            return;
+        }
+
+        if (StartsWithIgnoreCase(line, pos, end, "dword:")) {
+            uint32_t value = 0;
+            size_t digits = 0;
+            for (size_t i = pos + 6; i < end; i++) {
+                int nibble = HexNibble(line[i]);
+                if (nibble < 0 || digits == 8) {
+                    digits = 0;
+                    break;
+                }
+                value = (value << 4) | static_cast<uint32_t>(nibble);
+                digits++;
+            }
+            if (digits == 0) {
+                Warn("Invalid dword data");
+                return;
+            }
+            m_op.kind = RegOpSetValue;
+            m_op.type = kRegDword;
+            for (int i = 0; i < 4; i++) {
+                m_op.data.push_back(static_cast<uint8_t>((value >> (i * 8)) & 0xFF));
+            }
+            Emit();
+            return;
+        }
+
+        if (StartsWithIgnoreCase(line, pos, end, "hex")) {
+            uint32_t type = kRegBinary;
+            size_t p = pos + 3;
+            if (p < end && line[p] == '(') {
+                type = 0;
+                size_t digits = 0;
+                for (p++; p < end && line[p] != ')'; p++) {
+                    int nibble = HexNibble(line[p]);
+                    if (nibble < 0 || digits == 8) {
+                        digits = 0;
+                        break;
+                    }
+                    type = (type << 4) | static_cast<uint32_t>(nibble);
+                    digits++;
+                }
+                if (digits == 0 || p >= end) {
+                    Warn("Invalid hex type");
+                    return;
+                }
+                p++;
+            }
+            if (p >= end || line[p] != ':') {
+                Warn("Missing ':' after hex type");
+                return;
+            }
+            if (!ParseHexBytes(line, p + 1, end, &m_op.data)) {
+                Warn("Invalid hex data");
+                return;
+            }
+            // REGEDIT4中字符串类型的十六进制数据为ANSI字节，需转为UTF-16LE
+            if (m_version == RegVersion4 && (type == kRegSz || type == kRegExpandSz || type == kRegMultiSz)) {
+                std::string text;
+                m_ansiDecoder(reinterpret_cast<const char*>(m_op.data.data()), m_op.data.size(), &text);
+                m_op.data.clear();
+                Utf8ToUtf16Le(text.data(), text.size(), &m_op.data);
+            }
+            m_op.kind = RegOpSetValue;
+            m_op.type = type;
+            Emit();
+            return;
+        }
+
+        Warn("Unrecognized value data");
+    }
+
+    // 解析引号内的转义字符串，pos指向开引号之后，成功时next指向闭引号之后
+    static bool ParseQuoted(const std::string& line, size_t pos, size_t end, std::string* out, size_t* next) {
+        size_t i = pos;
+        while (i < end) {
+            // 普通字符段整体追加，只在引号和反斜杠处停下
+            size_t run = RegFindAnyOf(line.data() + i, end - i, RegQuoteChars());
+            out->append(line, i, run);
+            i += run;
+            if (i >= end) {
+                break;
+            }
+            if (line[i] == '"') {
+                *next = i + 1;
+                return true;
+            }
+            if (i + 1 < end) {
+                char e = line[i + 1];
+                if (e == '\\' || e == '"') {
+                    out->push_back(e);
+                    i += 2;
+                    continue;
+                }
+                if (e == 'n') {
+                    out->push_back('\n');
+                    i += 2;
+                    continue;
+                }
+                if (e == 'r') {
+                    out->push_back('\r');
+                    i += 2;
+                    continue;
+                }
+            }
+            out->push_back('\\');
+            i++;
+        }
+        return false;
+    }
+
+    // 解析逗号分隔的十六进制字节（续行已合并）
+    static bool ParseHexBytes(const std::string& line, size_t pos, size_t end, std::vector<uint8_t>* out) {
+        return RegHexDecodeList(line.data() + pos, end - pos, out);
+    }
+
+    static int HexNibble(char c) { return RegHexNibble(c); }
+
+    static size_t SkipBlanks(const std::string& line, size_t pos, size_t end) {
+        while (pos < end && (line[pos] == ' ' || line[pos] == '\t')) {
+            pos++;
+        }
+        return pos;
+    }
+
+    static bool StartsWithIgnoreCase(const std::string& line, size_t pos, size_t end, const char* prefix) {
+        size_t len = std::strlen(prefix);
+        return end - pos >= len && RegEqualsIgnoreCase(line.c_str() + pos, len, prefix, len);
+    }
+
+    void Emit() {
+        m_opCount++;
+        m_sink(m_op);
+    }
+
+    void Warn(const std::string& message) {
+        m_warningCount++;
+        if (m_warningSink) {
+            m_warningSink(m_logicalLineStart, message);
+        }
+    }
+
+    void Fail(size_t line, const std::string& message) {
+        m_failed = true;
+        m_error = "line " + std::to_string(line) + ": " + message;
+    }
+
+    RegOpSink m_sink;
+    RegWarningSink m_warningSink;
+    AnsiToUtf8Fn m_ansiDecoder;
+    RegFileEncoding m_encoding;
+    RegFileVersion m_version;
+    std::string m_head;         // 编码检测前暂存的文件头字节
+    std::string m_pending;      // 跨块的不完整物理行（原始字节）
+    std::string m_line;         // 当前物理行（UTF-8）
+    std::string m_logical;      // 当前逻辑行（续行已合并）
+    std::string m_currentKey;
+    RegOp m_op;
+    size_t m_lineNumber;
+    size_t m_logicalLineStart;
+    bool m_continuing;
+    bool m_keyValid;
+    bool m_failed;
+    std::string m_error;
+    size_t m_warningCount;
+    size_t m_opCount;
+};
+
+// 分块读取并解析.reg文件
+inline bool ParseRegFile(const std::string& path, RegFileParser& parser, std::string* error) {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        *error = "Cannot open file: " + path;
+        return false;
+    }
+    std::vector<char> buffer(64 * 1024);
+    while (file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        std::streamsize got = file.gcount();
+        if (got <= 0) {
+            break;
+        }
+        if (!parser.Feed(buffer.data(), static_cast<size_t>(got))) {
+            *error = parser.GetError();
+            return false;
+        }
+    }
+    if (!parser.Finish()) {
+        *error = parser.GetError();
+        return false;
+    }
+    return true;
+}
+
+// 整文件解析结果（供并行解析等需要先解析后应用的场景使用）
+struct RegParsedFile {
+    bool parsed;
+    std::string error;
+    std::vector<RegOp> ops;
+    std::vector<std::pair<size_t, std::string> > warnings;
+
+    RegParsedFile() : parsed(false) {}
+};
+
+// 解析整个文件到内存中的操作列表（不访问全局状态，可在工作线程中调用）
+inline void ParseRegFileToOps(const std::string& path, AnsiToUtf8Fn ansiDecoder, RegParsedFile* result) {
+    std::vector<RegOp>& ops = result->ops;
+    RegFileParser parser([&ops](const RegOp& op) { ops.push_back(op); });
+    parser.SetAnsiDecoder(ansiDecoder);
+    std::vector<std::pair<size_t, std::string> >& warnings = result->warnings;
+    parser.SetWarningSink([&warnings](size_t line, const std::string& message) {
+        warnings.push_back(std::make_pair(line, message));
+    });
+    result->parsed = ParseRegFile(path, parser, &result->error);
+}
+
+#endif // REG_PARSER_H
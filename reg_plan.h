@@ -0,0 +1,269 @@
+/*
+ * 静默注册表导入程序 - 跨文件写入合并规划
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 将多个文件的写操作按顺序合并到一棵不区分大小写的键树中：
+ * - 同一值的多次写入只保留最后一次
+ * - [-key]丢弃此前该子树内的所有写入
+ * - 对不存在的值的删除被消除
+ * 输出按键路径排序的最小写入计划，每个键只打开一次，每个值最多写一次
+ * 平台无关：不访问注册表
+ */
+
+#ifndef REG_PLAN_H
+#define REG_PLAN_H
+
+#include "reg_types.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 规划统计
+struct RegPlanStats {
+    size_t inputOps;                // 输入操作总数
+    size_t plannedOps;              // 计划中的操作数
+    size_t overwrittenValues;       // 被后续写入覆盖的值写入
+    size_t redundantValueDeletes;   // 删除不存在的值
+    size_t redundantKeyDeletes;     // 祖先键已删除时的重复删除
+    size_t discardedBySubtreeDelete;// 被后续[-key]丢弃的写入
+    size_t repeatedKeyOpens;        // 同一键的重复打开
+
+    RegPlanStats() : inputOps(0), plannedOps(0), overwrittenValues(0), redundantValueDeletes(0),
+                     redundantKeyDeletes(0), discardedBySubtreeDelete(0), repeatedKeyOpens(0) {}
+
+    size_t Eliminated() const { return inputOps > plannedOps ? inputOps - plannedOps : 0; }
+};
+
+// 写入合并规划器
+class RegWritePlanner {
+public:
+    RegWritePlanner() {}
+
+    // 按输入顺序添加一个操作，source为来源文件序号（用于失败归因）
+    void Add(const RegOp& op, size_t source) {
+        m_stats.inputOps++;
+        std::vector<std::string> segments;
+        SplitPath(op.keyPath, &segments);
+        // 根键不允许删除（应用时同样会被拒绝），不参与合并
+        if (segments.empty() || (op.kind == RegOpDeleteKey && segments.size() == 1)) {
+            return;
+        }
+
+        bool ancestorDeleted = false;
+        Node* node = Ensure(segments, op.kind == RegOpSetValue || op.kind == RegOpDeleteValue || op.kind == RegOpCreateKey,
+                            &ancestorDeleted);
+
+        switch (op.kind) {
+            case RegOpCreateKey:
+                if (node->opened) {
+                    m_stats.repeatedKeyOpens++;
+                }
+                node->opened = true;
+                node->source = source;
+                break;
+
+            case RegOpDeleteKey: {
+                m_stats.discardedBySubtreeDelete += CountWrites(*node);
+                node->children.clear();
+                node->values.clear();
+                node->created = false;
+                node->opened = false;
+                if (ancestorDeleted || node->deleteFirst) {
+                    // 祖先（或自身）已在此前被删除，中间重建的内容已从树中丢弃
+                    m_stats.redundantKeyDeletes++;
+                } else {
+                    node->deleteFirst = true;
+                    node->deleteSource = source;
+                }
+                break;
+            }
+
+            case RegOpSetValue: {
+                node->opened = true;
+                std::map<std::string, Value, RegLessIgnoreCase>::iterator it = node->values.find(op.valueName);
+                if (it != node->values.end()) {
+                    if (!it->second.isDelete) {
+                        m_stats.overwrittenValues++;
+                    } else {
+                        m_stats.redundantValueDeletes++;
+                    }
+                    it->second.isDelete = false;
+                    it->second.type = op.type;
+                    it->second.data = op.data;
+                    it->second.source = source;
+                } else {
+                    Value& value = node->values[op.valueName];
+                    value.name = op.valueName;
+                    value.isDelete = false;
+                    value.type = op.type;
+                    value.data = op.data;
+                    value.source = source;
+                }
+                break;
+            }
+
+            case RegOpDeleteValue: {
+                node->opened = true;
+                std::map<std::string, Value, RegLessIgnoreCase>::iterator it = node->values.find(op.valueName);
+                if (it != node->values.end()) {
+                    // 此前写入的值被删除抵消
+                    if (it->second.isDelete) {
+                        m_stats.redundantValueDeletes++;
+                    } else {
+                        m_stats.overwrittenValues++;
+                    }
+                    if (node->deleteFirst || ancestorDeleted) {
+                        // 键已被删除重建，值原本就不存在
+                        node->values.erase(it);
+                        m_stats.redundantValueDeletes++;
+                    } else {
+                        it->second.isDelete = true;
+                        it->second.type = kRegNone;
+                        it->second.data.clear();
+                        it->second.source = source;
+                    }
+                } else if (node->deleteFirst || ancestorDeleted) {
+                    m_stats.redundantValueDeletes++;
+                } else {
+                    Value& value = node->values[op.valueName];
+                    value.name = op.valueName;
+                    value.isDelete = true;
+                    value.type = kRegNone;
+                    value.source = source;
+                }
+                break;
+            }
+        }
+    }
+
+    // 生成按键路径排序的最小操作序列，sources与ops一一对应
+    void Build(std::vector<RegOp>* ops, std::vector<size_t>* sources) {
+        m_stats.plannedOps = 0;
+        for (NodeMap::iterator it = m_roots.begin(); it != m_roots.end(); ++it) {
+            Emit(*it->second, it->second->name, ops, sources);
+        }
+    }
+
+    const RegPlanStats& GetStats() const { return m_stats; }
+
+private:
+    struct Value {
+        std::string name;
+        bool isDelete;
+        uint32_t type;
+        std::vector<uint8_t> data;
+        size_t source;
+
+        Value() : isDelete(false), type(kRegNone), source(0) {}
+    };
+
+    struct Node;
+    typedef std::map<std::string, std::unique_ptr<Node>, RegLessIgnoreCase> NodeMap;
+
+    struct Node {
+        std::string name;           // 首次出现时的大小写形式
+        bool deleteFirst;           // 写入前先删除整个子树
+        bool created;               // 键被显式或隐式（作为中间路径）创建
+        bool opened;                // 键上有显式的[key]或值操作
+        size_t source;
+        size_t deleteSource;
+        std::map<std::string, Value, RegLessIgnoreCase> values;
+        NodeMap children;
+
+        Node() : deleteFirst(false), created(false), opened(false), source(0), deleteSource(0) {}
+    };
+
+    static void SplitPath(const std::string& path, std::vector<std::string>* segments) {
+        size_t start = 0;
+        while (start <= path.length()) {
+            size_t slash = path.find('\\', start);
+            if (slash == std::string::npos) {
+                slash = path.length();
+            }
+            if (slash > start) {
+                segments->push_back(path.substr(start, slash - start));
+            }
+            start = slash + 1;
+        }
+    }
+
+    // 定位（必要时创建）路径对应的节点；create为真时沿途节点都标记为已创建
+    Node* Ensure(const std::vector<std::string>& segments, bool create, bool* ancestorDeleted) {
+        NodeMap* level = &m_roots;
+        Node* node = NULL;
+        for (size_t i = 0; i < segments.size(); i++) {
+            if (node != NULL && node->deleteFirst) {
+                *ancestorDeleted = true;
+            }
+            std::unique_ptr<Node>& slot = (*level)[segments[i]];
+            if (!slot) {
+                slot.reset(new Node());
+                slot->name = segments[i];
+            }
+            node = slot.get();
+            if (create) {
+                node->created = true;
+            }
+            level = &node->children;
+        }
+        return node;
+    }
+
+    static size_t CountWrites(const Node& node) {
+        size_t count = node.values.size() + (node.opened ? 1 : 0);
+        for (NodeMap::const_iterator it = node.children.begin(); it != node.children.end(); ++it) {
+            count += CountWrites(*it->second);
+        }
+        return count;
+    }
+
+    static bool HasCreatedChild(const Node& node) {
+        for (NodeMap::const_iterator it = node.children.begin(); it != node.children.end(); ++it) {
+            if (it->second->created) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Emit(const Node& node, const std::string& path, std::vector<RegOp>* ops, std::vector<size_t>* sources) {
+        RegOp op;
+        op.keyPath = path;
+        if (node.deleteFirst) {
+            op.kind = RegOpDeleteKey;
+            ops->push_back(op);
+            sources->push_back(node.deleteSource);
+            m_stats.plannedOps++;
+        }
+        // 有值操作或没有子键会隐式创建它时才需要显式打开
+        if (node.created && (!node.values.empty() || !HasCreatedChild(node))) {
+            op.kind = RegOpCreateKey;
+            ops->push_back(op);
+            sources->push_back(node.source);
+            m_stats.plannedOps++;
+            for (std::map<std::string, Value, RegLessIgnoreCase>::const_iterator it = node.values.begin();
+                 it != node.values.end(); ++it) {
+                const Value& value = it->second;
+                op.kind = value.isDelete ? RegOpDeleteValue : RegOpSetValue;
+                op.valueName = value.name;
+                op.type = value.type;
+                op.data = value.data;
+                ops->push_back(op);
+                sources->push_back(value.source);
+                m_stats.plannedOps++;
+            }
+        }
+        for (NodeMap::const_iterator it = node.children.begin(); it != node.children.end(); ++it) {
+            Emit(*it->second, path + "\\" + it->second->name, ops, sources);
+        }
+    }
+
+    NodeMap m_roots;
+    RegPlanStats m_stats;
+};
+
+#endif // REG_PLAN_H
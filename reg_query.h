@@ -0,0 +1,261 @@
+/*
+ * 静默注册表导入程序 - 注册表查询输出
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 通过RegBackend遍历（可并行）键及其值并按缩进格式输出
+ * 字符串值为UTF-16LE，输出前转换为UTF-8
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_QUERY_H
+#define REG_QUERY_H
+
+#include "reg_backend.h"
+#include "reg_encoding.h"
+#include "reg_hex.h"
+#include "reg_traverse.h"
+#include "reg_types.h"
+
+#include <cstdio>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 日志消息回调
+typedef std::function<void(const std::string& message)> RegLogSink;
+
+// 获取注册表数据类型名称
+inline const char* GetRegTypeName(uint32_t type) {
+    if (type == kRegNone) return "REG_NONE";
+    if (type == kRegSz) return "REG_SZ";
+    if (type == kRegExpandSz) return "REG_EXPAND_SZ";
+    if (type == kRegBinary) return "REG_BINARY";
+    if (type == kRegDword) return "REG_DWORD";
+    if (type == kRegDwordBigEndian) return "REG_DWORD_BIG_ENDIAN";
+    if (type == kRegLink) return "REG_LINK";
+    if (type == kRegMultiSz) return "REG_MULTI_SZ";
+    if (type == kRegResourceList) return "REG_RESOURCE_LIST";
+    if (type == kRegFullResourceDescriptor) return "REG_FULL_RESOURCE_DESCRIPTOR";
+    if (type == kRegResourceRequirementsList) return "REG_RESOURCE_REQUIREMENTS_LIST";
+    if (type == kRegQword) return "REG_QWORD";
+    return "UNKNOWN";
+}
+
+// UTF-16LE字符串数据转换为UTF-8并追加到out（去掉结尾的NUL）
+inline void AppendRegStringData(const uint8_t* data, size_t dataSize, std::string* out) {
+    size_t units = dataSize / 2;
+    while (units > 0 && data[units * 2 - 2] == 0 && data[units * 2 - 1] == 0) {
+        units--;
+    }
+    Utf16LeToUtf8(data, units, out);
+}
+
+inline std::string RegStringDataToUtf8(const uint8_t* data, size_t dataSize) {
+    std::string text;
+    AppendRegStringData(data, dataSize, &text);
+    return text;
+}
+
+// 格式化注册表值数据并追加到out（out的容量足够时不分配内存）
+inline void AppendRegValueData(uint32_t type, const uint8_t* data, size_t dataSize, std::string* out) {
+    if (data == NULL || dataSize == 0) {
+        out->append("(empty)");
+        return;
+    }
+
+    char number[64];
+    switch (type) {
+        case kRegSz:
+        case kRegExpandSz: {
+            AppendRegStringData(data, dataSize, out);
+            return;
+        }
+        case kRegDword: {
+            if (dataSize >= 4) {
+                uint32_t value = static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+                                 (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+                int length = std::snprintf(number, sizeof(number), "0x%08X (%u)", value, value);
+                out->append(number, static_cast<size_t>(length));
+                return;
+            }
+            out->append("(invalid DWORD)");
+            return;
+        }
+        case kRegQword: {
+            if (dataSize >= 8) {
+                unsigned long long value = 0;
+                for (int i = 7; i >= 0; i--) {
+                    value = (value << 8) | data[i];
+                }
+                int length = std::snprintf(number, sizeof(number), "0x%016llX (%llu)", value, value);
+                out->append(number, static_cast<size_t>(length));
+                return;
+            }
+            out->append("(invalid QWORD)");
+            return;
+        }
+        case kRegBinary: {
+            // 完整输出，不截断
+            size_t base = out->size();
+            out->resize(base + dataSize * 3 - 1);
+            RegHexEncodeList(data, dataSize, ' ', true, &(*out)[base]);
+            return;
+        }
+        case kRegMultiSz: {
+            size_t units = dataSize / 2;
+            size_t start = 0;
+            bool first = true;
+            for (size_t i = 0; i <= units; i++) {
+                bool end = (i == units) || (data[i * 2] == 0 && data[i * 2 + 1] == 0);
+                if (!end) {
+                    continue;
+                }
+                if (i > start) {
+                    if (!first) out->append("; ");
+                    Utf16LeToUtf8(data + start * 2, i - start, out);
+                    first = false;
+                }
+                start = i + 1;
+            }
+            return;
+        }
+        default: {
+            int length = std::snprintf(number, sizeof(number), "(%s, %lu bytes)", GetRegTypeName(type),
+                                       static_cast<unsigned long>(dataSize));
+            out->append(number, static_cast<size_t>(length));
+            return;
+        }
+    }
+}
+
+// 格式化注册表值数据
+inline std::string FormatRegValueData(uint32_t type, const uint8_t* data, size_t dataSize) {
+    std::string result;
+    AppendRegValueData(type, data, dataSize, &result);
+    return result;
+}
+
+// 查询输出器：每个键输出路径行和值行，按缩进表示层级
+class RegQueryPrinter : public RegTraversalVisitor {
+public:
+    // jobs > 1时子树由多个线程并行遍历，输出顺序不变
+    RegQueryPrinter(RegBackend& backend, std::ostream& out, size_t jobs = 1)
+        : m_backend(backend), m_out(out), m_jobs(jobs), m_keys(0), m_filter(NULL) {}
+
+    void SetLogSink(const RegLogSink& sink) { m_log = sink; }
+
+    // 只输出过滤器选中的键和值（过滤器须在查询期间保持有效）
+    void SetFilter(const RegKeyFilter* filter) { m_filter = filter; }
+
+    // 依次查询各路径下的所有值和子键，任一路径无效或无法打开时返回false
+    bool Query(const std::vector<std::string>& paths) {
+        bool success = true;
+        std::vector<std::string> roots;
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!SplitRegKeyPath(paths[i], NULL, NULL)) {
+                Log("Error: Invalid registry path format: " + paths[i]);
+                success = false;
+            } else {
+                roots.push_back(paths[i]);
+            }
+        }
+        RegTraversal traversal(m_backend, *this, m_jobs);
+        traversal.SetFilter(m_filter);
+        traversal.Run(roots, [this, &success](const std::string&, int depth, RegTraversalOutput& output) {
+            size_t start = 0;
+            for (size_t i = 0; i < output.logEnds.size(); i++) {
+                m_line.assign(output.logs, start, output.logEnds[i] - start);
+                Log(m_line);
+                start = output.logEnds[i];
+            }
+            m_out.write(reinterpret_cast<const char*>(output.data.data()),
+                        static_cast<std::streamsize>(output.data.size()));
+            if (output.opened) {
+                m_keys += output.selected ? 1 : 0;
+            } else if (depth == 0) {
+                success = false;
+            }
+        });
+        m_traversalStats = traversal.GetStats();
+        return success;
+    }
+
+    bool Query(const std::string& path) { return Query(std::vector<std::string>(1, path)); }
+
+    size_t GetKeyCount() const { return m_keys; }
+    const RegTraversalStats& GetTraversalStats() const { return m_traversalStats; }
+
+    // 键行和值行先在线程的格式化缓冲区中拼接，再整行追加到输出，不产生临时字符串
+    bool VisitKey(RegBackend& backend, RegKeyHandle key, const std::string& path, int depth,
+                  RegTraversalContext& context, RegTraversalOutput* out) override {
+        if (m_log) {
+            AppendLog(out, "Querying registry path: ", path);
+        }
+        size_t indent = static_cast<size_t>(depth) * 2;
+        std::string& text = context.text;
+
+        // 打印键路径
+        text.assign(indent, ' ');
+        text.append(depth == 0 ? "[ " : "").append(path).append(depth == 0 ? " ]\n" : "\n");
+        Append(out, text);
+
+        // 枚举键值
+        for (uint32_t index = 0; ; index++) {
+            long result = backend.EnumValue(key, index, &context.name, &context.type, &context.data);
+            if (result == kRegErrorNoMoreItems) {
+                break;
+            }
+            if (result == kRegSuccess && context.ValueSelected()) {
+                const char* typeName = GetRegTypeName(context.type);
+                text.assign(indent + 2, ' ');
+                text.append("\"").append(context.name).append("\" = ");
+                size_t valueStart = text.size();
+                AppendRegValueData(context.type, context.data.data(), context.data.size(), &text);
+                size_t valueEnd = text.size();
+                text.append(" (").append(typeName).append(")\n");
+                Append(out, text);
+                if (m_log) {
+                    out->logs.append("  Value: ").append(context.name).append(" (").append(typeName).append(") = ");
+                    out->logs.append(text, valueStart, valueEnd - valueStart);
+                    out->EndLog();
+                }
+                out->values++;
+            }
+        }
+        return true;
+    }
+
+    void VisitError(const std::string& path, int, long result, RegTraversalOutput* out) override {
+        AppendLog(out, "Error: Failed to open registry key: ", path + " (Error code: " + std::to_string(result) + ")");
+    }
+
+private:
+    static void Append(RegTraversalOutput* out, const std::string& text) {
+        out->data.insert(out->data.end(), text.begin(), text.end());
+    }
+
+    static void AppendLog(RegTraversalOutput* out, const char* prefix, const std::string& text) {
+        out->logs.append(prefix).append(text);
+        out->EndLog();
+    }
+
+    void Log(const std::string& message) {
+        if (m_log) {
+            m_log(message);
+        }
+    }
+
+    RegBackend& m_backend;
+    std::ostream& m_out;
+    size_t m_jobs;
+    size_t m_keys;
+    const RegKeyFilter* m_filter;
+    RegTraversalStats m_traversalStats;
+    RegLogSink m_log;
+    std::string m_line;     // 日志消息的复用缓冲区（仅在调用线程中使用）
+};
+
+#endif // REG_QUERY_H
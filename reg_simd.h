@@ -0,0 +1,607 @@
+/*
+ * 静默注册表导入程序 - SIMD文本扫描与编码转换内核
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * SSE2/AVX2向量化实现，运行时按CPU能力分派，非x86平台使用标量实现
+ * 子串查找先用向量比较子串的首尾字符筛选候选位置，再逐个校验；
+ * 忽略大小写时子串须已转为小写，只折叠ASCII字母
+ * 平台无关：不依赖windows.h
+ */
+
+#ifndef REG_SIMD_H
+#define REG_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define REG_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define REG_SIMD_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define REG_TARGET_SSE2 __attribute__((target("sse2")))
+#define REG_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define REG_TARGET_SSE2
+#define REG_TARGET_AVX2
+#endif
+
+// 向量化指令集级别
+enum RegSimdLevel {
+    RegSimdScalar = 0,
+    RegSimdSse2 = 1,
+    RegSimdAvx2 = 2
+};
+
+inline const char* RegSimdLevelName(RegSimdLevel level) {
+    if (level == RegSimdAvx2) return "avx2";
+    if (level == RegSimdSse2) return "sse2";
+    return "scalar";
+}
+
+// 检测CPU支持的最高级别
+inline RegSimdLevel RegDetectSimdLevel() {
+#if REG_SIMD_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2") != 0;
+    bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    if (avx2) return RegSimdAvx2;
+    if (sse2) return RegSimdSse2;
+#endif
+    return RegSimdScalar;
+}
+
+inline RegSimdLevel& RegSimdLevelStorage() {
+    static RegSimdLevel level = RegDetectSimdLevel();
+    return level;
+}
+
+// 当前使用的级别
+inline RegSimdLevel RegGetSimdLevel() {
+    return RegSimdLevelStorage();
+}
+
+// 强制使用指定级别（不会超过CPU实际支持的级别，基准测试使用）
+inline RegSimdLevel RegSetSimdLevel(RegSimdLevel level) {
+    RegSimdLevel detected = RegDetectSimdLevel();
+    RegSimdLevelStorage() = (level > detected) ? detected : level;
+    return RegSimdLevelStorage();
+}
+
+inline unsigned RegCountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// 最多8个ASCII字符组成的查找集合
+struct RegCharSet {
+    char chars[8];
+    int count;
+    bool table[256];
+
+    explicit RegCharSet(const char* set) : count(0) {
+        std::memset(table, 0, sizeof(table));
+        std::memset(chars, 0, sizeof(chars));
+        for (const char* p = set; *p != '\0' && count < 8; p++) {
+            chars[count++] = *p;
+            table[static_cast<unsigned char>(*p)] = true;
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// 标量实现
+// ---------------------------------------------------------------------------
+
+inline size_t RegFindAnyOfScalar(const char* p, size_t n, const RegCharSet& set) {
+    for (size_t i = 0; i < n; i++) {
+        if (set.table[static_cast<unsigned char>(p[i])]) {
+            return i;
+        }
+    }
+    return n;
+}
+
+inline size_t RegFindUtf16AnyOfScalar(const uint8_t* p, size_t units, const RegCharSet& set) {
+    for (size_t i = 0; i < units; i++) {
+        if (p[i * 2 + 1] == 0 && set.table[p[i * 2]]) {
+            return i;
+        }
+    }
+    return units;
+}
+
+inline size_t RegFindUtf16ControlScalar(const uint8_t* p, size_t units) {
+    for (size_t i = 0; i < units; i++) {
+        if (p[i * 2 + 1] == 0 && p[i * 2] < 0x20) {
+            return i;
+        }
+    }
+    return units;
+}
+
+inline size_t RegUtf16AsciiToUtf8Scalar(const uint8_t* src, size_t units, char* dst) {
+    size_t i = 0;
+    while (i < units && src[i * 2 + 1] == 0 && src[i * 2] < 0x80) {
+        dst[i] = static_cast<char>(src[i * 2]);
+        i++;
+    }
+    return i;
+}
+
+inline size_t RegAsciiToUtf16LeScalar(const char* src, size_t size, uint8_t* dst) {
+    size_t i = 0;
+    while (i < size && static_cast<unsigned char>(src[i]) < 0x80) {
+        dst[i * 2] = static_cast<uint8_t>(src[i]);
+        dst[i * 2 + 1] = 0;
+        i++;
+    }
+    return i;
+}
+
+inline char RegSimdAsciiLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// 筛选时与块按位或的折叠掩码：忽略大小写且为字母时为0x20（把大写映射为小写），否则为0
+inline uint8_t RegSimdFoldMask(char c, bool ignoreCase) {
+    return (ignoreCase && c >= 'a' && c <= 'z') ? 0x20 : 0;
+}
+
+// p处是否为子串（needle已按ignoreCase转为小写）
+inline bool RegSubstringAt(const char* p, const char* needle, size_t m, bool ignoreCase) {
+    if (!ignoreCase) {
+        return std::memcmp(p, needle, m) == 0;
+    }
+    for (size_t i = 0; i < m; i++) {
+        if (RegSimdAsciiLower(p[i]) != needle[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// UTF-16LE版本：m为单元数
+inline bool RegSubstringAtUtf16(const uint8_t* p, const uint8_t* needle, size_t m, bool ignoreCase) {
+    if (!ignoreCase) {
+        return std::memcmp(p, needle, m * 2) == 0;
+    }
+    for (size_t i = 0; i < m; i++) {
+        char c = (p[i * 2 + 1] == 0) ? RegSimdAsciiLower(static_cast<char>(p[i * 2])) : static_cast<char>(p[i * 2]);
+        if (static_cast<uint8_t>(c) != needle[i * 2] || p[i * 2 + 1] != needle[i * 2 + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline size_t RegFindSubstringScalar(const char* p, size_t n, const char* needle, size_t m, bool ignoreCase) {
+    for (size_t i = 0; i + m <= n; i++) {
+        if (RegSubstringAt(p + i, needle, m, ignoreCase)) {
+            return i;
+        }
+    }
+    return n;
+}
+
+inline size_t RegFindSubstringUtf16Scalar(const uint8_t* p, size_t units, const uint8_t* needle, size_t m,
+                                          bool ignoreCase) {
+    for (size_t i = 0; i + m <= units; i++) {
+        if (RegSubstringAtUtf16(p + i * 2, needle, m, ignoreCase)) {
+            return i;
+        }
+    }
+    return units;
+}
+
+#if REG_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// SSE2实现
+// ---------------------------------------------------------------------------
+
+REG_TARGET_SSE2 inline size_t RegFindAnyOfSse2(const char* p, size_t n, const RegCharSet& set) {
+    __m128i needles[8];
+    for (int k = 0; k < set.count; k++) {
+        needles[k] = _mm_set1_epi8(set.chars[k]);
+    }
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_cmpeq_epi8(block, needles[0]);
+        for (int k = 1; k < set.count; k++) {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, needles[k]));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if (mask != 0) {
+            return i + RegCountTrailingZeros(mask);
+        }
+    }
+    return i + RegFindAnyOfScalar(p + i, n - i, set);
+}
+
+REG_TARGET_SSE2 inline size_t RegFindUtf16AnyOfSse2(const uint8_t* p, size_t units, const RegCharSet& set) {
+    __m128i needles[8];
+    for (int k = 0; k < set.count; k++) {
+        needles[k] = _mm_set1_epi16(static_cast<short>(static_cast<unsigned char>(set.chars[k])));
+    }
+    size_t i = 0;
+    for (; i + 8 <= units; i += 8) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 2));
+        __m128i hit = _mm_cmpeq_epi16(block, needles[0]);
+        for (int k = 1; k < set.count; k++) {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi16(block, needles[k]));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if (mask != 0) {
+            return i + RegCountTrailingZeros(mask) / 2;
+        }
+    }
+    return i + RegFindUtf16AnyOfScalar(p + i * 2, units - i, set);
+}
+
+// 无符号饱和减0x1F后为0的单元即小于0x20
+REG_TARGET_SSE2 inline size_t RegFindUtf16ControlSse2(const uint8_t* p, size_t units) {
+    const __m128i limit = _mm_set1_epi16(0x1F);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= units; i += 8) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 2));
+        __m128i hit = _mm_cmpeq_epi16(_mm_subs_epu16(block, limit), zero);
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+        if (mask != 0) {
+            return i + RegCountTrailingZeros(mask) / 2;
+        }
+    }
+    return i + RegFindUtf16ControlScalar(p + i * 2, units - i);
+}
+
+REG_TARGET_SSE2 inline size_t RegUtf16AsciiToUtf8Sse2(const uint8_t* src, size_t units, char* dst) {
+    const __m128i highMask = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= units; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2 + 16));
+        __m128i high = _mm_and_si128(_mm_or_si128(a, b), highMask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+    }
+    return i + RegUtf16AsciiToUtf8Scalar(src + i * 2, units - i, dst + i);
+}
+
+REG_TARGET_SSE2 inline size_t RegAsciiToUtf16LeSse2(const char* src, size_t size, uint8_t* dst) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(block) != 0) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), _mm_unpacklo_epi8(block, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2 + 16), _mm_unpackhi_epi8(block, zero));
+    }
+    return i + RegAsciiToUtf16LeScalar(src + i, size - i, dst + i * 2);
+}
+
+REG_TARGET_SSE2 inline size_t RegFindSubstringSse2(const char* p, size_t n, const char* needle, size_t m,
+                                                   bool ignoreCase) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    const __m128i foldFirst = _mm_set1_epi8(static_cast<char>(RegSimdFoldMask(needle[0], ignoreCase)));
+    const __m128i foldLast = _mm_set1_epi8(static_cast<char>(RegSimdFoldMask(needle[m - 1], ignoreCase)));
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), foldFirst);
+        __m128i b = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + m - 1)), foldLast);
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                                              _mm_cmpeq_epi8(b, last))));
+        while (mask != 0) {
+            size_t candidate = i + RegCountTrailingZeros(mask);
+            if (RegSubstringAt(p + candidate, needle, m, ignoreCase)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = RegFindSubstringScalar(p + i, n - i, needle, m, ignoreCase);
+    return rest == n - i ? n : i + rest;
+}
+
+REG_TARGET_SSE2 inline size_t RegFindSubstringUtf16Sse2(const uint8_t* p, size_t units, const uint8_t* needle,
+                                                        size_t m, bool ignoreCase) {
+    uint16_t firstUnit = static_cast<uint16_t>(needle[0] | (needle[1] << 8));
+    uint16_t lastUnit = static_cast<uint16_t>(needle[m * 2 - 2] | (needle[m * 2 - 1] << 8));
+    const __m128i first = _mm_set1_epi16(static_cast<short>(firstUnit));
+    const __m128i last = _mm_set1_epi16(static_cast<short>(lastUnit));
+    const __m128i foldFirst = _mm_set1_epi16(firstUnit < 0x80 ? RegSimdFoldMask(static_cast<char>(firstUnit), ignoreCase) : 0);
+    const __m128i foldLast = _mm_set1_epi16(lastUnit < 0x80 ? RegSimdFoldMask(static_cast<char>(lastUnit), ignoreCase) : 0);
+    size_t i = 0;
+    for (; i + m - 1 + 8 <= units; i += 8) {
+        __m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 2)), foldFirst);
+        __m128i b = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + (i + m - 1) * 2)), foldLast);
+        // 每个单元的比较结果占两位，只保留低位
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, first),
+                                                                              _mm_cmpeq_epi16(b, last)))) & 0x5555;
+        while (mask != 0) {
+            size_t candidate = i + RegCountTrailingZeros(mask) / 2;
+            if (RegSubstringAtUtf16(p + candidate * 2, needle, m, ignoreCase)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = RegFindSubstringUtf16Scalar(p + i * 2, units - i, needle, m, ignoreCase);
+    return rest == units - i ? units : i + rest;
+}
+
+// ---------------------------------------------------------------------------
+// AVX2实现
+// ---------------------------------------------------------------------------
+
+REG_TARGET_AVX2 inline size_t RegFindAnyOfAvx2(const char* p, size_t n, const RegCharSet& set) {
+    __m256i needles[8];
+    for (int k = 0; k < set.count; k++) {
+        needles[k] = _mm256_set1_epi8(set.chars[k]);
+    }
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = _mm256_cmpeq_epi8(block, needles[0]);
+        for (int k = 1; k < set.count; k++) {
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(block, needles[k]));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask != 0) {
+            return i + RegCountTrailingZeros(mask);
+        }
+    }
+    return i + RegFindAnyOfScalar(p + i, n - i, set);
+}
+
+REG_TARGET_AVX2 inline size_t RegFindUtf16AnyOfAvx2(const uint8_t* p, size_t units, const RegCharSet& set) {
+    __m256i needles[8];
+    for (int k = 0; k < set.count; k++) {
+        needles[k] = _mm256_set1_epi16(static_cast<short>(static_cast<unsigned char>(set.chars[k])));
+    }
+    size_t i = 0;
+    for (; i + 16 <= units; i += 16) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 2));
+        __m256i hit = _mm256_cmpeq_epi16(block, needles[0]);
+        for (int k = 1; k < set.count; k++) {
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi16(block, needles[k]));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask != 0) {
+            return i + RegCountTrailingZeros(mask) / 2;
+        }
+    }
+    return i + RegFindUtf16AnyOfScalar(p + i * 2, units - i, set);
+}
+
+REG_TARGET_AVX2 inline size_t RegFindUtf16ControlAvx2(const uint8_t* p, size_t units) {
+    const __m256i limit = _mm256_set1_epi16(0x1F);
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= units; i += 16) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 2));
+        __m256i hit = _mm256_cmpeq_epi16(_mm256_subs_epu16(block, limit), zero);
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hit));
+        if (mask != 0) {
+            return i + RegCountTrailingZeros(mask) / 2;
+        }
+    }
+    return i + RegFindUtf16ControlScalar(p + i * 2, units - i);
+}
+
+REG_TARGET_AVX2 inline size_t RegUtf16AsciiToUtf8Avx2(const uint8_t* src, size_t units, char* dst) {
+    const __m256i highMask = _mm256_set1_epi16(static_cast<short>(0xFF80));
+    size_t i = 0;
+    for (; i + 32 <= units; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 2 + 32));
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), highMask)) {
+            break;
+        }
+        // packus按128位通道交错，需要重排为顺序结果
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    return i + RegUtf16AsciiToUtf8Sse2(src + i * 2, units - i, dst + i);
+}
+
+REG_TARGET_AVX2 inline size_t RegAsciiToUtf16LeAvx2(const char* src, size_t size, uint8_t* dst) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        if (_mm256_movemask_epi8(block) != 0) {
+            break;
+        }
+        __m256i low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(block));
+        __m256i high = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(block, 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2), low);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 2 + 32), high);
+    }
+    return i + RegAsciiToUtf16LeSse2(src + i, size - i, dst + i * 2);
+}
+
+REG_TARGET_AVX2 inline size_t RegFindSubstringAvx2(const char* p, size_t n, const char* needle, size_t m,
+                                                   bool ignoreCase) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    const __m256i foldFirst = _mm256_set1_epi8(static_cast<char>(RegSimdFoldMask(needle[0], ignoreCase)));
+    const __m256i foldLast = _mm256_set1_epi8(static_cast<char>(RegSimdFoldMask(needle[m - 1], ignoreCase)));
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i a = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), foldFirst);
+        __m256i b = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + m - 1)), foldLast);
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                                                     _mm256_cmpeq_epi8(b, last))));
+        while (mask != 0) {
+            size_t candidate = i + RegCountTrailingZeros(mask);
+            if (RegSubstringAt(p + candidate, needle, m, ignoreCase)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = RegFindSubstringSse2(p + i, n - i, needle, m, ignoreCase);
+    return rest == n - i ? n : i + rest;
+}
+
+REG_TARGET_AVX2 inline size_t RegFindSubstringUtf16Avx2(const uint8_t* p, size_t units, const uint8_t* needle,
+                                                        size_t m, bool ignoreCase) {
+    uint16_t firstUnit = static_cast<uint16_t>(needle[0] | (needle[1] << 8));
+    uint16_t lastUnit = static_cast<uint16_t>(needle[m * 2 - 2] | (needle[m * 2 - 1] << 8));
+    const __m256i first = _mm256_set1_epi16(static_cast<short>(firstUnit));
+    const __m256i last = _mm256_set1_epi16(static_cast<short>(lastUnit));
+    const __m256i foldFirst = _mm256_set1_epi16(firstUnit < 0x80 ? RegSimdFoldMask(static_cast<char>(firstUnit), ignoreCase) : 0);
+    const __m256i foldLast = _mm256_set1_epi16(lastUnit < 0x80 ? RegSimdFoldMask(static_cast<char>(lastUnit), ignoreCase) : 0);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= units; i += 16) {
+        __m256i a = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 2)), foldFirst);
+        __m256i b = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + (i + m - 1) * 2)),
+                                    foldLast);
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(
+                            _mm256_cmpeq_epi16(a, first), _mm256_cmpeq_epi16(b, last)))) & 0x55555555u;
+        while (mask != 0) {
+            size_t candidate = i + RegCountTrailingZeros(mask) / 2;
+            if (RegSubstringAtUtf16(p + candidate * 2, needle, m, ignoreCase)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = RegFindSubstringUtf16Sse2(p + i * 2, units - i, needle, m, ignoreCase);
+    return rest == units - i ? units : i + rest;
+}
+
+#endif // REG_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// 分派入口
+// ---------------------------------------------------------------------------
+
+// 查找集合中任一字符首次出现的位置，未找到返回n
+inline size_t RegFindAnyOf(const char* p, size_t n, const RegCharSet& set) {
+#if REG_SIMD_X86
+    switch (RegGetSimdLevel()) {
+        case RegSimdAvx2: return RegFindAnyOfAvx2(p, n, set);
+        case RegSimdSse2: return RegFindAnyOfSse2(p, n, set);
+        default: break;
+    }
+#endif
+    return RegFindAnyOfScalar(p, n, set);
+}
+
+// 在UTF-16LE数据中查找集合中任一ASCII字符首次出现的单元位置，未找到返回units
+inline size_t RegFindUtf16AnyOf(const uint8_t* p, size_t units, const RegCharSet& set) {
+#if REG_SIMD_X86
+    switch (RegGetSimdLevel()) {
+        case RegSimdAvx2: return RegFindUtf16AnyOfAvx2(p, units, set);
+        case RegSimdSse2: return RegFindUtf16AnyOfSse2(p, units, set);
+        default: break;
+    }
+#endif
+    return RegFindUtf16AnyOfScalar(p, units, set);
+}
+
+// 在UTF-16LE数据中查找首个控制字符（小于0x20的单元，含NUL、CR、LF），未找到返回units
+inline size_t RegFindUtf16Control(const uint8_t* p, size_t units) {
+#if REG_SIMD_X86
+    switch (RegGetSimdLevel()) {
+        case RegSimdAvx2: return RegFindUtf16ControlAvx2(p, units);
+        case RegSimdSse2: return RegFindUtf16ControlSse2(p, units);
+        default: break;
+    }
+#endif
+    return RegFindUtf16ControlScalar(p, units);
+}
+
+// 转换UTF-16LE开头的连续ASCII单元为单字节，返回转换的单元数
+inline size_t RegUtf16AsciiToUtf8(const uint8_t* src, size_t units, char* dst) {
+#if REG_SIMD_X86
+    switch (RegGetSimdLevel()) {
+        case RegSimdAvx2: return RegUtf16AsciiToUtf8Avx2(src, units, dst);
+        case RegSimdSse2: return RegUtf16AsciiToUtf8Sse2(src, units, dst);
+        default: break;
+    }
+#endif
+    return RegUtf16AsciiToUtf8Scalar(src, units, dst);
+}
+
+// 转换开头的连续ASCII字节为UTF-16LE，返回转换的字节数
+inline size_t RegAsciiToUtf16Le(const char* src, size_t size, uint8_t* dst) {
+#if REG_SIMD_X86
+    switch (RegGetSimdLevel()) {
+        case RegSimdAvx2: return RegAsciiToUtf16LeAvx2(src, size, dst);
+        case RegSimdSse2: return RegAsciiToUtf16LeSse2(src, size, dst);
+        default: break;
+    }
+#endif
+    return RegAsciiToUtf16LeScalar(src, size, dst);
+}
+
+// 查找子串needle（m个字节，m > 0）首次出现的位置，未找到返回n；ignoreCase时needle须已转为小写
+inline size_t RegFindSubstring(const char* p, size_t n, const char* needle, size_t m, bool ignoreCase) {
+    if (m == 0 || m > n) {
+        return n;
+    }
+#if REG_SIMD_X86
+    switch (RegGetSimdLevel()) {
+        case RegSimdAvx2: return RegFindSubstringAvx2(p, n, needle, m, ignoreCase);
+        case RegSimdSse2: return RegFindSubstringSse2(p, n, needle, m, ignoreCase);
+        default: break;
+    }
+#endif
+    return RegFindSubstringScalar(p, n, needle, m, ignoreCase);
+}
+
+// 在UTF-16LE数据中按单元查找子串（needle为m个单元的UTF-16LE），未找到返回units
+inline size_t RegFindSubstringUtf16(const uint8_t* p, size_t units, const uint8_t* needle, size_t m,
+                                    bool ignoreCase) {
+    if (m == 0 || m > units) {
+        return units;
+    }
+#if REG_SIMD_X86
+    switch (RegGetSimdLevel()) {
+        case RegSimdAvx2: return RegFindSubstringUtf16Avx2(p, units, needle, m, ignoreCase);
+        case RegSimdSse2: return RegFindSubstringUtf16Sse2(p, units, needle, m, ignoreCase);
+        default: break;
+    }
+#endif
+    return RegFindSubstringUtf16Scalar(p, units, needle, m, ignoreCase);
+}
+
+#endif // REG_SIMD_H
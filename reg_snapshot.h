@@ -0,0 +1,742 @@
+/*
+ * 静默注册表导入程序 - 二进制快照
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 把子树保存为可直接映射使用的二进制文件，再次查询、导出或导入时不需要解析文本：
+ * - 文件依次为文件头、值数据区、字符串池、键表、值表和尾部目录；
+ *   值数据随遍历流式写出，只有键表、值表和字符串池保存在内存中，目录最后写入
+ * - 键名和值名去重后保存在字符串池中（UTF-8），记录中只保存偏移和长度
+ * - 键表按层序排列：同一父键的子键连续存放并按大写折叠排序，
+ *   按路径查找时每一级做一次二分查找
+ * - 值按枚举顺序保存，数据为注册表原始字节（与.reg导入后的结果逐字节一致）
+ * - 快照范围之外的上级键（如HKEY_LOCAL_MACHINE）和过滤时只经过的中间键保存为占位键，导入时不创建
+ * 整数均为小端序，表按8字节对齐，读取时直接访问映射内存，不逐项复制
+ * RegSnapshot是只读的RegBackend，查询、导出和导入均可直接使用
+ * 平台无关：文件映射见reg_mmap.h
+ */
+
+#ifndef REG_SNAPSHOT_H
+#define REG_SNAPSHOT_H
+
+#include "reg_backend.h"
+#include "reg_export.h"
+#include "reg_mmap.h"
+#include "reg_parser.h"
+#include "reg_traverse.h"
+#include "reg_types.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+const char kRegSnapshotMagic[8] = {'R', 'E', 'G', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t kRegSnapshotVersion = 1;
+const uint32_t kRegSnapshotNoParent = 0xFFFFFFFFu;
+
+// 键标志：快照范围之外的上级键
+const uint32_t kRegSnapshotPlaceholder = 1;
+
+// 文件头
+struct RegSnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// 键记录
+struct RegSnapshotKey {
+    uint32_t nameOffset;        // 名称在字符串池中的偏移
+    uint32_t nameLength;
+    uint32_t parent;            // 父键序号，根键为kRegSnapshotNoParent
+    uint32_t firstChild;        // 第一个子键的序号（子键连续存放）
+    uint32_t childCount;
+    uint32_t firstValue;        // 第一个值在值表中的序号
+    uint32_t valueCount;
+    uint32_t flags;
+};
+
+// 值记录
+struct RegSnapshotValue {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t type;
+    uint32_t size;
+    uint64_t dataOffset;        // 数据在文件中的偏移
+};
+
+// 尾部目录（文件的最后64字节）
+struct RegSnapshotTrailer {
+    uint64_t stringOffset;
+    uint64_t stringSize;
+    uint64_t keyOffset;
+    uint64_t keyCount;
+    uint64_t valueOffset;
+    uint64_t valueCount;
+    uint64_t rootCount;         // 键表开头的根键数量
+    char magic[8];
+};
+
+static_assert(sizeof(RegSnapshotHeader) == 16, "snapshot header layout");
+static_assert(sizeof(RegSnapshotKey) == 32, "snapshot key layout");
+static_assert(sizeof(RegSnapshotValue) == 24, "snapshot value layout");
+static_assert(sizeof(RegSnapshotTrailer) == 64, "snapshot trailer layout");
+
+// path是否等于ancestor或位于其下（不区分大小写）
+inline bool RegPathWithin(const std::string& path, const std::string& ancestor) {
+    return path.size() >= ancestor.size() &&
+           RegEqualsIgnoreCase(path.data(), ancestor.size(), ancestor.data(), ancestor.size()) &&
+           (path.size() == ancestor.size() || path[ancestor.size()] == '\\');
+}
+
+// 快照写入器（每个键的值由遍历引擎的工作线程并行读取）
+class RegSnapshotWriter : public RegTraversalVisitor {
+public:
+    RegSnapshotWriter(RegBackend& backend, const RegOutputSink& sink, size_t bufferSize = 1024 * 1024,
+                      size_t jobs = 1)
+        : m_backend(backend), m_sink(sink), m_bufferSize(bufferSize), m_jobs(jobs), m_failed(false),
+          m_overflow(false), m_filter(NULL) {
+        m_buffer.reserve(bufferSize + 64 * 1024);
+    }
+
+    // 禁止拷贝
+    RegSnapshotWriter(const RegSnapshotWriter&) = delete;
+    RegSnapshotWriter& operator=(const RegSnapshotWriter&) = delete;
+
+    void SetProgressSink(const RegExportProgressSink& sink) { m_progress = sink; }
+
+    // 只保存过滤器选中的键和值（过滤器须在导出期间保持有效）
+    void SetFilter(const RegKeyFilter* filter) { m_filter = filter; }
+
+    // 保存一个或多个子树（重复或位于其他路径之下的路径只保存一次），失败时返回false并设置error
+    bool Export(const std::vector<std::string>& keyPaths, std::string* error) {
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < keyPaths.size(); i++) {
+            std::string path;
+            if (!NormalizeRegKeyPath(keyPaths[i], &path)) {
+                *error = "Invalid registry path format: " + keyPaths[i];
+                return false;
+            }
+            while (path.length() > 1 && path[path.length() - 1] == '\\') {
+                path.erase(path.length() - 1);
+            }
+            RegKeyHandle key = NULL;
+            long result = m_backend.OpenKey(path, &key);
+            if (result != kRegSuccess) {
+                *error = "Failed to open registry key: " + path + " (Error code: " + std::to_string(result) + ")";
+                return false;
+            }
+            m_backend.CloseKey(key);
+            paths.push_back(path);
+        }
+        std::vector<std::string> roots;
+        for (size_t i = 0; i < paths.size(); i++) {
+            bool covered = false;
+            for (size_t j = 0; j < paths.size() && !covered; j++) {
+                covered = j != i && RegPathWithin(paths[i], paths[j]) && (paths[i].size() > paths[j].size() || j < i);
+            }
+            if (!covered) {
+                roots.push_back(paths[i]);
+            }
+        }
+
+        RegSnapshotHeader header;
+        std::memcpy(header.magic, kRegSnapshotMagic, sizeof(header.magic));
+        header.version = kRegSnapshotVersion;
+        header.reserved = 0;
+        Append(&header, sizeof(header));
+
+        RegTraversal traversal(m_backend, *this, m_jobs);
+        traversal.SetFilter(m_filter);
+        traversal.Run(roots, [this](const std::string& path, int depth, RegTraversalOutput& output) {
+            if (!output.opened) {
+                return;
+            }
+            AddKey(path, depth, output);
+            if (m_buffer.size() >= m_bufferSize) {
+                Flush();
+            }
+            if (m_progress && output.selected && (m_stats.keys & 0xFFF) == 0) {
+                m_progress(m_stats.keys, Offset());
+            }
+        });
+        m_traversalStats = traversal.GetStats();
+
+        if (m_overflow || m_keys.size() >= kRegSnapshotNoParent || m_values.size() >= kRegSnapshotNoParent) {
+            *error = "Registry subtree is too large for a snapshot";
+            return false;
+        }
+        WriteTables();
+        Flush();
+        if (m_failed) {
+            *error = "Failed to write snapshot output";
+            return false;
+        }
+        return true;
+    }
+
+    const RegExportStats& GetStats() const { return m_stats; }
+    const RegTraversalStats& GetTraversalStats() const { return m_traversalStats; }
+
+    // 每个值依次写入类型、名称长度、数据长度、名称和数据
+    bool VisitKey(RegBackend& backend, RegKeyHandle key, const std::string&, int, RegTraversalContext& context,
+                  RegTraversalOutput* out) override {
+        for (uint32_t index = 0; ; index++) {
+            long result = backend.EnumValue(key, index, &context.name, &context.type, &context.data);
+            if (result == kRegErrorNoMoreItems) {
+                break;
+            }
+            if (result == kRegSuccess && context.ValueSelected()) {
+                uint32_t fields[3] = {context.type, static_cast<uint32_t>(context.name.size()),
+                                      static_cast<uint32_t>(context.data.size())};
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(fields);
+                out->data.insert(out->data.end(), bytes, bytes + sizeof(fields));
+                out->data.insert(out->data.end(), context.name.begin(), context.name.end());
+                out->data.insert(out->data.end(), context.data.begin(), context.data.end());
+                out->values++;
+            }
+        }
+        return true;
+    }
+
+    // 无法打开的子键（如权限不足）与导出一样跳过
+    void VisitError(const std::string&, int, long, RegTraversalOutput*) override {}
+
+private:
+    // 写入过程中的键（父键为写入顺序中的序号）
+    struct BuildKey {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t parent;
+        uint32_t firstValue;
+        uint32_t valueCount;
+        uint32_t flags;
+    };
+
+    size_t Offset() const { return m_stats.bytes + m_buffer.size(); }
+
+    // 记录遍历交付的键，值数据直接追加到输出；过滤器未选中的键保存为占位键
+    void AddKey(const std::string& path, int depth, const RegTraversalOutput& output) {
+        uint32_t index;
+        uint32_t flags = output.selected ? 0 : kRegSnapshotPlaceholder;
+        if (depth == 0) {
+            index = AddPath(path);
+            m_keys[index].flags |= flags;
+        } else {
+            size_t slash = path.rfind('\\');
+            index = NewKey(m_stack[depth - 1], path.data() + slash + 1, path.size() - slash - 1, flags);
+        }
+        m_stack.resize(static_cast<size_t>(depth) + 1);
+        m_stack[depth] = index;
+
+        m_keys[index].firstValue = static_cast<uint32_t>(m_values.size());
+        m_keys[index].valueCount = static_cast<uint32_t>(output.values);
+        const uint8_t* p = output.data.data();
+        const uint8_t* end = p + output.data.size();
+        while (p < end) {
+            uint32_t fields[3];
+            std::memcpy(fields, p, sizeof(fields));
+            p += sizeof(fields);
+            RegSnapshotValue value;
+            value.nameOffset = Intern(reinterpret_cast<const char*>(p), fields[1]);
+            value.nameLength = fields[1];
+            value.type = fields[0];
+            value.size = fields[2];
+            p += fields[1];
+            value.dataOffset = Offset();
+            m_buffer.insert(m_buffer.end(), p, p + fields[2]);
+            p += fields[2];
+            m_values.push_back(value);
+        }
+        m_stats.keys += output.selected ? 1 : 0;
+        m_stats.values += output.values;
+    }
+
+    // 按路径逐级查找或创建根路径上的键，上级键标记为占位键
+    uint32_t AddPath(const std::string& path) {
+        uint32_t parent = kRegSnapshotNoParent;
+        size_t start = 0;
+        while (true) {
+            size_t end = path.find('\\', start);
+            bool last = end == std::string::npos;
+            if (last) {
+                end = path.size();
+            }
+            std::string prefix = path.substr(0, end);
+            std::transform(prefix.begin(), prefix.end(), prefix.begin(), RegAsciiUpper);
+            std::unordered_map<std::string, uint32_t>::iterator it = m_pathKeys.find(prefix);
+            uint32_t index;
+            if (it == m_pathKeys.end()) {
+                index = NewKey(parent, path.data() + start, end - start, kRegSnapshotPlaceholder);
+                m_pathKeys.insert(std::make_pair(prefix, index));
+            } else {
+                index = it->second;
+            }
+            if (last) {
+                m_keys[index].flags &= ~kRegSnapshotPlaceholder;
+                return index;
+            }
+            parent = index;
+            start = end + 1;
+        }
+    }
+
+    uint32_t NewKey(uint32_t parent, const char* name, size_t length, uint32_t flags) {
+        BuildKey key;
+        key.nameOffset = Intern(name, length);
+        key.nameLength = static_cast<uint32_t>(length);
+        key.parent = parent;
+        key.firstValue = 0;
+        key.valueCount = 0;
+        key.flags = flags;
+        m_keys.push_back(key);
+        return static_cast<uint32_t>(m_keys.size() - 1);
+    }
+
+    // 名称去重后放入字符串池，返回偏移
+    uint32_t Intern(const char* text, size_t length) {
+        m_lookup.assign(text, length);
+        std::unordered_map<std::string, uint32_t>::iterator it = m_strings.find(m_lookup);
+        if (it != m_strings.end()) {
+            return it->second;
+        }
+        if (m_pool.size() + length >= 0xFFFFFFFFu) {
+            m_overflow = true;
+            return 0;
+        }
+        uint32_t offset = static_cast<uint32_t>(m_pool.size());
+        m_pool.append(text, length);
+        m_strings.insert(std::make_pair(m_lookup, offset));
+        return offset;
+    }
+
+    bool NameLess(uint32_t a, uint32_t b) const {
+        return RegCompareIgnoreCase(m_pool.data() + m_keys[a].nameOffset, m_keys[a].nameLength,
+                                    m_pool.data() + m_keys[b].nameOffset, m_keys[b].nameLength) < 0;
+    }
+
+    // 写出字符串池、层序排列的键表、值表和尾部目录
+    void WriteTables() {
+        RegSnapshotTrailer trailer;
+        AlignOutput();
+        trailer.stringOffset = Offset();
+        trailer.stringSize = m_pool.size();
+        Append(m_pool.data(), m_pool.size());
+        AlignOutput();
+
+        // 按父键分组（根键为第0组），组内按名称排序
+        size_t count = m_keys.size();
+        std::vector<uint32_t> groupStart(count + 2, 0);
+        for (size_t i = 0; i < count; i++) {
+            groupStart[GroupOf(i) + 1]++;
+        }
+        for (size_t g = 1; g < groupStart.size(); g++) {
+            groupStart[g] += groupStart[g - 1];
+        }
+        std::vector<uint32_t> grouped(count);
+        std::vector<uint32_t> fill(groupStart.begin(), groupStart.end() - 1);
+        for (size_t i = 0; i < count; i++) {
+            grouped[fill[GroupOf(i)]++] = static_cast<uint32_t>(i);
+        }
+        for (size_t g = 0; g + 1 < groupStart.size(); g++) {
+            std::sort(grouped.begin() + groupStart[g], grouped.begin() + groupStart[g + 1],
+                      [this](uint32_t a, uint32_t b) { return NameLess(a, b); });
+        }
+
+        // 层序：先放根键，再依次追加每个已放置键的子键
+        std::vector<uint32_t> order(grouped.begin(), grouped.begin() + groupStart[1]);
+        order.reserve(count);
+        std::vector<uint32_t> position(count);
+        std::vector<RegSnapshotKey> records(count);
+        for (size_t i = 0; i < order.size(); i++) {
+            uint32_t index = order[i];
+            const BuildKey& key = m_keys[index];
+            position[index] = static_cast<uint32_t>(i);
+            RegSnapshotKey& record = records[i];
+            record.nameOffset = key.nameOffset;
+            record.nameLength = key.nameLength;
+            record.parent = key.parent == kRegSnapshotNoParent ? kRegSnapshotNoParent : position[key.parent];
+            record.firstChild = static_cast<uint32_t>(order.size());
+            record.childCount = groupStart[index + 2] - groupStart[index + 1];
+            record.firstValue = key.firstValue;
+            record.valueCount = key.valueCount;
+            record.flags = key.flags;
+            order.insert(order.end(), grouped.begin() + groupStart[index + 1], grouped.begin() + groupStart[index + 2]);
+        }
+
+        trailer.keyOffset = Offset();
+        trailer.keyCount = count;
+        Append(records.data(), count * sizeof(RegSnapshotKey));
+        trailer.valueOffset = Offset();
+        trailer.valueCount = m_values.size();
+        Append(m_values.data(), m_values.size() * sizeof(RegSnapshotValue));
+        trailer.rootCount = groupStart[1];
+        std::memcpy(trailer.magic, kRegSnapshotMagic, sizeof(trailer.magic));
+        Append(&trailer, sizeof(trailer));
+    }
+
+    size_t GroupOf(size_t index) const {
+        return m_keys[index].parent == kRegSnapshotNoParent ? 0 : m_keys[index].parent + 1;
+    }
+
+    void AlignOutput() {
+        while (Offset() % 8 != 0) {
+            m_buffer.push_back(0);
+        }
+    }
+
+    // 追加大块数据时分段写出，缓冲区不超过设定大小
+    void Append(const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            size_t chunk = std::min(size, m_bufferSize);
+            m_buffer.insert(m_buffer.end(), bytes, bytes + chunk);
+            bytes += chunk;
+            size -= chunk;
+            if (m_buffer.size() >= m_bufferSize) {
+                Flush();
+            }
+        }
+    }
+
+    void Flush() {
+        if (m_buffer.empty()) {
+            return;
+        }
+        if (!m_failed && !m_sink(m_buffer.data(), m_buffer.size())) {
+            m_failed = true;
+        }
+        m_stats.bytes += m_buffer.size();
+        m_buffer.clear();
+    }
+
+    RegBackend& m_backend;
+    RegOutputSink m_sink;
+    RegExportProgressSink m_progress;
+    size_t m_bufferSize;
+    size_t m_jobs;
+    std::vector<uint8_t> m_buffer;
+    bool m_failed;
+    bool m_overflow;
+    RegExportStats m_stats;
+    const RegKeyFilter* m_filter;
+    RegTraversalStats m_traversalStats;
+
+    std::vector<BuildKey> m_keys;
+    std::vector<RegSnapshotValue> m_values;
+    std::vector<uint32_t> m_stack;                              // 各深度当前键的序号
+    std::unordered_map<std::string, uint32_t> m_pathKeys;      // 根路径上各级键（大写完整路径）
+    std::string m_pool;
+    std::unordered_map<std::string, uint32_t> m_strings;
+    std::string m_lookup;
+};
+
+// 只读快照后端（键句柄指向映射内存中的键记录）
+class RegSnapshot : public RegBackend {
+public:
+    RegSnapshot()
+        : m_data(NULL), m_strings(NULL), m_keys(NULL), m_values(NULL), m_keyCount(0),
+          m_valueCount(0), m_rootCount(0) {}
+
+    // 禁止拷贝
+    RegSnapshot(const RegSnapshot&) = delete;
+    RegSnapshot& operator=(const RegSnapshot&) = delete;
+
+    // 映射并校验快照文件，失败时返回false并设置error
+    bool Open(const std::string& path, std::string* error) {
+        m_keyCount = 0;
+        m_valueCount = 0;
+        m_rootCount = 0;
+        if (!m_file.Open(path, error)) {
+            return false;
+        }
+        if (!Attach(m_file.Data(), m_file.Size(), error)) {
+            *error += ": " + path;
+            m_file.Close();
+            return false;
+        }
+        return true;
+    }
+
+    // 使用内存中的快照（data须按8字节对齐，并在使用期间保持有效）
+    // 校验目录和每条记录的范围，之后的访问不再检查边界
+    bool Attach(const uint8_t* data, size_t size, std::string* error) {
+        RegSnapshotHeader header;
+        RegSnapshotTrailer trailer;
+        if (size < sizeof(header) + sizeof(trailer) || std::memcmp(data, kRegSnapshotMagic, 8) != 0) {
+            *error = "Not a registry snapshot";
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.version != kRegSnapshotVersion) {
+            *error = "Unsupported snapshot version " + std::to_string(header.version);
+            return false;
+        }
+        std::memcpy(&trailer, data + size - sizeof(trailer), sizeof(trailer));
+        uint64_t tableEnd = size - sizeof(trailer);
+        if (std::memcmp(trailer.magic, kRegSnapshotMagic, 8) != 0 || reinterpret_cast<uintptr_t>(data) % 8 != 0 ||
+            trailer.stringOffset < sizeof(header) || !InRange(trailer.stringOffset, trailer.stringSize, tableEnd) ||
+            trailer.keyOffset % 8 != 0 || trailer.keyCount > tableEnd / sizeof(RegSnapshotKey) ||
+            !InRange(trailer.keyOffset, trailer.keyCount * sizeof(RegSnapshotKey), tableEnd) ||
+            trailer.valueOffset % 8 != 0 || trailer.valueCount > tableEnd / sizeof(RegSnapshotValue) ||
+            !InRange(trailer.valueOffset, trailer.valueCount * sizeof(RegSnapshotValue), tableEnd) ||
+            trailer.rootCount > trailer.keyCount) {
+            *error = "Corrupt or truncated snapshot";
+            return false;
+        }
+
+        const char* strings = reinterpret_cast<const char*>(data + trailer.stringOffset);
+        const RegSnapshotKey* keys = reinterpret_cast<const RegSnapshotKey*>(data + trailer.keyOffset);
+        const RegSnapshotValue* values = reinterpret_cast<const RegSnapshotValue*>(data + trailer.valueOffset);
+        // 按层序校验：各键的子键范围依次首尾相接且位于该键之后，子键记录的父键与之对应，
+        // 保证键表是一棵树，遍历和转换时不会重复访问或成环
+        uint64_t nextChild = trailer.rootCount;
+        for (uint64_t i = 0; i < trailer.keyCount; i++) {
+            const RegSnapshotKey& key = keys[i];
+            bool root = i < trailer.rootCount;
+            bool valid = InRange(key.nameOffset, key.nameLength, trailer.stringSize) &&
+                         root == (key.parent == kRegSnapshotNoParent) && nextChild > i &&
+                         key.firstChild == nextChild && InRange(key.firstChild, key.childCount, trailer.keyCount) &&
+                         InRange(key.firstValue, key.valueCount, trailer.valueCount);
+            for (uint32_t c = 0; valid && c < key.childCount; c++) {
+                valid = keys[key.firstChild + c].parent == i;
+            }
+            if (!valid) {
+                *error = "Corrupt snapshot key table";
+                return false;
+            }
+            nextChild += key.childCount;
+        }
+        if (nextChild != trailer.keyCount) {
+            *error = "Corrupt snapshot key table";
+            return false;
+        }
+        for (uint64_t i = 0; i < trailer.valueCount; i++) {
+            const RegSnapshotValue& value = values[i];
+            if (!InRange(value.nameOffset, value.nameLength, trailer.stringSize) ||
+                value.dataOffset < sizeof(header) || !InRange(value.dataOffset, value.size, trailer.stringOffset)) {
+                *error = "Corrupt snapshot value table";
+                return false;
+            }
+        }
+
+        m_data = data;
+        m_strings = strings;
+        m_keys = keys;
+        m_values = values;
+        m_keyCount = static_cast<size_t>(trailer.keyCount);
+        m_valueCount = static_cast<size_t>(trailer.valueCount);
+        m_rootCount = static_cast<size_t>(trailer.rootCount);
+        return true;
+    }
+
+    // 键和值的总数（含占位键）
+    size_t GetKeyCount() const { return m_keyCount; }
+    size_t GetValueCount() const { return m_valueCount; }
+
+    // 按先序转换为写操作（与导入同一子树的.reg导出文件得到的操作一致），占位键不生成操作
+    void ForEachOp(const std::function<void(const RegOp&)>& callback) const {
+        RegOp op;
+        std::string path;
+        for (size_t i = 0; i < m_rootCount; i++) {
+            EmitOps(m_keys[i], &path, &op, callback);
+        }
+    }
+
+    long OpenKey(const std::string& keyPath, RegKeyHandle* key) override {
+        const RegSnapshotKey* found = Walk(keyPath);
+        if (found == NULL) {
+            return kRegErrorNotFound;
+        }
+        *key = const_cast<RegSnapshotKey*>(found);
+        return kRegSuccess;
+    }
+
+    // 快照只读：已存在的键可以打开，不能创建
+    long CreateKey(const std::string& keyPath, RegKeyHandle* key) override {
+        return OpenKey(keyPath, key) == kRegSuccess ? kRegSuccess : kRegErrorAccessDenied;
+    }
+
+    void CloseKey(RegKeyHandle) override {}
+
+    long DeleteKeyTree(const std::string&) override { return kRegErrorAccessDenied; }
+
+    // 名称长度按UTF-8字节数返回（与内存配置单元一致）
+    long QueryKeyInfo(RegKeyHandle key, RegKeyInfo* info) override {
+        const RegSnapshotKey* node = static_cast<const RegSnapshotKey*>(key);
+        *info = RegKeyInfo();
+        info->subKeyCount = node->childCount;
+        for (uint32_t i = 0; i < node->childCount; i++) {
+            info->maxSubKeyLength = std::max(info->maxSubKeyLength, m_keys[node->firstChild + i].nameLength);
+        }
+        info->valueCount = node->valueCount;
+        for (uint32_t i = 0; i < node->valueCount; i++) {
+            const RegSnapshotValue& value = m_values[node->firstValue + i];
+            info->maxValueNameLength = std::max(info->maxValueNameLength, value.nameLength);
+            info->maxValueDataSize = std::max(info->maxValueDataSize, value.size);
+        }
+        return kRegSuccess;
+    }
+
+    long EnumSubKey(RegKeyHandle key, uint32_t index, std::string* name) override {
+        const RegSnapshotKey* node = static_cast<const RegSnapshotKey*>(key);
+        if (index >= node->childCount) {
+            return kRegErrorNoMoreItems;
+        }
+        const RegSnapshotKey& child = m_keys[node->firstChild + index];
+        name->assign(m_strings + child.nameOffset, child.nameLength);
+        return kRegSuccess;
+    }
+
+    long EnumValue(RegKeyHandle key, uint32_t index, std::string* name, uint32_t* type,
+                   std::vector<uint8_t>* data) override {
+        const RegSnapshotKey* node = static_cast<const RegSnapshotKey*>(key);
+        if (index >= node->valueCount) {
+            return kRegErrorNoMoreItems;
+        }
+        const RegSnapshotValue& value = m_values[node->firstValue + index];
+        name->assign(m_strings + value.nameOffset, value.nameLength);
+        *type = value.type;
+        data->assign(m_data + value.dataOffset, m_data + value.dataOffset + value.size);
+        return kRegSuccess;
+    }
+
+    long QueryValue(RegKeyHandle key, const std::string& name, uint32_t* type, std::vector<uint8_t>* data) override {
+        const RegSnapshotKey* node = static_cast<const RegSnapshotKey*>(key);
+        for (uint32_t i = 0; i < node->valueCount; i++) {
+            const RegSnapshotValue& value = m_values[node->firstValue + i];
+            if (RegEqualsIgnoreCase(m_strings + value.nameOffset, value.nameLength, name.data(), name.size())) {
+                *type = value.type;
+                data->assign(m_data + value.dataOffset, m_data + value.dataOffset + value.size);
+                return kRegSuccess;
+            }
+        }
+        return kRegErrorNotFound;
+    }
+
+    long SetValue(RegKeyHandle, const std::string&, uint32_t, const uint8_t*, size_t) override {
+        return kRegErrorAccessDenied;
+    }
+
+    long DeleteValue(RegKeyHandle, const std::string&) override { return kRegErrorAccessDenied; }
+
+private:
+    static bool InRange(uint64_t offset, uint64_t length, uint64_t limit) {
+        return offset <= limit && length <= limit - offset;
+    }
+
+    // 在连续存放的同级键中二分查找名称
+    const RegSnapshotKey* FindChild(uint32_t first, uint32_t count, const char* name, size_t length) const {
+        while (count > 0) {
+            uint32_t step = count / 2;
+            const RegSnapshotKey& middle = m_keys[first + step];
+            int compare = RegCompareIgnoreCase(m_strings + middle.nameOffset, middle.nameLength, name, length);
+            if (compare == 0) {
+                return &middle;
+            }
+            if (compare < 0) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return NULL;
+    }
+
+    // 按路径逐段定位键（根键支持全称和简称），不分配临时字符串
+    const RegSnapshotKey* Walk(const std::string& keyPath) const {
+        size_t slash = keyPath.find('\\');
+        size_t rootLength = (slash == std::string::npos) ? keyPath.length() : slash;
+        const RegSnapshotKey* key = NULL;
+        const size_t rootCount = sizeof(kRegRootKeys) / sizeof(kRegRootKeys[0]);
+        for (size_t i = 0; i < rootCount; i++) {
+            const char* fullName = kRegRootKeys[i].fullName;
+            if (RegEqualsIgnoreCase(keyPath.data(), rootLength, fullName, std::strlen(fullName)) ||
+                RegEqualsIgnoreCase(keyPath.data(), rootLength, kRegRootKeys[i].shortName,
+                                    std::strlen(kRegRootKeys[i].shortName))) {
+                key = FindChild(0, static_cast<uint32_t>(m_rootCount), fullName, std::strlen(fullName));
+                break;
+            }
+        }
+        if (key == NULL || slash == std::string::npos) {
+            return key;
+        }
+        const char* p = keyPath.data() + slash + 1;
+        const char* end = keyPath.data() + keyPath.size();
+        while (p < end && key != NULL) {
+            const char* segmentEnd = static_cast<const char*>(std::memchr(p, '\\', static_cast<size_t>(end - p)));
+            if (segmentEnd == NULL) {
+                segmentEnd = end;
+            }
+            if (segmentEnd > p) {
+                key = FindChild(key->firstChild, key->childCount, p, static_cast<size_t>(segmentEnd - p));
+            }
+            p = segmentEnd + 1;
+        }
+        return key;
+    }
+
+    void EmitOps(const RegSnapshotKey& key, std::string* path, RegOp* op,
+                 const std::function<void(const RegOp&)>& callback) const {
+        size_t length = path->size();
+        if (!path->empty()) {
+            path->push_back('\\');
+        }
+        path->append(m_strings + key.nameOffset, key.nameLength);
+        if ((key.flags & kRegSnapshotPlaceholder) == 0) {
+            op->kind = RegOpCreateKey;
+            op->keyPath = *path;
+            op->valueName.clear();
+            op->type = kRegNone;
+            op->data.clear();
+            callback(*op);
+            op->kind = RegOpSetValue;
+            for (uint32_t i = 0; i < key.valueCount; i++) {
+                const RegSnapshotValue& value = m_values[key.firstValue + i];
+                op->valueName.assign(m_strings + value.nameOffset, value.nameLength);
+                op->type = value.type;
+                op->data.assign(m_data + value.dataOffset, m_data + value.dataOffset + value.size);
+                callback(*op);
+            }
+        }
+        for (uint32_t i = 0; i < key.childCount; i++) {
+            EmitOps(m_keys[key.firstChild + i], path, op, callback);
+        }
+        path->resize(length);
+    }
+
+    RegMappedFile m_file;
+    const uint8_t* m_data;
+    const char* m_strings;
+    const RegSnapshotKey* m_keys;
+    const RegSnapshotValue* m_values;
+    size_t m_keyCount;
+    size_t m_valueCount;
+    size_t m_rootCount;
+};
+
+// 文件是否以快照文件头开始
+inline bool IsRegSnapshotFile(const std::string& path) {
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    char magic[sizeof(kRegSnapshotMagic)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, kRegSnapshotMagic, sizeof(magic)) == 0;
+}
+
+// 把快照文件转换为操作列表（与ParseRegFileToOps的结果形式相同，可在工作线程中调用）
+inline void LoadRegSnapshotOps(const std::string& path, RegParsedFile* result) {
+    RegSnapshot snapshot;
+    if (!snapshot.Open(path, &result->error)) {
+        return;
+    }
+    std::vector<RegOp>& ops = result->ops;
+    snapshot.ForEachOp([&ops](const RegOp& op) { ops.push_back(op); });
+    result->parsed = true;
+}
+
+#endif // REG_SNAPSHOT_H
@@ -0,0 +1,212 @@
+/*
+ * 静默注册表导入程序 - 大文件分段并行解析
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 把一个很大的.reg文件（如整个配置单元的导出，可达数GB）映射到内存并切分为多段，
+ * 各段在工作线程上并行解析，调用方按文件顺序提交，结果与单线程流式解析完全相同：
+ * - 先在目标位置之后寻找行首的'['（UTF-16LE为"\n\0[\0"，ANSI/UTF-8为"\n["）作为候选分段点
+ * - 解析器只把以'\'结尾的值行与下一行合并，引号内的字符串不能跨行，
+ *   因此候选点的前一行（去掉行尾空白）不以'\'结尾时，候选行必然按节标题解析，分段点有效；
+ *   否则该行是hex续行或字符串的一部分，继续向后寻找
+ * - 文件头只在第一段中解析，其余各段以已知的编码和格式版本续接（RegFileParser::Resume）
+ * - 每段的行号从1起算，提交时加上之前各段的行数即与单线程解析的行号一致
+ * 平台无关：文件映射见reg_mmap.h
+ */
+
+#ifndef REG_SPLIT_H
+#define REG_SPLIT_H
+
+#include "reg_mmap.h"
+#include "reg_parser.h"
+#include "reg_simd.h"
+#include "reg_trace.h"
+#include "reg_types.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 默认每段字节数：段数远多于线程数，有序提交时同时解析完成等待写入的段不超过线程数的4倍，
+// 内存占用与文件大小无关
+const size_t kRegSplitSegmentSize = 4 * 1024 * 1024;
+
+// 一段在文件中的字节范围
+struct RegFileSegment {
+    size_t begin;
+    size_t end;
+
+    RegFileSegment(size_t b, size_t e) : begin(b), end(e) {}
+};
+
+// 一段的解析结果
+struct RegParsedSegment {
+    RegParsedFile file;     // 操作和警告（警告行号相对于段首）
+    size_t lines;           // 该段的物理行数
+
+    RegParsedSegment() : lines(0) {}
+};
+
+// 大文件分段器：Open映射文件并读取文件头，Split切分，ParseSegment可在多个线程上同时调用
+class RegFileSplitter {
+public:
+    RegFileSplitter() : m_encoding(RegEncodingUnknown), m_version(RegVersionUnknown), m_headerEnd(0) {}
+
+    // 禁止拷贝
+    RegFileSplitter(const RegFileSplitter&) = delete;
+    RegFileSplitter& operator=(const RegFileSplitter&) = delete;
+
+    bool Open(const std::string& path, std::string* error) {
+        m_segments.clear();
+        if (!m_file.Open(path, error)) {
+            return false;
+        }
+        DetectFormat();
+        m_segments.push_back(RegFileSegment(0, m_file.Size()));
+        return true;
+    }
+
+    // 切分为约segmentSize字节的段（在其后的第一个有效分段点切开），返回段数；文件头无效时不切分
+    size_t Split(size_t segmentSize) {
+        size_t size = m_file.Size();
+        if (segmentSize == 0) {
+            segmentSize = 1;
+        }
+        m_segments.clear();
+        size_t begin = 0;
+        while (m_version != RegVersionUnknown && size - begin > segmentSize) {
+            size_t boundary = FindBoundary(begin + segmentSize);
+            if (boundary >= size) {
+                break;
+            }
+            m_segments.push_back(RegFileSegment(begin, boundary));
+            begin = boundary;
+        }
+        m_segments.push_back(RegFileSegment(begin, size));
+        return m_segments.size();
+    }
+
+    size_t GetSegmentCount() const { return m_segments.size(); }
+    const RegFileSegment& GetSegment(size_t index) const { return m_segments[index]; }
+    size_t GetSize() const { return m_file.Size(); }
+    RegFileEncoding GetEncoding() const { return m_encoding; }
+
+    // 解析第index段（不访问全局状态，可在工作线程中调用）
+    void ParseSegment(size_t index, AnsiToUtf8Fn ansiDecoder, RegParsedSegment* result) const {
+        RegTraceSpan span("file", "ParseSegment");
+        std::vector<RegOp>& ops = result->file.ops;
+        RegFileParser parser([&ops](const RegOp& op) { ops.push_back(op); });
+        parser.SetAnsiDecoder(ansiDecoder);
+        std::vector<std::pair<size_t, std::string> >& warnings = result->file.warnings;
+        parser.SetWarningSink([&warnings](size_t line, const std::string& message) {
+            warnings.push_back(std::make_pair(line, message));
+        });
+        if (index > 0) {
+            parser.Resume(m_encoding, m_version);
+        }
+        // 按块输入，跨块的行由解析器暂存，与分块读取文件时相同
+        const size_t chunk = 1024 * 1024;
+        const char* data = reinterpret_cast<const char*>(m_file.Data());
+        const RegFileSegment& segment = m_segments[index];
+        bool ok = true;
+        for (size_t pos = segment.begin; ok && pos < segment.end; pos += chunk) {
+            ok = parser.Feed(data + pos, segment.end - pos < chunk ? segment.end - pos : chunk);
+        }
+        result->file.parsed = ok && parser.Finish();
+        if (!result->file.parsed) {
+            result->file.error = parser.GetError();
+        }
+        result->lines = parser.GetLineCount();
+    }
+
+private:
+    // 按BOM确定编码，再逐行交给探测解析器直到读完文件头
+    void DetectFormat() {
+        const uint8_t* p = m_file.Data();
+        size_t size = m_file.Size();
+        if (size >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+            m_encoding = RegEncodingUtf16Le;
+        } else if (size >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+            m_encoding = RegEncodingUtf8;
+        } else {
+            m_encoding = RegEncodingAnsi;
+        }
+        RegFileParser probe([](const RegOp&) {});
+        size_t pos = 0;
+        while (pos < size && probe.GetVersion() == RegVersionUnknown) {
+            size_t next = NextLineStart(pos);
+            if (!probe.Feed(reinterpret_cast<const char*>(p) + pos, next - pos)) {
+                break;
+            }
+            pos = next;
+        }
+        m_version = probe.GetVersion();
+        m_headerEnd = pos;
+    }
+
+    size_t UnitSize() const { return m_encoding == RegEncodingUtf16Le ? 2 : 1; }
+
+    // pos处的字符（UTF-16LE为一个16位单元）
+    unsigned CharAt(size_t pos) const {
+        const uint8_t* p = m_file.Data();
+        return m_encoding == RegEncodingUtf16Le ? (p[pos] | (p[pos + 1] << 8)) : p[pos];
+    }
+
+    // pos之后（含pos）第一个换行符的下一个位置，没有换行符时返回文件大小
+    size_t NextLineStart(size_t pos) const {
+        const uint8_t* p = m_file.Data();
+        size_t size = m_file.Size();
+        if (m_encoding == RegEncodingUtf16Le) {
+            size_t units = (size - pos) / 2;
+            size_t nl = RegFindUtf16AnyOf(p + pos, units, RegNewlineChars());
+            return nl >= units ? size : pos + (nl + 1) * 2;
+        }
+        const void* nl = std::memchr(p + pos, '\n', size - pos);
+        return nl == NULL ? size : static_cast<size_t>(static_cast<const uint8_t*>(nl) - p) + 1;
+    }
+
+    // lineStart之前的一行（去掉CR和行尾空白）是否以'\'结尾
+    bool PreviousLineContinues(size_t lineStart) const {
+        size_t unit = UnitSize();
+        size_t pos = lineStart - unit;      // 换行符
+        while (pos >= unit) {
+            pos -= unit;
+            unsigned c = CharAt(pos);
+            if (c == '\r' || c == ' ' || c == '\t') {
+                continue;
+            }
+            return c == '\\';
+        }
+        return false;
+    }
+
+    // from之后第一个有效的分段点（节标题行的行首），没有时返回文件大小
+    size_t FindBoundary(size_t from) const {
+        size_t size = m_file.Size();
+        size_t unit = UnitSize();
+        if (from < m_headerEnd) {
+            from = m_headerEnd;
+        }
+        from -= from % unit;
+        while (from < size) {
+            size_t lineStart = NextLineStart(from);
+            if (lineStart + unit > size) {
+                return size;
+            }
+            if (CharAt(lineStart) == '[' && !PreviousLineContinues(lineStart)) {
+                return lineStart;
+            }
+            from = lineStart;
+        }
+        return size;
+    }
+
+    RegMappedFile m_file;
+    RegFileEncoding m_encoding;
+    RegFileVersion m_version;
+    size_t m_headerEnd;                     // 文件头所在行之后的位置
+    std::vector<RegFileSegment> m_segments;
+};
+
+#endif // REG_SPLIT_H
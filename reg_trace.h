@@ -0,0 +1,290 @@
+/*
+ * 静默注册表导入程序 - 运行时间线
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 记录各阶段、每个输入文件和遍历的键的耗时区间（--trace），输出Chrome trace-event JSON，
+ * 可在Perfetto（ui.perfetto.dev）或chrome://tracing中打开：
+ * - 未启用时每个区间只检查一次全局记录器指针，不取时间、不复制字符串、不分配内存
+ * - 区间只引用调用方的路径字符串，结束时确定要保存才复制
+ * - 每个线程写入自己的事件缓冲区（首次记录时登记一次），记录事件不加锁
+ * - 数量巨大的区间（如遍历的每个键）按采样阈值记录：短于阈值的只计数不保存
+ * - 时间取自steady_clock，按纳秒记录，输出为微秒
+ * - 常驻运行（监视模式）可在两批之间清空记录器，内存和时间线文件只保留最近一批
+ * 平台无关：仅依赖C++11标准线程库
+ */
+
+#ifndef REG_TRACE_H
+#define REG_TRACE_H
+
+#include "reg_types.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 一个已结束的区间
+struct RegTraceEvent {
+    const char* category;   // 字符串常量
+    const char* name;       // 字符串常量
+    std::string detail;     // 文件路径、键路径等（输出为args.detail，可为空）
+    int64_t start;          // 相对记录器创建时间的纳秒数
+    int64_t duration;
+};
+
+// 时间线记录器
+class RegTracer {
+public:
+    // sampleThresholdUs：采样区间的最短记录时长（微秒）
+    explicit RegTracer(int64_t sampleThresholdUs = 100)
+        : m_id(NextId()), m_origin(std::chrono::steady_clock::now()), m_sampleThreshold(sampleThresholdUs * 1000) {}
+
+    // 禁止拷贝
+    RegTracer(const RegTracer&) = delete;
+    RegTracer& operator=(const RegTracer&) = delete;
+
+    // 相对创建时间的纳秒数
+    int64_t Now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_origin)
+            .count();
+    }
+
+    int64_t GetSampleThreshold() const { return m_sampleThreshold; }
+
+    // 记录一个区间（在任意线程中调用）；sampled为true且短于采样阈值时只计数
+    void Record(const char* category, const char* name, const std::string* detail, int64_t start, int64_t end,
+                bool sampled) {
+        ThreadBuffer* buffer = GetThreadBuffer();
+        if (sampled && end - start < m_sampleThreshold) {
+            buffer->sampledOut++;
+            return;
+        }
+        buffer->events.push_back(RegTraceEvent());
+        RegTraceEvent& event = buffer->events.back();
+        event.category = category;
+        event.name = name;
+        if (detail != NULL) {
+            event.detail = *detail;
+        }
+        event.start = start;
+        event.duration = end - start;
+    }
+
+    // 设置当前线程在时间线中显示的名称
+    void SetThreadName(const std::string& name) { GetThreadBuffer()->name = name; }
+
+    // 已记录的区间数和因短于采样阈值未保存的区间数（须在其他线程停止记录后调用）
+    size_t GetEventCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t count = 0;
+        for (size_t i = 0; i < m_buffers.size(); i++) {
+            count += m_buffers[i]->events.size();
+        }
+        return count;
+    }
+
+    size_t GetSampledOutCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t count = 0;
+        for (size_t i = 0; i < m_buffers.size(); i++) {
+            count += m_buffers[i]->sampledOut;
+        }
+        return count;
+    }
+
+    // 生成Chrome trace-event JSON（须在其他线程停止记录后调用；监视模式在两批之间调用）
+    std::string ToJson() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        size_t sampledOut = 0;
+        for (size_t b = 0; b < m_buffers.size(); b++) {
+            const ThreadBuffer& buffer = *m_buffers[b];
+            sampledOut += buffer.sampledOut;
+            AppendEventPrefix(&first, &json);
+            json += "{\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buffer.tid) +
+                    ",\"name\":\"thread_name\",\"args\":{\"name\":";
+            AppendJsonString(buffer.name, &json);
+            json += "}}";
+            AppendEventPrefix(&first, &json);
+            json += "{\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buffer.tid) +
+                    ",\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":" + std::to_string(buffer.tid) + "}}";
+            for (size_t i = 0; i < buffer.events.size(); i++) {
+                const RegTraceEvent& event = buffer.events[i];
+                AppendEventPrefix(&first, &json);
+                json += "{\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(buffer.tid) + ",\"cat\":";
+                AppendJsonString(event.category, std::strlen(event.category), &json);
+                json += ",\"name\":";
+                AppendJsonString(event.name, std::strlen(event.name), &json);
+                json += ",\"ts\":";
+                AppendMicroseconds(event.start, &json);
+                json += ",\"dur\":";
+                AppendMicroseconds(event.duration, &json);
+                if (!event.detail.empty()) {
+                    json += ",\"args\":{\"detail\":";
+                    AppendJsonString(event.detail, &json);
+                    json += "}";
+                }
+                json += "}";
+            }
+        }
+        json += "\n],\"otherData\":{\"sampleThresholdUs\":" + std::to_string(m_sampleThreshold / 1000) +
+                ",\"sampledOut\":" + std::to_string(sampledOut) + "}}\n";
+        return json;
+    }
+
+    // 清空已记录的区间和计数，注销所有线程的缓冲区（之后各线程首次记录时重新登记），
+    // 调用线程保留其名称；须在其他线程停止记录后调用
+    void Reset() {
+        std::string name = GetThreadBuffer()->name;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_buffers.clear();
+            // 更换编号使各线程缓存的缓冲区指针失效
+            m_id = NextId();
+        }
+        SetThreadName(name);
+    }
+
+    // 写入JSON文件（覆盖已有文件）
+    bool WriteFile(const std::string& path) const {
+        std::string json = ToJson();
+        std::ofstream out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(json.data(), static_cast<std::streamsize>(json.size()));
+        return static_cast<bool>(out);
+    }
+
+private:
+    struct ThreadBuffer {
+        uint32_t tid;
+        std::string name;
+        std::vector<RegTraceEvent> events;
+        size_t sampledOut;
+
+        ThreadBuffer() : tid(0), sampledOut(0) {}
+    };
+
+    // 记录器编号：线程缓存按编号识别记录器，旧记录器释放后地址被复用也不会误用
+    static uint64_t NextId() {
+        static std::atomic<uint64_t> next(1);
+        return next++;
+    }
+
+    // 当前线程的缓冲区，每个线程首次记录时加锁登记
+    ThreadBuffer* GetThreadBuffer() {
+        static thread_local uint64_t ownerId = 0;
+        static thread_local ThreadBuffer* cached = NULL;
+        if (ownerId == m_id) {
+            return cached;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        buffer->tid = static_cast<uint32_t>(m_buffers.size() + 1);
+        buffer->name = "thread " + std::to_string(buffer->tid);
+        cached = buffer.get();
+        ownerId = m_id;
+        m_buffers.push_back(std::move(buffer));
+        return cached;
+    }
+
+    static void AppendEventPrefix(bool* first, std::string* json) {
+        if (!*first) {
+            json->append(",\n");
+        }
+        *first = false;
+    }
+
+    // 纳秒转为带三位小数的微秒
+    static void AppendMicroseconds(int64_t ns, std::string* json) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%lld.%03d", static_cast<long long>(ns / 1000),
+                      static_cast<int>(ns % 1000));
+        json->append(text);
+    }
+
+    uint64_t m_id;
+    std::chrono::steady_clock::time_point m_origin;
+    int64_t m_sampleThreshold;
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+// 当前启用的记录器（NULL表示未启用）；须在工作线程启动前设置，在其结束后清除
+inline std::atomic<RegTracer*>& RegActiveTracerSlot() {
+    static std::atomic<RegTracer*> tracer(NULL);
+    return tracer;
+}
+
+inline RegTracer* RegActiveTracer() {
+    return RegActiveTracerSlot().load(std::memory_order_relaxed);
+}
+
+inline void SetRegActiveTracer(RegTracer* tracer) {
+    RegActiveTracerSlot().store(tracer, std::memory_order_relaxed);
+}
+
+// 设置当前线程的名称，index不为负时追加编号（未启用时不做任何事）
+inline void SetRegTraceThreadName(const char* name, int index = -1) {
+    RegTracer* tracer = RegActiveTracer();
+    if (tracer != NULL) {
+        tracer->SetThreadName(index < 0 ? std::string(name) : std::string(name) + " " + std::to_string(index));
+    }
+}
+
+// 作用域区间：构造时开始，析构或End时结束
+class RegTraceSpan {
+public:
+    RegTraceSpan(const char* category, const char* name) : m_tracer(RegActiveTracer()) {
+        if (m_tracer != NULL) {
+            Begin(category, name, NULL, false);
+        }
+    }
+
+    // detail须在区间结束前保持有效（不接受临时字符串）；sampled为true时短于采样阈值的区间不保存
+    RegTraceSpan(const char* category, const char* name, const std::string& detail, bool sampled = false)
+        : m_tracer(RegActiveTracer()) {
+        if (m_tracer != NULL) {
+            Begin(category, name, &detail, sampled);
+        }
+    }
+    RegTraceSpan(const char* category, const char* name, std::string&& detail, bool sampled = false) = delete;
+
+    ~RegTraceSpan() { End(); }
+
+    // 禁止拷贝
+    RegTraceSpan(const RegTraceSpan&) = delete;
+    RegTraceSpan& operator=(const RegTraceSpan&) = delete;
+
+    // 提前结束区间
+    void End() {
+        if (m_tracer != NULL) {
+            m_tracer->Record(m_category, m_name, m_detail, m_start, m_tracer->Now(), m_sampled);
+            m_tracer = NULL;
+        }
+    }
+
+private:
+    void Begin(const char* category, const char* name, const std::string* detail, bool sampled) {
+        m_category = category;
+        m_name = name;
+        m_detail = detail;
+        m_sampled = sampled;
+        m_start = m_tracer->Now();
+    }
+
+    RegTracer* m_tracer;
+    const char* m_category;
+    const char* m_name;
+    const std::string* m_detail;
+    int64_t m_start;
+    bool m_sampled;
+};
+
+#endif // REG_TRACE_H
@@ -0,0 +1,412 @@
+/*
+ * 静默注册表导入程序 - 并行子树遍历
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 查询和导出共用的遍历引擎：
+ * - 每个键是一个任务，工作线程处理键后把子键任务压入自己的双端队列，
+ *   自己从队尾取（深度优先），空闲线程从其他队列的队头窃取（较大的子树）
+ * - 每个线程自行按完整路径打开键，句柄不跨线程共享
+ * - 打开键后按QueryKeyInfo的最大名称/数据尺寸预留该线程的枚举缓冲区，
+ *   缓冲区只增不减，稳定后枚举值不再分配内存；每个键的输出先写入线程的暂存区，
+ *   完成后按实际大小复制一次，避免逐值扩容
+ * - 每个键的输出先写入该键自己的缓冲区，调用线程按先序（键、值、子键）
+ *   依次等待并交给输出回调，结果与单线程遍历逐字节一致
+ * - 多个根路径共用一个线程池，按给定顺序输出
+ * - 已处理但尚未输出的键超过上限时工作线程暂停领取任务（调用线程等待某个键时解除），
+ *   输出端较慢（如管道）时内存占用不随子树大小增长
+ * - 启用--trace时每个键记录一个采样区间（短于采样阈值的只计数）
+ * - 设置了键过滤器（reg_keyfilter.h）时，子键在创建任务前按父键的匹配状态判定：
+ *   被剪掉的子树不打开也不枚举，只为选中的键调用VisitKey，只经过的中间键仍按先序交付（selected为false）
+ * - 访问器已知子键名时（如增量查询中未变化的键）可通过context.knownSubKeys提供，引擎不再枚举子键
+ * 平台无关：仅依赖C++11标准线程库
+ */
+
+#ifndef REG_TRAVERSE_H
+#define REG_TRAVERSE_H
+
+#include "reg_backend.h"
+#include "reg_keyfilter.h"
+#include "reg_trace.h"
+#include "reg_types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 单个键的输出（由访问器在工作线程中填写）
+struct RegTraversalOutput {
+    std::vector<uint8_t> data;          // 输出字节（查询为UTF-8文本，导出为UTF-16LE）
+    std::string logs;                   // 按顺序拼接的日志消息（消息本身可含换行和NUL）
+    std::vector<size_t> logEnds;        // 每条日志消息在logs中的结束位置
+    size_t values;                      // 访问器统计的值数量
+    bool opened;                        // 键是否成功打开（由引擎设置）
+    bool selected;                      // 键是否被过滤器选中（由引擎设置，未选中的键没有访问器输出）
+
+    RegTraversalOutput() : values(0), opened(false), selected(true) {}
+
+    // 结束当前正在拼接的日志消息
+    void EndLog() { logEnds.push_back(logs.size()); }
+
+    // 清空内容，保留容量
+    void Clear() {
+        data.clear();
+        logs.clear();
+        logEnds.clear();
+        values = 0;
+        opened = false;
+        selected = true;
+    }
+};
+
+// 每个工作线程独占的临时缓冲区，在该线程处理的所有键之间复用
+struct RegTraversalContext {
+    RegKeyInfo info;                    // 当前键的计数和最大尺寸
+    std::string name;
+    uint32_t type;
+    std::vector<uint8_t> data;
+    std::string text;                   // 访问器的格式化缓冲区
+    std::string decoded;                // 访问器的数据解码缓冲区
+    RegTraversalOutput output;          // 访问器写入的暂存输出，完成后按实际大小复制到键节点
+    RegKeyFilterState state;            // 子键匹配状态的暂存区
+    const RegKeyFilter* filter;         // 键和值过滤器（由引擎设置，NULL表示不过滤）
+    // 访问器在VisitKey中可设置的当前键的子键名（按枚举顺序，须在遍历期间保持有效），
+    // 非NULL时引擎直接使用，不再调用EnumSubKey；每个键访问前由引擎清空
+    const std::vector<std::string>* knownSubKeys;
+
+    RegTraversalContext() : type(kRegNone), filter(NULL), knownSubKeys(NULL) {}
+
+    // 当前枚举到的值（name）是否输出
+    bool ValueSelected() const { return filter == NULL || filter->MatchValue(name); }
+
+    // 按键的最大尺寸预留缓冲区（UTF-16转UTF-8每单元最多3字节）
+    void Reserve(const RegKeyInfo& keyInfo) {
+        info = keyInfo;
+        size_t nameBytes = static_cast<size_t>(std::max(keyInfo.maxValueNameLength, keyInfo.maxSubKeyLength)) * 3;
+        if (name.capacity() < nameBytes) {
+            name.reserve(nameBytes);
+        }
+        if (data.capacity() < keyInfo.maxValueDataSize) {
+            data.reserve(keyInfo.maxValueDataSize);
+        }
+    }
+};
+
+// 键访问器：方法在多个工作线程中同时调用，实现不得修改共享状态
+class RegTraversalVisitor {
+public:
+    virtual ~RegTraversalVisitor() {}
+
+    // 输出已打开的键，返回false时不再遍历其子键
+    virtual bool VisitKey(RegBackend& backend, RegKeyHandle key, const std::string& path, int depth,
+                          RegTraversalContext& context, RegTraversalOutput* out) = 0;
+
+    // 键无法打开
+    virtual void VisitError(const std::string& path, int depth, long result, RegTraversalOutput* out) = 0;
+};
+
+// 输出回调：写入失败时返回false
+typedef std::function<bool(const uint8_t* data, size_t size)> RegOutputSink;
+
+// 按先序交付每个键输出的回调（在调用线程中执行）
+typedef std::function<void(const std::string& path, int depth, RegTraversalOutput& output)> RegTraversalSink;
+
+// 遍历统计
+struct RegTraversalStats {
+    size_t keys;        // 访问（打开）的键，含只经过的中间键
+    size_t pruned;      // 被过滤器剪掉、未打开的子树数
+    size_t steals;
+
+    RegTraversalStats() : keys(0), pruned(0), steals(0) {}
+};
+
+// 并行子树遍历引擎
+class RegTraversal {
+public:
+    // jobs <= 1时在调用线程中顺序遍历
+    RegTraversal(RegBackend& backend, RegTraversalVisitor& visitor, size_t jobs)
+        : m_backend(backend), m_visitor(visitor), m_jobs(jobs), m_aheadLimit(jobs * 4096), m_pending(0), m_ahead(0),
+          m_waiting(0), m_steals(0), m_pruned(0), m_filter(NULL) {}
+
+    // 禁止拷贝
+    RegTraversal(const RegTraversal&) = delete;
+    RegTraversal& operator=(const RegTraversal&) = delete;
+
+    // 设置键和值过滤器（在Run之前调用，过滤器须在遍历期间保持有效；NULL或空过滤器表示不过滤）
+    void SetFilter(const RegKeyFilter* filter) {
+        m_filter = (filter != NULL && !filter->Empty()) ? filter : NULL;
+    }
+
+    // 依次遍历所有根路径，按先序把每个键的输出交给sink
+    void Run(const std::vector<std::string>& roots, const RegTraversalSink& sink) {
+        std::vector<std::unique_ptr<Node>> rootNodes;
+        for (size_t i = 0; i < roots.size(); i++) {
+            std::unique_ptr<Node> root(new Node(roots[i], 0));
+            if (m_filter != NULL) {
+                RegKeyFilterResult result = m_filter->Start(&root->state);
+                if (result == kRegKeyPruned) {
+                    m_pruned++;
+                    continue;
+                }
+                root->selected = result == kRegKeySelected;
+            }
+            rootNodes.push_back(std::move(root));
+        }
+
+        if (m_jobs <= 1) {
+            RegTraversalContext context;
+            context.filter = m_filter;
+            for (size_t i = 0; i < rootNodes.size(); i++) {
+                EmitSequential(std::move(rootNodes[i]), context, sink);
+            }
+            m_stats.pruned = m_pruned;
+            return;
+        }
+
+        m_queues.clear();
+        for (size_t w = 0; w < m_jobs; w++) {
+            m_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+        }
+        m_pending = rootNodes.size();
+        for (size_t i = 0; i < rootNodes.size(); i++) {
+            m_queues[i % m_jobs]->items.push_back(rootNodes[i].get());
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < m_jobs; w++) {
+            workers.push_back(std::thread([this, w]() { WorkerLoop(w); }));
+        }
+        for (size_t i = 0; i < rootNodes.size(); i++) {
+            EmitOrdered(std::move(rootNodes[i]), sink);
+        }
+        for (size_t w = 0; w < workers.size(); w++) {
+            workers[w].join();
+        }
+        m_stats.steals = m_steals;
+        m_stats.pruned = m_pruned;
+    }
+
+    const RegTraversalStats& GetStats() const { return m_stats; }
+
+private:
+    struct Node {
+        std::string path;
+        int depth;
+        RegTraversalOutput output;
+        std::vector<std::unique_ptr<Node>> children;    // 按枚举顺序
+        RegKeyFilterState state;                        // 过滤器的匹配状态（不过滤时为空）
+        bool selected;
+        std::atomic<bool> done;
+
+        Node(const std::string& nodePath, int nodeDepth)
+            : path(nodePath), depth(nodeDepth), selected(true), done(false) {}
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Node*> items;
+    };
+
+    // 打开并访问一个键，为其子键创建节点
+    void Process(Node* node, RegTraversalContext& context) {
+        RegTraceSpan span("registry", "Key", node->path, true);
+        RegTraversalOutput& scratch = context.output;
+        scratch.Clear();
+        scratch.selected = node->selected;
+        RegKeyHandle key = NULL;
+        long result = m_backend.OpenKey(node->path, &key);
+        if (result != kRegSuccess) {
+            m_visitor.VisitError(node->path, node->depth, result, &scratch);
+            CopyOutput(scratch, &node->output);
+            return;
+        }
+        scratch.opened = true;
+        RegKeyInfo info;
+        m_backend.QueryKeyInfo(key, &info);
+        context.Reserve(info);
+        context.knownSubKeys = NULL;
+        bool descend = !node->selected ||
+                       m_visitor.VisitKey(m_backend, key, node->path, node->depth, context, &scratch);
+        CopyOutput(scratch, &node->output);
+        if (descend && context.knownSubKeys != NULL) {
+            const std::vector<std::string>& names = *context.knownSubKeys;
+            node->children.reserve(names.size());
+            for (size_t i = 0; i < names.size(); i++) {
+                AddChild(node, names[i], context);
+            }
+        } else if (descend) {
+            node->children.reserve(info.subKeyCount);
+            for (uint32_t index = 0; ; index++) {
+                result = m_backend.EnumSubKey(key, index, &context.name);
+                if (result == kRegErrorNoMoreItems) {
+                    break;
+                }
+                if (result == kRegSuccess) {
+                    AddChild(node, context.name, context);
+                }
+            }
+        }
+        m_backend.CloseKey(key);
+    }
+
+    // 为子键创建节点（被过滤器剪掉的子键只计数）
+    void AddChild(Node* node, const std::string& name, RegTraversalContext& context) {
+        RegKeyFilterResult match = kRegKeySelected;
+        if (m_filter != NULL) {
+            match = m_filter->Step(node->state, name, &context.state);
+            if (match == kRegKeyPruned) {
+                m_pruned++;
+                return;
+            }
+        }
+        std::unique_ptr<Node> child(new Node(std::string(), node->depth + 1));
+        child->selected = match == kRegKeySelected;
+        child->state.swap(context.state);
+        child->path.reserve(node->path.size() + 1 + name.size());
+        child->path.append(node->path);
+        if (node->path.empty() || node->path[node->path.length() - 1] != '\\') {
+            child->path += '\\';
+        }
+        child->path.append(name);
+        node->children.push_back(std::move(child));
+    }
+
+    static void CopyOutput(const RegTraversalOutput& scratch, RegTraversalOutput* output) {
+        output->data.assign(scratch.data.begin(), scratch.data.end());
+        output->logs.assign(scratch.logs);
+        output->logEnds.assign(scratch.logEnds.begin(), scratch.logEnds.end());
+        output->values = scratch.values;
+        output->opened = scratch.opened;
+        output->selected = scratch.selected;
+    }
+
+    void EmitSequential(std::unique_ptr<Node> root, RegTraversalContext& context, const RegTraversalSink& sink) {
+        std::vector<std::unique_ptr<Node>> stack;
+        stack.push_back(std::move(root));
+        while (!stack.empty()) {
+            std::unique_ptr<Node> node = std::move(stack.back());
+            stack.pop_back();
+            Process(node.get(), context);
+            sink(node->path, node->depth, node->output);
+            m_stats.keys++;
+            for (size_t i = node->children.size(); i > 0; i--) {
+                stack.push_back(std::move(node->children[i - 1]));
+            }
+        }
+    }
+
+    void EmitOrdered(std::unique_ptr<Node> root, const RegTraversalSink& sink) {
+        std::vector<std::unique_ptr<Node>> stack;
+        stack.push_back(std::move(root));
+        while (!stack.empty()) {
+            std::unique_ptr<Node> node = std::move(stack.back());
+            stack.pop_back();
+            if (!node->done.load()) {
+                std::unique_lock<std::mutex> lock(m_waitMutex);
+                m_waiting++;
+                m_doneChanged.wait(lock, [&node]() { return node->done.load(); });
+                m_waiting--;
+            }
+            sink(node->path, node->depth, node->output);
+            m_ahead--;
+            m_stats.keys++;
+            for (size_t i = node->children.size(); i > 0; i--) {
+                stack.push_back(std::move(node->children[i - 1]));
+            }
+        }
+    }
+
+    bool PopLocal(size_t worker, Node** node) {
+        WorkQueue& queue = *m_queues[worker];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.items.empty()) {
+            return false;
+        }
+        *node = queue.items.back();
+        queue.items.pop_back();
+        return true;
+    }
+
+    bool Steal(size_t worker, Node** node) {
+        for (size_t i = 1; i < m_queues.size(); i++) {
+            WorkQueue& queue = *m_queues[(worker + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.items.empty()) {
+                *node = queue.items.front();
+                queue.items.pop_front();
+                m_steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(size_t worker) {
+        SetRegTraceThreadName("traversal worker", static_cast<int>(worker));
+        RegTraversalContext context;
+        context.filter = m_filter;
+        int idle = 0;
+        while (true) {
+            Node* node = NULL;
+            // 领先输出太多时暂停，调用线程在等待时（所需的键尚未完成）不限制
+            bool throttled = m_ahead.load() >= m_aheadLimit && m_waiting.load() == 0;
+            if (!throttled && (PopLocal(worker, &node) || Steal(worker, &node))) {
+                idle = 0;
+                Process(node, context);
+                size_t childCount = node->children.size();
+                if (childCount > 0) {
+                    m_pending += childCount;
+                    WorkQueue& queue = *m_queues[worker];
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    // 逆序压入，使第一个子键最先被本线程取出
+                    for (size_t i = childCount; i > 0; i--) {
+                        queue.items.push_back(node->children[i - 1].get());
+                    }
+                }
+                // done置位后节点随时可能被调用线程释放，之后不得再访问node
+                m_ahead++;
+                node->done.store(true);
+                if (m_waiting.load() > 0) {
+                    std::lock_guard<std::mutex> lock(m_waitMutex);
+                    m_doneChanged.notify_all();
+                }
+                m_pending--;
+                continue;
+            }
+            if (m_pending.load() == 0) {
+                return;
+            }
+            if (++idle < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+    }
+
+    RegBackend& m_backend;
+    RegTraversalVisitor& m_visitor;
+    size_t m_jobs;
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    size_t m_aheadLimit;
+    std::atomic<size_t> m_pending;      // 已创建但尚未处理完的节点数
+    std::atomic<size_t> m_ahead;        // 已处理但尚未输出的节点数
+    std::atomic<int> m_waiting;
+    std::atomic<size_t> m_steals;
+    std::atomic<size_t> m_pruned;
+    const RegKeyFilter* m_filter;
+    std::mutex m_waitMutex;
+    std::condition_variable m_doneChanged;
+    RegTraversalStats m_stats;
+};
+
+#endif // REG_TRAVERSE_H
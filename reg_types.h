@@ -0,0 +1,181 @@
+/*
+ * 静默注册表导入程序 - 公共类型定义
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 平台无关：不依赖windows.h，可在Linux上单独编译测试
+ */
+
+#ifndef REG_TYPES_H
+#define REG_TYPES_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 注册表值类型（数值与Win32 REG_*常量一致）
+const uint32_t kRegNone = 0;
+const uint32_t kRegSz = 1;
+const uint32_t kRegExpandSz = 2;
+const uint32_t kRegBinary = 3;
+const uint32_t kRegDword = 4;
+const uint32_t kRegDwordBigEndian = 5;
+const uint32_t kRegLink = 6;
+const uint32_t kRegMultiSz = 7;
+const uint32_t kRegResourceList = 8;
+const uint32_t kRegFullResourceDescriptor = 9;
+const uint32_t kRegResourceRequirementsList = 10;
+const uint32_t kRegQword = 11;
+
+// 注册表写操作类型
+enum RegOpKind {
+    RegOpCreateKey,     // [key]
+    RegOpDeleteKey,     // [-key]（删除整个子树）
+    RegOpSetValue,      // "name"=data
+    RegOpDeleteValue    // "name"=-
+};
+
+// 解析器输出的单个类型化写操作
+struct RegOp {
+    RegOpKind kind;
+    std::string keyPath;        // 完整键路径（根键已规范化为全称），UTF-8
+    std::string valueName;      // 值名称，空字符串表示默认值(@)
+    uint32_t type;
+    std::vector<uint8_t> data;  // 注册表原始字节（字符串为UTF-16LE且包含结尾NUL）
+
+    RegOp() : kind(RegOpCreateKey), type(kRegNone) {}
+};
+
+// ASCII范围内的小写转换（注册表键名比较不区分大小写）
+inline char RegAsciiLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// ASCII范围内的大写转换（排序与Windows注册表一致：按大写折叠比较）
+inline char RegAsciiUpper(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// 不区分大小写比较两个字符串是否相等
+inline bool RegEqualsIgnoreCase(const char* a, size_t aLen, const char* b, size_t bLen) {
+    if (aLen != bLen) {
+        return false;
+    }
+    for (size_t i = 0; i < aLen; i++) {
+        if (RegAsciiLower(a[i]) != RegAsciiLower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 不区分大小写的字典序比较（返回负数、0或正数）
+inline int RegCompareIgnoreCase(const char* a, size_t aLen, const char* b, size_t bLen) {
+    size_t n = aLen < bLen ? aLen : bLen;
+    for (size_t i = 0; i < n; i++) {
+        unsigned char ca = static_cast<unsigned char>(RegAsciiUpper(a[i]));
+        unsigned char cb = static_cast<unsigned char>(RegAsciiUpper(b[i]));
+        if (ca != cb) {
+            return ca < cb ? -1 : 1;
+        }
+    }
+    return (aLen == bLen) ? 0 : (aLen < bLen ? -1 : 1);
+}
+
+// 不区分大小写的std::map比较器（键名和值名）
+struct RegLessIgnoreCase {
+    bool operator()(const std::string& a, const std::string& b) const {
+        return RegCompareIgnoreCase(a.data(), a.size(), b.data(), b.size()) < 0;
+    }
+};
+
+// 根键全称与简称对照表
+struct RegRootKeyName {
+    const char* fullName;
+    const char* shortName;
+};
+
+const RegRootKeyName kRegRootKeys[] = {
+    {"HKEY_LOCAL_MACHINE", "HKLM"},
+    {"HKEY_CURRENT_USER", "HKCU"},
+    {"HKEY_CLASSES_ROOT", "HKCR"},
+    {"HKEY_USERS", "HKU"},
+    {"HKEY_CURRENT_CONFIG", "HKCC"},
+};
+
+// 拆分键路径为根键全称和子路径（支持简称与全称，不区分大小写）
+inline bool SplitRegKeyPath(const std::string& path, std::string* rootName, std::string* subPath) {
+    size_t slash = path.find('\\');
+    size_t rootLen = (slash == std::string::npos) ? path.length() : slash;
+    for (size_t i = 0; i < sizeof(kRegRootKeys) / sizeof(kRegRootKeys[0]); i++) {
+        const RegRootKeyName& root = kRegRootKeys[i];
+        if (RegEqualsIgnoreCase(path.c_str(), rootLen, root.fullName, std::strlen(root.fullName)) ||
+            RegEqualsIgnoreCase(path.c_str(), rootLen, root.shortName, std::strlen(root.shortName))) {
+            if (rootName != NULL) {
+                *rootName = root.fullName;
+            }
+            if (subPath != NULL) {
+                *subPath = (slash == std::string::npos) ? std::string() : path.substr(slash + 1);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// 将键路径的根键规范化为全称
+inline bool NormalizeRegKeyPath(const std::string& path, std::string* normalized) {
+    std::string rootName;
+    std::string subPath;
+    if (!SplitRegKeyPath(path, &rootName, &subPath)) {
+        return false;
+    }
+    *normalized = subPath.empty() ? rootName : rootName + "\\" + subPath;
+    return true;
+}
+
+// 把键路径的根键替换为root（root可以带子路径，如 HKEY_USERS\.DEFAULT），结果写入out
+inline void ReplaceRegKeyRoot(const std::string& keyPath, const std::string& root, std::string* out) {
+    size_t slash = keyPath.find('\\');
+    out->assign(root);
+    if (slash != std::string::npos) {
+        out->append(keyPath, slash, std::string::npos);
+    }
+}
+
+// 追加JSON字符串（含引号），转义引号、反斜杠和控制字符
+inline void AppendJsonString(const char* text, size_t length, std::string* out) {
+    static const char digits[] = "0123456789abcdef";
+    out->push_back('"');
+    size_t start = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out->append(text + start, i - start);
+        start = i + 1;
+        switch (c) {
+            case '"': out->append("\\\""); break;
+            case '\\': out->append("\\\\"); break;
+            case '\n': out->append("\\n"); break;
+            case '\r': out->append("\\r"); break;
+            case '\t': out->append("\\t"); break;
+            default: {
+                char escaped[6] = {'\\', 'u', '0', '0', digits[c >> 4], digits[c & 0x0F]};
+                out->append(escaped, 6);
+                break;
+            }
+        }
+    }
+    out->append(text + start, length - start);
+    out->push_back('"');
+}
+
+inline void AppendJsonString(const std::string& text, std::string* out) {
+    AppendJsonString(text.data(), text.size(), out);
+}
+
+#endif // REG_TYPES_H
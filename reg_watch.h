@@ -0,0 +1,353 @@
+/*
+ * 静默注册表导入程序 - 目录监视
+ * 作者: Mison
+ * 联系方式: 1360962086@qq.com
+ * 许可证: MIT License
+ *
+ * 常驻监视一个目录，新放入或被修改的文件在写入停止后分批交给调用方导入：
+ * - RegDirectoryWatcher等待目录变化通知：Windows使用ReadDirectoryChangesW（重叠I/O），
+ *   其他平台使用inotify；通知丢失（缓冲区溢出）时报告overflow，由调用方重新扫描目录
+ * - RegWatchQueue按文件名合并事件并去抖：目录静默满去抖间隔后，待处理的文件按名称排序整批取出
+ * - RegWatchStats统计事件数、批次数、导入成功/失败数、队列深度和从放入到导入完成的延迟
+ * 队列和统计平台无关，时间由调用方传入
+ */
+
+#ifndef REG_WATCH_H
+#define REG_WATCH_H
+
+#include "reg_fs.h"
+#include "reg_types.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+typedef std::chrono::steady_clock::time_point RegWatchTime;
+
+// 是否为需要导入的文件（.reg或.regpack，不区分大小写）
+inline bool IsRegWatchCandidate(const std::string& name) {
+    const char* const extensions[] = {".reg", ".regpack"};
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        size_t length = std::strlen(extensions[i]);
+        if (name.size() > length &&
+            RegEqualsIgnoreCase(name.data() + name.size() - length, length, extensions[i], length)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 目录变化通知（不含子目录）
+class RegDirectoryWatcher {
+public:
+#ifdef _WIN32
+    RegDirectoryWatcher() : m_handle(INVALID_HANDLE_VALUE), m_event(NULL), m_buffer(16384) {
+        std::memset(&m_overlapped, 0, sizeof(m_overlapped));
+    }
+#else
+    RegDirectoryWatcher() : m_fd(-1), m_buffer(65536) {}
+#endif
+    ~RegDirectoryWatcher() { Close(); }
+
+    // 禁止拷贝
+    RegDirectoryWatcher(const RegDirectoryWatcher&) = delete;
+    RegDirectoryWatcher& operator=(const RegDirectoryWatcher&) = delete;
+
+    // 开始监视目录，失败时返回false并设置error
+    bool Open(const std::string& directory, std::string* error) {
+        Close();
+        m_directory = directory;
+#ifdef _WIN32
+        m_handle = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                               FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+        if (m_handle == INVALID_HANDLE_VALUE) {
+            *error = "Cannot open directory: " + directory;
+            return false;
+        }
+        m_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+        // 读取完成时由系统置位m_event，Wait在其上等待
+        std::memset(&m_overlapped, 0, sizeof(m_overlapped));
+        m_overlapped.hEvent = m_event;
+        if (m_event == NULL || !Issue()) {
+            *error = "Cannot watch directory: " + directory;
+            Close();
+            return false;
+        }
+#else
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd < 0 ||
+            inotify_add_watch(m_fd, directory.c_str(), IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            *error = "Cannot watch directory: " + directory;
+            Close();
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (m_handle != INVALID_HANDLE_VALUE) {
+            // 取消未完成的读取并等待其结束，之后缓冲区不再被写入
+            DWORD bytes = 0;
+            CancelIo(m_handle);
+            GetOverlappedResult(m_handle, &m_overlapped, &bytes, TRUE);
+            CloseHandle(m_handle);
+            m_handle = INVALID_HANDLE_VALUE;
+        }
+        if (m_event != NULL) {
+            CloseHandle(m_event);
+            m_event = NULL;
+        }
+#else
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+#endif
+    }
+
+    const std::string& GetDirectory() const { return m_directory; }
+
+    // 等待目录变化，最多timeoutMs毫秒；names追加新建、修改或重命名得到的文件名（不含目录），
+    // 通知丢失时overflow为true（调用方应重新扫描目录），出错时返回false
+    bool Wait(unsigned timeoutMs, std::vector<std::string>* names, bool* overflow) {
+        *overflow = false;
+#ifdef _WIN32
+        DWORD result = WaitForSingleObject(m_event, timeoutMs);
+        if (result == WAIT_TIMEOUT) {
+            return true;
+        }
+        DWORD bytes = 0;
+        if (result != WAIT_OBJECT_0 || !GetOverlappedResult(m_handle, &m_overlapped, &bytes, FALSE)) {
+            return false;
+        }
+        if (bytes == 0) {
+            *overflow = true;
+        }
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(m_buffer.data());
+        while (bytes > 0) {
+            const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+            if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED ||
+                info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                int wideLength = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+                int length = WideCharToMultiByte(CP_ACP, 0, info->FileName, wideLength, NULL, 0, NULL, NULL);
+                std::string name(static_cast<size_t>(length), '\0');
+                WideCharToMultiByte(CP_ACP, 0, info->FileName, wideLength, &name[0], length, NULL, NULL);
+                names->push_back(name);
+            }
+            if (info->NextEntryOffset == 0) {
+                break;
+            }
+            p += info->NextEntryOffset;
+        }
+        return Issue();
+#else
+        struct pollfd descriptor;
+        descriptor.fd = m_fd;
+        descriptor.events = POLLIN;
+        descriptor.revents = 0;
+        int ready = ::poll(&descriptor, 1, static_cast<int>(timeoutMs));
+        if (ready <= 0) {
+            return ready == 0;
+        }
+        for (;;) {
+            ssize_t bytes = ::read(m_fd, m_buffer.data(), m_buffer.size());
+            if (bytes <= 0) {
+                break;
+            }
+            size_t offset = 0;
+            while (offset + sizeof(struct inotify_event) <= static_cast<size_t>(bytes)) {
+                struct inotify_event event;
+                std::memcpy(&event, m_buffer.data() + offset, sizeof(event));
+                if (event.mask & IN_Q_OVERFLOW) {
+                    *overflow = true;
+                } else if (event.len > 0 && (event.mask & IN_ISDIR) == 0) {
+                    names->push_back(std::string(m_buffer.data() + offset + sizeof(event)));
+                }
+                offset += sizeof(event) + event.len;
+            }
+        }
+        return true;
+#endif
+    }
+
+    // 列出目录中的全部文件名（启动时和通知丢失后重新扫描）
+    bool List(std::vector<std::string>* names) const {
+        std::vector<RegDirEntry> entries;
+        if (!RegListDirectory(m_directory, &entries)) {
+            return false;
+        }
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!entries[i].directory) {
+                names->push_back(entries[i].name);
+            }
+        }
+        return true;
+    }
+
+private:
+#ifdef _WIN32
+    // 发起下一次异步读取
+    bool Issue() {
+        ResetEvent(m_event);
+        return ReadDirectoryChangesW(m_handle, m_buffer.data(), static_cast<DWORD>(m_buffer.size() * sizeof(DWORD)),
+                                     FALSE,
+                                     FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                         FILE_NOTIFY_CHANGE_SIZE,
+                                     NULL, &m_overlapped, NULL) != 0;
+    }
+
+    HANDLE m_handle;
+    HANDLE m_event;
+    OVERLAPPED m_overlapped;
+    std::vector<DWORD> m_buffer;    // 通知记录按DWORD对齐
+#else
+    int m_fd;
+    std::vector<char> m_buffer;
+#endif
+    std::string m_directory;
+};
+
+// 按文件名去抖的待导入队列
+// 目录静默满去抖间隔后整批取出（一次放入的多个文件合为一批）；持续有文件放入时，
+// 最早的文件等待超过10倍去抖间隔后取出各自已静默的文件，避免一直不导入
+class RegWatchQueue {
+public:
+    explicit RegWatchQueue(std::chrono::milliseconds debounce) : m_debounce(debounce), m_maxDelay(debounce * 10) {}
+
+    // 记录一次文件变化
+    void Touch(const std::string& name, RegWatchTime now) {
+        std::map<std::string, Pending>::iterator it = m_pending.find(name);
+        if (it == m_pending.end()) {
+            Pending pending;
+            pending.first = now;
+            pending.last = now;
+            m_pending[name] = pending;
+        } else {
+            it->second.last = now;
+        }
+        m_lastEvent = now;
+    }
+
+    // 取出就绪的文件（按名称排序），firstSeen返回各文件第一次变化的时间
+    void TakeReady(RegWatchTime now, std::vector<std::string>* names, std::vector<RegWatchTime>* firstSeen) {
+        if (m_pending.empty()) {
+            return;
+        }
+        bool quiet = now - m_lastEvent >= m_debounce;
+        if (!quiet && now - OldestFirst() < m_maxDelay) {
+            return;
+        }
+        std::map<std::string, Pending>::iterator it = m_pending.begin();
+        while (it != m_pending.end()) {
+            if (quiet || now - it->second.last >= m_debounce) {
+                names->push_back(it->first);
+                firstSeen->push_back(it->second.first);
+                it = m_pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // 到下一次可能有文件就绪还需等待的时间，没有待处理文件时返回idle
+    std::chrono::milliseconds NextWait(RegWatchTime now, std::chrono::milliseconds idle) const {
+        if (m_pending.empty()) {
+            return idle;
+        }
+        RegWatchTime due = m_lastEvent + m_debounce;
+        RegWatchTime overdue = OldestFirst() + m_maxDelay;
+        if (overdue < due) {
+            // 已超过最长等待：等到最早静默的文件就绪
+            due = std::max(overdue, OldestLast() + m_debounce);
+        }
+        if (due <= now) {
+            return std::chrono::milliseconds(0);
+        }
+        std::chrono::milliseconds wait =
+            std::chrono::duration_cast<std::chrono::milliseconds>(due - now) + std::chrono::milliseconds(1);
+        return std::min(wait, idle);
+    }
+
+    size_t Size() const { return m_pending.size(); }
+
+private:
+    struct Pending {
+        RegWatchTime first;     // 第一次变化（计算放入到导入的延迟）
+        RegWatchTime last;      // 最后一次变化（去抖）
+    };
+
+    RegWatchTime OldestFirst() const {
+        RegWatchTime oldest = m_lastEvent;
+        for (std::map<std::string, Pending>::const_iterator it = m_pending.begin(); it != m_pending.end(); ++it) {
+            oldest = std::min(oldest, it->second.first);
+        }
+        return oldest;
+    }
+
+    RegWatchTime OldestLast() const {
+        RegWatchTime oldest = m_lastEvent;
+        for (std::map<std::string, Pending>::const_iterator it = m_pending.begin(); it != m_pending.end(); ++it) {
+            oldest = std::min(oldest, it->second.last);
+        }
+        return oldest;
+    }
+
+    std::chrono::milliseconds m_debounce;
+    std::chrono::milliseconds m_maxDelay;
+    RegWatchTime m_lastEvent;
+    std::map<std::string, Pending> m_pending;
+};
+
+// 监视统计
+struct RegWatchStats {
+    size_t events;          // 收到的文件变化通知
+    size_t rescans;         // 通知丢失后的目录重新扫描
+    size_t batches;         // 导入批次
+    size_t filesApplied;    // 导入成功（含内容未变而跳过）的文件
+    size_t filesFailed;
+    size_t queueDepth;      // 当前等待去抖的文件数
+    size_t maxQueueDepth;
+    double totalLatencyMs;  // 从第一次变化到所在批次导入完成
+    double maxLatencyMs;
+
+    RegWatchStats() : events(0), rescans(0), batches(0), filesApplied(0), filesFailed(0), queueDepth(0),
+                      maxQueueDepth(0), totalLatencyMs(0), maxLatencyMs(0) {}
+
+    void UpdateQueueDepth(size_t depth) {
+        queueDepth = depth;
+        maxQueueDepth = std::max(maxQueueDepth, depth);
+    }
+
+    // 记录一个批次的结果（done为批次导入完成的时间）
+    void AddBatch(size_t applied, size_t failed, const std::vector<RegWatchTime>& firstSeen, RegWatchTime done) {
+        batches++;
+        filesApplied += applied;
+        filesFailed += failed;
+        for (size_t i = 0; i < firstSeen.size(); i++) {
+            double latency = std::chrono::duration<double, std::milli>(done - firstSeen[i]).count();
+            totalLatencyMs += latency;
+            maxLatencyMs = std::max(maxLatencyMs, latency);
+        }
+    }
+
+    double AverageLatencyMs() const {
+        size_t files = filesApplied + filesFailed;
+        return files == 0 ? 0 : totalLatencyMs / static_cast<double>(files);
+    }
+};
+
+#endif // REG_WATCH_H